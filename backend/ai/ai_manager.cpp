@@ -1,6 +1,8 @@
 #include "ai_manager.h"
+#include "metrics/memory_accounting.h"
 #include <QDebug>
 #include <QRegularExpression>
+#include <memory>
 
 AIManager::AIManager(QObject *parent) : QObject(parent)
 {
@@ -22,7 +24,7 @@ AIManager::AIManager(QObject *parent) : QObject(parent)
     if (ok && maxTok > 0) m_maxTokens = maxTok;
 }
 
-void AIManager::sendMessage(const QString& message, const QString& context)
+void AIManager::sendMessage(const QString& message, const QString& context, ReplyCallback done)
 {
     QUrl url(m_apiUrl);
     QNetworkRequest request(url);
@@ -71,13 +73,16 @@ void AIManager::sendMessage(const QString& message, const QString& context)
     
     QByteArray data = QJsonDocument(json).toJson();
     
+    // 请求体与应答体记入 ai_gateway，回调随 reply 销毁时撤销
+    auto memory = std::make_shared<MemoryCharge>(MemoryTag::AiGateway, heapBytes(data), true);
     QNetworkReply *reply = m_networkManager->post(request, data);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        onReplyFinished(reply);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, done, memory]() {
+        memory->resize(memory->bytes() + reply->bytesAvailable());
+        onReplyFinished(reply, done);
     });
 }
 
-void AIManager::onReplyFinished(QNetworkReply *reply)
+void AIManager::onReplyFinished(QNetworkReply *reply, const ReplyCallback& done)
 {
     const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
     const QByteArray responseData = reply->readAll();
@@ -96,11 +101,15 @@ void AIManager::onReplyFinished(QNetworkReply *reply)
                     static QRegularExpression thinkRegex("<think>.*?</think>", QRegularExpression::DotMatchesEverythingOption);
                     content.remove(thinkRegex);
                     
-                    emit responseReceived(content.trimmed());
+                    done(true, content.trimmed());
+                } else {
+                    done(false, "无法解析服务器响应");
                 }
+            } else {
+                done(false, "无法解析服务器响应");
             }
         } else {
-            emit errorOccurred("无法解析服务器响应");
+            done(false, "无法解析服务器响应");
         }
     } else {
         QString serverMsg;
@@ -111,7 +120,7 @@ void AIManager::onReplyFinished(QNetworkReply *reply)
         if (!serverMsg.isEmpty()) {
             friendly += QString(" | 服务端返回: %1").arg(serverMsg.trimmed());
         }
-        emit errorOccurred(friendly);
+        done(false, friendly);
     }
     
     reply->deleteLater();
@@ -8,20 +8,21 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QProcessEnvironment>
+#include <functional>
 
 class AIManager : public QObject
 {
     Q_OBJECT
 public:
-    explicit AIManager(QObject *parent = nullptr);
-    void sendMessage(const QString& message, const QString& context = "");
+    // 单次请求的结果回调，在 AIManager 所在线程调用；success 为 false 时 text 为错误描述
+    using ReplyCallback = std::function<void(bool success, const QString& text)>;
 
-signals:
-    void responseReceived(const QString& response);
-    void errorOccurred(const QString& error);
+    explicit AIManager(QObject *parent = nullptr);
+    // 多个连接可共享同一实例，结果按请求回调而不是广播信号
+    void sendMessage(const QString& message, const QString& context, ReplyCallback done);
 
-private slots:
-    void onReplyFinished(QNetworkReply *reply);
+private:
+    void onReplyFinished(QNetworkReply *reply, const ReplyCallback& done);
 
 private:
     QNetworkAccessManager *m_networkManager;
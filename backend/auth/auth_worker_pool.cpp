@@ -0,0 +1,44 @@
+#include "auth_worker_pool.h"
+#include "log/logger.h"
+#include "metrics/metrics.h"
+#include <QThread>
+
+namespace {
+LogCategory logAuth("auth");
+}
+
+AuthWorkerPool* AuthWorkerPool::m_instance = nullptr;
+
+AuthWorkerPool* AuthWorkerPool::getInstance() {
+    if (!m_instance) {
+        m_instance = new AuthWorkerPool();
+    }
+    return m_instance;
+}
+
+AuthWorkerPool::AuthWorkerPool() {
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+    // 线程不过期：数据库连接按线程缓存，线程反复创建会泄漏连接
+    m_pool.setExpiryTimeout(-1);
+
+    Metrics::getInstance()->gauge("ftms_queue_depth", "各工作队列中已提交未完成的任务数", "queue=\"auth\"",
+                                  [this]() { return double(m_pending.load()); });
+}
+
+void AuthWorkerPool::configure(int threadCount, int queueLimit) {
+    if (threadCount > 0) m_pool.setMaxThreadCount(threadCount);
+    if (queueLimit > 0) m_queueLimit = queueLimit;
+}
+
+bool AuthWorkerPool::submit(std::function<void()> task) {
+    if (m_pending.fetch_add(1) >= m_queueLimit) {
+        m_pending.fetch_sub(1);
+        logInfo(logAuth, "认证队列已满，拒绝请求，排队数：{}", m_queueLimit);
+        return false;
+    }
+    m_pool.start([this, task = std::move(task)]() {
+        task();
+        m_pending.fetch_sub(1);
+    });
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef AUTH_WORKER_POOL_H
+#define AUTH_WORKER_POOL_H
+
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+
+// 认证专用线程池：登录、注册、改密中的口令哈希在这里执行，不占用网络 I/O 线程。
+// 线程数与排队上限固定，登录高峰时超出上限的请求直接拒绝（ServerBusy），
+// 避免排队无限增长拖垮整个服务
+class AuthWorkerPool {
+public:
+    static AuthWorkerPool* getInstance();
+
+    // FTMS_AUTH_THREADS / FTMS_AUTH_QUEUE 可覆盖默认配置，需在首次 submit 前调用
+    void configure(int threadCount, int queueLimit);
+
+    // 提交任务，队列已满时返回 false 且不执行。任务内可直接使用 DBManager，
+    // 工作线程常驻，各自持有一个数据库连接
+    bool submit(std::function<void()> task);
+
+    int pending() const { return m_pending.load(); }
+    int threadCount() const { return m_pool.maxThreadCount(); }
+    int queueLimit() const { return m_queueLimit; }
+
+private:
+    AuthWorkerPool();
+    AuthWorkerPool(const AuthWorkerPool&) = delete;
+    AuthWorkerPool& operator=(const AuthWorkerPool&) = delete;
+
+    QThreadPool m_pool;
+    int m_queueLimit = 256;
+    // 已提交未完成的任务数（含正在执行的）
+    std::atomic<int> m_pending{0};
+    static AuthWorkerPool* m_instance;
+};
+
+#endif // AUTH_WORKER_POOL_H
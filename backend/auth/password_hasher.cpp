@@ -0,0 +1,85 @@
+#include "password_hasher.h"
+#include <QCryptographicHash>
+#include <QPasswordDigestor>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+#include <QStringList>
+
+namespace {
+const QString kScheme = QStringLiteral("pbkdf2_sha256");
+constexpr int kSaltBytes = 16;
+constexpr int kKeyBytes = 32;
+constexpr int kDefaultIterations = 60000;
+constexpr int kMinIterations = 1000;
+
+// FTMS_PBKDF2_ITERATIONS 调整迭代次数；调高后旧哈希会在下次登录时自动升级
+int configuredIterations() {
+    static const int iterations = [] {
+        bool ok = false;
+        const int value = QProcessEnvironment::systemEnvironment()
+                              .value("FTMS_PBKDF2_ITERATIONS").trimmed().toInt(&ok);
+        return ok ? qMax(kMinIterations, value) : kDefaultIterations;
+    }();
+    return iterations;
+}
+
+QByteArray derive(const QString& password, const QByteArray& salt, int iterations) {
+    return QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256,
+                                              password.toUtf8(), salt, iterations, kKeyBytes);
+}
+}
+
+namespace PasswordHasher {
+
+QString hash(const QString& password) {
+    QByteArray salt(kSaltBytes, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(salt.data()), kSaltBytes / sizeof(quint32));
+
+    const int iterations = configuredIterations();
+    return QStringList{kScheme,
+                       QString::number(iterations),
+                       QString::fromLatin1(salt.toBase64()),
+                       QString::fromLatin1(derive(password, salt, iterations).toBase64())}
+        .join('$');
+}
+
+bool isHashed(const QString& stored) {
+    const QStringList parts = stored.split('$');
+    return parts.size() == 4 && parts[0] == kScheme;
+}
+
+bool verify(const QString& password, const QString& stored, bool* needsRehash) {
+    if (needsRehash) *needsRehash = false;
+
+    const QStringList parts = stored.split('$');
+    if (parts.size() != 4 || parts[0] != kScheme) {
+        // 旧版明文行：比较通过后由调用方升级为哈希
+        const bool ok = constantTimeEquals(password.toUtf8(), stored.toUtf8());
+        if (needsRehash) *needsRehash = ok;
+        return ok;
+    }
+
+    bool ok = false;
+    const int iterations = parts[1].toInt(&ok);
+    if (!ok || iterations <= 0) return false;
+    const QByteArray salt = QByteArray::fromBase64(parts[2].toLatin1());
+    const QByteArray expected = QByteArray::fromBase64(parts[3].toLatin1());
+
+    const bool match = constantTimeEquals(derive(password, salt, iterations), expected);
+    if (match && needsRehash) *needsRehash = iterations < configuredIterations();
+    return match;
+}
+
+bool constantTimeEquals(const QByteArray& a, const QByteArray& b) {
+    // 长度不同仍完整遍历较长的一方，使耗时不随前缀匹配程度变化
+    const qsizetype n = qMax(a.size(), b.size());
+    quint8 diff = quint8(a.size() != b.size());
+    for (qsizetype i = 0; i < n; ++i) {
+        const quint8 x = i < a.size() ? quint8(a[i]) : 0;
+        const quint8 y = i < b.size() ? quint8(b[i]) : 0;
+        diff |= x ^ y;
+    }
+    return diff == 0;
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include <QByteArray>
+#include <QString>
+
+// 加盐口令哈希（PBKDF2-HMAC-SHA256）。存储格式：
+//   pbkdf2_sha256$<迭代次数>$<盐 base64>$<摘要 base64>
+// 计算耗时数十毫秒，只应在认证线程池（AuthWorkerPool）中调用
+namespace PasswordHasher {
+
+// 为明文口令生成带随机盐的存储串
+QString hash(const QString& password);
+
+// 校验口令，比较为常量时间。stored 为旧版明文行或迭代次数低于当前配置时
+// 通过 needsRehash 返回 true，调用方应在验证成功后写回新哈希
+bool verify(const QString& password, const QString& stored, bool* needsRehash = nullptr);
+
+// stored 是否已是本格式的哈希（否则为旧版明文行）
+bool isHashed(const QString& stored);
+
+// 常量时间比较，耗时只与长度有关，避免通过响应时间逐字节猜测
+bool constantTimeEquals(const QByteArray& a, const QByteArray& b);
+
+}
+
+#endif // PASSWORD_HASHER_H
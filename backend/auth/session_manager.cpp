@@ -0,0 +1,149 @@
+#include "session_manager.h"
+#include "db/db_manager.h"
+#include "log/logger.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+
+SessionManager* SessionManager::m_instance = nullptr;
+
+namespace {
+LogCategory logSession("session");
+}
+
+SessionManager* SessionManager::getInstance() {
+    if (!m_instance) {
+        m_instance = new SessionManager();
+    }
+    return m_instance;
+}
+
+void SessionManager::setTtl(int seconds) {
+    m_ttl = qMax(60, seconds);
+}
+
+quint64 SessionManager::create(qint64 userId, const QString& username) {
+    Session session;
+    session.userId = userId;
+    session.username = username;
+    session.lastSeen = QDateTime::currentSecsSinceEpoch();
+    session.sharedAt = session.lastSeen;
+
+    while (true) {
+        const quint64 token = QRandomGenerator::system()->generate64();
+        if (token == 0) continue;  // 0 表示"未登录"
+
+        {
+            Shard& shard = shardFor(token);
+            QMutexLocker locker(&shard.mutex);
+            if (shard.sessions.contains(token)) continue;
+        }
+        // 写进程不可达时会话只在本进程有效，断线重连到其他进程需重新登录
+        if (m_shared && !DBManager::getInstance()->saveSession(token, userId, session.lastSeen)) {
+            logWarning(logSession, "会话未能写入共享会话表，只在本进程有效：用户 {}", username);
+        }
+        Shard& shard = shardFor(token);
+        QMutexLocker locker(&shard.mutex);
+        shard.sessions.insert(token, session);
+        return token;
+    }
+}
+
+// 在库中查找其他进程签发的会话，找到后放入本进程并续期
+bool SessionManager::loadShared(quint64 token, qint64 now, Session* session) {
+    Session loaded;
+    if (!DBManager::getInstance()->loadSession(token, &loaded.userId, &loaded.username, &loaded.lastSeen)) {
+        return false;
+    }
+    if (loaded.lastSeen + m_ttl < now) return false;
+    DBManager::getInstance()->touchSession(token, now);
+    loaded.lastSeen = now;
+    loaded.sharedAt = now;
+    {
+        Shard& shard = shardFor(token);
+        QMutexLocker locker(&shard.mutex);
+        shard.sessions.insert(token, loaded);
+    }
+    if (session) *session = loaded;
+    return true;
+}
+
+bool SessionManager::resolve(quint64 token, Session* session) {
+    if (token == 0) return false;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    bool touch = false;
+    {
+        Shard& shard = shardFor(token);
+        QMutexLocker locker(&shard.mutex);
+        auto it = shard.sessions.find(token);
+        if (it == shard.sessions.end()) {
+            locker.unlock();
+            return m_shared && loadShared(token, now, session);
+        }
+        if (it->lastSeen + m_ttl < now) {
+            shard.sessions.erase(it);
+            return false;
+        }
+        it->lastSeen = now;
+        touch = m_shared && now - it->sharedAt >= m_ttl / 4;
+        if (touch) it->sharedAt = now;
+        if (session) *session = *it;
+    }
+    // 续期在锁外经写进程执行。库中已没有该会话时不补写：可能是改密刚删除、通知尚未到达
+    if (touch) DBManager::getInstance()->touchSession(token, now);
+    return true;
+}
+
+void SessionManager::remove(quint64 token) {
+    {
+        Shard& shard = shardFor(token);
+        QMutexLocker locker(&shard.mutex);
+        shard.sessions.remove(token);
+    }
+    if (m_shared) DBManager::getInstance()->removeSession(token);
+}
+
+int SessionManager::removeUser(qint64 userId) {
+    int removed = 0;
+    for (Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        removed += shard.sessions.removeIf([userId](const QHash<quint64, Session>::iterator& it) {
+            return it->userId == userId;
+        });
+    }
+    return removed;
+}
+
+int SessionManager::removeUsername(const QString& username) {
+    int removed = 0;
+    for (Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        removed += shard.sessions.removeIf([&username](const QHash<quint64, Session>::iterator& it) {
+            return it->username == username;
+        });
+    }
+    return removed;
+}
+
+// 逐个分片整体扫描，每个分片只加锁一次
+int SessionManager::expireSessions() {
+    const qint64 deadline = QDateTime::currentSecsSinceEpoch() - m_ttl;
+    int removed = 0;
+    for (Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        removed += shard.sessions.removeIf([deadline](const QHash<quint64, Session>::iterator& it) {
+            return it->lastSeen < deadline;
+        });
+    }
+    return removed;
+}
+
+int SessionManager::size() {
+    int total = 0;
+    for (Shard& shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        total += shard.sessions.size();
+    }
+    return total;
+}
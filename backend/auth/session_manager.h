@@ -0,0 +1,62 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include <QHash>
+#include <QString>
+
+#include "metrics/profiled_mutex.h"
+
+// 已登录会话：登录后由令牌直接定位用户，后续请求不再携带用户名
+struct Session {
+    qint64 userId = 0;      // user 表 rowid
+    QString username;
+    qint64 lastSeen = 0;    // 最近一次使用（秒级时间戳），用于滑动过期
+    qint64 sharedAt = 0;    // 共享模式下最近一次在库中续期的时间
+};
+
+// 进程内会话表：64 位随机令牌 -> 会话，按令牌低位分片加锁，查找为 O(1)。
+// 会话与连接解耦，客户端断线重连后凭令牌直接恢复，无需重新登录。
+// 多进程模式的工作进程开启共享：会话同时写入库中的 session 表（经写进程），本进程查不到的令牌
+// 到库中查找，重连被分到其他工作进程或滚动重启后会话仍有效；本进程命中的会话每隔 TTL/4 在库中续期一次
+class SessionManager {
+public:
+    static SessionManager* getInstance();
+
+    // 会话空闲多久后过期（秒）
+    void setTtl(int seconds);
+    int ttl() const { return m_ttl; }
+    void setShared(bool shared) { m_shared = shared; }
+
+    quint64 create(qint64 userId, const QString& username);
+    // 查找并续期，令牌无效或已过期时返回 false
+    bool resolve(quint64 token, Session* session);
+    void remove(quint64 token);
+    // 移除某用户的全部会话（修改密码后强制重新登录）
+    int removeUser(qint64 userId);
+    // 同上，按用户名（多进程模式下写进程通知的改密事件只带用户名）
+    int removeUsername(const QString& username);
+
+    // 批量清理过期会话，由定时器周期调用，返回清理数量
+    int expireSessions();
+    int size();
+
+private:
+    SessionManager() = default;
+    SessionManager(const SessionManager&) = delete;
+    SessionManager& operator=(const SessionManager&) = delete;
+
+    static constexpr int kShardCount = 16;
+    struct Shard {
+        ProfiledMutex mutex{"sessions"};     // 各分片的统计合并在同一锁名下
+        QHash<quint64, Session> sessions;
+    };
+    Shard& shardFor(quint64 token) { return m_shards[token % kShardCount]; }
+    bool loadShared(quint64 token, qint64 now, Session* session);
+
+    Shard m_shards[kShardCount];
+    int m_ttl = 24 * 3600;
+    bool m_shared = false;
+    static SessionManager* m_instance;
+};
+
+#endif // SESSION_MANAGER_H
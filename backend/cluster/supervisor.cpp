@@ -0,0 +1,178 @@
+#include "supervisor.h"
+#include "log/logger.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QProcessEnvironment>
+#include <QTimer>
+
+namespace {
+LogCategory logCluster("cluster");
+
+// 运行超过该时长后退出视为偶发，退避清零；否则每次翻倍，最长 30 秒
+constexpr qint64 kStableRunMs = 30 * 1000;
+constexpr int kMinRestartDelayMs = 500;
+constexpr int kMaxRestartDelayMs = 30 * 1000;
+// 关停时子进程排空连接的上限之外再等待的时间，之后强制结束
+constexpr int kKillGraceMs = 10 * 1000;
+
+const char* roleName(int slot) {
+    return slot == 0 ? "writer" : "worker";
+}
+}
+
+Supervisor::Supervisor(int workerCount, QObject* parent)
+    : QObject(parent), m_workerCount(workerCount), m_failures(workerCount + 1, 0) {}
+
+void Supervisor::start() {
+    logInfo(logCluster, "监督进程启动：1 个写进程，{} 个工作进程", m_workerCount);
+    spawn(0);
+}
+
+void Supervisor::spawn(int slot) {
+    auto* child = new Child;
+    child->slot = slot;
+    child->process = new QProcess(this);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    const int metricsPort = env.value("FTMS_METRICS_PORT").trimmed().toInt();
+    if (metricsPort > 0) env.insert("FTMS_METRICS_PORT", QString::number(metricsPort + slot));
+    const QString capture = env.value("FTMS_CAPTURE_FILE").trimmed();
+    if (slot == 0) {
+        env.remove("FTMS_CAPTURE_FILE");
+    } else if (!capture.isEmpty()) {
+        env.insert("FTMS_CAPTURE_FILE", QString("%1.w%2").arg(capture).arg(slot));
+    }
+    child->process->setProcessEnvironment(env);
+    // 标准错误（日志）直接透传，标准输出只用于就绪通知
+    child->process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    connect(child->process, &QProcess::readyReadStandardOutput, this, [this, child]() {
+        if (child->process->readAllStandardOutput().contains("READY")) onReady(child);
+    });
+    connect(child->process, &QProcess::finished, this, [this, child]() { onExited(child); });
+    connect(child->process, &QProcess::errorOccurred, this, [this, child](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) onExited(child);
+    });
+
+    m_children.append(child);
+    child->startedMs = QDateTime::currentMSecsSinceEpoch();
+    QStringList args = {"--role", roleName(slot)};
+    const QStringList passthrough = QCoreApplication::arguments().mid(1);
+    for (int i = 0; i < passthrough.size(); ++i) {
+        // 子进程不再带 --workers，避免递归启动监督进程
+        if (passthrough.at(i) == "--workers") {
+            ++i;
+            continue;
+        }
+        if (passthrough.at(i).startsWith("--workers=")) continue;
+        args.append(passthrough.at(i));
+    }
+    child->process->start(QCoreApplication::applicationFilePath(), args);
+}
+
+void Supervisor::retire(Child* child) {
+    if (child->retiring) return;
+    child->retiring = true;
+    child->process->terminate();
+}
+
+Supervisor::Child* Supervisor::current(int slot) const {
+    for (Child* child : m_children) {
+        if (child->slot == slot && !child->retiring) return child;
+    }
+    return nullptr;
+}
+
+void Supervisor::onReady(Child* child) {
+    logInfo(logCluster, "{} 进程（槽位 {}，pid {}）就绪", roleName(child->slot), child->slot, child->process->processId());
+    if (child->slot == 0 && !m_workersStarted && !m_stopping) {
+        m_workersStarted = true;
+        for (int slot = 1; slot <= m_workerCount; ++slot) spawn(slot);
+    }
+    if (child->slot == m_reloadSlot) reloadNext();
+}
+
+void Supervisor::onExited(Child* child) {
+    // FailedToStart 之后不会再有 finished，但 finished 之后也可能补发其他错误，只处理一次
+    if (!m_children.removeOne(child)) return;
+    const int slot = child->slot;
+    const qint64 ranMs = QDateTime::currentMSecsSinceEpoch() - child->startedMs;
+    const bool expected = child->retiring || m_stopping;
+    child->process->deleteLater();
+    delete child;
+
+    if (!expected) {
+        m_failures[slot] = ranMs < kStableRunMs ? m_failures[slot] + 1 : 0;
+        const int delayMs = qMin(kMaxRestartDelayMs, kMinRestartDelayMs << qMin(m_failures[slot], 6));
+        logWarning(logCluster, "{} 进程（槽位 {}）运行 {} 秒后意外退出，{} 毫秒后重启", roleName(slot), slot, ranMs / 1000, delayMs);
+        QTimer::singleShot(delayMs, this, [this, slot]() {
+            if (!m_stopping && !current(slot)) spawn(slot);
+        });
+    }
+
+    if (!m_stopping) return;
+    bool workersLeft = false;
+    for (Child* remaining : m_children) {
+        if (remaining->slot != 0) workersLeft = true;
+    }
+    if (!workersLeft) {
+        if (Child* writer = current(0)) retire(writer);
+    }
+    if (m_children.isEmpty()) {
+        logInfo(logCluster, "全部子进程已退出");
+        QCoreApplication::quit();
+    }
+}
+
+void Supervisor::reload() {
+    if (m_stopping) return;
+    if (m_reloadSlot >= 0) {
+        logWarning(logCluster, "滚动重启进行中（槽位 {}），忽略本次请求", m_reloadSlot);
+        return;
+    }
+    logInfo(logCluster, "开始滚动重启");
+    m_reloadQueue.clear();
+    for (int slot = 0; slot <= m_workerCount; ++slot) m_reloadQueue.append(slot);
+    reloadNext();
+}
+
+void Supervisor::reloadNext() {
+    if (m_stopping || m_reloadQueue.isEmpty()) {
+        if (m_reloadSlot >= 0 && !m_stopping) logInfo(logCluster, "滚动重启完成");
+        m_reloadSlot = -1;
+        return;
+    }
+    m_reloadSlot = m_reloadQueue.takeFirst();
+    // 旧写进程关闭 socket 后把未完成的写请求做完；工作进程在写进程切换期间重试连接
+    if (Child* old = current(m_reloadSlot)) retire(old);
+    spawn(m_reloadSlot);
+}
+
+void Supervisor::shutdown() {
+    if (m_stopping) return;
+    m_stopping = true;
+    logInfo(logCluster, "监督进程退出：等待工作进程排空连接");
+    bool workersLeft = false;
+    for (Child* child : m_children) {
+        if (child->slot != 0) {
+            retire(child);
+            workersLeft = true;
+        }
+    }
+    if (!workersLeft) {
+        if (Child* writer = current(0)) retire(writer);
+    }
+    if (m_children.isEmpty()) {
+        QCoreApplication::quit();
+        return;
+    }
+
+    bool ok = false;
+    const int drainSecs = QProcessEnvironment::systemEnvironment().value("FTMS_DRAIN_SECS").trimmed().toInt(&ok);
+    QTimer::singleShot((ok && drainSecs >= 0 ? drainSecs : 30) * 1000 + kKillGraceMs, this, [this]() {
+        for (Child* child : m_children) {
+            logWarning(logCluster, "{} 进程（槽位 {}）未按时退出，强制结束", roleName(child->slot), child->slot);
+            child->process->kill();
+        }
+    });
+}
@@ -0,0 +1,50 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QVector>
+
+// 多进程模式的监督进程：以 --role 参数重新启动本程序，槽位 0 为写进程，1..N 为工作进程。
+// 工作进程各自以 SO_REUSEPORT 监听同一端口、只读打开同一个 WAL 库，写操作经本地 socket 交给写进程。
+// 子进程初始化完成后在标准输出打印 READY；意外退出的子进程按槽位退避重启。
+// 各子进程的指标端口为 FTMS_METRICS_PORT + 槽位号，流量抓取文件追加 .w<槽位号> 后缀
+class Supervisor : public QObject {
+    Q_OBJECT
+public:
+    explicit Supervisor(int workerCount, QObject* parent = nullptr);
+
+    // 先启动写进程，就绪后再启动各工作进程
+    void start();
+    // 滚动重启（SIGHUP）：按槽位依次结束旧进程并启动新进程，新进程就绪后才处理下一个槽位，
+    // 旧工作进程停止监听后继续处理已有连接直到排空
+    void reload();
+    // 优雅退出（SIGTERM / SIGINT）：先结束工作进程，全部退出后再结束写进程
+    void shutdown();
+
+private:
+    struct Child {
+        QProcess* process = nullptr;
+        int slot = 0;
+        qint64 startedMs = 0;
+        bool retiring = false;      // 已要求退出，退出后不重启
+    };
+
+    void spawn(int slot);
+    void retire(Child* child);
+    Child* current(int slot) const;
+    void onReady(Child* child);
+    void onExited(Child* child);
+    void reloadNext();
+
+    int m_workerCount;
+    QList<Child*> m_children;       // 存活的子进程，含正在退出的
+    QVector<int> m_failures;        // 各槽位连续的快速退出次数，决定重启退避
+    QList<int> m_reloadQueue;
+    int m_reloadSlot = -1;          // 正在滚动重启的槽位
+    bool m_workersStarted = false;
+    bool m_stopping = false;
+};
+
+#endif // SUPERVISOR_H
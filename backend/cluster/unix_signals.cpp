@@ -0,0 +1,45 @@
+#include "unix_signals.h"
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UnixSignals* UnixSignals::m_instance = nullptr;
+
+namespace {
+int g_signalFds[2] = {-1, -1};
+
+void handleSignal(int signalNumber) {
+    const unsigned char byte = static_cast<unsigned char>(signalNumber);
+    const ssize_t written = ::write(g_signalFds[0], &byte, 1);
+    (void)written;
+}
+}
+
+UnixSignals* UnixSignals::getInstance() {
+    if (!m_instance) {
+        m_instance = new UnixSignals();
+    }
+    return m_instance;
+}
+
+UnixSignals::UnixSignals() {
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, g_signalFds) != 0) return;
+    m_notifier = new QSocketNotifier(g_signalFds[1], QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &UnixSignals::onActivated);
+}
+
+void UnixSignals::watch(int signalNumber) {
+    struct sigaction action {};
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    ::sigaction(signalNumber, &action, nullptr);
+}
+
+void UnixSignals::onActivated() {
+    unsigned char byte = 0;
+    if (::read(g_signalFds[1], &byte, 1) == 1) {
+        emit received(int(byte));
+    }
+}
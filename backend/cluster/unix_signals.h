@@ -0,0 +1,30 @@
+#ifndef UNIX_SIGNALS_H
+#define UNIX_SIGNALS_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+// 把 SIGTERM / SIGINT / SIGHUP 转成主线程的 Qt 信号：处理函数只向 socketpair 写入信号编号，
+// 主线程事件循环中的 QSocketNotifier 读出后发出 received，其余工作都在处理函数之外完成
+class UnixSignals : public QObject {
+    Q_OBJECT
+public:
+    static UnixSignals* getInstance();
+
+    void watch(int signalNumber);
+
+signals:
+    void received(int signalNumber);
+
+private slots:
+    void onActivated();
+
+private:
+    UnixSignals();
+
+    QSocketNotifier* m_notifier = nullptr;
+    static UnixSignals* m_instance;
+};
+
+#endif // UNIX_SIGNALS_H
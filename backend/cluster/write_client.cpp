@@ -0,0 +1,206 @@
+#include "write_client.h"
+#include "writer_protocol.h"
+#include "auth/session_manager.h"
+#include "db/city_dictionary.h"
+#include "db/db_manager.h"
+#include "db/schema_migrator.h"
+#include "db/username_index.h"
+#include "log/logger.h"
+#include <QDataStream>
+#include <QProcessEnvironment>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+LogCategory logCluster("cluster");
+
+int envInt(const char* name, int fallback) {
+    bool ok = false;
+    const int value = QProcessEnvironment::systemEnvironment().value(name).trimmed().toInt(&ok);
+    return ok && value > 0 ? value : fallback;
+}
+}
+
+WriteClient::WriteClient(const QString& path)
+    : m_path(path),
+      m_poolSize(envInt("FTMS_WRITER_CONNECTIONS", 8)),
+      m_timeoutMs(envInt("FTMS_WRITER_TIMEOUT_MS", 5000)) {}
+
+WriteClient::~WriteClient() {
+    stop();
+}
+
+// 写进程重启期间每 100ms 重试一次，超过 timeoutMs 返回 -1
+int WriteClient::connectWriter(int timeoutMs) {
+    const QByteArray native = m_path.toLocal8Bit();
+    sockaddr_un addr{};
+    if (native.size() >= qsizetype(sizeof(addr.sun_path))) return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, native.constData(), size_t(native.size()));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return fd;
+        if (fd >= 0) ::close(fd);
+        if (m_stopping.load() || std::chrono::steady_clock::now() >= deadline) return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+int WriteClient::acquire() {
+    {
+        std::unique_lock<ProfiledMutex> lock(m_mutex);
+        const bool ready = m_available.wait_for(lock, std::chrono::milliseconds(m_timeoutMs), [this]() {
+            return !m_idle.isEmpty() || m_open < m_poolSize;
+        });
+        if (!ready) return -1;
+        if (!m_idle.isEmpty()) return m_idle.takeLast();
+        ++m_open;
+    }
+    const int fd = connectWriter(m_timeoutMs);
+    if (fd < 0) release(-1);
+    return fd;
+}
+
+// fd 为 -1 表示该连接已关闭，释放名额
+void WriteClient::release(int fd) {
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        if (fd >= 0) {
+            m_idle.append(fd);
+        } else {
+            --m_open;
+        }
+    }
+    m_available.notify_one();
+}
+
+bool WriteClient::call(WriteOp op, const QByteArray& args, QByteArray* result) {
+    QByteArray request;
+    QDataStream out(&request, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint8(op) << args;
+
+    // 空闲连接可能已随写进程重启失效：请求未完整发出时写进程不会执行，换一条连接重发一次；
+    // 请求已发出而应答丢失或超过 FTMS_WRITER_TIMEOUT_MS 未到时结果未知，不重发，避免重复订票。
+    // 超时的连接上可能稍后才到达旧应答，直接关闭，不放回连接池
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const int fd = acquire();
+        if (fd < 0) break;
+        if (!WriterProtocol::writeFrame(fd, request)) {
+            ::close(fd);
+            release(-1);
+            continue;
+        }
+        if (WriterProtocol::readFrame(fd, result, m_timeoutMs)) {
+            release(fd);
+            return true;
+        }
+        ::close(fd);
+        release(-1);
+        logWarning(logCluster, "写进程应答丢失或超时，操作 {} 的结果未知", int(op));
+        return false;
+    }
+    logWarning(logCluster, "写进程不可达，操作 {} 失败", int(op));
+    return false;
+}
+
+void WriteClient::startEvents() {
+    m_stopping = false;
+    m_eventThread = std::thread([this]() { eventLoop(); });
+}
+
+void WriteClient::stop() {
+    m_stopping = true;
+    const int fd = m_eventFd.load();
+    if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+    if (m_eventThread.joinable()) m_eventThread.join();
+
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    for (int idle : m_idle) ::close(idle);
+    m_open -= int(m_idle.size());
+    m_idle.clear();
+}
+
+void WriteClient::eventLoop() {
+    QByteArray subscribe;
+    QDataStream out(&subscribe, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << WriterProtocol::kSubscribeOp << QByteArray();
+
+    while (!m_stopping.load()) {
+        const int fd = connectWriter(1000);
+        if (fd < 0) continue;
+        m_eventFd.store(fd);
+        if (m_stopping.load() || !WriterProtocol::writeFrame(fd, subscribe)) {
+            m_eventFd.store(-1);
+            ::close(fd);
+            continue;
+        }
+        // 订阅建立之前（启动加载后、断线期间）的变更收不到通知，订阅后全量重载一次
+        DBManager::getInstance()->reloadCaches();
+        logInfo(logCluster, "已订阅写进程的变更通知");
+
+        QByteArray frame;
+        while (WriterProtocol::readFrame(fd, &frame)) {
+            applyEvent(frame);
+        }
+        m_eventFd.store(-1);
+        ::close(fd);
+        if (!m_stopping.load()) logWarning(logCluster, "与写进程的订阅连接断开，重新连接");
+    }
+    DBManager::getInstance()->releaseConnection();
+}
+
+void WriteClient::applyEvent(const QByteArray& frame) {
+    QDataStream in(frame);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 event = 0;
+    QByteArray data;
+    in >> event >> data;
+    QDataStream payload(data);
+    payload.setVersion(QDataStream::Qt_6_0);
+
+    switch (event) {
+    case WriterProtocol::UserRegistered: {
+        QString username;
+        payload >> username;
+        UsernameIndex::getInstance()->add(username);
+        if (UsernameIndex::getInstance()->needsRebuild()) DBManager::getInstance()->reloadCaches();
+        break;
+    }
+    case WriterProtocol::PasswordChanged: {
+        QString username;
+        payload >> username;
+        SessionManager::getInstance()->removeUsername(username);
+        break;
+    }
+    case WriterProtocol::CatalogChanged:
+        DBManager::getInstance()->loadFlightCatalog();
+        break;
+    case WriterProtocol::SchemaChanged: {
+        qint32 version = 0;
+        payload >> version;
+        SchemaMigrator::getInstance()->adopt(version);
+        logInfo(logCluster, "写进程已完成结构迁移 v{}", version);
+        break;
+    }
+    case WriterProtocol::CitiesChanged: {
+        quint32 version = 0;
+        QStringList cities;
+        payload >> version >> cities;
+        // 并发写操作的广播可能乱序到达，只接受更新的版本
+        if (version > CityDictionary::getInstance()->version()) {
+            CityDictionary::getInstance()->reset(cities, version);
+        }
+        break;
+    }
+    default:
+        logWarning(logCluster, "未知的写进程通知：{}", int(event));
+        break;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef WRITE_CLIENT_H
+#define WRITE_CLIENT_H
+
+#include <QList>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include "db/write_forwarder.h"
+#include "metrics/profiled_mutex.h"
+
+// 工作进程到写进程的连接池：调用线程借用一条空闲的阻塞连接发出写请求并等待应答，
+// 连接数上限为 FTMS_WRITER_CONNECTIONS（默认 8），全部占用时排队。写进程重启期间
+// 在 FTMS_WRITER_TIMEOUT_MS（默认 5000）内重试连接，超时后写操作按失败返回；
+// 等待应答同样以此为限，超时按结果未知处理。
+// 另有一条订阅连接在后台线程接收变更通知，更新本进程的用户名过滤器、城市字典与会话表
+class WriteClient : public WriteForwarder {
+public:
+    explicit WriteClient(const QString& path);
+    ~WriteClient() override;
+
+    bool call(WriteOp op, const QByteArray& args, QByteArray* result) override;
+
+    void startEvents();
+    void stop();
+
+private:
+    int connectWriter(int timeoutMs);
+    int acquire();
+    void release(int fd);
+    void eventLoop();
+    void applyEvent(const QByteArray& frame);
+
+    QString m_path;
+    int m_poolSize;
+    int m_timeoutMs;
+
+    ProfiledMutex m_mutex{"writer_pool"};
+    std::condition_variable_any m_available;
+    QList<int> m_idle;
+    int m_open = 0;             // 已建立（空闲 + 借出）的连接数
+
+    std::atomic<bool> m_stopping{false};
+    std::atomic<int> m_eventFd{-1};
+    std::thread m_eventThread;
+};
+
+#endif // WRITE_CLIENT_H
@@ -0,0 +1,69 @@
+#include "writer_protocol.h"
+#include <QProcessEnvironment>
+#include <QtEndian>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+bool sendAll(int fd, const char* data, qsizetype size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size_t(size), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+using Clock = std::chrono::steady_clock;
+
+// deadline 为默认值时不限时
+bool recvAll(int fd, char* data, qsizetype size, Clock::time_point deadline) {
+    while (size > 0) {
+        if (deadline != Clock::time_point()) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (left <= 0) return false;
+            pollfd pfd{fd, POLLIN, 0};
+            const int ready = ::poll(&pfd, 1, int(left));
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) return false;
+        }
+        const ssize_t n = ::recv(fd, data, size_t(size), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+}
+
+namespace WriterProtocol {
+
+QString socketPath() {
+    const QString path = QProcessEnvironment::systemEnvironment().value("FTMS_WRITER_SOCKET").trimmed();
+    return path.isEmpty() ? QString("ftms-writer.sock") : path;
+}
+
+bool writeFrame(int fd, const QByteArray& payload) {
+    char header[4];
+    qToBigEndian<quint32>(quint32(payload.size()), header);
+    return sendAll(fd, header, 4) && sendAll(fd, payload.constData(), payload.size());
+}
+
+bool readFrame(int fd, QByteArray* payload, int timeoutMs) {
+    const Clock::time_point deadline =
+        timeoutMs > 0 ? Clock::now() + std::chrono::milliseconds(timeoutMs) : Clock::time_point();
+    char header[4];
+    if (!recvAll(fd, header, 4, deadline)) return false;
+    const quint32 size = qFromBigEndian<quint32>(header);
+    if (size > kMaxFrameBytes) return false;
+    payload->resize(qsizetype(size));
+    return recvAll(fd, payload->data(), payload->size(), deadline);
+}
+
+}
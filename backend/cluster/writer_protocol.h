@@ -0,0 +1,34 @@
+#ifndef WRITER_PROTOCOL_H
+#define WRITER_PROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+
+// 工作进程与写进程之间的本地 socket 协议，帧格式与客户端协议相同（quint32 大端长度 + 负载）。
+// 调用连接：请求负载为 (quint8 WriteOp, QByteArray 参数)，应答负载为编码的结果，一问一答。
+// 订阅连接：首帧的操作号为 kSubscribeOp，之后写进程单向推送 (quint8 WriterEvent, QByteArray 数据)
+namespace WriterProtocol {
+
+constexpr quint8 kSubscribeOp = 0;
+// 单帧上限，批量导入航班的请求最大
+constexpr quint32 kMaxFrameBytes = 256 * 1024 * 1024;
+
+// 写进程在写操作成功后广播的变更，工作进程据此更新本进程的缓存与会话表
+enum WriterEvent : quint8 {
+    UserRegistered = 1,     // QString 用户名
+    CitiesChanged,          // quint32 版本号 + QStringList 全部城市
+    PasswordChanged,        // QString 用户名，该用户的会话全部失效
+    CatalogChanged,         // 无数据，航班目录快照已重新生成或已过期，工作进程重新映射（过期时停用）
+    SchemaChanged,          // qint32 结构版本，后台迁移完成，工作进程据此切换读路径
+};
+
+// 写进程 socket 路径：FTMS_WRITER_SOCKET，默认为工作目录下的 ftms-writer.sock
+QString socketPath();
+
+// 阻塞读写一帧，连接断开或出错时返回 false。timeoutMs 大于 0 时整帧须在该时间内读完，超时也返回 false
+bool writeFrame(int fd, const QByteArray& payload);
+bool readFrame(int fd, QByteArray* payload, int timeoutMs = 0);
+
+}
+
+#endif // WRITER_PROTOCOL_H
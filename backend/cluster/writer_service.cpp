@@ -0,0 +1,215 @@
+#include "writer_service.h"
+#include "writer_protocol.h"
+#include "db/city_dictionary.h"
+#include "db/db_manager.h"
+#include "log/logger.h"
+#include <QDataStream>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+LogCategory logCluster("cluster");
+
+// 订阅者长时间不读时放弃该连接，避免广播卡住写路径；工作进程重连后全量重载缓存
+constexpr int kSubscriberSendTimeoutSecs = 1;
+
+QByteArray encodeString(const QString& value) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << value;
+    return data;
+}
+}
+
+WriterService::~WriterService() {
+    close();
+}
+
+bool WriterService::listen(const QString& path, QString* error) {
+    const QByteArray native = path.toLocal8Bit();
+    sockaddr_un addr{};
+    if (native.size() >= qsizetype(sizeof(addr.sun_path))) {
+        *error = QString("socket 路径过长：%1").arg(path);
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, native.constData(), size_t(native.size()));
+
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        *error = QString("socket 失败：%1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    // 上一个写进程异常退出时留下的路径
+    ::unlink(native.constData());
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(m_listenFd, 64) < 0) {
+        *error = QString("监听 %1 失败：%2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    ::chmod(native.constData(), S_IRUSR | S_IWUSR);
+    struct stat info {};
+    m_inode = ::stat(native.constData(), &info) == 0 ? info.st_ino : 0;
+
+    m_path = path;
+    m_stopping = false;
+    m_acceptThread = std::thread([this]() { acceptLoop(); });
+    return true;
+}
+
+void WriterService::close() {
+    if (m_listenFd < 0) return;
+    m_stopping = true;
+    if (m_acceptThread.joinable()) m_acceptThread.join();
+    ::close(m_listenFd);
+    m_listenFd = -1;
+    // 滚动重启时新写进程可能已在同一路径上监听，只删除自己创建的 socket 文件
+    const QByteArray native = m_path.toLocal8Bit();
+    struct stat info {};
+    if (::stat(native.constData(), &info) == 0 && info.st_ino == m_inode) ::unlink(native.constData());
+
+    // 只关闭读方向：正在执行的写操作仍能写出应答，随后各线程读到 EOF 退出
+    std::list<std::thread> threads;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        for (int fd : m_connections) ::shutdown(fd, SHUT_RD);
+        threads.swap(m_threads);
+    }
+    for (std::thread& thread : threads) thread.join();
+}
+
+// 以超时轮询代替阻塞 accept，close() 置位后最多 200ms 退出
+void WriterService::acceptLoop() {
+    while (!m_stopping.load()) {
+        pollfd pfd{m_listenFd, POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, 200);
+        if (ready <= 0) continue;
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                logWarning(logCluster, "写进程 accept 失败：{}", strerror(errno));
+            }
+            continue;
+        }
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        m_connections.append(fd);
+        m_threads.emplace_back([this, fd]() { serve(fd); });
+    }
+}
+
+void WriterService::serve(int fd) {
+    QByteArray frame;
+    while (WriterProtocol::readFrame(fd, &frame)) {
+        QDataStream in(frame);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint8 op = 0;
+        QByteArray args;
+        in >> op >> args;
+        if (in.status() != QDataStream::Ok) {
+            logWarning(logCluster, "写进程收到无法解析的请求，断开连接");
+            break;
+        }
+
+        if (op == WriterProtocol::kSubscribeOp) {
+            timeval timeout{kSubscriberSendTimeoutSecs, 0};
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            {
+                std::lock_guard<ProfiledMutex> lock(m_mutex);
+                m_subscribers.append(fd);
+            }
+            // 订阅连接不再发送请求，阻塞到对端关闭或 close() 关闭读方向
+            char byte;
+            for (;;) {
+                const ssize_t n = ::recv(fd, &byte, 1, 0);
+                if (n > 0 || (n < 0 && errno == EINTR)) continue;
+                break;
+            }
+            break;
+        }
+
+        const QByteArray result = DBManager::getInstance()->executeForwardedWrite(WriteOp(op), args);
+        // 先广播再应答：客户端看到写成功时，其他工作进程的缓存已收到变更
+        afterWrite(op, args, result);
+        if (!WriterProtocol::writeFrame(fd, result)) break;
+    }
+
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        m_connections.removeOne(fd);
+        m_subscribers.removeOne(fd);
+    }
+    ::close(fd);
+    DBManager::getInstance()->releaseConnection();
+}
+
+void WriterService::afterWrite(quint8 op, const QByteArray& args, const QByteArray& result) {
+    QDataStream in(args);
+    in.setVersion(QDataStream::Qt_6_0);
+    QDataStream reply(result);
+    reply.setVersion(QDataStream::Qt_6_0);
+    bool success = false;
+
+    switch (WriteOp(op)) {
+    case WriteOp::RegisterUser: {
+        User user;
+        in >> user;
+        reply >> success;
+        if (success) broadcast(WriterProtocol::UserRegistered, encodeString(user.username));
+        break;
+    }
+    case WriteOp::ChangePassword: {
+        QString username;
+        in >> username;
+        reply >> success;
+        if (success) broadcast(WriterProtocol::PasswordChanged, encodeString(username));
+        break;
+    }
+    case WriteOp::AddFlight:
+    case WriteOp::ImportFlights: {
+        // 城市字典可能新增了城市，按版本号整体下发，工作进程忽略旧版本。
+        // 航班目录快照稍后合并重建，此时通知工作进程，其按最大 id 发现快照过期后停用，检索走 SQL
+        broadcast(WriterProtocol::CitiesChanged, CityDictionary::getInstance()->encoded());
+        broadcast(WriterProtocol::CatalogChanged, QByteArray());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void WriterService::schemaChanged(int version) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << qint32(version);
+    broadcast(WriterProtocol::SchemaChanged, data);
+}
+
+void WriterService::catalogChanged() {
+    broadcast(WriterProtocol::CatalogChanged, QByteArray());
+}
+
+void WriterService::broadcast(quint8 event, const QByteArray& data) {
+    QByteArray frame;
+    QDataStream out(&frame, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << event << data;
+
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    for (int i = m_subscribers.size() - 1; i >= 0; --i) {
+        const int fd = m_subscribers.at(i);
+        if (!WriterProtocol::writeFrame(fd, frame)) {
+            logWarning(logCluster, "向工作进程推送变更失败，断开其订阅连接");
+            ::shutdown(fd, SHUT_RDWR);
+            m_subscribers.removeAt(i);
+        }
+    }
+}
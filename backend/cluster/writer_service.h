@@ -0,0 +1,46 @@
+#ifndef WRITER_SERVICE_H
+#define WRITER_SERVICE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <atomic>
+#include <list>
+#include <thread>
+
+#include "metrics/profiled_mutex.h"
+
+// 写进程的本地 socket 服务：每个工作进程的连接一个线程，阻塞读取写请求后在本线程的数据库连接上执行，
+// 成功后向订阅连接广播变更。SQLite 同一时刻只有一个写事务，写操作集中到本进程后不再跨进程争抢写锁
+class WriterService {
+public:
+    WriterService() = default;
+    ~WriterService();
+
+    bool listen(const QString& path, QString* error);
+    // 停止接受新连接；已收到的写请求执行完并写出应答后各连接线程退出
+    void close();
+    // 后台结构迁移完成（迁移线程调用）
+    void schemaChanged(int version);
+    // 航班目录快照已重新生成（主线程调用）
+    void catalogChanged();
+
+private:
+    void acceptLoop();
+    void serve(int fd);
+    void broadcast(quint8 event, const QByteArray& data);
+    void afterWrite(quint8 op, const QByteArray& args, const QByteArray& result);
+
+    QString m_path;
+    int m_listenFd = -1;
+    quint64 m_inode = 0;
+    std::atomic<bool> m_stopping{false};
+    std::thread m_acceptThread;
+
+    ProfiledMutex m_mutex{"writer_connections"};   // 保护以下三项，广播时也持有，保证各订阅者收到的事件顺序一致
+    QList<int> m_connections;
+    QList<int> m_subscribers;
+    std::list<std::thread> m_threads;
+};
+
+#endif // WRITER_SERVICE_H
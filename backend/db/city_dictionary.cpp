@@ -0,0 +1,77 @@
+#include "city_dictionary.h"
+#include <QDataStream>
+#include <algorithm>
+
+CityDictionary* CityDictionary::m_instance = nullptr;
+
+CityDictionary* CityDictionary::getInstance() {
+    if (!m_instance) {
+        m_instance = new CityDictionary();
+    }
+    return m_instance;
+}
+
+void CityDictionary::reset(const QStringList& cities, quint32 version) {
+    ProfiledWriteLocker locker(&m_lock);
+    m_set = QSet<QString>(cities.begin(), cities.end());
+    m_version = version;
+    rebuildEncoded();
+}
+
+void CityDictionary::merge(const QStringList& cities, quint32 version) {
+    ProfiledWriteLocker locker(&m_lock);
+    for (const QString& city : cities) {
+        m_set.insert(city);
+    }
+    m_version = version;
+    rebuildEncoded();
+}
+
+bool CityDictionary::contains(const QString& city) const {
+    ProfiledReadLocker locker(&m_lock);
+    return m_set.contains(city);
+}
+
+QStringList CityDictionary::missing(const QStringList& cities) const {
+    QStringList result;
+    ProfiledReadLocker locker(&m_lock);
+    for (const QString& city : cities) {
+        if (!city.isEmpty() && !m_set.contains(city) && !result.contains(city)) {
+            result.append(city);
+        }
+    }
+    return result;
+}
+
+quint32 CityDictionary::version() const {
+    ProfiledReadLocker locker(&m_lock);
+    return m_version;
+}
+
+QStringList CityDictionary::cities() const {
+    ProfiledReadLocker locker(&m_lock);
+    return m_sorted;
+}
+
+QByteArray CityDictionary::encodedFor(quint32* version) const {
+    ProfiledReadLocker locker(&m_lock);
+    if (version) *version = m_version;
+    return m_encoded;
+}
+
+// 只在内容变化时执行，请求路径上直接返回共享的 QByteArray
+void CityDictionary::rebuildEncoded() {
+    m_sorted = QStringList(m_set.begin(), m_set.end());
+    std::sort(m_sorted.begin(), m_sorted.end());
+
+    m_encoded.clear();
+    QDataStream out(&m_encoded, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << m_version << m_sorted;
+
+    // 集合与排序列表共享同一批字符串数据，只计一次；哈希节点按每项 32 字节估算
+    qint64 bytes = heapBytes(m_encoded) + qint64(m_sorted.capacity()) * qint64(sizeof(QString))
+                   + qint64(m_set.capacity()) * 32;
+    for (const QString& city : m_sorted) bytes += heapBytes(city);
+    m_memory.resize(bytes);
+}
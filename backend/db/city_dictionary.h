@@ -0,0 +1,49 @@
+#ifndef CITY_DICTIONARY_H
+#define CITY_DICTIONARY_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QStringList>
+
+#include "metrics/memory_accounting.h"
+#include "metrics/profiled_mutex.h"
+
+// 城市字典的内存副本：数据来自 city 表，由 DBManager 在新增航班或批量导入时维护。
+// 每次内容变化版本号加一，应答数据 (版本号, 城市列表) 按版本只编码一次
+class CityDictionary {
+public:
+    static CityDictionary* getInstance();
+
+    // 用持久化的内容与版本号整体替换
+    void reset(const QStringList& cities, quint32 version);
+    // 合并新城市并更新到指定版本
+    void merge(const QStringList& cities, quint32 version);
+
+    bool contains(const QString& city) const;
+    // 返回尚未收录的城市（去重）
+    QStringList missing(const QStringList& cities) const;
+
+    quint32 version() const;
+    QStringList cities() const;
+    // 预编码的 GetCitiesRequest 应答数据：quint32 版本号 + QStringList
+    QByteArray encoded() const { return encodedFor(nullptr); }
+    // 同时取出版本号，保证两者一致
+    QByteArray encodedFor(quint32* version) const;
+
+private:
+    CityDictionary() = default;
+    CityDictionary(const CityDictionary&) = delete;
+    CityDictionary& operator=(const CityDictionary&) = delete;
+
+    void rebuildEncoded();
+
+    mutable ProfiledReadWriteLock m_lock{"city_dictionary"};
+    QSet<QString> m_set;
+    QStringList m_sorted;
+    quint32 m_version = 0;
+    QByteArray m_encoded;
+    MemoryCharge m_memory{MemoryTag::Caches};
+    static CityDictionary* m_instance;
+};
+
+#endif // CITY_DICTIONARY_H
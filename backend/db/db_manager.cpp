@@ -1,13 +1,551 @@
 #include "db_manager.h"
-#include <QUuid>
+#include "auth/password_hasher.h"
+#include "username_index.h"
+#include "city_dictionary.h"
+#include "flight_catalog.h"
+#include "order_id_generator.h"
+#include "schema_migrator.h"
+#include "seat_inventory.h"
+#include "flight_importer.h"
+#include "log/logger.h"
+#include "metrics/metrics.h"
+#include "metrics/tracer.h"
+#include "statement_profiler.h"
+#include "write_forwarder.h"
+#include <QCoreApplication>
+#include <QDataStream>
 #include <QRandomGenerator>
+#include <QRegularExpression>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QMutexLocker>
 #include <QThread>
+#include <QTimer>
+#include <limits>
 
 DBManager* DBManager::m_instance = nullptr;
 
+namespace {
+// 请求路径上的日志走异步日志，启动、迁移等一次性日志仍用 qDebug
+LogCategory logDb("db");
+
+// 公开操作的耗时直方图编号（含等待连接与事务）与追踪段名，每个操作一个静态实例
+struct DbOp {
+    explicit DbOp(const char* name)
+        : name(name), metric(Metrics::getInstance()->histogram("ftms_db_duration_seconds", "DBManager 各操作的耗时",
+                                                               QString("op=\"%1\"").arg(name))) {}
+    const char* name;
+    int metric;
+};
+
+class DbOpScope {
+public:
+    explicit DbOpScope(const DbOp& op) : m_span("db", op.name), m_latency(op.metric) {}
+
+private:
+    TraceSpan m_span;
+    ScopedLatency m_latency;
+};
+
+// 语句一律经 StatementProfiler 执行，计入按语句形态的统计与慢语句日志
+inline bool execQuery(QSqlQuery& query) {
+    return StatementProfiler::getInstance()->exec(query);
+}
+
+inline bool execQuery(QSqlQuery& query, const QString& sql) {
+    return StatementProfiler::getInstance()->exec(query, sql);
+}
+
+// 转发写操作的参数与结果编码
+template <typename... Args>
+QByteArray encodeWrite(const Args&... args) {
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    (out << ... << args);
+    return bytes;
+}
+
+// 写进程不可达或结果无法解析时返回 fallback
+template <typename R, typename... Args>
+R forwardWrite(WriteForwarder* forwarder, WriteOp op, R fallback, const Args&... args) {
+    QByteArray result;
+    if (!forwarder->call(op, encodeWrite(args...), &result)) return fallback;
+    QDataStream in(result);
+    in.setVersion(QDataStream::Qt_6_0);
+    R value = fallback;
+    in >> value;
+    return in.status() == QDataStream::Ok ? value : fallback;
+}
+
+// 内部一律使用整数代理键（rowid 别名），用户名、航班号、订单号的字符串形式只在协议层出现
+const char* kCreateUserTable = R"(
+    CREATE TABLE IF NOT EXISTS user (
+        id          INTEGER PRIMARY KEY,
+        username    TEXT NOT NULL UNIQUE,
+        password    TEXT NOT NULL,
+        real_name   TEXT,
+        phone       TEXT
+    )
+)";
+
+const char* kCreateFlightTable = R"(
+    CREATE TABLE IF NOT EXISTS flight (
+        id                  INTEGER PRIMARY KEY,
+        flight_id           TEXT NOT NULL UNIQUE,
+        departure           TEXT NOT NULL,
+        destination         TEXT NOT NULL,
+        departure_airport   TEXT,
+        arrival_airport     TEXT,
+        depart_time         INTEGER NOT NULL,
+        arrive_time         INTEGER NOT NULL,
+        price               REAL NOT NULL,
+        rest_seats          INTEGER NOT NULL
+    )
+)";
+
+// order_id 为 OrderIdGenerator 生成的 64 位订单号；depart_time 冗余自 flight，作为订单分页的排序键。
+// 时间列一律存 Unix 秒，范围过滤直接比较整数，读取时无需逐行解析字符串
+const char* kCreateTicketTable = R"(
+    CREATE TABLE IF NOT EXISTS ticket (
+        order_id    INTEGER PRIMARY KEY,
+        user_id     INTEGER NOT NULL REFERENCES user(id),
+        flight_ref  INTEGER NOT NULL REFERENCES flight(id),
+        book_time   INTEGER NOT NULL,
+        status      INTEGER DEFAULT 1,
+        seat_number TEXT,
+        depart_time INTEGER
+    )
+)";
+
+// 订单变更日志：seq 全局递增，某用户的最大 seq 即其订单版本号
+const char* kCreateOrderChangeTable = R"(
+    CREATE TABLE IF NOT EXISTS order_change (
+        seq         INTEGER PRIMARY KEY AUTOINCREMENT,
+        user_id     INTEGER NOT NULL,
+        order_id    INTEGER NOT NULL,
+        op          INTEGER NOT NULL,
+        changed_at  INTEGER NOT NULL
+    )
+)";
+
+// 多进程模式的共享会话：令牌按位存为有符号整数，last_seen 由各工作进程定期续期，
+// 写进程按 TTL 清理。单进程模式不使用
+const char* kCreateSessionTable = R"(
+    CREATE TABLE IF NOT EXISTS session (
+        token       INTEGER PRIMARY KEY,
+        user_id     INTEGER NOT NULL,
+        last_seen   INTEGER NOT NULL
+    )
+)";
+
+// 结构版本（PRAGMA user_version），各版本的迁移步骤见 DBManager::registerMigrations
+enum SchemaVersion {
+    kSchemaTextKeys = 1,            // 用户名、航班号、UUID 字符串主键
+    kSchemaIntegerKeys = 2,         // 整数代理键
+    kSchemaEpochTimes = 3,          // 时间列改为 Unix 秒（后台回填）
+    kSchemaRouteIndex = 4,          // 航线索引 idx_flight_route（后台）
+    kSchemaHashedPasswords = 5      // 残留明文口令全部哈希（后台）
+};
+
+const char* kCreateRouteIndex =
+    "CREATE INDEX IF NOT EXISTS idx_flight_route ON flight(departure, destination, depart_time)";
+
+constexpr int kPasswordBatch = 32;
+
+// 每批取游标之后的若干条明文口令，先在事务外计算哈希，再以原值为条件写回：
+// 期间已改密或已在登录时升级的行不会被覆盖，重做同一批也没有副作用
+bool hashLegacyPasswords(QSqlDatabase& db, qint64* cursor, bool* done) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, password FROM user WHERE id > :cursor AND password NOT LIKE 'pbkdf2_sha256$%' "
+                  "ORDER BY id LIMIT :limit");
+    query.bindValue(":cursor", *cursor);
+    query.bindValue(":limit", kPasswordBatch);
+    if (!execQuery(query)) return false;
+
+    QList<qint64> ids;
+    QStringList plain;
+    while (query.next()) {
+        ids.append(query.value(0).toLongLong());
+        plain.append(query.value(1).toString());
+    }
+    query.finish();
+
+    QStringList hashed;
+    for (const QString& password : plain) {
+        hashed.append(PasswordHasher::hash(password));
+    }
+
+    db.transaction();
+    query.prepare("UPDATE user SET password = :hash WHERE id = :id AND password = :old");
+    for (int i = 0; i < ids.size(); ++i) {
+        query.bindValue(":hash", hashed[i]);
+        query.bindValue(":id", ids[i]);
+        query.bindValue(":old", plain[i]);
+        if (!execQuery(query)) {
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        db.rollback();
+        return false;
+    }
+
+    if (!ids.isEmpty()) *cursor = ids.last();
+    *done = ids.size() < kPasswordBatch;
+    return true;
+}
+
+// 旧版库的时间列是服务器本地时间的 ISO 文本，在 SQL 内转换为 Unix 秒。
+// 时间列迁移完成前新写入的 Unix 秒按文本列的亲和性存成数字串，原样取整
+QString epochFromText(const QString& column) {
+    return QString("CASE WHEN %1 GLOB '[0-9]*' AND %1 NOT GLOB '*[^0-9]*' THEN CAST(%1 AS INTEGER) "
+                   "ELSE CAST(strftime('%s', %1, 'utc') AS INTEGER) END").arg(column);
+}
+
+// 读路径引用时间列：v3 完成前仍是文本列，逐行换算（无法走时间索引）
+QString timeColumn(const QString& column) {
+    return SchemaMigrator::getInstance()->reached(kSchemaEpochTimes) ? column : epochFromText(column);
+}
+
+// v3 在旧表旁加入整数列并按主键分批回填，回填期间由触发器换算新写入或修改的行；
+// 回填完成后在一个事务内建索引，把整数列改为正式列名，旧文本列改名后保留但不再读写
+struct EpochTable {
+    const char* table;
+    const char* key;
+    QStringList columns;
+};
+
+const QList<EpochTable>& epochTables() {
+    static const QList<EpochTable> tables = {
+        {"flight", "id", {"depart_time", "arrive_time"}},
+        {"ticket", "order_id", {"book_time", "depart_time"}},
+    };
+    return tables;
+}
+
+constexpr int kEpochBatch = 2000;
+
+QString epochColumn(const QString& column) {
+    return QString(column).replace("_time", "_epoch");
+}
+
+QString backfillKey(const EpochTable& table) {
+    return QString("epoch_backfill_%1").arg(table.table);
+}
+
+// 每列一组 "<列>_epoch = <换算>"，source 为取值的前缀（触发器内为 NEW.）
+QString epochAssignments(const EpochTable& table, const QString& source) {
+    QStringList assignments;
+    for (const QString& column : table.columns) {
+        assignments.append(QString("%1 = %2").arg(epochColumn(column), epochFromText(source + column)));
+    }
+    return assignments.join(", ");
+}
+
+// 加入整数列与触发器，并在 meta 记下各表的回填位置；同一事务内完成，重复调用时跳过
+bool prepareEpochColumns(QSqlDatabase& db) {
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM meta WHERE key = :key");
+    query.bindValue(":key", backfillKey(epochTables().first()));
+    if (!execQuery(query)) return false;
+    if (query.next()) return true;
+    query.finish();
+
+    db.transaction();
+    for (const EpochTable& table : epochTables()) {
+        bool ok = true;
+        for (const QString& column : table.columns) {
+            ok = ok && execQuery(query, QString("ALTER TABLE %1 ADD COLUMN %2 INTEGER").arg(table.table, epochColumn(column)));
+        }
+        const QString assign = QString("UPDATE %1 SET %2 WHERE %3 = NEW.%3; END")
+                                   .arg(table.table, epochAssignments(table, "NEW."), table.key);
+        ok = ok &&
+             execQuery(query, QString("CREATE TRIGGER %1_epoch_insert AFTER INSERT ON %1 BEGIN ").arg(table.table) + assign) &&
+             execQuery(query, QString("CREATE TRIGGER %1_epoch_update AFTER UPDATE OF %2 ON %1 BEGIN ")
+                                  .arg(table.table, table.columns.join(", ")) + assign);
+        query.prepare("INSERT INTO meta (key, value) VALUES (:key, 0)");
+        query.bindValue(":key", backfillKey(table));
+        if (!ok || !execQuery(query)) {
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// 回填 table 中主键在回填位置之后的一批行，回填位置之后已没有行时 *finished 为 true
+bool backfillEpochBatch(QSqlDatabase& db, const EpochTable& table, int* rows, bool* finished) {
+    QSqlQuery query(db);
+    query.prepare("SELECT value FROM meta WHERE key = :key");
+    query.bindValue(":key", backfillKey(table));
+    if (!execQuery(query) || !query.next()) return false;
+    const qint64 from = query.value(0).toLongLong();
+    query.prepare(QString("SELECT MAX(%2) FROM (SELECT %2 FROM %1 WHERE %2 > :from ORDER BY %2 LIMIT :limit)")
+                      .arg(table.table, table.key));
+    query.bindValue(":from", from);
+    query.bindValue(":limit", kEpochBatch);
+    if (!execQuery(query) || !query.next()) return false;
+    *finished = query.value(0).isNull();
+    if (*finished) return true;
+    const qint64 to = query.value(0).toLongLong();
+    query.finish();
+
+    db.transaction();
+    query.prepare(QString("UPDATE %1 SET %2 WHERE %3 > :from AND %3 <= :to")
+                      .arg(table.table, epochAssignments(table, QString()), table.key));
+    query.bindValue(":from", from);
+    query.bindValue(":to", to);
+    const bool ok = execQuery(query);
+    *rows = query.numRowsAffected();
+    query.prepare("UPDATE meta SET value = :to WHERE key = :key");
+    query.bindValue(":to", to);
+    query.bindValue(":key", backfillKey(table));
+    if (!ok || !execQuery(query) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+// 回填完成后的切换，在一个写事务内完成，提交前读请求仍看到旧结构（WAL）。
+// 与航线索引一样，SQLite 只能一次建完整个索引，期间写请求排队等待
+bool switchEpochColumns(QSqlDatabase& db) {
+    QSqlQuery query(db);
+    if (!execQuery(query, "BEGIN IMMEDIATE")) return false;
+    auto fail = [&](const char* step) {
+        qDebug() << "❌ 时间列切换失败：" << step << query.lastError().text();
+        execQuery(query, "ROLLBACK");
+        execQuery(query, "PRAGMA writable_schema = OFF");
+        return false;
+    };
+
+    for (const EpochTable& table : epochTables()) {
+        if (!execQuery(query, QString("DROP TRIGGER IF EXISTS %1_epoch_insert").arg(table.table)) ||
+            !execQuery(query, QString("DROP TRIGGER IF EXISTS %1_epoch_update").arg(table.table))) {
+            return fail("删除触发器");
+        }
+    }
+    // 时间索引先建在整数列上，改列名时随之改写，索引名与新库一致
+    if (!execQuery(query, "DROP INDEX IF EXISTS idx_flight_depart_time") ||
+        !execQuery(query, "CREATE INDEX idx_flight_depart_time ON flight(depart_epoch)") ||
+        !execQuery(query, "DROP INDEX IF EXISTS idx_ticket_user_depart") ||
+        !execQuery(query, "CREATE INDEX idx_ticket_user_depart ON ticket(user_id, depart_epoch DESC, order_id DESC)")) {
+        return fail("重建时间索引");
+    }
+
+    for (const EpochTable& table : epochTables()) {
+        for (const QString& column : table.columns) {
+            if (!execQuery(query, QString("ALTER TABLE %1 RENAME COLUMN %2 TO %2_text").arg(table.table, column)) ||
+                !execQuery(query, QString("ALTER TABLE %1 RENAME COLUMN %2 TO %3")
+                                      .arg(table.table, epochColumn(column), column))) {
+                return fail("改列名");
+            }
+        }
+    }
+
+    // 旧文本列的 NOT NULL 会挡住之后不再写它的 INSERT。SQLite 不支持 ALTER 约束，
+    // 按其文档中去掉 NOT NULL 的做法直接改写 sqlite_master 中的建表语句（不涉及表内数据）
+    if (!execQuery(query, "PRAGMA schema_version") || !query.next()) return fail("读取 schema_version");
+    const qint64 schemaVersion = query.value(0).toLongLong();
+    query.finish();
+    if (!execQuery(query, "PRAGMA writable_schema = ON")) return fail("writable_schema");
+    for (const EpochTable& table : epochTables()) {
+        query.prepare("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = :name");
+        query.bindValue(":name", QString(table.table));
+        if (!execQuery(query) || !query.next()) return fail("读取建表语句");
+        QString sql = query.value(0).toString();
+        for (const QString& column : table.columns) {
+            sql.replace(QRegularExpression(QString(R"(\b(%1_text\s+TEXT)\s+NOT\s+NULL)").arg(column),
+                                           QRegularExpression::CaseInsensitiveOption),
+                        "\\1");
+        }
+        query.prepare("UPDATE sqlite_master SET sql = :sql WHERE type = 'table' AND name = :name");
+        query.bindValue(":sql", sql);
+        query.bindValue(":name", QString(table.table));
+        if (!execQuery(query)) return fail("改写建表语句");
+    }
+    if (!execQuery(query, QString("PRAGMA schema_version = %1").arg(schemaVersion + 1)) ||
+        !execQuery(query, "PRAGMA writable_schema = OFF")) {
+        return fail("schema_version");
+    }
+
+    if (!execQuery(query, "DELETE FROM meta WHERE key LIKE 'epoch_backfill_%'") || !execQuery(query, "COMMIT")) {
+        return fail("提交");
+    }
+    return true;
+}
+
+// order_change.op
+enum OrderChangeOp {
+    OrderUpserted = 1,
+    OrderRemoved = 2
+};
+
+// 在调用方的事务内追加一条订单变更记录
+bool logOrderChange(QSqlQuery& query, qint64 userId, qint64 orderId, OrderChangeOp op) {
+    query.prepare("INSERT INTO order_change (user_id, order_id, op, changed_at) "
+                  "VALUES (:userId, :orderId, :op, :changedAt)");
+    query.bindValue(":userId", userId);
+    query.bindValue(":orderId", orderId);
+    query.bindValue(":op", int(op));
+    query.bindValue(":changedAt", QDateTime::currentSecsSinceEpoch());
+    return execQuery(query);
+}
+
+struct FlightRef {
+    qint64 id = 0;
+    int restSeats = 0;
+    QString departure;
+    QString destination;
+};
+
+// 航班号只在入口处解析一次，之后都用整数 id
+bool findFlight(QSqlQuery& query, const QString& flightId, FlightRef* flight) {
+    query.prepare("SELECT id, rest_seats, departure, destination FROM flight WHERE flight_id = :flightId");
+    query.bindValue(":flightId", flightId);
+    if (!execQuery(query) || !query.next()) return false;
+    flight->id = query.value(0).toLongLong();
+    flight->restSeats = query.value(1).toInt();
+    flight->departure = query.value(2).toString();
+    flight->destination = query.value(3).toString();
+    return true;
+}
+
+// 航班只增不删，最大 id 变化即说明航班目录快照已过期
+qint64 maxFlightId(QSqlQuery& query) {
+    return execQuery(query, "SELECT MAX(id) FROM flight") && query.next() ? query.value(0).toLongLong() : 0;
+}
+
+// 在写事务内、提交之前把库中的余座写入航班目录的余座表：此时持有库的写锁，
+// 各写者（含其他进程）对余座表的更新顺序与提交顺序一致
+void publishRestSeats(QSqlQuery& query, qint64 flightRef) {
+    FlightCatalog* catalog = FlightCatalog::getInstance();
+    if (!catalog->seatsWritable()) return;
+    query.prepare("SELECT rest_seats FROM flight WHERE id = :flightRef");
+    query.bindValue(":flightRef", flightRef);
+    if (execQuery(query) && query.next()) catalog->setRestSeats(flightRef, query.value(0).toInt());
+}
+
+// order_change 的当前序号：写事务内调用时含本事务刚写入的变更，否则为已提交的最大值
+qint64 lastChangeSeq(QSqlQuery& query) {
+    return execQuery(query, "SELECT seq FROM sqlite_sequence WHERE name = 'order_change'") && query.next()
+               ? query.value(0).toLongLong() : 0;
+}
+
+bool ticketSeats(QSqlQuery& query, qint64 flightRef, QStringList* seats) {
+    query.prepare("SELECT seat_number FROM ticket WHERE flight_ref = :flightRef");
+    query.bindValue(":flightRef", flightRef);
+    if (!execQuery(query)) return false;
+    while (query.next()) seats->append(query.value(0).toString());
+    return true;
+}
+
+bool seatFree(QSqlQuery& query, qint64 flightRef, const QString& seatNumber) {
+    query.prepare("SELECT 1 FROM ticket WHERE flight_ref = :flightRef AND seat_number = :seat");
+    query.bindValue(":flightRef", flightRef);
+    query.bindValue(":seat", seatNumber);
+    return execQuery(query) && !query.next();
+}
+
+// 与 publishRestSeats 同在提交之前调用，先于它执行：日志写失败时调用方回滚，余座表尚未改动
+bool publishSeats(QSqlQuery& query, std::initializer_list<SeatInventory::SeatChange> changes) {
+    SeatInventory* inventory = SeatInventory::getInstance();
+    if (!inventory->isActive()) return true;
+    return inventory->apply(lastChangeSeq(query), changes);
+}
+
+// 提交改动了余座的写事务；提交失败时回滚，并把余座表与座位库存改回库中的值。
+// 回填在库的写锁内进行，不会盖掉其他写者随后提交的改动
+bool commitSeatChange(QSqlDatabase& db, std::initializer_list<qint64> flightRefs) {
+    TraceSpan commit("db", "commit");
+    if (db.commit()) return true;
+    db.rollback();
+    QSqlQuery query(db);
+    const bool locked = execQuery(query, "BEGIN IMMEDIATE");
+    SeatInventory* inventory = SeatInventory::getInstance();
+    const qint64 changeSeq = inventory->isActive() ? lastChangeSeq(query) : 0;
+    for (qint64 flightRef : flightRefs) {
+        publishRestSeats(query, flightRef);
+        QStringList seats;
+        if (inventory->isActive() && ticketSeats(query, flightRef, &seats)) inventory->assign(flightRef, seats, changeSeq);
+    }
+    if (locked) execQuery(query, "COMMIT");
+    return false;
+}
+
+// 在调用方的事务内写入订单、记录变更并扣减余座，返回订单号，失败返回 0
+qint64 insertTicket(QSqlQuery& query, qint64 userId, qint64 flightRef, const QString& seatNumber) {
+    const qint64 orderId = OrderIdGenerator::getInstance()->next();
+
+    query.prepare("INSERT INTO ticket (order_id, user_id, flight_ref, book_time, status, seat_number, depart_time) "
+                  "VALUES (:orderId, :userId, :flightRef, :bookTime, 1, :seat, "
+                  "(SELECT depart_time FROM flight WHERE id = :departFlight))");
+    query.bindValue(":orderId", orderId);
+    query.bindValue(":userId", userId);
+    query.bindValue(":flightRef", flightRef);
+    query.bindValue(":bookTime", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":seat", seatNumber);
+    query.bindValue(":departFlight", flightRef);
+    if (!execQuery(query) || !logOrderChange(query, userId, orderId, OrderUpserted)) return 0;
+
+    query.prepare("UPDATE flight SET rest_seats = rest_seats - 1 WHERE id = :flightRef");
+    query.bindValue(":flightRef", flightRef);
+    if (!execQuery(query)) return 0;
+    return orderId;
+}
+
+QString orderColumns() {
+    return QString("SELECT t.order_id, u.username, f.flight_id, %1, t.seat_number, "
+                   "f.departure, f.destination, f.departure_airport, f.arrival_airport, %2, %3 "
+                   "FROM ticket t JOIN flight f ON f.id = t.flight_ref JOIN user u ON u.id = t.user_id ")
+        .arg(timeColumn("t.book_time"), timeColumn("t.depart_time"), timeColumn("f.arrive_time"));
+}
+
+Order readOrder(const QSqlQuery& query) {
+    Order order;
+    order.order_id = QString::number(query.value(0).toLongLong());
+    order.username = query.value(1).toString();
+    order.flight_id = query.value(2).toString();
+    order.book_time = query.value(3).toLongLong();
+    order.seat_number = query.value(4).toString();
+    order.departure = query.value(5).toString();
+    order.destination = query.value(6).toString();
+    order.departure_airport = query.value(7).toString();
+    order.arrival_airport = query.value(8).toString();
+    order.depart_time = query.value(9).toLongLong();
+    order.arrive_time = query.value(10).toLongLong();
+    return order;
+}
+
+QString flightColumns() {
+    return QString("SELECT flight_id, departure, destination, departure_airport, arrival_airport, "
+                   "%1, %2, price, rest_seats FROM flight ")
+        .arg(timeColumn("depart_time"), timeColumn("arrive_time"));
+}
+
+Flight readFlight(const QSqlQuery& query) {
+    Flight f;
+    f.flight_id = query.value(0).toString();
+    f.departure = query.value(1).toString();
+    f.destination = query.value(2).toString();
+    f.departure_airport = query.value(3).toString();
+    f.arrival_airport = query.value(4).toString();
+    f.depart_time = query.value(5).toLongLong();
+    f.arrive_time = query.value(6).toLongLong();
+    f.price = query.value(7).toDouble();
+    f.rest_seats = query.value(8).toInt();
+    return f;
+}
+}
+
 DBManager* DBManager::getInstance() {
     if (!m_instance) {
         m_instance = new DBManager();
@@ -17,7 +555,44 @@ DBManager* DBManager::getInstance() {
 
 DBManager::DBManager() {}
 
-bool DBManager::init(const QString& dbPath) {
+bool DBManager::init(const QString& dbPath, bool backgroundMigrations) {
+    if (!openDatabase(dbPath)) return false;
+
+    QSqlQuery query(getDb());
+    // WAL：后台迁移和写事务进行时读请求不被阻塞（设置持久保存在库文件中）
+    execQuery(query, "PRAGMA journal_mode = WAL;");
+
+    if (!createTables()) {
+        qDebug() << "❌ 创建数据库表失败";
+        return false;
+    }
+
+    // 订单号生成器从库中最大订单号之后继续，避免时钟回拨后重复
+    if (execQuery(query, "SELECT MAX(order_id) FROM ticket") && query.next() && !query.value(0).isNull()) {
+        OrderIdGenerator::getInstance()->advancePast(query.value(0).toLongLong());
+    }
+
+    loadUsernameIndex();
+    backfillCityDictionary();
+    loadCityDictionary();
+    loadFlightCatalog();
+
+    // 剩余的耗时迁移在后台线程分批执行，服务照常启动
+    if (!backgroundMigrations) return true;
+    SchemaMigrator::getInstance()->startBackground([this]() { return getDb(); },
+                                                   [this]() { releaseConnection(); });
+    return true;
+}
+
+// 写进程在工作进程启动之前已完成建表与前台迁移
+bool DBManager::attach(const QString& dbPath) {
+    if (!openDatabase(dbPath)) return false;
+    reloadCaches();
+    qDebug() << "✅ 使用写进程维护的库结构，版本" << SchemaMigrator::getInstance()->version();
+    return true;
+}
+
+bool DBManager::openDatabase(const QString& dbPath) {
     m_dbPath = dbPath;
 
     QSqlDatabase db = getDb();
@@ -28,18 +603,24 @@ bool DBManager::init(const QString& dbPath) {
 
     qDebug() << "✅ SQLite 数据库连接成功：" << QFileInfo(dbPath).absoluteFilePath();
 
-    QSqlQuery query(db);
-    query.exec("PRAGMA foreign_keys = ON;");
-
-    if (!createTables()) {
-        qDebug() << "❌ 创建数据库表失败";
-        return false;
-    }
+    // 慢语句首次出现时在同一线程的连接上以相同参数抓取执行计划，EXPLAIN 本身不计入统计
+    StatementProfiler::getInstance()->setPlanProvider([this](const QString& sql, const QVariantList& values) {
+        QStringList plan;
+        QSqlQuery explain(getDb());
+        if (!explain.prepare("EXPLAIN QUERY PLAN " + sql)) return plan;
+        for (int i = 0; i < values.size(); ++i) explain.bindValue(i, values.at(i));
+        if (!explain.exec()) return plan;
+        while (explain.next()) plan.append(explain.value(3).toString());
+        return plan;
+    });
 
+    QSqlQuery query(db);
+    execQuery(query, "PRAGMA foreign_keys = ON;");
     return true;
 }
 
 QSqlDatabase DBManager::getDb() {
+    TraceSpan span("db", "getDb");
     QMutexLocker locker(&m_mutex);
     const Qt::HANDLE tid = QThread::currentThreadId();
 
@@ -67,123 +648,406 @@ bool DBManager::createTables() {
     QSqlDatabase db = getDb();
     QSqlQuery query(db);
 
-    QString createUserTable = R"(
-        CREATE TABLE IF NOT EXISTS user (
-            username    TEXT PRIMARY KEY,
-            password    TEXT NOT NULL,
-            real_name   TEXT,
-            phone       TEXT
-        )
-    )";
-
-    QString createFlightTable = R"(
-        CREATE TABLE IF NOT EXISTS flight (
-            flight_id           TEXT PRIMARY KEY,
-            departure           TEXT NOT NULL,
-            destination         TEXT NOT NULL,
-            departure_airport   TEXT,
-            arrival_airport     TEXT,
-            depart_time         TEXT NOT NULL,
-            arrive_time         TEXT NOT NULL,
-            price               REAL NOT NULL,
-            rest_seats          INTEGER NOT NULL
-        )
-    )";
-
-    QString createTicketTable = R"(
-        CREATE TABLE IF NOT EXISTS ticket (
-            order_id    TEXT PRIMARY KEY,
-            username    TEXT NOT NULL,
-            flight_id   TEXT NOT NULL,
-            book_time   TEXT NOT NULL,
-            status      INTEGER DEFAULT 1,
-            seat_number TEXT,
-            FOREIGN KEY (username) REFERENCES user(username),
-            FOREIGN KEY (flight_id) REFERENCES flight(flight_id)
-        )
-    )";
-
-    if (!query.exec(createUserTable)) {
+    // 城市字典与元数据（字典版本号等），避免每次请求扫描 flight 表
+    if (!execQuery(query, "CREATE TABLE IF NOT EXISTS city (name TEXT PRIMARY KEY)") ||
+        !execQuery(query, "CREATE TABLE IF NOT EXISTS meta (key TEXT PRIMARY KEY, value INTEGER NOT NULL)")) {
+        qDebug() << "创建 city/meta 表失败：" << query.lastError().text();
+        return false;
+    }
+
+    // 按 user_version 执行启动时的迁移步骤，耗时步骤由 init 交给后台线程
+    registerMigrations();
+    if (!SchemaMigrator::getInstance()->runForeground(db, detectLegacyVersion())) {
+        return false;
+    }
+
+    if (!execQuery(query, kCreateUserTable)) {
         qDebug() << "创建 user 表失败：" << query.lastError().text();
         return false;
     }
 
-    if (!query.exec(createFlightTable)) {
+    if (!execQuery(query, kCreateFlightTable)) {
         qDebug() << "创建 flight 表失败：" << query.lastError().text();
         return false;
     }
 
-    if (!query.exec(createTicketTable)) {
+    if (!execQuery(query, kCreateTicketTable)) {
         qDebug() << "创建 ticket 表失败：" << query.lastError().text();
         return false;
     }
 
-    query.exec("CREATE INDEX IF NOT EXISTS idx_flight_departure ON flight(departure)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_flight_destination ON flight(destination)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_flight_depart_time ON flight(depart_time)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_ticket_username ON ticket(username)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_ticket_flight ON ticket(flight_id)");
+    if (!execQuery(query, kCreateOrderChangeTable)) {
+        qDebug() << "创建 order_change 表失败：" << query.lastError().text();
+        return false;
+    }
+
+    if (!execQuery(query, kCreateSessionTable)) {
+        qDebug() << "创建 session 表失败：" << query.lastError().text();
+        return false;
+    }
+
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_flight_departure ON flight(departure)");
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_flight_destination ON flight(destination)");
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_flight_depart_time ON flight(depart_time)");
+    // 订单分页按 (user_id, depart_time, order_id) 定位，覆盖排序与游标比较
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_ticket_user_depart ON ticket(user_id, depart_time DESC, order_id DESC)");
+    // 选座冲突检查与已占座位查询只需读索引
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_ticket_flight ON ticket(flight_ref, seat_number)");
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_order_change_user ON order_change(user_id, seq)");
+    execQuery(query, "CREATE INDEX IF NOT EXISTS idx_session_user ON session(user_id)");
+    // 离线导入会临时删除 flight 的索引，导入中途被终止时在此补回已完成版本的索引
+    if (SchemaMigrator::getInstance()->reached(kSchemaRouteIndex)) {
+        execQuery(query, kCreateRouteIndex);
+    }
 
     qDebug() << "✅ 数据库表结构创建成功";
     return true;
 }
 
+bool DBManager::finishMigrations() {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+    SchemaMigrator* migrator = SchemaMigrator::getInstance();
+    migrator->runPending(db);
+    return migrator->version() >= migrator->latestVersion();
+}
+
+// 结构迁移按版本号登记，新的结构变化在末尾追加：耗时与数据量相关的步骤（建索引、回填数据）
+// 一律用 step，在后台分批执行，读路径用 SchemaMigrator::reached 切换；apply 只用于常数时间的
+// 结构变化，或像整数主键那样明确需要停机的一次性迁移
+void DBManager::registerMigrations() {
+    SchemaMigrator* migrator = SchemaMigrator::getInstance();
+    if (migrator->latestVersion() > 0) return;
+
+    // 唯一保留在前台、需要停机的迁移：所有表的主键与外键由字符串改为整数，订单号全部重新生成。
+    // 在线迁移要求新旧两套主键的读写路径并存，而字符串主键的代码已经删除；这一步只对 user_version
+    // 引入之前的库执行一次，停机时间与订单数成正比，升级前应先备份并在维护窗口内启动
+    Migration integerKeys;
+    integerKeys.version = kSchemaIntegerKeys;
+    integerKeys.name = "整数主键";
+    integerKeys.apply = [this](QSqlDatabase&) { return migrateToIntegerKeys(); };
+    migrator->add(integerKeys);
+
+    Migration epochTimes;
+    epochTimes.version = kSchemaEpochTimes;
+    epochTimes.name = "时间列改为 Unix 秒";
+    epochTimes.step = [this](QSqlDatabase& db, qint64* cursor, bool* done) {
+        return migrateTimesToEpoch(db, cursor, done);
+    };
+    epochTimes.total = [](QSqlDatabase& db) {
+        QSqlQuery query(db);
+        return execQuery(query, "SELECT (SELECT COUNT(*) FROM flight) + (SELECT COUNT(*) FROM ticket)") && query.next()
+                   ? query.value(0).toLongLong() : 0;
+    };
+    migrator->add(epochTimes);
+
+    // SQLite 只能用一条语句建完整个索引，无法分批；建索引期间读请求照常（WAL），写请求排队等待
+    Migration routeIndex;
+    routeIndex.version = kSchemaRouteIndex;
+    routeIndex.name = "航线索引";
+    routeIndex.step = [](QSqlDatabase& db, qint64*, bool* done) {
+        QSqlQuery query(db);
+        if (!execQuery(query, kCreateRouteIndex)) {
+            return false;
+        }
+        *done = true;
+        return true;
+    };
+    migrator->add(routeIndex);
+
+    // 旧版明文口令原本只在用户下次登录时升级，这里在后台全部补齐；完成前登录仍兼容明文
+    Migration hashedPasswords;
+    hashedPasswords.version = kSchemaHashedPasswords;
+    hashedPasswords.name = "明文口令哈希";
+    hashedPasswords.step = hashLegacyPasswords;
+    hashedPasswords.total = [](QSqlDatabase& db) {
+        QSqlQuery query(db);
+        return execQuery(query, "SELECT MAX(id) FROM user") && query.next() ? query.value(0).toLongLong() : 0;
+    };
+    migrator->add(hashedPasswords);
+}
+
+// user_version 引入之前的库按表结构判定版本；新库直接按当前结构建表
+int DBManager::detectLegacyVersion() {
+    if (hasLegacyTextKeys()) return kSchemaTextKeys;
+    if (hasTextTimeColumns()) return kSchemaIntegerKeys;
+    return kSchemaEpochTimes;
+}
+
+// 旧版库以用户名、航班号、UUID 字符串为主键（user 表没有 id 列）
+bool DBManager::hasLegacyTextKeys() {
+    QSqlQuery query(getDb());
+    if (!execQuery(query, "PRAGMA table_info(user)")) return false;
+    bool hasTable = false;
+    while (query.next()) {
+        hasTable = true;
+        if (query.value(1).toString() == "id") return false;
+    }
+    return hasTable;
+}
+
+// 一次性迁移到整数主键：user/flight 沿用原 rowid 作为 id，订单按下单时间重新生成订单号。
+// 旧订单号无法映射，清空变更日志并抬高下限，客户端下次同步时全量重新拉取
+bool DBManager::migrateToIntegerKeys() {
+    QSqlDatabase db = getDb();
+    QSqlQuery query(db);
+    qDebug() << "检测到旧版字符串主键，开始迁移到整数主键...";
+
+    execQuery(query, "PRAGMA foreign_keys = OFF");
+    db.transaction();
+    auto fail = [&](const char* step) {
+        qDebug() << "❌ 主键迁移失败：" << step << query.lastError().text();
+        db.rollback();
+        execQuery(query, "PRAGMA foreign_keys = ON");
+        return false;
+    };
+
+    if (!execQuery(query, "ALTER TABLE user RENAME TO user_old") ||
+        !execQuery(query, "ALTER TABLE flight RENAME TO flight_old") ||
+        !execQuery(query, "ALTER TABLE ticket RENAME TO ticket_old")) {
+        return fail("重命名旧表");
+    }
+
+    if (!execQuery(query, kCreateUserTable) ||
+        !execQuery(query, "INSERT INTO user (id, username, password, real_name, phone) "
+                    "SELECT rowid, username, password, real_name, phone FROM user_old")) {
+        return fail("user");
+    }
+    if (!execQuery(query, kCreateFlightTable) ||
+        !execQuery(query, "INSERT INTO flight (id, flight_id, departure, destination, departure_airport, arrival_airport, "
+                    "depart_time, arrive_time, price, rest_seats) "
+                    "SELECT rowid, flight_id, departure, destination, departure_airport, arrival_airport, " +
+                    epochFromText("depart_time") + ", " + epochFromText("arrive_time") + ", price, rest_seats FROM flight_old")) {
+        return fail("flight");
+    }
+    if (!execQuery(query, kCreateTicketTable)) {
+        return fail("ticket");
+    }
+
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    if (!execQuery(select, "SELECT u.id, f.id, " + epochFromText("t.book_time") + ", t.status, t.seat_number, f.depart_time "
+                     "FROM ticket_old t JOIN user u ON u.username = t.username "
+                     "JOIN flight f ON f.flight_id = t.flight_id ORDER BY t.book_time")) {
+        qDebug() << select.lastError().text();
+        return fail("读取旧订单");
+    }
+    query.prepare("INSERT INTO ticket (order_id, user_id, flight_ref, book_time, status, seat_number, depart_time) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?)");
+    int migrated = 0;
+    while (select.next()) {
+        query.bindValue(0, OrderIdGenerator::getInstance()->next());
+        for (int i = 0; i < 6; ++i) {
+            query.bindValue(i + 1, select.value(i));
+        }
+        if (!execQuery(query)) return fail("写入订单");
+        ++migrated;
+    }
+
+    qint64 lastSeq = 0;
+    if (execQuery(query, "SELECT seq FROM sqlite_sequence WHERE name = 'order_change'") && query.next()) {
+        lastSeq = query.value(0).toLongLong();
+    }
+    if (!execQuery(query, "DROP TABLE IF EXISTS order_change") || !execQuery(query, kCreateOrderChangeTable)) {
+        return fail("order_change");
+    }
+    if (lastSeq > 0) {
+        query.prepare("INSERT INTO sqlite_sequence (name, seq) VALUES ('order_change', :seq)");
+        query.bindValue(":seq", lastSeq);
+        if (!execQuery(query)) return fail("sqlite_sequence");
+        query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('order_change_floor', :floor)");
+        query.bindValue(":floor", lastSeq + 1);
+        if (!execQuery(query)) return fail("meta");
+    }
+
+    if (!execQuery(query, "DROP TABLE ticket_old") ||
+        !execQuery(query, "DROP TABLE flight_old") ||
+        !execQuery(query, "DROP TABLE user_old")) {
+        return fail("删除旧表");
+    }
+
+    if (!db.commit()) return fail("提交");
+    execQuery(query, "PRAGMA foreign_keys = ON");
+    qDebug() << "✅ 主键迁移完成，订单数：" << migrated;
+    return true;
+}
+
+// 旧版库的时间列为 ISO 文本
+bool DBManager::hasTextTimeColumns() {
+    QSqlQuery query(getDb());
+    if (!execQuery(query, "PRAGMA table_info(flight)")) return false;
+    while (query.next()) {
+        if (query.value(1).toString() == "depart_time") {
+            return query.value(2).toString().compare("INTEGER", Qt::CaseInsensitive) != 0;
+        }
+    }
+    return false;
+}
+
+// 后台步骤：首批加入整数列与触发器，之后每次回填一批，flight 在前、ticket 在后，全部回填后切换列名。
+// 新库与由整数主键迁移一并转换过的库没有文本时间列，直接完成。cursor 只计已回填的行数，用于进度日志
+bool DBManager::migrateTimesToEpoch(QSqlDatabase& db, qint64* cursor, bool* done) {
+    if (!hasTextTimeColumns()) {
+        *done = true;
+        return true;
+    }
+    if (!prepareEpochColumns(db)) return false;
+
+    for (const EpochTable& table : epochTables()) {
+        int rows = 0;
+        bool finished = false;
+        if (!backfillEpochBatch(db, table, &rows, &finished)) return false;
+        if (finished) continue;
+        *cursor += rows;
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!switchEpochColumns(db)) return false;
+    qDebug() << "时间列回填完成，已切换到整数列，建索引与切换耗时" << timer.elapsed() << "ms";
+    *done = true;
+    return true;
+}
+
 // 注册
 bool DBManager::registerUser(const User& user) {
+    static const DbOp op("register_user");
+    DbOpScope scope(op);
+    if (isUserExist(user.username)) {
+        return false;
+    }
+    // 口令在调用线程（认证线程池）中哈希，写进程只做插入
+    User hashed = user;
+    hashed.password = PasswordHasher::hash(user.password);
+    if (m_forwarder) {
+        const bool success = forwardWrite(m_forwarder, WriteOp::RegisterUser, false, hashed);
+        // 本进程立即可见，其他工作进程经写进程的通知更新
+        if (success) UsernameIndex::getInstance()->add(user.username);
+        return success;
+    }
+    return insertUser(hashed);
+}
+
+// password 为 PasswordHasher 格式
+bool DBManager::insertUser(const User& user) {
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT username FROM user WHERE username = :username");
-    query.bindValue(":username", user.username);
-    if (query.exec() && query.next()) {
+    if (isUserExist(user.username)) {
         return false;
     }
 
+    QSqlQuery query(db);
     query.prepare("INSERT INTO user (username, password, real_name, phone) VALUES (:username, :password, :real_name, :phone)");
     query.bindValue(":username", user.username);
     query.bindValue(":password", user.password);
     query.bindValue(":real_name", user.real_name);
     query.bindValue(":phone", user.phone);
 
-    return query.exec();
+    // 插入与加入过滤器作为整体，和重建互斥，避免重建期间新注册的用户名丢失
+    QMutexLocker locker(&m_userIndexMutex);
+    if (!execQuery(query)) return false;
+    UsernameIndex::getInstance()->add(user.username);
+    if (UsernameIndex::getInstance()->needsRebuild()) {
+        rebuildUsernameIndex();
+    }
+    return true;
+}
+
+// 全量加载用户名重建布隆过滤器，启动时及元素数超过容量时调用
+void DBManager::loadUsernameIndex() {
+    QMutexLocker locker(&m_userIndexMutex);
+    rebuildUsernameIndex();
+}
+
+void DBManager::rebuildUsernameIndex() {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return;
+
+    QStringList usernames;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!execQuery(query, "SELECT username FROM user")) {
+        qDebug() << "加载用户名索引失败：" << query.lastError().text();
+        return;
+    }
+    while (query.next()) {
+        usernames.append(query.value(0).toString());
+    }
+    UsernameIndex::getInstance()->rebuild(usernames);
 }
 
-ResponseStatus DBManager::verifyUser(const QString& username, const QString& password) {
+ResponseStatus DBManager::verifyUser(const QString& username, const QString& password, qint64* userId) {
+    static const DbOp op("verify_user");
+    DbOpScope scope(op);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return Failed;
 
     QSqlQuery query(db);
-    query.prepare("SELECT password FROM user WHERE username = :username");
+    query.prepare("SELECT id, password FROM user WHERE username = :username");
     query.bindValue(":username", username);
 
-    if (!query.exec() || !query.next()) {
+    if (!execQuery(query) || !query.next()) {
         return UserNotFound;
     }
 
-    QString dbPwd = query.value(0).toString();
-    return (dbPwd == password) ? Success : PasswordError;
+    const qint64 rowid = query.value(0).toLongLong();
+    const QString stored = query.value(1).toString();
+    bool needsRehash = false;
+    if (!PasswordHasher::verify(password, stored, &needsRehash)) {
+        return PasswordError;
+    }
+    // 旧版明文或迭代次数过低的记录在验证成功后升级，哈希在本线程计算，写入与其他写操作一样经写进程
+    if (needsRehash) {
+        const QString hashed = PasswordHasher::hash(password);
+        const bool upgraded = m_forwarder ? forwardWrite(m_forwarder, WriteOp::UpgradePassword, false, rowid, stored, hashed)
+                                          : upgradePassword(rowid, stored, hashed);
+        if (!upgraded) {
+            logWarning(logDb, "升级口令哈希失败：用户 {}", username);
+        }
+    }
+    if (userId) *userId = rowid;
+    return Success;
+}
+
+// 只在口令仍是验证时读到的旧值时替换，期间已改密的记录保持不变
+bool DBManager::upgradePassword(qint64 rowid, const QString& oldHash, const QString& newHash) {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery update(db);
+    update.prepare("UPDATE user SET password = :password WHERE id = :rowid AND password = :old");
+    update.bindValue(":password", newHash);
+    update.bindValue(":rowid", rowid);
+    update.bindValue(":old", oldHash);
+    return execQuery(update);
 }
 
 User DBManager::getUserInfo(const QString& username) {
+    static const DbOp op("get_user_info");
+    DbOpScope scope(op);
     User user;
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return user;
 
     QSqlQuery query(db);
-    query.prepare("SELECT username, password, real_name, phone FROM user WHERE username = :username");
+    // 口令哈希不出库，应答中的 password 字段始终为空
+    query.prepare("SELECT username, real_name, phone FROM user WHERE username = :username");
     query.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
+    if (execQuery(query) && query.next()) {
         user.username = query.value(0).toString();
-        user.password = query.value(1).toString();
-        user.real_name = query.value(2).toString();
-        user.phone = query.value(3).toString();
+        user.real_name = query.value(1).toString();
+        user.phone = query.value(2).toString();
     }
     return user;
 }
 
 bool DBManager::updateUserInfo(const User& user) {
+    static const DbOp op("update_user_info");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::UpdateUserInfo, false, user);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
@@ -192,10 +1056,13 @@ bool DBManager::updateUserInfo(const User& user) {
     query.bindValue(":phone", user.phone);
     query.bindValue(":username", user.username);
 
-    return query.exec();
+    return execQuery(query);
 }
 
 bool DBManager::changePassword(const QString& username, const QString& oldPass, const QString& newPass) {
+    static const DbOp op("change_password");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::ChangePassword, false, username, oldPass, newPass);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
@@ -204,90 +1071,121 @@ bool DBManager::changePassword(const QString& username, const QString& oldPass,
     query.prepare("SELECT password FROM user WHERE username = :username");
     query.bindValue(":username", username);
     
-    if (!query.exec() || !query.next()) {
-        qDebug() << "修改密码失败：用户不存在" << username;
+    if (!execQuery(query) || !query.next()) {
+        logInfo(logDb, "修改密码失败：用户不存在 {}", username);
         return false;
     }
     
-    if (query.value(0).toString() != oldPass) {
-        qDebug() << "修改密码失败：旧密码不正确";
+    if (!PasswordHasher::verify(oldPass, query.value(0).toString())) {
+        logInfo(logDb, "修改密码失败：旧密码不正确");
         return false;
     }
     
     query.prepare("UPDATE user SET password = :newPass WHERE username = :username");
-    query.bindValue(":newPass", newPass);
+    query.bindValue(":newPass", PasswordHasher::hash(newPass));
     query.bindValue(":username", username);
     
-    if (query.exec()) {
-        qDebug() << "用户" << username << "密码修改成功";
+    if (execQuery(query)) {
+        // 共享会话表中该用户的会话一并失效，各进程内的会话由调用方与改密通知清除
+        query.prepare("DELETE FROM session WHERE user_id = (SELECT id FROM user WHERE username = :username)");
+        query.bindValue(":username", username);
+        execQuery(query);
+        logInfo(logDb, "用户 {} 密码修改成功", username);
         return true;
     }
     return false;
 }
 
+// 布隆过滤器判定不存在时直接返回，正向缓存命中时也不查库
 bool DBManager::isUserExist(const QString& username) {
+    static const DbOp op("is_user_exist");
+    DbOpScope scope(op);
+    UsernameIndex* index = UsernameIndex::getInstance();
+    switch (index->lookup(username)) {
+    case UsernameIndex::DefinitelyAbsent:
+        return false;
+    case UsernameIndex::KnownPresent:
+        return true;
+    case UsernameIndex::Unknown:
+        break;
+    }
+
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
     
     QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM user WHERE username = :username");
+    query.prepare("SELECT 1 FROM user WHERE username = :username");
     query.bindValue(":username", username);
     
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
+    if (execQuery(query) && query.next()) {
+        index->rememberPresent(username);
+        return true;
     }
     return false;
 }
 
 // 查询航班（支持部分条件为空）
 QList<Flight> DBManager::queryFlights(const QString& departure, const QString& destination, const QDate& date) {
+    static const DbOp op("query_flights");
+    DbOpScope scope(op);
     QList<Flight> flights;
+
+    // 无日期时只查今天及以后的航班
+    const qint64 from = (date.isValid() ? date.addDays(-3) : QDate::currentDate()).startOfDay().toSecsSinceEpoch();
+    const qint64 to = date.isValid() ? date.addDays(4).startOfDay().toSecsSinceEpoch() : 0;
+    // 航班目录快照与库一致时直接在映射的页面上检索，不访问数据库
+    if (FlightCatalog::getInstance()->search(departure, destination, from, to, &flights)) return flights;
+
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return flights;
 
-    QString sql = "SELECT flight_id, departure, destination, departure_airport, arrival_airport, "
-                  "depart_time, arrive_time, price, rest_seats FROM flight WHERE rest_seats > 0";
-    
-    if (!departure.isEmpty())   sql += " AND departure LIKE :departure";
-    if (!destination.isEmpty()) sql += " AND destination LIKE :destination";
+    QString sql = flightColumns() + "WHERE rest_seats > 0";
+    QList<QPair<QString, QVariant>> binds;
+
+    // 航线索引建成后，已收录的城市名按字典展开为等值条件（与 LIKE '%城市%' 命中的城市相同），
+    // 走 idx_flight_route；索引建成前或城市未收录时仍用 LIKE
+    const bool routeIndex = SchemaMigrator::getInstance()->reached(kSchemaRouteIndex);
+    auto addCityFilter = [&](const char* column, const QString& keyword) {
+        if (keyword.isEmpty()) return;
+        const QString prefix = QString(":%1").arg(column);
+        if (routeIndex && CityDictionary::getInstance()->contains(keyword)) {
+            QStringList placeholders;
+            for (const QString& city : CityDictionary::getInstance()->cities()) {
+                if (!city.contains(keyword)) continue;
+                placeholders.append(prefix + QString::number(placeholders.size()));
+                binds.append(qMakePair(placeholders.last(), QVariant(city)));
+            }
+            sql += QString(" AND %1 IN (%2)").arg(column, placeholders.join(", "));
+        } else {
+            sql += QString(" AND %1 LIKE %2").arg(column, prefix);
+            binds.append(qMakePair(prefix, QVariant("%" + keyword + "%")));
+        }
+    };
+    addCityFilter("departure", departure);
+    addCityFilter("destination", destination);
     
-    // 日期检索逻辑
+    // 日期检索逻辑：前后各 3 天换算成半开区间 [from, to)，走 depart_time 索引做范围扫描
+    const QString departTime = timeColumn("depart_time");
     if (date.isValid()) {
-        QDate startDate = date.addDays(-3);
-        QDate endDate = date.addDays(3);
-        sql += " AND DATE(depart_time) BETWEEN :startDate AND :endDate";
+        sql += QString(" AND %1 >= :from AND %1 < :to").arg(departTime);
     } else {
-        // 无日期限制，仅查询未来航班
-        sql += " AND DATE(depart_time) >= :today";
+        sql += QString(" AND %1 >= :from").arg(departTime);
     }
     
-    sql += " ORDER BY depart_time ASC";
+    sql += QString(" ORDER BY %1 ASC").arg(departTime);
 
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     query.prepare(sql);
-    if (!departure.isEmpty())   query.bindValue(":departure", "%" + departure + "%");
-    if (!destination.isEmpty()) query.bindValue(":destination", "%" + destination + "%");
-    
-    if (date.isValid()) {
-        query.bindValue(":startDate", date.addDays(-3).toString("yyyy-MM-dd"));
-        query.bindValue(":endDate", date.addDays(3).toString("yyyy-MM-dd"));
-    } else {
-        query.bindValue(":today", QDate::currentDate().toString("yyyy-MM-dd"));
+    for (const auto& bind : binds) {
+        query.bindValue(bind.first, bind.second);
     }
+    query.bindValue(":from", from);
+    if (date.isValid()) query.bindValue(":to", to);
 
-    if (query.exec()) {
+    if (execQuery(query)) {
         while (query.next()) {
-            Flight f;
-            f.flight_id = query.value(0).toString();
-            f.departure = query.value(1).toString();
-            f.destination = query.value(2).toString();
-            f.departure_airport = query.value(3).toString();
-            f.arrival_airport = query.value(4).toString();
-            f.depart_time = QDateTime::fromString(query.value(5).toString(), Qt::ISODate);
-            f.arrive_time = QDateTime::fromString(query.value(6).toString(), Qt::ISODate);
-            f.price = query.value(7).toDouble();
-            f.rest_seats = query.value(8).toInt();
-            flights.append(f);
+            flights.append(readFlight(query));
         }
     }
     return flights;
@@ -299,42 +1197,96 @@ QList<Flight> DBManager::getAllFlights(int limit) {
     if (!db.isOpen()) return flights;
 
     QSqlQuery query(db);
-    query.prepare(QString("SELECT flight_id, departure, destination, departure_airport, arrival_airport, "
-                  "depart_time, arrive_time, price, rest_seats FROM flight "
-                  "WHERE depart_time > datetime('now', 'localtime') ORDER BY depart_time ASC LIMIT %1").arg(limit));
+    query.setForwardOnly(true);
+    query.prepare(flightColumns() +
+                  QString("WHERE %1 > :now ORDER BY %1 ASC LIMIT :limit").arg(timeColumn("depart_time")));
+    query.bindValue(":now", QDateTime::currentSecsSinceEpoch());
+    query.bindValue(":limit", limit);
     
-    if (query.exec()) {
+    if (execQuery(query)) {
         while (query.next()) {
-            Flight f;
-            f.flight_id = query.value(0).toString();
-            f.departure = query.value(1).toString();
-            f.destination = query.value(2).toString();
-            f.departure_airport = query.value(3).toString();
-            f.arrival_airport = query.value(4).toString();
-            f.depart_time = QDateTime::fromString(query.value(5).toString(), Qt::ISODate);
-            f.arrive_time = QDateTime::fromString(query.value(6).toString(), Qt::ISODate);
-            f.price = query.value(7).toDouble();
-            f.rest_seats = query.value(8).toInt();
-            flights.append(f);
+            flights.append(readFlight(query));
         }
     }
     return flights;
 }
 
 QStringList DBManager::getCities() {
-    QStringList cities;
+    return CityDictionary::getInstance()->cities();
+}
+
+// 启动时加载城市字典；city 表为空而已有航班时（旧库）从 flight 表回填一次
+// 旧库首次启动时 city 表为空，从 flight 表回填。只在执行写操作的进程（init）中调用，
+// 工作进程经 reloadCaches 只读取字典
+void DBManager::backfillCityDictionary() {
     QSqlDatabase db = getDb();
-    if (!db.isOpen()) return cities;
+    if (m_forwarder || !db.isOpen()) return;
 
     QSqlQuery query(db);
-    query.exec("SELECT DISTINCT departure FROM flight UNION SELECT DISTINCT destination FROM flight ORDER BY 1");
+    if (execQuery(query, "SELECT COUNT(*) FROM city") && query.next() && query.value(0).toInt() == 0) {
+        execQuery(query, "INSERT OR IGNORE INTO city (name) "
+                   "SELECT departure FROM flight UNION SELECT destination FROM flight");
+        execQuery(query, "INSERT OR REPLACE INTO meta (key, value) VALUES ('city_version', 1)");
+    }
+}
+
+void DBManager::loadCityDictionary() {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return;
+
+    QSqlQuery query(db);
+    quint32 version = 0;
+    if (execQuery(query, "SELECT value FROM meta WHERE key = 'city_version'") && query.next()) {
+        version = query.value(0).toUInt();
+    }
+
+    QStringList cities;
+    execQuery(query, "SELECT name FROM city");
     while (query.next()) {
         cities.append(query.value(0).toString());
     }
-    return cities;
+    CityDictionary::getInstance()->reset(cities, version);
+    qDebug() << "城市字典：" << cities.size() << "个城市，版本" << version;
+}
+
+// 收录新城市并持久化新版本号；已收录的城市直接跳过，不访问数据库
+bool DBManager::registerCities(const QStringList& cities) {
+    CityDictionary* dictionary = CityDictionary::getInstance();
+    if (dictionary->missing(cities).isEmpty()) return true;
+
+    QMutexLocker locker(&m_cityMutex);
+    const QStringList added = dictionary->missing(cities);
+    if (added.isEmpty()) return true;
+
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("INSERT OR IGNORE INTO city (name) VALUES (:name)");
+    for (const QString& city : added) {
+        query.bindValue(":name", city);
+        if (!execQuery(query)) {
+            db.rollback();
+            return false;
+        }
+    }
+    const quint32 version = dictionary->version() + 1;
+    query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('city_version', :version)");
+    query.bindValue(":version", version);
+    if (!execQuery(query) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+
+    dictionary->merge(added, version);
+    qDebug() << "城市字典新增：" << added << "版本" << version;
+    return true;
 }
 
 int DBManager::getRestSeats(const QString& flight_id) {
+    static const DbOp op("get_rest_seats");
+    DbOpScope scope(op);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return -2;
 
@@ -342,21 +1294,31 @@ int DBManager::getRestSeats(const QString& flight_id) {
     query.prepare("SELECT rest_seats FROM flight WHERE flight_id = :flight_id");
     query.bindValue(":flight_id", flight_id);
     
-    if (!query.exec()) return -2;
+    if (!execQuery(query)) return -2;
     if (!query.next()) return -1;
     return query.value(0).toInt();
 }
 
 QStringList DBManager::getOccupiedSeats(const QString& flightId) {
+    static const DbOp op("get_occupied_seats");
+    DbOpScope scope(op);
     QStringList seats;
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return seats;
 
     QSqlQuery query(db);
-    query.prepare("SELECT seat_number FROM ticket WHERE flight_id = :flightId");
+    // 座位库存跟踪的航班直接读位图
+    FlightRef flight;
+    if (SeatInventory::getInstance()->isActive() && findFlight(query, flightId, &flight) &&
+        SeatInventory::getInstance()->occupiedSeats(flight.id, &seats)) {
+        return seats;
+    }
+
+    query.prepare("SELECT seat_number FROM ticket "
+                  "WHERE flight_ref = (SELECT id FROM flight WHERE flight_id = :flightId)");
     query.bindValue(":flightId", flightId);
     
-    if (query.exec()) {
+    if (execQuery(query)) {
         while (query.next()) {
             seats.append(query.value(0).toString());
         }
@@ -365,6 +1327,9 @@ QStringList DBManager::getOccupiedSeats(const QString& flightId) {
 }
 
 bool DBManager::addFlight(const Flight& flight) {
+    static const DbOp op("add_flight");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::AddFlight, false, flight);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
@@ -377,177 +1342,403 @@ bool DBManager::addFlight(const Flight& flight) {
     query.bindValue(":dest", flight.destination);
     query.bindValue(":dep_airport", flight.departure_airport);
     query.bindValue(":arr_airport", flight.arrival_airport);
-    query.bindValue(":dtime", flight.depart_time.toString(Qt::ISODate));
-    query.bindValue(":atime", flight.arrive_time.toString(Qt::ISODate));
+    query.bindValue(":dtime", flight.depart_time);
+    query.bindValue(":atime", flight.arrive_time);
     query.bindValue(":price", flight.price);
     query.bindValue(":seats", flight.rest_seats);
 
-    return query.exec();
+    if (!execQuery(query) || !registerCities({flight.departure, flight.destination})) return false;
+    scheduleFlightCatalogRefresh();
+    return true;
+}
+
+bool DBManager::importFlights(FlightFileReader& reader, const ImportOptions& options, ImportStats* stats) {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    FlightBulkWriter writer(db, options);
+    if (!writer.begin()) {
+        qDebug() << "❌ 导入初始化失败：" << writer.errorString();
+        return false;
+    }
+    Flight flight;
+    while (reader.next(&flight)) {
+        if (!writer.add(flight)) {
+            qDebug() << "❌ 导入写入失败：" << writer.errorString();
+            return false;
+        }
+    }
+    // 读取出错时已提交的事务保留，重新导入同一文件会跳过这些航班号
+    if (!reader.errorString().isEmpty()) {
+        qDebug() << "❌ 读取航班文件失败：" << reader.errorString();
+        return false;
+    }
+    if (!writer.finish()) {
+        qDebug() << "❌ 导入提交失败：" << writer.errorString();
+        return false;
+    }
+    if (stats) {
+        *stats = writer.stats();
+        stats->invalid = reader.invalid();
+    }
+    if (!registerCities(writer.cities())) return false;
+    refreshFlightCatalog();
+    return true;
+}
+
+bool DBManager::importFlights(const QList<Flight>& flights, ImportStats* stats) {
+    static const DbOp op("import_flights");
+    DbOpScope scope(op);
+    if (m_forwarder) {
+        QByteArray result;
+        if (!m_forwarder->call(WriteOp::ImportFlights, encodeWrite(flights), &result)) return false;
+        QDataStream in(result);
+        in.setVersion(QDataStream::Qt_6_0);
+        bool success = false;
+        ImportStats remote;
+        in >> success >> remote.rows >> remote.inserted >> remote.skipped >> remote.invalid >> remote.elapsedMs >> remote.indexMs;
+        if (stats) *stats = remote;
+        return in.status() == QDataStream::Ok && success;
+    }
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    // 整批在一个事务内写入
+    ImportOptions options;
+    options.rowsPerTransaction = std::numeric_limits<int>::max();
+    FlightBulkWriter writer(db, options);
+    if (!writer.begin()) return false;
+    for (const Flight& flight : flights) {
+        if (!writer.add(flight)) return false;
+    }
+    if (!writer.finish()) return false;
+    if (stats) *stats = writer.stats();
+    if (!registerCities(writer.cities())) return false;
+    scheduleFlightCatalogRefresh();
+    return true;
 }
 
 // 不指定座位的随机订票
-QString DBManager::bookTicket(const QString& username, const QString& flight_id) {
+qint64 DBManager::bookTicket(qint64 userId, const QString& flight_id) {
+    static const DbOp op("book_ticket");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite<qint64>(m_forwarder, WriteOp::BookTicket, 0, userId, flight_id);
     QSqlDatabase db = getDb();
-    if (!db.isOpen()) return "";
+    if (!db.isOpen()) return 0;
     
     db.transaction();
 
     QSqlQuery query(db);
     
-    query.prepare("SELECT rest_seats FROM flight WHERE flight_id = :flight_id");
-    query.bindValue(":flight_id", flight_id);
-    if (!query.exec() || !query.next()) {
+    FlightRef flight;
+    if (!findFlight(query, flight_id, &flight) || flight.restSeats <= 0) {
         db.rollback();
-        return "";
+        return 0;
     }
 
-    int remaining = query.value(0).toInt();
-    if (remaining <= 0) {
-        db.rollback();
-        return "";
-    }
-
-    query.prepare("SELECT seat_number FROM ticket WHERE flight_id = :flight_id");
-    query.bindValue(":flight_id", flight_id);
-    QSet<QString> occupiedSeats;
-    if (query.exec()) {
-        while (query.next()) {
-            occupiedSeats.insert(query.value(0).toString());
+    // 座位库存跟踪该航班时直接在位图的空位中选，选中的座位仍按索引确认一次
+    QString seatNumber = SeatInventory::getInstance()->pickFreeSeat(flight.id);
+    if (!seatNumber.isEmpty() && !seatFree(query, flight.id, seatNumber)) seatNumber.clear();
+
+    if (seatNumber.isEmpty()) {
+        query.prepare("SELECT seat_number FROM ticket WHERE flight_ref = :flightRef");
+        query.bindValue(":flightRef", flight.id);
+        QSet<QString> occupiedSeats;
+        if (execQuery(query)) {
+            while (query.next()) {
+                occupiedSeats.insert(query.value(0).toString());
+            }
         }
-    }
 
-    QString seatNumber;
-    int attempts = 0;
-    while (attempts < 100) {
-        int row = QRandomGenerator::global()->bounded(1, 31);
-        char col = 'A' + QRandomGenerator::global()->bounded(0, 6);
-        seatNumber = QString("%1%2").arg(row).arg(col);
-        
-        if (!occupiedSeats.contains(seatNumber)) {
-            break;
-        }
-        attempts++;
-    }
-    
-    if (attempts >= 100) {
-        db.rollback();
-        qDebug() << "订票失败：无法找到空闲座位";
-        return "";
-    }
+        int attempts = 0;
+        while (attempts < 100) {
+            int row = QRandomGenerator::global()->bounded(1, 31);
+            char col = 'A' + QRandomGenerator::global()->bounded(0, 6);
+            seatNumber = QString("%1%2").arg(row).arg(col);
 
-    QString orderId = QUuid::createUuid().toString(QUuid::WithoutBraces);
-    QString bookTime = QDateTime::currentDateTime().toString(Qt::ISODate);
+            if (!occupiedSeats.contains(seatNumber)) {
+                break;
+            }
+            attempts++;
+        }
 
-    query.prepare("INSERT INTO ticket (order_id, username, flight_id, book_time, status, seat_number) "
-                  "VALUES (:order_id, :username, :flight_id, :book_time, 1, :seat_number)");
-    query.bindValue(":order_id", orderId);
-    query.bindValue(":username", username);
-    query.bindValue(":flight_id", flight_id);
-    query.bindValue(":book_time", bookTime);
-    query.bindValue(":seat_number", seatNumber);
-    
-    if (!query.exec()) {
-        db.rollback();
-        return "";
+        if (attempts >= 100) {
+            db.rollback();
+            logInfo(logDb, "订票失败：无法找到空闲座位");
+            return 0;
+        }
     }
 
-    query.prepare("UPDATE flight SET rest_seats = rest_seats - 1 WHERE flight_id = :flight_id");
-    query.bindValue(":flight_id", flight_id);
-    if (!query.exec()) {
+    const qint64 orderId = insertTicket(query, userId, flight.id, seatNumber);
+    if (orderId == 0 || !publishSeats(query, {{flight.id, seatNumber, true}})) {
         db.rollback();
-        return "";
+        return 0;
     }
 
-    db.commit();
+    publishRestSeats(query, flight.id);
+    if (!commitSeatChange(db, {flight.id})) return 0;
     return orderId;
 }
 
 // 指定座位订票（来自前端座位图）
-QString DBManager::bookTicketWithSeat(const QString& username, const QString& flightId, const QString& seatNumber) {
+qint64 DBManager::bookTicketWithSeat(qint64 userId, const QString& flightId, const QString& seatNumber) {
+    static const DbOp op("book_ticket_with_seat");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite<qint64>(m_forwarder, WriteOp::BookTicketWithSeat, 0, userId, flightId, seatNumber);
     QSqlDatabase db = getDb();
-    if (!db.isOpen()) return "";
+    if (!db.isOpen()) return 0;
     
     db.transaction();
 
     QSqlQuery query(db);
     
-    query.prepare("SELECT rest_seats FROM flight WHERE flight_id = :flightId");
-    query.bindValue(":flightId", flightId);
-    if (!query.exec() || !query.next() || query.value(0).toInt() <= 0) {
+    FlightRef flight;
+    if (!findFlight(query, flightId, &flight) || flight.restSeats <= 0) {
         db.rollback();
-        return "";
+        return 0;
     }
 
-    query.prepare("SELECT COUNT(*) FROM ticket WHERE flight_id = :flightId AND seat_number = :seat");
-    query.bindValue(":flightId", flightId);
-    query.bindValue(":seat", seatNumber);
-    if (!query.exec() || !query.next() || query.value(0).toInt() > 0) {
-        db.rollback();
-        return "";
-    }
-
-    QString orderId = QUuid::createUuid().toString(QUuid::WithoutBraces);
-    QString bookTime = QDateTime::currentDateTime().toString(Qt::ISODate);
-
-    query.prepare("INSERT INTO ticket (order_id, username, flight_id, book_time, status, seat_number) "
-                  "VALUES (:orderId, :username, :flightId, :bookTime, 1, :seat)");
-    query.bindValue(":orderId", orderId);
-    query.bindValue(":username", username);
-    query.bindValue(":flightId", flightId);
-    query.bindValue(":bookTime", bookTime);
-    query.bindValue(":seat", seatNumber);
-    
-    if (!query.exec()) {
+    if (!seatFree(query, flight.id, seatNumber)) {
         db.rollback();
-        return "";
+        return 0;
     }
 
-    query.prepare("UPDATE flight SET rest_seats = rest_seats - 1 WHERE flight_id = :flightId");
-    query.bindValue(":flightId", flightId);
-    if (!query.exec()) {
+    const qint64 orderId = insertTicket(query, userId, flight.id, seatNumber);
+    if (orderId == 0 || !publishSeats(query, {{flight.id, seatNumber, true}})) {
         db.rollback();
-        return "";
+        return 0;
     }
 
-    db.commit();
+    publishRestSeats(query, flight.id);
+    if (!commitSeatChange(db, {flight.id})) return 0;
     return orderId;
 }
 
-QList<Order> DBManager::queryUserOrders(const QString& username) {
+QList<Order> DBManager::queryUserOrders(qint64 userId) {
+    static const DbOp op("query_user_orders");
+    DbOpScope scope(op);
     QList<Order> orders;
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return orders;
 
     QSqlQuery query(db);
-    query.prepare("SELECT t.order_id, t.username, t.flight_id, t.book_time, t.seat_number, "
-                  "f.departure, f.destination, f.departure_airport, f.arrival_airport, f.depart_time, f.arrive_time "
-                  "FROM ticket t "
-                  "JOIN flight f ON t.flight_id = f.flight_id "
-                  "WHERE t.username = :username "
-                  "ORDER BY f.depart_time DESC");
-    query.bindValue(":username", username);
+    query.prepare(orderColumns() +
+                  QString("WHERE t.user_id = :userId "
+                          "ORDER BY %1 DESC, t.order_id DESC").arg(timeColumn("t.depart_time")));
+    query.bindValue(":userId", userId);
 
-    if (query.exec()) {
+    if (execQuery(query)) {
         while (query.next()) {
-            Order order;
-            order.order_id = query.value(0).toString();
-            order.username = query.value(1).toString();
-            order.flight_id = query.value(2).toString();
-            order.book_time = QDateTime::fromString(query.value(3).toString(), Qt::ISODate);
-            order.seat_number = query.value(4).toString();
-            order.departure = query.value(5).toString();
-            order.destination = query.value(6).toString();
-            order.departure_airport = query.value(7).toString();
-            order.arrival_airport = query.value(8).toString();
-            order.depart_time = QDateTime::fromString(query.value(9).toString(), Qt::ISODate);
-            order.arrive_time = QDateTime::fromString(query.value(10).toString(), Qt::ISODate);
-            orders.append(order);
+            orders.append(readOrder(query));
         }
     }
     return orders;
 }
 
-bool DBManager::cancelTicket(const QString& orderId) {
+// 键集分页：游标为上一页最后一条的 "depart_time|order_id"，
+// 借助 idx_ticket_user_depart 直接定位，翻页代价与页码无关
+DBManager::OrderPage DBManager::queryUserOrdersPage(qint64 userId, const QString& cursor, int limit) {
+    static const DbOp op("query_user_orders_page");
+    DbOpScope scope(op);
+    OrderPage page;
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return page;
+
+    // 先取版本号再读数据，读取期间发生的变更会在下次增量同步中补齐
+    page.version = orderVersion(userId);
+
+    const int sep = cursor.indexOf('|');
+    const QString departTime = timeColumn("t.depart_time");
+    QSqlQuery query(db);
+    if (sep < 0) {
+        query.prepare(orderColumns() +
+                      QString("WHERE t.user_id = :userId "
+                              "ORDER BY %1 DESC, t.order_id DESC LIMIT :limit").arg(departTime));
+    } else {
+        query.prepare(orderColumns() +
+                      QString("WHERE t.user_id = :userId AND (%1, t.order_id) < (:cursorTime, :cursorId) "
+                              "ORDER BY %1 DESC, t.order_id DESC LIMIT :limit").arg(departTime));
+        query.bindValue(":cursorTime", cursor.left(sep).toLongLong());
+        query.bindValue(":cursorId", cursor.mid(sep + 1).toLongLong());
+    }
+    query.bindValue(":userId", userId);
+    query.bindValue(":limit", limit + 1);  // 多取一条判断是否还有下一页
+
+    if (!execQuery(query)) {
+        logWarning(logDb, "订单分页查询失败：{}", query.lastError().text());
+        return page;
+    }
+    while (query.next()) {
+        if (page.orders.size() == limit) {
+            const Order& last = page.orders.last();
+            page.nextCursor = QString::number(last.depart_time) + '|' + last.order_id;
+            break;
+        }
+        page.orders.append(readOrder(query));
+    }
+    return page;
+}
+
+quint64 DBManager::orderVersion(qint64 userId) {
+    static const DbOp op("order_version");
+    DbOpScope scope(op);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return 0;
+
+    QSqlQuery query(db);
+    query.prepare("SELECT COALESCE(MAX(seq), 0) FROM order_change WHERE user_id = :userId");
+    query.bindValue(":userId", userId);
+    if (execQuery(query) && query.next()) {
+        return query.value(0).toULongLong();
+    }
+    return 0;
+}
+
+// 按变更日志计算 sinceVersion 之后每个订单的最终状态
+bool DBManager::queryOrderChanges(qint64 userId, quint64 sinceVersion, OrderChanges* changes) {
+    static const DbOp op("query_order_changes");
+    DbOpScope scope(op);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery query(db);
+    execQuery(query, "SELECT value FROM meta WHERE key = 'order_change_floor'");
+    if (query.next() && sinceVersion < query.value(0).toULongLong()) {
+        return false;  // 所需日志已被清理
+    }
+
+    query.prepare("SELECT seq, order_id, op FROM order_change WHERE user_id = :userId AND seq > :since ORDER BY seq");
+    query.bindValue(":userId", userId);
+    query.bindValue(":since", sinceVersion);
+    if (!execQuery(query)) return false;
+
+    changes->version = sinceVersion;
+    QHash<qint64, int> lastOp;
+    QList<qint64> touched;
+    while (query.next()) {
+        changes->version = query.value(0).toULongLong();
+        const qint64 orderId = query.value(1).toLongLong();
+        if (!lastOp.contains(orderId)) touched.append(orderId);
+        lastOp.insert(orderId, query.value(2).toInt());
+    }
+
+    query.prepare(orderColumns() + "WHERE t.order_id = :orderId AND t.user_id = :userId");
+    for (qint64 orderId : touched) {
+        if (lastOp.value(orderId) == OrderRemoved) {
+            changes->removed.append(QString::number(orderId));
+            continue;
+        }
+        query.bindValue(":orderId", orderId);
+        query.bindValue(":userId", userId);
+        if (execQuery(query) && query.next()) {
+            changes->upserts.append(readOrder(query));
+        } else {
+            changes->removed.append(QString::number(orderId));
+        }
+    }
+    return true;
+}
+
+// 登记新签发的会话令牌，多进程模式下经写进程执行
+bool DBManager::saveSession(quint64 token, qint64 userId, qint64 lastSeen) {
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::SaveSession, false, token, userId, lastSeen);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO session (token, user_id, last_seen) VALUES (:token, :userId, :lastSeen)");
+    query.bindValue(":token", qint64(token));
+    query.bindValue(":userId", userId);
+    query.bindValue(":lastSeen", lastSeen);
+    return execQuery(query);
+}
+
+// 按令牌查找会话及其用户名，工作进程本地未命中时调用
+bool DBManager::loadSession(quint64 token, qint64* userId, QString* username, qint64* lastSeen) {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery query(db);
+    query.prepare("SELECT s.user_id, u.username, s.last_seen FROM session s JOIN user u ON u.id = s.user_id "
+                  "WHERE s.token = :token");
+    query.bindValue(":token", qint64(token));
+    if (!execQuery(query) || !query.next()) return false;
+    *userId = query.value(0).toLongLong();
+    *username = query.value(1).toString();
+    *lastSeen = query.value(2).toLongLong();
+    return true;
+}
+
+// 会话不存在（已过期清理或改密后删除）时返回 false
+bool DBManager::touchSession(quint64 token, qint64 lastSeen) {
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::TouchSession, false, token, lastSeen);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery query(db);
+    query.prepare("UPDATE session SET last_seen = MAX(last_seen, :lastSeen) WHERE token = :token");
+    query.bindValue(":lastSeen", lastSeen);
+    query.bindValue(":token", qint64(token));
+    return execQuery(query) && query.numRowsAffected() > 0;
+}
+
+bool DBManager::removeSession(quint64 token) {
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::RemoveSession, false, token);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return false;
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM session WHERE token = :token");
+    query.bindValue(":token", qint64(token));
+    return execQuery(query);
+}
+
+// 删除最近续期早于 ttlSecs 之前的会话，返回删除行数（写进程定时调用）
+int DBManager::pruneSessions(int ttlSecs) {
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return 0;
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM session WHERE last_seen < :deadline");
+    query.bindValue(":deadline", QDateTime::currentSecsSinceEpoch() - ttlSecs);
+    return execQuery(query) ? query.numRowsAffected() : 0;
+}
+
+// 清理早于 keepSecs 的变更日志，并记录被清理的最大 seq；更旧的客户端版本改走全量分页
+int DBManager::pruneOrderChanges(int keepSecs) {
+    static const DbOp op("prune_order_changes");
+    DbOpScope scope(op);
+    QSqlDatabase db = getDb();
+    if (!db.isOpen()) return 0;
+
+    const qint64 deadline = QDateTime::currentSecsSinceEpoch() - keepSecs;
+    QSqlQuery query(db);
+    query.prepare("SELECT MAX(seq) FROM order_change WHERE changed_at < :deadline");
+    query.bindValue(":deadline", deadline);
+    if (!execQuery(query) || !query.next() || query.value(0).isNull()) return 0;
+    const qint64 floor = query.value(0).toLongLong();
+
+    db.transaction();
+    query.prepare("DELETE FROM order_change WHERE seq <= :floor");
+    query.bindValue(":floor", floor);
+    if (!execQuery(query)) {
+        db.rollback();
+        return 0;
+    }
+    const int removed = query.numRowsAffected();
+    query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('order_change_floor', :floor)");
+    query.bindValue(":floor", floor);
+    if (!execQuery(query) || !db.commit()) {
+        db.rollback();
+        return 0;
+    }
+    return removed;
+}
+
+bool DBManager::cancelTicket(qint64 orderId, qint64 userId) {
+    static const DbOp op("cancel_ticket");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::CancelTicket, false, orderId, userId);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
@@ -555,34 +1746,39 @@ bool DBManager::cancelTicket(const QString& orderId) {
 
     QSqlQuery query(db);
     
-    query.prepare("SELECT flight_id FROM ticket WHERE order_id = :orderId");
+    query.prepare("SELECT flight_ref, seat_number FROM ticket WHERE order_id = :orderId AND user_id = :userId");
     query.bindValue(":orderId", orderId);
-    if (!query.exec() || !query.next()) {
+    query.bindValue(":userId", userId);
+    if (!execQuery(query) || !query.next()) {
         db.rollback();
         return false;
     }
-    QString flightId = query.value(0).toString();
+    const qint64 flightRef = query.value(0).toLongLong();
+    const QString seatNumber = query.value(1).toString();
 
     query.prepare("DELETE FROM ticket WHERE order_id = :orderId");
     query.bindValue(":orderId", orderId);
-    if (!query.exec()) {
+    if (!execQuery(query) || !logOrderChange(query, userId, orderId, OrderRemoved)) {
         db.rollback();
         return false;
     }
 
-    query.prepare("UPDATE flight SET rest_seats = rest_seats + 1 WHERE flight_id = :flightId");
-    query.bindValue(":flightId", flightId);
-    if (!query.exec()) {
+    query.prepare("UPDATE flight SET rest_seats = rest_seats + 1 WHERE id = :flightRef");
+    query.bindValue(":flightRef", flightRef);
+    if (!execQuery(query) || !publishSeats(query, {{flightRef, seatNumber, false}})) {
         db.rollback();
         return false;
     }
 
-    db.commit();
-    return true;
+    publishRestSeats(query, flightRef);
+    return commitSeatChange(db, {flightRef});
 }
 
 // 改签时沿用订票的流程，只不过替换航班
-bool DBManager::changeTicket(const QString& orderId, const QString& newFlightId, const QString& seatNumber) {
+bool DBManager::changeTicket(qint64 orderId, qint64 userId, const QString& newFlightId, const QString& seatNumber) {
+    static const DbOp op("change_ticket");
+    DbOpScope scope(op);
+    if (m_forwarder) return forwardWrite(m_forwarder, WriteOp::ChangeTicket, false, orderId, userId, newFlightId, seatNumber);
     QSqlDatabase db = getDb();
     if (!db.isOpen()) return false;
 
@@ -590,89 +1786,333 @@ bool DBManager::changeTicket(const QString& orderId, const QString& newFlightId,
 
     QSqlQuery query(db);
     
-    query.prepare("SELECT t.username, t.flight_id, f.departure, f.destination "
-                  "FROM ticket t JOIN flight f ON t.flight_id = f.flight_id "
-                  "WHERE t.order_id = :orderId");
+    query.prepare("SELECT t.flight_ref, f.departure, f.destination, t.seat_number "
+                  "FROM ticket t JOIN flight f ON f.id = t.flight_ref "
+                  "WHERE t.order_id = :orderId AND t.user_id = :userId");
     query.bindValue(":orderId", orderId);
-    if (!query.exec() || !query.next()) {
+    query.bindValue(":userId", userId);
+    if (!execQuery(query) || !query.next()) {
         db.rollback();
         return false;
     }
-    QString username = query.value(0).toString();
-    QString oldFlightId = query.value(1).toString();
-    QString oldDeparture = query.value(2).toString();
-    QString oldDestination = query.value(3).toString();
+    const qint64 oldFlightRef = query.value(0).toLongLong();
+    QString oldDeparture = query.value(1).toString();
+    QString oldDestination = query.value(2).toString();
+    const QString oldSeatNumber = query.value(3).toString();
 
-    query.prepare("SELECT departure, destination, rest_seats FROM flight WHERE flight_id = :flightId");
-    query.bindValue(":flightId", newFlightId);
-    if (!query.exec() || !query.next()) {
+    FlightRef newFlight;
+    if (!findFlight(query, newFlightId, &newFlight)) {
         db.rollback();
         return false;
     }
-    QString newDeparture = query.value(0).toString();
-    QString newDestination = query.value(1).toString();
-    int restSeats = query.value(2).toInt();
     
-    if (oldDeparture != newDeparture || oldDestination != newDestination) {
+    if (oldDeparture != newFlight.departure || oldDestination != newFlight.destination) {
         db.rollback();
-        qDebug() << "改签失败：航线不匹配 - 原航线:" << oldDeparture << "→" << oldDestination
-                 << ", 新航线:" << newDeparture << "→" << newDestination;
+        logInfo(logDb, "改签失败：航线不匹配 - 原航线: {}→{}, 新航线: {}→{}", oldDeparture, oldDestination,
+                newFlight.departure, newFlight.destination);
         return false;
     }
     
-    if (restSeats <= 0) {
+    if (newFlight.restSeats <= 0) {
         db.rollback();
         return false;
     }
 
-    query.prepare("SELECT COUNT(*) FROM ticket WHERE flight_id = :flightId AND seat_number = :seat");
-    query.bindValue(":flightId", newFlightId);
-    query.bindValue(":seat", seatNumber);
-    if (!query.exec() || !query.next() || query.value(0).toInt() > 0) {
+    if (!seatFree(query, newFlight.id, seatNumber)) {
         db.rollback();
         return false;
     }
 
     query.prepare("DELETE FROM ticket WHERE order_id = :orderId");
     query.bindValue(":orderId", orderId);
-    if (!query.exec()) {
+    if (!execQuery(query) || !logOrderChange(query, userId, orderId, OrderRemoved)) {
         db.rollback();
         return false;
     }
 
-    query.prepare("UPDATE flight SET rest_seats = rest_seats + 1 WHERE flight_id = :flightId");
-    query.bindValue(":flightId", oldFlightId);
-    if (!query.exec()) {
+    query.prepare("UPDATE flight SET rest_seats = rest_seats + 1 WHERE id = :flightRef");
+    query.bindValue(":flightRef", oldFlightRef);
+    if (!execQuery(query)) {
         db.rollback();
         return false;
     }
 
-    QString newOrderId = QUuid::createUuid().toString(QUuid::WithoutBraces);
-    QString bookTime = QDateTime::currentDateTime().toString(Qt::ISODate);
-
-    query.prepare("INSERT INTO ticket (order_id, username, flight_id, book_time, status, seat_number) "
-                  "VALUES (:orderId, :username, :flightId, :bookTime, 1, :seatNumber)");
-    query.bindValue(":orderId", newOrderId);
-    query.bindValue(":username", username);
-    query.bindValue(":flightId", newFlightId);
-    query.bindValue(":bookTime", bookTime);
-    query.bindValue(":seatNumber", seatNumber);
-    if (!query.exec()) {
+    if (insertTicket(query, userId, newFlight.id, seatNumber) == 0 ||
+        !publishSeats(query, {{oldFlightRef, oldSeatNumber, false}, {newFlight.id, seatNumber, true}})) {
         db.rollback();
         return false;
     }
 
-    query.prepare("UPDATE flight SET rest_seats = rest_seats - 1 WHERE flight_id = :flightId");
-    query.bindValue(":flightId", newFlightId);
-    if (!query.exec()) {
-        db.rollback();
+    publishRestSeats(query, oldFlightRef);
+    publishRestSeats(query, newFlight.id);
+    return commitSeatChange(db, {oldFlightRef, newFlight.id});
+}
+
+void DBManager::setWriteForwarder(WriteForwarder* forwarder) {
+    m_forwarder = forwarder;
+}
+
+// 写进程执行工作进程转发来的写操作，参数与结果的编码和各写接口的转发分支一一对应
+QByteArray DBManager::executeForwardedWrite(WriteOp op, const QByteArray& args) {
+    QDataStream in(args);
+    in.setVersion(QDataStream::Qt_6_0);
+    qint64 userId = 0, orderId = 0;
+    QString username, flightId, seatNumber, oldPass, newPass;
+    User user;
+    Flight flight;
+    switch (op) {
+    case WriteOp::BookTicket:
+        in >> userId >> flightId;
+        return encodeWrite(bookTicket(userId, flightId));
+    case WriteOp::BookTicketWithSeat:
+        in >> userId >> flightId >> seatNumber;
+        return encodeWrite(bookTicketWithSeat(userId, flightId, seatNumber));
+    case WriteOp::CancelTicket:
+        in >> orderId >> userId;
+        return encodeWrite(cancelTicket(orderId, userId));
+    case WriteOp::ChangeTicket:
+        in >> orderId >> userId >> flightId >> seatNumber;
+        return encodeWrite(changeTicket(orderId, userId, flightId, seatNumber));
+    case WriteOp::UpdateUserInfo:
+        in >> user;
+        return encodeWrite(updateUserInfo(user));
+    case WriteOp::ChangePassword:
+        in >> username >> oldPass >> newPass;
+        return encodeWrite(changePassword(username, oldPass, newPass));
+    case WriteOp::RegisterUser:
+        in >> user;
+        return encodeWrite(insertUser(user));
+    case WriteOp::AddFlight:
+        in >> flight;
+        return encodeWrite(addFlight(flight));
+    case WriteOp::ImportFlights: {
+        QList<Flight> flights;
+        in >> flights;
+        ImportStats stats;
+        const bool success = importFlights(flights, &stats);
+        return encodeWrite(success, stats.rows, stats.inserted, stats.skipped, stats.invalid, stats.elapsedMs, stats.indexMs);
+    }
+    case WriteOp::SaveSession: {
+        quint64 token = 0;
+        qint64 lastSeen = 0;
+        in >> token >> userId >> lastSeen;
+        return encodeWrite(saveSession(token, userId, lastSeen));
+    }
+    case WriteOp::TouchSession: {
+        quint64 token = 0;
+        qint64 lastSeen = 0;
+        in >> token >> lastSeen;
+        return encodeWrite(touchSession(token, lastSeen));
+    }
+    case WriteOp::RemoveSession: {
+        quint64 token = 0;
+        in >> token;
+        return encodeWrite(removeSession(token));
+    }
+    case WriteOp::UpgradePassword: {
+        QString stored, hashed;
+        in >> userId >> stored >> hashed;
+        return encodeWrite(upgradePassword(userId, stored, hashed));
+    }
+    }
+    return QByteArray();
+}
+
+void DBManager::reloadCaches() {
+    QSqlDatabase db = getDb();
+    SchemaMigrator::getInstance()->adopt(SchemaMigrator::storedVersion(db));
+    loadUsernameIndex();
+    loadCityDictionary();
+    loadFlightCatalog();
+}
+
+void DBManager::loadFlightCatalog() {
+    const QString path = FlightCatalog::pathFor(m_dbPath);
+    QSqlDatabase db = getDb();
+    if (path.isEmpty() || !db.isOpen() || !SchemaMigrator::getInstance()->reached(kSchemaEpochTimes)) {
+        FlightCatalog::getInstance()->unload();
+        return;
+    }
+
+    QSqlQuery query(db);
+    QString error;
+    // 工作进程的余座表由写进程维护，只读映射
+    if (FlightCatalog::getInstance()->load(path, maxFlightId(query), m_forwarder == nullptr, &error)) {
+        qDebug() << "航班目录快照已映射：" << path;
+    } else {
+        qDebug() << "航班目录快照不可用，航班检索走 SQL：" << error;
+    }
+}
+
+bool DBManager::refreshFlightCatalog() {
+    const QString path = FlightCatalog::pathFor(m_dbPath);
+    if (path.isEmpty() || m_forwarder) return false;
+    QSqlDatabase db = getDb();
+    if (!db.isOpen() || !SchemaMigrator::getInstance()->reached(kSchemaEpochTimes)) return false;
+
+    static const DbOp op("refresh_flight_catalog");
+    DbOpScope scope(op);
+    QMutexLocker locker(&m_catalogMutex);
+    FlightCatalog* catalog = FlightCatalog::getInstance();
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    QString error;
+    if (!catalog->load(path, maxFlightId(query), true, &error)) {
+        QElapsedTimer timer;
+        timer.start();
+        // 单条 SELECT 读到的是同一时刻的数据，快照记录的最大 id 与写出的行一致
+        FlightCatalogBuilder builder;
+        qint64 maxId = 0;
+        if (!execQuery(query, "SELECT flight_id, departure, destination, departure_airport, arrival_airport, "
+                              "depart_time, arrive_time, price, rest_seats, id FROM flight")) {
+            return false;
+        }
+        while (query.next()) {
+            const qint64 id = query.value(9).toLongLong();
+            maxId = qMax(maxId, id);
+            builder.add(id, readFlight(query));
+        }
+        query.finish();
+        if (!builder.write(path, maxId, &error) || !catalog->load(path, maxId, true, &error)) {
+            logWarning(logDb, "生成航班目录快照失败：{}", error);
+            return false;
+        }
+        logInfo(logDb, "航班目录快照已生成：{} 个航班，{} 条航线，{} 字节，耗时 {} ms", builder.count(),
+                builder.routeCount(), builder.bytes(), timer.elapsed());
+    }
+
+    // 余座表可能落后于库（上次退出时停在更新余座表与提交之间）：持有库的写锁读出全部余座，期间没有并发的写者
+    if (!execQuery(query, "BEGIN IMMEDIATE")) return false;
+    QList<QPair<qint64, int>> seats;
+    if (execQuery(query, "SELECT id, rest_seats FROM flight")) {
+        while (query.next()) {
+            seats.append(qMakePair(query.value(0).toLongLong(), query.value(1).toInt()));
+        }
+    }
+    query.finish();
+    catalog->setRestSeats(seats);
+    return execQuery(query, "COMMIT");
+}
+
+void DBManager::scheduleFlightCatalogRefresh() {
+    if (FlightCatalog::pathFor(m_dbPath).isEmpty() || m_forwarder) return;
+    // 新航班使最大 id 变化，旧快照不再可用；写路径在提交前更新余座表，停用后改由重建时按库校正
+    FlightCatalog::getInstance()->unload();
+    if (m_catalogRefreshPending.exchange(true)) return;
+
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+        // 没有事件循环的离线工具直接重建
+        m_catalogRefreshPending.store(false);
+        refreshFlightCatalog();
+        return;
+    }
+    QMetaObject::invokeMethod(app, [this, app]() {
+        QTimer::singleShot(1000, app, [this]() {
+            // 先清标志：重建期间的写入会再排一次
+            m_catalogRefreshPending.store(false);
+            if (refreshFlightCatalog() && m_catalogListener) m_catalogListener();
+        });
+    }, Qt::QueuedConnection);
+}
+
+void DBManager::setCatalogListener(std::function<void()> listener) {
+    m_catalogListener = std::move(listener);
+}
+
+bool DBManager::recoverSeatInventory() {
+    const QString path = SeatInventory::pathFor(m_dbPath);
+    if (path.isEmpty() || m_forwarder) return false;
+    QSqlDatabase db = getDb();
+    if (!db.isOpen() || !SchemaMigrator::getInstance()->reached(kSchemaIntegerKeys)) return false;
+
+    static const DbOp op("recover_seat_inventory");
+    DbOpScope scope(op);
+    QElapsedTimer timer;
+    timer.start();
+    SeatInventory* inventory = SeatInventory::getInstance();
+    QString error;
+    if (!inventory->acquire(path, &error)) {
+        logWarning(logDb, "座位库存不可用，选座与座位图走 SQL：{}", error);
         return false;
     }
 
-    db.commit();
+    // 持有库的写锁完成校正与重建，期间没有并发的写者
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!execQuery(query, "BEGIN IMMEDIATE")) return false;
+    qint64 databaseId = 0;
+    if (execQuery(query, "SELECT value FROM meta WHERE key = 'seat_inventory_id'") && query.next()) {
+        databaseId = query.value(0).toLongLong();
+    }
+    const qint64 committed = lastChangeSeq(query);
+
+    // 日志在提交之前写入，库中已提交的变更日志里都有；日志里最多多出崩溃时未提交的那一个事务。
+    // 库标识不符（换了库文件）或日志落后于库（断电丢了未同步的尾部、绕过服务直接改库）时全量重建
+    const bool restored = inventory->restore(&error);
+    const qint64 replayed = inventory->replayedChangeSeq();
+    int corrected = 0;
+    bool rebuilt = false;
+    if (restored && databaseId != 0 && inventory->databaseId() == databaseId && replayed >= committed &&
+        replayed <= committed + 1) {
+        for (qint64 flightRef : inventory->flightsChangedAfter(committed)) {
+            QStringList seats;
+            if (!ticketSeats(query, flightRef, &seats)) {
+                execQuery(query, "ROLLBACK");
+                return false;
+            }
+            inventory->assign(flightRef, seats, committed);
+            ++corrected;
+        }
+    } else {
+        if (restored) {
+            logWarning(logDb, "座位库存与库不一致（快照库标识 {}，库 {}；日志序号 {}，库 {}），全量重建",
+                       inventory->databaseId(), databaseId, replayed, committed);
+        } else {
+            logInfo(logDb, "座位快照不可用（{}），从订单表全量重建", error);
+        }
+        databaseId = qint64(QRandomGenerator::global()->generate64() >> 1) | 1;
+        query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES ('seat_inventory_id', :id)");
+        query.bindValue(":id", databaseId);
+        if (!execQuery(query)) {
+            execQuery(query, "ROLLBACK");
+            return false;
+        }
+        inventory->reset(databaseId, committed);
+        if (execQuery(query, "SELECT flight_ref, seat_number FROM ticket")) {
+            while (query.next()) inventory->load(query.value(0).toLongLong(), query.value(1).toString());
+        }
+        query.finish();
+        rebuilt = true;
+    }
+    if (!execQuery(query, "COMMIT")) return false;
+
+    // 每次启动都写一次快照，下次只需重放本次运行期间的日志
+    if (!inventory->checkpoint(&error)) {
+        logWarning(logDb, "座位库存不可用，选座与座位图走 SQL：{}", error);
+        return false;
+    }
+    inventory->start();
+    logInfo(logDb, "座位库存已就绪（{}）：重放 {} 条日志，按库校正 {} 个航班，耗时 {} ms",
+            rebuilt ? "全量重建" : "快照加日志", inventory->replayedRecords(), corrected, timer.elapsed());
     return true;
 }
 
+void DBManager::releaseConnection() {
+    QString name;
+    {
+        QMutexLocker locker(&m_mutex);
+        name = m_connectionNames.take(QThread::currentThreadId());
+    }
+    if (name.isEmpty()) return;
+
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        if (db.isOpen()) db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
 void DBManager::close() {
     QMutexLocker locker(&m_mutex);
     for (auto it = m_connectionNames.begin(); it != m_connectionNames.end(); ++it) {
@@ -7,42 +7,114 @@
 #include <QDebug>
 #include <QList>
 #include <QDate>
-#include <QMutex>
 #include <QHash>
 #include <QThread>
+#include <atomic>
+#include <functional>
 #include "data_model.h"
+#include "metrics/profiled_mutex.h"
+#include "write_forwarder.h"
+
+class FlightFileReader;
+struct ImportOptions;
+struct ImportStats;
 
 class DBManager {
 public:
     static DBManager* getInstance();
 
     // 初始化数据库文件路径和表结构
-    bool init(const QString& dbPath = "ftms.db");
+    // backgroundMigrations 为 false 时不启动后台迁移线程（离线导入等独占写库的场景）
+    bool init(const QString& dbPath = "ftms.db", bool backgroundMigrations = true);
+    // 多进程模式的工作进程：打开写进程已建好的库，不建表、不迁移，结构版本取库中记录的
+    // user_version，之后随写进程的 SchemaChanged 通知推进
+    bool attach(const QString& dbPath = "ftms.db");
 
-    ResponseStatus verifyUser(const QString& username, const QString& password);
+    // 口令按 PasswordHasher 格式存储，旧版明文行在验证成功时升级。
+    // 以下涉及口令的接口耗时较长，应在认证线程池中调用。
+    // 验证成功时通过 userId 返回 user 表 rowid，供会话表使用
+    ResponseStatus verifyUser(const QString& username, const QString& password, qint64* userId = nullptr);
 
     QList<Flight> queryFlights(const QString& departure,
                                const QString& destination,
                                const QDate& date);
 
-    QString bookTicket(const QString& username, const QString& flight_id);
-    QString bookTicketWithSeat(const QString& username, const QString& flightId, const QString& seatNumber);
+    // 订票成功返回订单号（OrderIdGenerator 生成），失败返回 0
+    qint64 bookTicket(qint64 userId, const QString& flight_id);
+    qint64 bookTicketWithSeat(qint64 userId, const QString& flightId, const QString& seatNumber);
+
+    // 订单相关接口按 user 表 id 查询，Order 中的订单号以十进制字符串返回
+    QList<Order> queryUserOrders(qint64 userId);
+
+    struct OrderPage {
+        QList<Order> orders;
+        QString nextCursor;     // 为空表示已到最后一页
+        quint64 version = 0;    // 读取前的订单版本号，供后续增量同步
+    };
+    OrderPage queryUserOrdersPage(qint64 userId, const QString& cursor, int limit);
 
-    QList<Order> queryUserOrders(const QString& username);
+    struct OrderChanges {
+        QList<Order> upserts;   // 新增或变化的订单
+        QStringList removed;    // 已删除的订单号
+        quint64 version = 0;
+    };
+    // 查询 sinceVersion 之后的订单变更；日志已被清理时返回 false，调用方改走全量分页
+    bool queryOrderChanges(qint64 userId, quint64 sinceVersion, OrderChanges* changes);
+    quint64 orderVersion(qint64 userId);
+    int pruneOrderChanges(int keepSecs);
+    // 多进程模式的共享会话表（见 SessionManager）：写接口经写进程执行，查找读本地连接。
+    // 令牌已存在时 saveSession 返回 false；loadSession 返回用户 id、用户名与最近续期时间
+    bool saveSession(quint64 token, qint64 userId, qint64 lastSeen);
+    bool loadSession(quint64 token, qint64* userId, QString* username, qint64* lastSeen);
+    bool touchSession(quint64 token, qint64 lastSeen);
+    bool removeSession(quint64 token);
+    int pruneSessions(int ttlSecs);
     User getUserInfo(const QString& username);
     bool updateUserInfo(const User& user);
-    bool cancelTicket(const QString& orderId);
-    bool changeTicket(const QString& orderId, const QString& newFlightId, const QString& seatNumber);
+    // 只允许操作 userId 名下的订单
+    bool cancelTicket(qint64 orderId, qint64 userId);
+    bool changeTicket(qint64 orderId, qint64 userId, const QString& newFlightId, const QString& seatNumber);
     bool changePassword(const QString& username, const QString& oldPass, const QString& newPass);
 
     bool registerUser(const User& user);
     bool addFlight(const Flight& flight);
+    // 批量导入航班，航班号已存在的行跳过，新出现的城市收录进字典。
+    // 第一种用于 --import 离线导入，第二种用于管理员批量请求（单个事务）
+    bool importFlights(FlightFileReader& reader, const ImportOptions& options, ImportStats* stats);
+    bool importFlights(const QList<Flight>& flights, ImportStats* stats);
     bool isUserExist(const QString& username);
 
     int getRestSeats(const QString& flight_id);
+    // 城市列表来自内存字典（city 表），不再扫描 flight 表
     QStringList getCities();
+    // 新增航班、批量导入后调用，收录新出现的城市并递增字典版本号
+    bool registerCities(const QStringList& cities);
     QStringList getOccupiedSeats(const QString& flightId);
     QList<Flight> getAllFlights(int limit = 20);
+    // 在当前线程执行完剩余的后台迁移（离线工具生成的库直接处于最新结构），返回是否已到最新版本
+    bool finishMigrations();
+    // 多进程模式：工作进程设置转发器后，写接口改由写进程执行，读接口仍查本地连接。
+    // 写进程用 executeForwardedWrite 执行转发来的操作，返回编码的结果
+    void setWriteForwarder(WriteForwarder* forwarder);
+    QByteArray executeForwardedWrite(WriteOp op, const QByteArray& args);
+    // 重新读取结构版本，重新加载用户名过滤器、城市字典与航班目录快照（工作进程错过写进程的变更通知后调用）
+    void reloadCaches();
+    // 航班目录快照（见 FlightCatalog）：与库一致时直接映射，否则重新编译后映射，再在库写锁内按库校正余座表。
+    // 单进程模式与写进程启动时、新增或导入航班后调用；工作进程不编译，返回 false
+    bool refreshFlightCatalog();
+    // 新增航班与在线导入后调用：立即停用过期快照（检索走 SQL），约 1 秒后在主线程合并重建一次，
+    // 期间的多次写入只触发一次重建。重建成功后调用 setCatalogListener 设置的回调
+    void scheduleFlightCatalogRefresh();
+    // 写进程借此通知工作进程重新映射快照，需在处理写请求之前设置
+    void setCatalogListener(std::function<void()> listener);
+    // 只映射已有的快照，缺失或过期时航班检索走 SQL（工作进程收到写进程的通知后调用）
+    void loadFlightCatalog();
+    // 座位库存（见 SeatInventory）：读快照、重放日志尾部，按库校正崩溃时未提交的航班，
+    // 快照缺失或与库不一致时从订单表全量重建，最后写一次快照并启动组提交线程。
+    // 单进程模式与写进程在开始处理写请求之前调用；工作进程不持有库存，返回 false
+    bool recoverSeatInventory();
+    // 释放当前线程持有的连接，连接线程退出前调用
+    void releaseConnection();
     void close();
 
 private:
@@ -50,13 +122,32 @@ private:
     DBManager(const DBManager&) = delete;
     DBManager& operator=(const DBManager&) = delete;
 
+    bool openDatabase(const QString& dbPath);
     bool createTables();
+    bool insertUser(const User& user);
+    bool upgradePassword(qint64 rowid, const QString& oldHash, const QString& newHash);
+    void registerMigrations();
+    int detectLegacyVersion();
+    bool hasLegacyTextKeys();
+    bool migrateToIntegerKeys();
+    bool hasTextTimeColumns();
+    bool migrateTimesToEpoch(QSqlDatabase& db, qint64* cursor, bool* done);
+    void loadUsernameIndex();
+    void rebuildUsernameIndex();    // 调用方需持有 m_userIndexMutex
+    void backfillCityDictionary();
+    void loadCityDictionary();
 
     QSqlDatabase getDb();
 
     QString m_dbPath;
     QHash<Qt::HANDLE, QString> m_connectionNames;
-    QMutex m_mutex;
+    ProfiledMutex m_mutex{"db_connections"};          // 保护 m_connectionNames，每次 getDb() 都会获取
+    ProfiledMutex m_userIndexMutex{"db_username_index"};
+    ProfiledMutex m_cityMutex{"db_city_dictionary"};
+    ProfiledMutex m_catalogMutex{"db_flight_catalog"};  // 同一时刻只编译一份快照
+    WriteForwarder* m_forwarder = nullptr;
+    std::atomic<bool> m_catalogRefreshPending{false};
+    std::function<void()> m_catalogListener;
     static DBManager* m_instance;
 };
 
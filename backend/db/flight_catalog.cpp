@@ -0,0 +1,443 @@
+#include "flight_catalog.h"
+#include "metrics/metrics.h"
+#include <QFile>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QStringView>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+FlightCatalog* FlightCatalog::m_instance = nullptr;
+
+namespace {
+constexpr char kCatalogMagic[8] = {'F', 'T', 'M', 'S', 'C', 'A', 'T', 'L'};
+constexpr char kSeatsMagic[8] = {'F', 'T', 'M', 'S', 'S', 'E', 'A', 'T'};
+constexpr quint32 kFormatVersion = 1;
+constexpr qint64 kSectionAlign = 64;
+
+struct CatalogHeader {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 headerBytes;        // sizeof(CatalogHeader)，字节序或布局不同的文件在这里就对不上
+    quint64 generation;         // 与余座表文件头相同才是同一次编译的产物
+    qint64 sourceMaxId;
+    quint32 flightCount;
+    quint32 routeCount;
+    quint64 recordsOffset;
+    quint64 routesOffset;
+    quint64 idsOffset;
+    quint64 stringsOffset;
+    quint64 stringBytes;
+    quint8 reserved[48];
+};
+static_assert(sizeof(CatalogHeader) == 128, "快照文件头布局变化需要提升 kFormatVersion");
+
+// 字符串字段为字符串表内的偏移
+struct CatalogRecord {
+    qint64 departTime;
+    qint64 arriveTime;
+    double price;
+    quint32 flightId;
+    quint32 departure;
+    quint32 destination;
+    quint32 departureAirport;
+    quint32 arrivalAirport;
+    quint32 reserved;
+};
+static_assert(sizeof(CatalogRecord) == 48, "快照记录布局变化需要提升 kFormatVersion");
+
+struct CatalogRoute {
+    quint32 departure;
+    quint32 destination;
+    quint32 first;
+    quint32 count;
+};
+
+struct CatalogId {
+    qint64 flightRef;
+    quint32 record;
+    quint32 reserved;
+};
+
+struct SeatsHeader {
+    char magic[8];
+    quint64 generation;
+    quint32 count;
+    quint32 reserved;
+    quint8 padding[40];
+};
+static_assert(sizeof(SeatsHeader) == 64, "余座表文件头布局变化需要提升 kFormatVersion");
+static_assert(sizeof(std::atomic<qint32>) == sizeof(qint32) && std::atomic<qint32>::is_always_lock_free,
+              "余座表按 std::atomic<qint32> 数组映射");
+
+qint64 alignSection(qint64 offset) {
+    return (offset + kSectionAlign - 1) / kSectionAlign * kSectionAlign;
+}
+
+bool sectionFits(quint64 offset, quint64 count, quint64 itemBytes, qint64 fileBytes) {
+    return offset % 8 == 0 && offset <= quint64(fileBytes) && count <= (quint64(fileBytes) - offset) / itemBytes;
+}
+
+// QSaveFile 只能顺序写，用零字节补齐到下一段的起始偏移
+class SectionWriter {
+public:
+    explicit SectionWriter(QSaveFile* file) : m_file(file) {}
+
+    bool write(const void* data, qint64 bytes) {
+        if (bytes == 0) return true;
+        if (m_file->write(static_cast<const char*>(data), bytes) != bytes) return false;
+        m_position += bytes;
+        return true;
+    }
+    bool seek(qint64 offset) {
+        const QByteArray zeros(offset - m_position, '\0');
+        return write(zeros.constData(), zeros.size());
+    }
+
+private:
+    QSaveFile* m_file;
+    qint64 m_position = 0;
+};
+}
+
+struct FlightCatalog::Snapshot {
+    QFile catalogFile;
+    QFile seatsFile;
+    uchar* catalogBase = nullptr;
+    uchar* seatsBase = nullptr;
+    qint64 mappedBytes = 0;
+
+    const CatalogHeader* header = nullptr;
+    const CatalogRecord* records = nullptr;
+    const CatalogRoute* routes = nullptr;
+    const CatalogId* ids = nullptr;
+    const uchar* strings = nullptr;
+    std::atomic<qint32>* seats = nullptr;
+    bool writable = false;
+
+    ~Snapshot() {
+        if (catalogBase) catalogFile.unmap(catalogBase);
+        if (seatsBase) seatsFile.unmap(seatsBase);
+    }
+
+    // 越界的偏移返回空串，损坏的文件不会读到映射区之外
+    QStringView string(quint32 offset) const {
+        if (quint64(offset) + sizeof(quint32) > header->stringBytes) return QStringView();
+        quint32 length = 0;
+        std::memcpy(&length, strings + offset, sizeof(length));
+        if (length > (header->stringBytes - offset - sizeof(quint32)) / sizeof(char16_t)) return QStringView();
+        return QStringView(reinterpret_cast<const char16_t*>(strings + offset + sizeof(quint32)), qsizetype(length));
+    }
+
+    int recordFor(qint64 flightRef) const {
+        const CatalogId* end = ids + header->flightCount;
+        const CatalogId* it = std::lower_bound(ids, end, flightRef, [](const CatalogId& id, qint64 ref) {
+            return id.flightRef < ref;
+        });
+        if (it == end || it->flightRef != flightRef || it->record >= header->flightCount) return -1;
+        return int(it->record);
+    }
+
+    Flight flight(int index, int restSeats) const {
+        const CatalogRecord& record = records[index];
+        Flight f;
+        f.flight_id = string(record.flightId).toString();
+        f.departure = string(record.departure).toString();
+        f.destination = string(record.destination).toString();
+        f.departure_airport = string(record.departureAirport).toString();
+        f.arrival_airport = string(record.arrivalAirport).toString();
+        f.depart_time = record.departTime;
+        f.arrive_time = record.arriveTime;
+        f.price = record.price;
+        f.rest_seats = restSeats;
+        return f;
+    }
+};
+
+FlightCatalog* FlightCatalog::getInstance() {
+    if (!m_instance) {
+        m_instance = new FlightCatalog();
+    }
+    return m_instance;
+}
+
+FlightCatalog::FlightCatalog() {
+    Metrics* metrics = Metrics::getInstance();
+    metrics->gauge("ftms_flight_catalog_flights", "已映射的航班目录快照中的航班数，未加载时为 0", QString(),
+                   [this]() { return double(m_flights.load()); });
+    metrics->gauge("ftms_flight_catalog_mapped_bytes", "航班目录快照与余座表映射的字节数", QString(),
+                   [this]() { return double(m_mappedBytes.load()); });
+}
+
+QString FlightCatalog::pathFor(const QString& dbPath) {
+    const QString configured = QProcessEnvironment::systemEnvironment().value("FTMS_FLIGHT_CATALOG").trimmed();
+    if (configured.compare("off", Qt::CaseInsensitive) == 0) return QString();
+    return configured.isEmpty() ? dbPath + ".catalog" : configured;
+}
+
+QString FlightCatalog::seatsPathFor(const QString& path) {
+    return path + ".seats";
+}
+
+bool FlightCatalog::load(const QString& path, qint64 sourceMaxId, bool writable, QString* error) {
+    auto fail = [this, error](const QString& message) {
+        if (error) *error = message;
+        unload();
+        return false;
+    };
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->catalogFile.setFileName(path);
+    if (!snapshot->catalogFile.open(QIODevice::ReadOnly)) return fail(QString("无法打开 %1").arg(path));
+    const qint64 catalogBytes = snapshot->catalogFile.size();
+    if (catalogBytes < qint64(sizeof(CatalogHeader))) return fail("快照文件不完整");
+    snapshot->catalogBase = snapshot->catalogFile.map(0, catalogBytes);
+    if (!snapshot->catalogBase) return fail("映射快照文件失败");
+
+    const uchar* base = snapshot->catalogBase;
+    const auto* header = reinterpret_cast<const CatalogHeader*>(base);
+    if (std::memcmp(header->magic, kCatalogMagic, sizeof(kCatalogMagic)) != 0
+        || header->formatVersion != kFormatVersion || header->headerBytes != sizeof(CatalogHeader)) {
+        return fail("快照格式不符");
+    }
+    if (!sectionFits(header->recordsOffset, header->flightCount, sizeof(CatalogRecord), catalogBytes)
+        || !sectionFits(header->routesOffset, header->routeCount, sizeof(CatalogRoute), catalogBytes)
+        || !sectionFits(header->idsOffset, header->flightCount, sizeof(CatalogId), catalogBytes)
+        || !sectionFits(header->stringsOffset, header->stringBytes, 1, catalogBytes)) {
+        return fail("快照文件不完整");
+    }
+    if (header->sourceMaxId != sourceMaxId) {
+        return fail(QString("快照已过期（快照最大 id %1，库中 %2）").arg(header->sourceMaxId).arg(sourceMaxId));
+    }
+    snapshot->header = header;
+    snapshot->records = reinterpret_cast<const CatalogRecord*>(base + header->recordsOffset);
+    snapshot->routes = reinterpret_cast<const CatalogRoute*>(base + header->routesOffset);
+    snapshot->ids = reinterpret_cast<const CatalogId*>(base + header->idsOffset);
+    snapshot->strings = base + header->stringsOffset;
+    // 航线表很小，逐条确认记录区间不越界，检索时不再检查
+    for (quint32 i = 0; i < header->routeCount; ++i) {
+        const CatalogRoute& route = snapshot->routes[i];
+        if (route.first > header->flightCount || route.count > header->flightCount - route.first) {
+            return fail("快照航线表损坏");
+        }
+    }
+
+    const QString seatsPath = seatsPathFor(path);
+    snapshot->seatsFile.setFileName(seatsPath);
+    if (!snapshot->seatsFile.open(writable ? QIODevice::ReadWrite : QIODevice::ReadOnly)) {
+        return fail(QString("无法打开 %1").arg(seatsPath));
+    }
+    const qint64 seatsBytes = snapshot->seatsFile.size();
+    if (seatsBytes < qint64(sizeof(SeatsHeader))) return fail("余座表不完整");
+    snapshot->seatsBase = snapshot->seatsFile.map(0, seatsBytes);
+    if (!snapshot->seatsBase) return fail("映射余座表失败");
+    const auto* seatsHeader = reinterpret_cast<const SeatsHeader*>(snapshot->seatsBase);
+    if (std::memcmp(seatsHeader->magic, kSeatsMagic, sizeof(kSeatsMagic)) != 0
+        || seatsHeader->generation != header->generation || seatsHeader->count != header->flightCount
+        || (seatsBytes - qint64(sizeof(SeatsHeader))) / qint64(sizeof(qint32)) < qint64(header->flightCount)) {
+        // 另一进程正在重新编译时可能读到新旧不配套的两个文件，编译完成后会再次加载
+        return fail("余座表与快照不配套");
+    }
+    snapshot->seats = reinterpret_cast<std::atomic<qint32>*>(snapshot->seatsBase + sizeof(SeatsHeader));
+    snapshot->writable = writable;
+    snapshot->mappedBytes = catalogBytes + seatsBytes;
+
+    m_flights.store(header->flightCount);
+    m_mappedBytes.store(snapshot->mappedBytes);
+    ProfiledWriteLocker locker(&m_lock);
+    m_snapshot = std::move(snapshot);
+    return true;
+}
+
+// 正在检索的线程仍持有旧快照的引用，最后一个引用释放时才解除映射
+void FlightCatalog::unload() {
+    std::shared_ptr<const Snapshot> old;
+    {
+        ProfiledWriteLocker locker(&m_lock);
+        old.swap(m_snapshot);
+    }
+    m_flights.store(0);
+    m_mappedBytes.store(0);
+}
+
+std::shared_ptr<const FlightCatalog::Snapshot> FlightCatalog::current() const {
+    ProfiledReadLocker locker(&m_lock);
+    return m_snapshot;
+}
+
+bool FlightCatalog::isLoaded() const {
+    return current() != nullptr;
+}
+
+bool FlightCatalog::seatsWritable() const {
+    const auto snapshot = current();
+    return snapshot && snapshot->writable;
+}
+
+bool FlightCatalog::search(const QString& departure, const QString& destination, qint64 from, qint64 to,
+                           QList<Flight>* flights) const {
+    const auto snapshot = current();
+    if (!snapshot) return false;
+
+    // 与 SQL 的 LIKE '%城市%' 一致，ASCII 不区分大小写
+    auto matches = [&snapshot](quint32 offset, const QString& keyword) {
+        return keyword.isEmpty() || snapshot->string(offset).contains(keyword, Qt::CaseInsensitive);
+    };
+
+    QList<Flight> result;
+    for (quint32 i = 0; i < snapshot->header->routeCount; ++i) {
+        const CatalogRoute& route = snapshot->routes[i];
+        if (!matches(route.departure, departure) || !matches(route.destination, destination)) continue;
+
+        const CatalogRecord* first = snapshot->records + route.first;
+        const CatalogRecord* last = first + route.count;
+        const CatalogRecord* it = std::lower_bound(first, last, from, [](const CatalogRecord& record, qint64 time) {
+            return record.departTime < time;
+        });
+        for (; it != last && (to == 0 || it->departTime < to); ++it) {
+            const int index = int(it - snapshot->records);
+            const qint32 restSeats = snapshot->seats[index].load(std::memory_order_relaxed);
+            if (restSeats > 0) result.append(snapshot->flight(index, restSeats));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Flight& a, const Flight& b) {
+        return a.depart_time < b.depart_time;
+    });
+    *flights = std::move(result);
+    return true;
+}
+
+void FlightCatalog::setRestSeats(qint64 flightRef, int restSeats) {
+    const auto snapshot = current();
+    if (!snapshot || !snapshot->writable) return;
+    const int index = snapshot->recordFor(flightRef);
+    if (index >= 0) snapshot->seats[index].store(restSeats, std::memory_order_relaxed);
+}
+
+void FlightCatalog::setRestSeats(const QList<QPair<qint64, int>>& seats) {
+    const auto snapshot = current();
+    if (!snapshot || !snapshot->writable) return;
+    for (const auto& entry : seats) {
+        const int index = snapshot->recordFor(entry.first);
+        if (index >= 0) snapshot->seats[index].store(entry.second, std::memory_order_relaxed);
+    }
+}
+
+quint32 FlightCatalogBuilder::intern(const QString& value) {
+    const auto it = m_offsets.constFind(value);
+    if (it != m_offsets.constEnd()) return it.value();
+
+    const quint32 offset = quint32(m_strings.size());
+    const quint32 length = quint32(value.size());
+    m_strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    m_strings.append(reinterpret_cast<const char*>(value.utf16()), qsizetype(length) * qsizetype(sizeof(char16_t)));
+    m_strings.append((4 - m_strings.size() % 4) % 4, '\0');
+    m_offsets.insert(value, offset);
+    return offset;
+}
+
+void FlightCatalogBuilder::add(qint64 flightRef, const Flight& flight) {
+    Row row;
+    row.flightRef = flightRef;
+    row.departTime = flight.depart_time;
+    row.arriveTime = flight.arrive_time;
+    row.price = flight.price;
+    row.restSeats = flight.rest_seats;
+    row.flightId = intern(flight.flight_id);
+    row.departure = intern(flight.departure);
+    row.destination = intern(flight.destination);
+    row.departureAirport = intern(flight.departure_airport);
+    row.arrivalAirport = intern(flight.arrival_airport);
+    m_rows.append(row);
+}
+
+bool FlightCatalogBuilder::write(const QString& path, qint64 sourceMaxId, QString* error) {
+    // 同一航线的记录连续存放，航线内按出发时间排序；航线之间的先后不影响检索
+    std::sort(m_rows.begin(), m_rows.end(), [](const Row& a, const Row& b) {
+        if (a.departure != b.departure) return a.departure < b.departure;
+        if (a.destination != b.destination) return a.destination < b.destination;
+        if (a.departTime != b.departTime) return a.departTime < b.departTime;
+        return a.flightRef < b.flightRef;
+    });
+
+    std::vector<CatalogRecord> records(size_t(m_rows.size()));
+    std::vector<CatalogRoute> routes;
+    std::vector<CatalogId> ids(size_t(m_rows.size()));
+    std::vector<qint32> seats(size_t(m_rows.size()));
+    for (qsizetype i = 0; i < m_rows.size(); ++i) {
+        const Row& row = m_rows.at(i);
+        CatalogRecord& record = records[size_t(i)];
+        std::memset(&record, 0, sizeof(record));
+        record.departTime = row.departTime;
+        record.arriveTime = row.arriveTime;
+        record.price = row.price;
+        record.flightId = row.flightId;
+        record.departure = row.departure;
+        record.destination = row.destination;
+        record.departureAirport = row.departureAirport;
+        record.arrivalAirport = row.arrivalAirport;
+        ids[size_t(i)] = CatalogId{row.flightRef, quint32(i), 0};
+        seats[size_t(i)] = row.restSeats;
+
+        if (routes.empty() || routes.back().departure != row.departure || routes.back().destination != row.destination) {
+            routes.push_back(CatalogRoute{row.departure, row.destination, quint32(i), 0});
+        }
+        ++routes.back().count;
+    }
+    std::sort(ids.begin(), ids.end(), [](const CatalogId& a, const CatalogId& b) { return a.flightRef < b.flightRef; });
+
+    CatalogHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kCatalogMagic, sizeof(kCatalogMagic));
+    header.formatVersion = kFormatVersion;
+    header.headerBytes = sizeof(CatalogHeader);
+    header.generation = QRandomGenerator::global()->generate64();
+    header.sourceMaxId = sourceMaxId;
+    header.flightCount = quint32(records.size());
+    header.routeCount = quint32(routes.size());
+    header.recordsOffset = alignSection(sizeof(CatalogHeader));
+    header.routesOffset = alignSection(header.recordsOffset + records.size() * sizeof(CatalogRecord));
+    header.idsOffset = alignSection(header.routesOffset + routes.size() * sizeof(CatalogRoute));
+    header.stringsOffset = alignSection(header.idsOffset + ids.size() * sizeof(CatalogId));
+    header.stringBytes = quint64(m_strings.size());
+
+    SeatsHeader seatsHeader;
+    std::memset(&seatsHeader, 0, sizeof(seatsHeader));
+    std::memcpy(seatsHeader.magic, kSeatsMagic, sizeof(kSeatsMagic));
+    seatsHeader.generation = header.generation;
+    seatsHeader.count = header.flightCount;
+
+    const QString seatsPath = FlightCatalog::seatsPathFor(path);
+    QSaveFile seatsFile(seatsPath);
+    SectionWriter seatsOut(&seatsFile);
+    if (!seatsFile.open(QIODevice::WriteOnly)
+        || !seatsOut.write(&seatsHeader, sizeof(seatsHeader))
+        || !seatsOut.write(seats.data(), qint64(seats.size() * sizeof(qint32)))
+        || !seatsFile.commit()) {
+        if (error) *error = QString("写入 %1 失败：%2").arg(seatsPath, seatsFile.errorString());
+        return false;
+    }
+
+    QSaveFile file(path);
+    SectionWriter out(&file);
+    if (!file.open(QIODevice::WriteOnly)
+        || !out.write(&header, sizeof(header))
+        || !out.seek(qint64(header.recordsOffset))
+        || !out.write(records.data(), qint64(records.size() * sizeof(CatalogRecord)))
+        || !out.seek(qint64(header.routesOffset))
+        || !out.write(routes.data(), qint64(routes.size() * sizeof(CatalogRoute)))
+        || !out.seek(qint64(header.idsOffset))
+        || !out.write(ids.data(), qint64(ids.size() * sizeof(CatalogId)))
+        || !out.seek(qint64(header.stringsOffset))
+        || !out.write(m_strings.constData(), m_strings.size())
+        || !file.commit()) {
+        if (error) *error = QString("写入 %1 失败：%2").arg(path, file.errorString());
+        return false;
+    }
+
+    m_routeCount = int(routes.size());
+    m_bytes = qint64(header.stringsOffset + header.stringBytes) + qint64(sizeof(SeatsHeader) + seats.size() * sizeof(qint32));
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef FLIGHT_CATALOG_H
+#define FLIGHT_CATALOG_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+#include "data_model.h"
+#include "metrics/profiled_mutex.h"
+
+// 航班目录快照：航班号、城市、机场、时间、票价等只在导入时变化的列编译成一个只读二进制文件，
+// 启动时直接映射，不解析；检索在映射的页面上按航线索引定位、按出发时间二分，只有命中的航班才复制成 Flight。
+// 频繁变化的余座单独放在旁边的小文件（<快照>.seats）中，以共享方式映射，多个进程共用同一份页缓存。
+//
+// 快照文件布局（本机字节序，各段按 64 字节对齐）：
+//   文件头 | 航班记录（按 出发地、目的地、出发时间 排序）| 航线表（每条航线对应一段连续记录）
+//   | 按库中 id 排序的索引 | 字符串表（quint32 长度 + UTF-16 数据，按 4 字节对齐，记录中只存偏移）
+// 快照记录生成时库中 flight 的最大 id，与当前库不一致时不使用。航班只增不删，最大 id 即可判断是否过期
+class FlightCatalog {
+public:
+    static FlightCatalog* getInstance();
+
+    // 快照路径：FTMS_FLIGHT_CATALOG，缺省为 <库文件>.catalog；设为 off 时返回空串，不使用快照
+    static QString pathFor(const QString& dbPath);
+    static QString seatsPathFor(const QString& path);
+
+    // 映射快照与余座表，文件缺失、损坏、两者不配套或 sourceMaxId 不一致时卸载并返回 false。
+    // writable 为 true 时余座表以读写方式映射（单进程模式或写进程），否则只读
+    bool load(const QString& path, qint64 sourceMaxId, bool writable, QString* error);
+    void unload();
+    bool isLoaded() const;
+    bool seatsWritable() const;
+
+    // 与 DBManager::queryFlights 的 SQL 条件一致：城市按包含匹配（空串不限），出发时间在 [from, to) 内
+    // （to 为 0 表示不设上限），只返回有余座的航班，按出发时间升序。快照未加载时返回 false
+    bool search(const QString& departure, const QString& destination, qint64 from, qint64 to,
+                QList<Flight>* flights) const;
+
+    // 更新某航班（库中 id）的余座，快照中没有该航班时忽略。写路径在写事务提交前调用
+    void setRestSeats(qint64 flightRef, int restSeats);
+    // 批量版本，(库中 id, 余座)
+    void setRestSeats(const QList<QPair<qint64, int>>& seats);
+
+private:
+    struct Snapshot;
+
+    FlightCatalog();
+    FlightCatalog(const FlightCatalog&) = delete;
+    FlightCatalog& operator=(const FlightCatalog&) = delete;
+
+    std::shared_ptr<const Snapshot> current() const;
+
+    mutable ProfiledReadWriteLock m_lock{"flight_catalog"};   // 只保护 m_snapshot 的替换，检索在锁外进行
+    std::shared_ptr<const Snapshot> m_snapshot;
+    // 指标回调在注册表锁内执行，不能获取 m_lock，另存一份
+    std::atomic<qint64> m_flights{0};
+    std::atomic<qint64> m_mappedBytes{0};
+    static FlightCatalog* m_instance;
+};
+
+// 快照编译器：逐行收集航班，字符串去重后一次写出快照与余座表。
+// 先写余座表再写快照，各自经临时文件原子替换；已映射旧文件的进程不受影响，重新 load 后切换
+class FlightCatalogBuilder {
+public:
+    void add(qint64 flightRef, const Flight& flight);
+    bool write(const QString& path, qint64 sourceMaxId, QString* error);
+
+    int count() const { return int(m_rows.size()); }
+    int routeCount() const { return m_routeCount; }
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    struct Row {
+        qint64 flightRef = 0;
+        qint64 departTime = 0;
+        qint64 arriveTime = 0;
+        double price = 0;
+        qint32 restSeats = 0;
+        quint32 flightId = 0;
+        quint32 departure = 0;
+        quint32 destination = 0;
+        quint32 departureAirport = 0;
+        quint32 arrivalAirport = 0;
+    };
+
+    quint32 intern(const QString& value);
+
+    QList<Row> m_rows;
+    QByteArray m_strings;
+    QHash<QString, quint32> m_offsets;
+    int m_routeCount = 0;
+    qint64 m_bytes = 0;
+};
+
+#endif // FLIGHT_CATALOG_H
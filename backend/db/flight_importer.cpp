@@ -0,0 +1,361 @@
+#include "flight_importer.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlError>
+#include <QtEndian>
+
+namespace {
+constexpr int kColumnsPerRow = 9;
+constexpr int kProgressLogIntervalMs = 1000;
+
+// Unix 秒或 ISO 8601 本地时间，无法解析返回 0
+qint64 parseTime(const QString& text) {
+    bool ok = false;
+    const qint64 secs = text.toLongLong(&ok);
+    if (ok) return secs;
+    const QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+    return time.isValid() ? time.toSecsSinceEpoch() : 0;
+}
+
+qint64 parseTime(const QJsonValue& value) {
+    if (value.isDouble()) return static_cast<qint64>(value.toDouble());
+    return parseTime(value.toString());
+}
+
+bool isValidFlight(const Flight& flight) {
+    return !flight.flight_id.isEmpty() && !flight.departure.isEmpty() && !flight.destination.isEmpty() &&
+           flight.depart_time > 0 && flight.arrive_time >= flight.depart_time && flight.rest_seats >= 0;
+}
+
+Flight flightFromJson(const QJsonObject& object) {
+    Flight flight;
+    flight.flight_id = object.value("flight_id").toString();
+    flight.departure = object.value("departure").toString();
+    flight.destination = object.value("destination").toString();
+    flight.departure_airport = object.value("departure_airport").toString();
+    flight.arrival_airport = object.value("arrival_airport").toString();
+    flight.depart_time = parseTime(object.value("depart_time"));
+    flight.arrive_time = parseTime(object.value("arrive_time"));
+    flight.price = object.value("price").toDouble();
+    flight.rest_seats = object.value("rest_seats").toInt();
+    return flight;
+}
+
+double rowsPerSecond(qint64 rows, qint64 elapsedMs) {
+    return elapsedMs > 0 ? rows * 1000.0 / elapsedMs : 0.0;
+}
+}
+
+bool FlightFileReader::open(const QString& path, Format format) {
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("无法打开 %1：%2").arg(path, m_file.errorString());
+        return false;
+    }
+
+    if (format == Auto) {
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        if (suffix == "csv") format = Csv;
+        else if (suffix == "jsonl" || suffix == "ndjson") format = JsonLines;
+        else if (suffix == "json") format = JsonArray;
+        else {
+            // 无法从扩展名判断时看文件开头
+            const QByteArray head = m_file.peek(4);
+            quint32 magic = 0;
+            if (head.size() == 4) magic = qFromBigEndian<quint32>(head.constData());
+            if (magic == kFlightFileMagic) format = Binary;
+            else if (head.trimmed().startsWith('[')) format = JsonArray;
+            else if (head.trimmed().startsWith('{')) format = JsonLines;
+            else format = Csv;
+        }
+    }
+    m_format = format;
+
+    switch (m_format) {
+    case Csv: {
+        const QStringList header = QString::fromUtf8(m_file.readLine()).trimmed().split(',');
+        for (int i = 0; i < header.size(); ++i) {
+            m_columns.insert(header[i].trimmed(), i);
+        }
+        for (const char* column : {"flight_id", "departure", "destination", "depart_time", "arrive_time"}) {
+            if (!m_columns.contains(column)) {
+                m_error = QString("CSV 缺少列 %1").arg(column);
+                return false;
+            }
+        }
+        m_line = 1;
+        break;
+    }
+    case JsonArray: {
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(m_file.readAll(), &parseError);
+        if (!document.isArray()) {
+            m_error = QString("JSON 解析失败：%1").arg(parseError.errorString());
+            return false;
+        }
+        m_array = document.array();
+        break;
+    }
+    case Binary: {
+        m_stream.setDevice(&m_file);
+        m_stream.setVersion(QDataStream::Qt_6_0);
+        quint32 magic = 0, version = 0;
+        quint64 count = 0;
+        m_stream >> magic >> version >> count;
+        if (magic != kFlightFileMagic || version != kFlightFileVersion) {
+            m_error = QString("不是可识别的航班文件（版本 %1）").arg(version);
+            return false;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return true;
+}
+
+bool FlightFileReader::next(Flight* flight) {
+    switch (m_format) {
+    case Csv: return nextCsv(flight);
+    case JsonLines: return nextJsonLine(flight);
+    case JsonArray: return nextJsonArray(flight);
+    case Binary: return nextBinary(flight);
+    default: return false;
+    }
+}
+
+bool FlightFileReader::nextCsv(Flight* flight) {
+    while (!m_file.atEnd()) {
+        const QString line = QString::fromUtf8(m_file.readLine()).trimmed();
+        ++m_line;
+        if (line.isEmpty()) continue;
+
+        const QStringList fields = line.split(',');
+        auto field = [&](const char* name) {
+            const int index = m_columns.value(name, -1);
+            return index >= 0 && index < fields.size() ? fields[index].trimmed() : QString();
+        };
+        flight->flight_id = field("flight_id");
+        flight->departure = field("departure");
+        flight->destination = field("destination");
+        flight->departure_airport = field("departure_airport");
+        flight->arrival_airport = field("arrival_airport");
+        flight->depart_time = parseTime(field("depart_time"));
+        flight->arrive_time = parseTime(field("arrive_time"));
+        flight->price = field("price").toDouble();
+        flight->rest_seats = field("rest_seats").toInt();
+        if (isValidFlight(*flight)) return true;
+
+        if (m_invalid++ < 10) qDebug() << "跳过无效行" << m_line << ":" << line;
+    }
+    return false;
+}
+
+bool FlightFileReader::nextJsonLine(Flight* flight) {
+    while (!m_file.atEnd()) {
+        const QByteArray line = m_file.readLine().trimmed();
+        ++m_line;
+        if (line.isEmpty()) continue;
+
+        const QJsonDocument document = QJsonDocument::fromJson(line);
+        if (document.isObject()) {
+            *flight = flightFromJson(document.object());
+            if (isValidFlight(*flight)) return true;
+        }
+        if (m_invalid++ < 10) qDebug() << "跳过无效行" << m_line;
+    }
+    return false;
+}
+
+bool FlightFileReader::nextJsonArray(Flight* flight) {
+    while (m_arrayIndex < m_array.size()) {
+        const QJsonValue value = m_array.at(m_arrayIndex++);
+        if (value.isObject()) {
+            *flight = flightFromJson(value.toObject());
+            if (isValidFlight(*flight)) return true;
+        }
+        if (m_invalid++ < 10) qDebug() << "跳过无效记录" << m_arrayIndex;
+    }
+    return false;
+}
+
+bool FlightFileReader::nextBinary(Flight* flight) {
+    while (!m_stream.atEnd()) {
+        m_stream >> *flight;
+        if (m_stream.status() != QDataStream::Ok) {
+            m_error = "航班文件截断或损坏";
+            return false;
+        }
+        if (isValidFlight(*flight)) return true;
+        ++m_invalid;
+    }
+    return false;
+}
+
+FlightBulkWriter::FlightBulkWriter(QSqlDatabase db, const ImportOptions& options)
+    : m_db(db), m_options(options), m_batchQuery(db) {
+    m_options.rowsPerStatement = qBound(1, m_options.rowsPerStatement, 32766 / kColumnsPerRow);
+    m_options.rowsPerTransaction = qMax(m_options.rowsPerStatement, m_options.rowsPerTransaction);
+    m_pending.reserve(m_options.rowsPerStatement);
+}
+
+FlightBulkWriter::~FlightBulkWriter() {
+    if (m_open) {
+        m_db.rollback();
+        m_open = false;
+    }
+    restoreIndexes();
+}
+
+bool FlightBulkWriter::begin() {
+    m_timer.start();
+    m_logTimer.start();
+
+    if (m_options.dropIndexes) {
+        // 自动生成的唯一约束索引（sql 为空）无法删除，也需要它判断重复航班号
+        QSqlQuery query(m_db);
+        query.exec("SELECT name, sql FROM sqlite_master "
+                   "WHERE type = 'index' AND tbl_name = 'flight' AND sql IS NOT NULL");
+        QStringList names;
+        while (query.next()) {
+            names.append(query.value(0).toString());
+            m_droppedIndexes.append(query.value(1).toString());
+        }
+        for (const QString& name : names) {
+            if (!query.exec(QString("DROP INDEX IF EXISTS %1").arg(name))) {
+                m_error = query.lastError().text();
+                return false;
+            }
+        }
+        if (!names.isEmpty()) qDebug() << "导入前删除索引：" << names;
+    }
+
+    if (!prepare(m_batchQuery, m_options.rowsPerStatement)) return false;
+    m_open = m_db.transaction();
+    if (!m_open) m_error = m_db.lastError().text();
+    return m_open;
+}
+
+bool FlightBulkWriter::prepare(QSqlQuery& query, int rows) {
+    QString sql = "INSERT OR IGNORE INTO flight (flight_id, departure, destination, departure_airport, "
+                  "arrival_airport, depart_time, arrive_time, price, rest_seats) VALUES ";
+    sql.reserve(sql.size() + rows * 20);
+    for (int i = 0; i < rows; ++i) {
+        sql += i == 0 ? "(?,?,?,?,?,?,?,?,?)" : ",(?,?,?,?,?,?,?,?,?)";
+    }
+    if (!query.prepare(sql)) {
+        m_error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool FlightBulkWriter::add(const Flight& flight) {
+    m_pending.append(flight);
+    m_cities.insert(flight.departure);
+    m_cities.insert(flight.destination);
+    ++m_stats.rows;
+
+    if (m_pending.size() < m_options.rowsPerStatement) return true;
+    if (!execBatch(m_batchQuery, 0, m_pending.size())) return false;
+    m_pending.clear();
+
+    if (m_inTransaction >= m_options.rowsPerTransaction) {
+        if (!commit()) return false;
+        m_open = m_db.transaction();
+        if (!m_open) {
+            m_error = m_db.lastError().text();
+            return false;
+        }
+    }
+    logProgress(false);
+    return true;
+}
+
+bool FlightBulkWriter::execBatch(QSqlQuery& query, int offset, int rows) {
+    for (int i = 0; i < rows; ++i) {
+        const Flight& flight = m_pending[offset + i];
+        const int base = i * kColumnsPerRow;
+        query.bindValue(base, flight.flight_id);
+        query.bindValue(base + 1, flight.departure);
+        query.bindValue(base + 2, flight.destination);
+        query.bindValue(base + 3, flight.departure_airport);
+        query.bindValue(base + 4, flight.arrival_airport);
+        query.bindValue(base + 5, flight.depart_time);
+        query.bindValue(base + 6, flight.arrive_time);
+        query.bindValue(base + 7, flight.price);
+        query.bindValue(base + 8, flight.rest_seats);
+    }
+    if (!query.exec()) {
+        m_error = query.lastError().text();
+        return false;
+    }
+    const int inserted = query.numRowsAffected();
+    m_stats.inserted += inserted;
+    m_stats.skipped += rows - inserted;
+    m_inTransaction += rows;
+    return true;
+}
+
+bool FlightBulkWriter::flush() {
+    if (m_pending.isEmpty()) return true;
+    // 不足一整批的尾部单独准备一条语句
+    QSqlQuery tail(m_db);
+    if (!prepare(tail, m_pending.size()) || !execBatch(tail, 0, m_pending.size())) return false;
+    m_pending.clear();
+    return true;
+}
+
+bool FlightBulkWriter::commit() {
+    if (!m_db.commit()) {
+        m_error = m_db.lastError().text();
+        m_db.rollback();
+        m_open = false;
+        return false;
+    }
+    m_open = false;
+    m_inTransaction = 0;
+    return true;
+}
+
+bool FlightBulkWriter::finish() {
+    if (!m_open) return false;
+    if (!flush() || !commit()) return false;
+    m_stats.elapsedMs = m_timer.elapsed();
+    logProgress(true);
+
+    QElapsedTimer indexTimer;
+    indexTimer.start();
+    if (!restoreIndexes()) return false;
+    m_stats.indexMs = indexTimer.elapsed();
+    return true;
+}
+
+bool FlightBulkWriter::restoreIndexes() {
+    if (m_droppedIndexes.isEmpty()) return true;
+    qDebug() << "重建索引" << m_droppedIndexes.size() << "个...";
+
+    QSqlQuery query(m_db);
+    bool ok = true;
+    for (const QString& sql : m_droppedIndexes) {
+        if (!query.exec(sql)) {
+            qDebug() << "❌ 重建索引失败：" << sql << query.lastError().text();
+            m_error = query.lastError().text();
+            ok = false;
+        }
+    }
+    m_droppedIndexes.clear();
+    return ok;
+}
+
+void FlightBulkWriter::logProgress(bool force) {
+    if (!force && m_logTimer.elapsed() < kProgressLogIntervalMs) return;
+    m_logTimer.restart();
+    const qint64 elapsed = m_timer.elapsed();
+    qDebug() << "导入进度：已读取" << m_stats.rows << "条，写入" << m_stats.inserted
+             << "条，跳过" << m_stats.skipped << "条，"
+             << QString("%1 条/秒").arg(rowsPerSecond(m_stats.rows, elapsed), 0, 'f', 0);
+}
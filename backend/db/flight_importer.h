@@ -0,0 +1,107 @@
+#ifndef FLIGHT_IMPORTER_H
+#define FLIGHT_IMPORTER_H
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include "data_model.h"
+
+// 二进制航班文件：QDataStream（Qt_6_0）依次写入 quint32 魔数、quint32 版本、
+// quint64 条数（未知时为 0），之后是连续的 Flight 记录，直到文件结束
+constexpr quint32 kFlightFileMagic = 0x46544D46;   // "FTMF"
+constexpr quint32 kFlightFileVersion = 1;
+
+struct ImportOptions {
+    int rowsPerStatement = 200;         // 单条 INSERT 的行数，9 列 × 200 = 1800 个参数
+    int rowsPerTransaction = 100000;    // 每个事务写入的行数
+    bool dropIndexes = false;           // 导入前删除 flight 的二级索引，提交后重建（仅离线导入使用）
+};
+
+struct ImportStats {
+    qint64 rows = 0;        // 交给写入端的行数
+    qint64 inserted = 0;    // 实际写入的行数
+    qint64 skipped = 0;     // 航班号已存在而跳过的行数
+    qint64 invalid = 0;     // 无法解析或缺少必填字段的行数
+    qint64 elapsedMs = 0;
+    qint64 indexMs = 0;     // 重建索引耗时
+};
+
+// 流式读取航班文件，逐条返回，内存占用与文件大小无关（JSON 数组除外，需整体解析）。
+// CSV 首行为列名，列名与 Flight 字段同名、顺序任意，字段内不能含逗号；
+// 时间字段可以是 Unix 秒或 ISO 8601 本地时间
+class FlightFileReader {
+public:
+    enum Format { Auto, Csv, JsonLines, JsonArray, Binary };
+
+    bool open(const QString& path, Format format = Auto);
+    // 取下一条有效记录，文件结束或读取出错时返回 false；无法解析的记录计入 invalid 并跳过
+    bool next(Flight* flight);
+
+    Format format() const { return m_format; }
+    qint64 invalid() const { return m_invalid; }
+    QString errorString() const { return m_error; }
+
+private:
+    bool nextCsv(Flight* flight);
+    bool nextJsonLine(Flight* flight);
+    bool nextJsonArray(Flight* flight);
+    bool nextBinary(Flight* flight);
+
+    QFile m_file;
+    Format m_format = Auto;
+    QHash<QString, int> m_columns;      // CSV 列名 -> 下标
+    QDataStream m_stream;
+    QJsonArray m_array;
+    qsizetype m_arrayIndex = 0;
+    qint64 m_line = 0;
+    qint64 m_invalid = 0;
+    QString m_error;
+};
+
+// 批量写入 flight 表：多行 INSERT OR IGNORE 预编译一次、反复执行，按行数分段提交事务。
+// 只负责写表，城市字典由调用方根据 cities() 更新
+class FlightBulkWriter {
+public:
+    FlightBulkWriter(QSqlDatabase db, const ImportOptions& options);
+    // 未调用 finish 时回滚当前事务，并恢复已删除的索引
+    ~FlightBulkWriter();
+    FlightBulkWriter(const FlightBulkWriter&) = delete;
+    FlightBulkWriter& operator=(const FlightBulkWriter&) = delete;
+
+    bool begin();
+    bool add(const Flight& flight);
+    // 写出剩余行、提交并重建索引
+    bool finish();
+
+    const ImportStats& stats() const { return m_stats; }
+    QStringList cities() const { return m_cities.values(); }
+    QString errorString() const { return m_error; }
+
+private:
+    bool flush();
+    bool prepare(QSqlQuery& query, int rows);
+    bool execBatch(QSqlQuery& query, int offset, int rows);
+    bool commit();
+    bool restoreIndexes();
+    void logProgress(bool force);
+
+    QSqlDatabase m_db;
+    ImportOptions m_options;
+    QSqlQuery m_batchQuery;
+    QList<Flight> m_pending;
+    qint64 m_inTransaction = 0;
+    bool m_open = false;
+    QStringList m_droppedIndexes;       // 被删除索引的建表语句
+    QSet<QString> m_cities;
+    ImportStats m_stats;
+    QElapsedTimer m_timer;
+    QElapsedTimer m_logTimer;
+    QString m_error;
+};
+
+#endif // FLIGHT_IMPORTER_H
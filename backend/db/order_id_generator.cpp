@@ -0,0 +1,62 @@
+#include "order_id_generator.h"
+#include <QDateTime>
+#include <QProcessEnvironment>
+
+namespace {
+constexpr qint64 kEpochMs = 1704067200000LL;  // 2024-01-01T00:00:00Z
+constexpr int kSequenceBits = 12;
+constexpr int kNodeBits = 10;
+constexpr quint64 kSequenceMask = (quint64(1) << kSequenceBits) - 1;
+}
+
+OrderIdGenerator* OrderIdGenerator::m_instance = nullptr;
+
+OrderIdGenerator* OrderIdGenerator::getInstance() {
+    if (!m_instance) {
+        m_instance = new OrderIdGenerator();
+    }
+    return m_instance;
+}
+
+// FTMS_NODE_ID 指定节点号，默认 0
+OrderIdGenerator::OrderIdGenerator() {
+    bool ok = false;
+    const int node = QProcessEnvironment::systemEnvironment().value("FTMS_NODE_ID").trimmed().toInt(&ok);
+    if (ok) setNodeId(node);
+}
+
+void OrderIdGenerator::setNodeId(int nodeId) {
+    m_node = quint64(nodeId) & ((quint64(1) << kNodeBits) - 1);
+}
+
+qint64 OrderIdGenerator::next() {
+    const quint64 now = quint64(QDateTime::currentMSecsSinceEpoch() - kEpochMs) << kSequenceBits;
+    quint64 state = m_state.load(std::memory_order_relaxed);
+    quint64 next;
+    do {
+        // 时钟回拨或同一毫秒内：在上一个值基础上加一
+        next = now > state ? now : state + 1;
+    } while (!m_state.compare_exchange_weak(state, next, std::memory_order_relaxed));
+
+    const quint64 ms = next >> kSequenceBits;
+    const quint64 sequence = next & kSequenceMask;
+    return qint64((ms << (kNodeBits + kSequenceBits)) | (m_node << kSequenceBits) | sequence);
+}
+
+void OrderIdGenerator::advancePast(qint64 id) {
+    const quint64 ms = quint64(id) >> (kNodeBits + kSequenceBits);
+    const quint64 floor = (ms << kSequenceBits) | (quint64(id) & kSequenceMask);
+    quint64 state = m_state.load(std::memory_order_relaxed);
+    while (state < floor && !m_state.compare_exchange_weak(state, floor, std::memory_order_relaxed)) {
+    }
+}
+
+qint64 OrderIdGenerator::timestampOf(qint64 id) {
+    return (id >> (kNodeBits + kSequenceBits)) + kEpochMs;
+}
+
+qint64 OrderIdGenerator::compose(qint64 msecsSinceEpoch, int nodeId, int sequence) {
+    const quint64 ms = quint64(msecsSinceEpoch - kEpochMs);
+    const quint64 node = quint64(nodeId) & ((quint64(1) << kNodeBits) - 1);
+    return qint64((ms << (kNodeBits + kSequenceBits)) | (node << kSequenceBits) | (quint64(sequence) & kSequenceMask));
+}
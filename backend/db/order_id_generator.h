@@ -0,0 +1,37 @@
+#ifndef ORDER_ID_GENERATOR_H
+#define ORDER_ID_GENERATOR_H
+
+#include <QtGlobal>
+#include <atomic>
+
+// 按时间递增的 64 位订单号（snowflake 布局）：
+//   [41 位毫秒时间戳（自 2024-01-01 起）][10 位节点号][12 位序号]
+// 状态为一个原子量，多线程并发取号只做 CAS、不加锁；同一毫秒内序号用尽时借用下一毫秒，
+// 保证单调递增。订单号即 ticket 表的 INTEGER 主键，对外以十进制字符串表示
+class OrderIdGenerator {
+public:
+    static OrderIdGenerator* getInstance();
+
+    // 多进程部署时各进程需使用不同节点号（0-1023）
+    void setNodeId(int nodeId);
+    qint64 next();
+    // 启动时传入库中最大订单号，时钟回拨后重启也不会生成重复订单号
+    void advancePast(qint64 id);
+
+    // 从订单号还原生成时间（毫秒级 Unix 时间戳）
+    static qint64 timestampOf(qint64 id);
+    // 按指定时间、节点号和序号（0-4095）拼出订单号，供离线生成数据使用
+    static qint64 compose(qint64 msecsSinceEpoch, int nodeId, int sequence);
+
+private:
+    OrderIdGenerator();
+    OrderIdGenerator(const OrderIdGenerator&) = delete;
+    OrderIdGenerator& operator=(const OrderIdGenerator&) = delete;
+
+    // (毫秒 << 12) | 序号
+    std::atomic<quint64> m_state{0};
+    quint64 m_node = 0;
+    static OrderIdGenerator* m_instance;
+};
+
+#endif // ORDER_ID_GENERATOR_H
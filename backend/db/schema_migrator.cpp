@@ -0,0 +1,195 @@
+#include "schema_migrator.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QProcessEnvironment>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+SchemaMigrator* SchemaMigrator::m_instance = nullptr;
+
+namespace {
+constexpr int kProgressLogIntervalMs = 5000;
+
+QString cursorKey(int version) {
+    return QString("migration_cursor_%1").arg(version);
+}
+}
+
+SchemaMigrator* SchemaMigrator::getInstance() {
+    if (!m_instance) {
+        m_instance = new SchemaMigrator();
+    }
+    return m_instance;
+}
+
+void SchemaMigrator::add(const Migration& migration) {
+    Q_ASSERT(m_migrations.isEmpty() || m_migrations.last().version < migration.version);
+    m_migrations.append(migration);
+}
+
+int SchemaMigrator::latestVersion() const {
+    return m_migrations.isEmpty() ? 0 : m_migrations.last().version;
+}
+
+int SchemaMigrator::storedVersion(QSqlDatabase& db) {
+    QSqlQuery query(db);
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+bool SchemaMigrator::setStoredVersion(QSqlDatabase& db, int version) {
+    // PRAGMA 不支持绑定参数，version 为内部整数
+    QSqlQuery query(db);
+    return query.exec(QString("PRAGMA user_version = %1").arg(version));
+}
+
+bool SchemaMigrator::runForeground(QSqlDatabase& db, int legacyVersion) {
+    int version = storedVersion(db);
+    if (version == 0) {
+        version = legacyVersion;
+        if (!setStoredVersion(db, version)) return false;
+        qDebug() << "数据库结构版本未记录，按表结构判定为版本" << version;
+    }
+    m_version.store(version);
+
+    for (const Migration& migration : m_migrations) {
+        if (migration.version <= version) continue;
+        if (!migration.apply) break;  // 后台步骤，留给 startBackground
+
+        qDebug() << "执行结构迁移 v" << migration.version << migration.name;
+        QElapsedTimer timer;
+        timer.start();
+        if (!migration.apply(db) || !setStoredVersion(db, migration.version)) {
+            qDebug() << "❌ 结构迁移 v" << migration.version << "失败";
+            return false;
+        }
+        version = migration.version;
+        m_version.store(version);
+        qDebug() << "✅ 结构迁移 v" << version << "完成，耗时" << timer.elapsed() << "ms";
+    }
+    return true;
+}
+
+void SchemaMigrator::startBackground(std::function<QSqlDatabase()> connection, std::function<void()> release) {
+    if (m_thread || m_version.load() >= latestVersion()) return;
+
+    bool ok = false;
+    const int pause = QProcessEnvironment::systemEnvironment().value("FTMS_MIGRATION_PAUSE_MS").trimmed().toInt(&ok);
+    if (ok && pause >= 0) m_pauseMs = pause;
+
+    m_stop.store(false);
+    m_thread = QThread::create([this, connection, release]() {
+        {
+            QSqlDatabase db = connection();
+            runBackground(db);
+        }
+        release();
+    });
+    m_thread->setObjectName("ftms-migration");
+    // 让出 CPU 给请求线程
+    m_thread->start(QThread::LowPriority);
+}
+
+void SchemaMigrator::stop() {
+    if (!m_thread) return;
+    m_stop.store(true);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void SchemaMigrator::runPending(QSqlDatabase& db) {
+    if (m_thread || m_version.load() >= latestVersion()) return;
+    m_stop.store(false);
+    runBackground(db);
+}
+
+void SchemaMigrator::setAdvancedListener(std::function<void(int version)> listener) {
+    m_advanced = std::move(listener);
+}
+
+void SchemaMigrator::adopt(int version) {
+    int current = m_version.load();
+    while (version > current && !m_version.compare_exchange_weak(current, version)) {
+    }
+}
+
+void SchemaMigrator::runBackground(QSqlDatabase db) {
+    for (const Migration& migration : m_migrations) {
+        if (migration.version <= m_version.load()) continue;
+        if (!migration.step) {
+            qDebug() << "结构迁移 v" << migration.version << "需在启动时执行，等待下次重启";
+            break;
+        }
+        if (!runStep(db, migration)) break;
+    }
+    m_running.store(0);
+}
+
+// 反复执行一批直到完成或被要求停止；每批之后保存游标，完成时同一事务内更新 user_version。
+// 步骤需可重复执行：进程在批次提交与游标保存之间退出时，重启后会重做这一批
+bool SchemaMigrator::runStep(QSqlDatabase& db, const Migration& migration) {
+    QSqlQuery query(db);
+    qint64 cursor = 0;
+    query.prepare("SELECT value FROM meta WHERE key = :key");
+    query.bindValue(":key", cursorKey(migration.version));
+    if (query.exec() && query.next()) {
+        cursor = query.value(0).toLongLong();
+    }
+    const qint64 total = migration.total ? migration.total(db) : 0;
+
+    m_running.store(migration.version);
+    m_progress.store(cursor);
+    qDebug() << "后台结构迁移 v" << migration.version << migration.name
+             << (cursor > 0 ? QString("从断点 %1 继续").arg(cursor) : QString("开始"));
+
+    QElapsedTimer timer;
+    timer.start();
+    QElapsedTimer logTimer;
+    logTimer.start();
+    while (!m_stop.load()) {
+        bool done = false;
+        if (!migration.step(db, &cursor, &done)) {
+            qDebug() << "❌ 后台结构迁移 v" << migration.version << "失败，下次启动重试：" << db.lastError().text();
+            return false;
+        }
+        m_progress.store(cursor);
+
+        if (done) {
+            db.transaction();
+            query.prepare("DELETE FROM meta WHERE key = :key");
+            query.bindValue(":key", cursorKey(migration.version));
+            if (!query.exec() || !setStoredVersion(db, migration.version) || !db.commit()) {
+                db.rollback();
+                qDebug() << "❌ 记录结构版本失败：" << query.lastError().text();
+                return false;
+            }
+            m_version.store(migration.version);
+            qDebug() << "✅ 后台结构迁移 v" << migration.version << migration.name
+                     << "完成，耗时" << timer.elapsed() << "ms";
+            if (m_advanced) m_advanced(migration.version);
+            return true;
+        }
+
+        query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES (:key, :value)");
+        query.bindValue(":key", cursorKey(migration.version));
+        query.bindValue(":value", cursor);
+        query.exec();
+
+        if (logTimer.elapsed() >= kProgressLogIntervalMs) {
+            logTimer.restart();
+            if (total > 0) {
+                qDebug() << "后台结构迁移 v" << migration.version << "进度" << cursor << "/" << total
+                         << QString("(%1%)").arg(100.0 * cursor / total, 0, 'f', 1);
+            } else {
+                qDebug() << "后台结构迁移 v" << migration.version << "进度" << cursor;
+            }
+        }
+        if (m_pauseMs > 0) QThread::msleep(m_pauseMs);
+    }
+    qDebug() << "后台结构迁移 v" << migration.version << "已暂停，进度" << cursor;
+    return false;
+}
@@ -0,0 +1,82 @@
+#ifndef SCHEMA_MIGRATOR_H
+#define SCHEMA_MIGRATOR_H
+
+#include <QList>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+class QThread;
+
+// 一个结构版本的迁移，完成后 PRAGMA user_version 置为 version。
+// apply 为前台步骤：启动时同步执行，用于必须先于读写完成的表结构变化；
+// step 为后台步骤：在独立线程中反复调用，每次处理一批并自行提交，
+// 批次游标保存在 meta 表，进程重启后从断点继续
+struct Migration {
+    int version = 0;
+    QString name;
+    std::function<bool(QSqlDatabase& db)> apply;
+    // cursor 传入上次保存的进度并由步骤推进；*done 为 true 表示该版本完成，返回 false 表示出错
+    std::function<bool(QSqlDatabase& db, qint64* cursor, bool* done)> step;
+    // 可选：估算总量，与 cursor 同一量纲，仅用于进度日志
+    std::function<qint64(QSqlDatabase& db)> total;
+};
+
+// 按 user_version 驱动的迁移执行器。读路径通过 reached() 判断新结构是否可用，
+// 后台步骤完成前继续使用旧的读法
+class SchemaMigrator {
+public:
+    static SchemaMigrator* getInstance();
+
+    // 按版本号递增注册
+    void add(const Migration& migration);
+    int latestVersion() const;
+
+    // 读取 user_version（为 0 时使用 legacyVersion），依次执行前台步骤，
+    // 遇到后台步骤即停止，之后的前台步骤要等后台步骤完成后的下次启动再执行
+    bool runForeground(QSqlDatabase& db, int legacyVersion);
+
+    // 启动后台线程执行剩余的后台步骤。connection 在后台线程内调用以取得该线程的连接，
+    // release 在线程退出前调用
+    void startBackground(std::function<QSqlDatabase()> connection, std::function<void()> release);
+    // 请求停止并等待当前批次结束，已提交的进度不会丢失
+    void stop();
+    // 在当前线程同步执行剩余的后台步骤，供数据生成等离线工具使用
+    void runPending(QSqlDatabase& db);
+    // 后台步骤完成、user_version 提交之后在后台线程调用，写进程借此通知工作进程。
+    // 需在 startBackground 之前设置
+    void setAdvancedListener(std::function<void(int version)> listener);
+    // 不执行迁移的进程（工作进程）按其他进程记录的版本更新 reached() 的判断，版本只增不减
+    void adopt(int version);
+
+    int version() const { return m_version.load(); }
+    bool reached(int version) const { return m_version.load() >= version; }
+    // 正在后台执行的版本，0 表示空闲
+    int running() const { return m_running.load(); }
+    qint64 progress() const { return m_progress.load(); }
+
+    static int storedVersion(QSqlDatabase& db);
+
+private:
+    SchemaMigrator() = default;
+    SchemaMigrator(const SchemaMigrator&) = delete;
+    SchemaMigrator& operator=(const SchemaMigrator&) = delete;
+
+    void runBackground(QSqlDatabase db);
+    bool runStep(QSqlDatabase& db, const Migration& migration);
+    bool setStoredVersion(QSqlDatabase& db, int version);
+
+    QList<Migration> m_migrations;
+    std::atomic<int> m_version{0};
+    std::atomic<int> m_running{0};
+    std::atomic<qint64> m_progress{0};
+    std::atomic<bool> m_stop{false};
+    QThread* m_thread = nullptr;
+    std::function<void(int version)> m_advanced;
+    int m_pauseMs = 20;
+    static SchemaMigrator* m_instance;
+};
+
+#endif // SCHEMA_MIGRATOR_H
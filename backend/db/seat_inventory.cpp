@@ -0,0 +1,673 @@
+#include "seat_inventory.h"
+#include "log/logger.h"
+#include "metrics/metrics.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+SeatInventory* SeatInventory::m_instance = nullptr;
+
+namespace {
+LogCategory logSeats("seats");
+
+constexpr char kSnapshotMagic[8] = {'F', 'T', 'M', 'S', 'S', 'M', 'A', 'P'};
+constexpr char kSegmentMagic[8] = {'F', 'T', 'M', 'S', 'S', 'L', 'O', 'G'};
+constexpr quint32 kFormatVersion = 1;
+constexpr int kRows = 30;
+constexpr int kColumns = 6;
+constexpr int kSeatCount = kRows * kColumns;
+constexpr quint32 kUntracked = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    quint32 formatVersion;
+    quint32 headerBytes;
+    qint64 databaseId;
+    quint64 lastSeq;            // 快照包含的最后一条日志记录，重放从下一条开始
+    qint64 changeSeq;
+    quint64 firstSegment;       // 快照之后的第一个日志段
+    quint32 flightCount;
+    quint32 crc;                // 整个文件的 CRC-32，计算时本字段为 0
+    quint8 reserved[8];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "快照文件头布局变化需要提升 kFormatVersion");
+
+struct SnapshotEntry {
+    qint64 flightRef;
+    qint64 changeSeq;
+    quint32 flags;
+    quint32 reserved;
+    quint64 bits[3];
+};
+static_assert(sizeof(SnapshotEntry) == 48, "快照条目布局变化需要提升 kFormatVersion");
+
+struct SegmentHeader {
+    char magic[8];
+    qint64 databaseId;
+};
+static_assert(sizeof(SegmentHeader) == 16, "日志段头布局变化需要提升 kFormatVersion");
+
+struct LogRecord {
+    quint32 crc;                // 以下各字段的 CRC-32
+    quint32 flags;
+    quint64 seq;
+    qint64 changeSeq;
+    qint64 flightRef;
+    quint64 bits[3];            // 变更后该航班的完整位图
+};
+static_assert(sizeof(LogRecord) == 56, "日志记录布局变化需要提升 kFormatVersion");
+
+// CRC-32（IEEE 802.3，与 zlib 的 crc32 相同），按字节查表
+quint32 crc32(const void* data, qint64 bytes, quint32 crc = 0) {
+    static const std::array<quint32, 256> table = []() {
+        std::array<quint32, 256> values{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            values[i] = c;
+        }
+        return values;
+    }();
+    const auto* p = static_cast<const uchar*>(data);
+    crc = ~crc;
+    for (qint64 i = 0; i < bytes; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+quint32 recordCrc(const LogRecord& record) {
+    return crc32(reinterpret_cast<const char*>(&record) + sizeof(record.crc), sizeof(record) - sizeof(record.crc));
+}
+
+// 座位号 <排><列>，排 1..30 不带前导零，列 A..F；其他写法返回 -1
+int seatIndex(const QString& seatNumber) {
+    const qsizetype n = seatNumber.size();
+    if (n < 2 || n > 3 || seatNumber.at(0).unicode() == '0') return -1;
+    int row = 0;
+    for (qsizetype i = 0; i < n - 1; ++i) {
+        const ushort c = seatNumber.at(i).unicode();
+        if (c < '0' || c > '9') return -1;
+        row = row * 10 + (c - '0');
+    }
+    const ushort column = seatNumber.at(n - 1).unicode();
+    if (row < 1 || row > kRows || column < 'A' || column >= 'A' + kColumns) return -1;
+    return (row - 1) * kColumns + (column - 'A');
+}
+
+QString seatName(int index) {
+    return QString("%1%2").arg(index / kColumns + 1).arg(QChar('A' + index % kColumns));
+}
+
+// 加锁与组提交依赖 flock、fdatasync，只在 Linux 上实现；其他平台 pathFor 返回空串，座位库存不启用，
+// 以下函数只保证能编译
+#ifdef Q_OS_LINUX
+QString lastError() {
+    return QString::fromLocal8Bit(std::strerror(errno));
+}
+
+int openLockFile(const QString& path) {
+    return ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+}
+
+bool lockFile(int fd, bool wait) {
+    while (::flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB) != 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+int openLogFile(const QString& path) {
+    return ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+}
+
+bool writeAll(int fd, const void* data, qint64 bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        const ssize_t written = ::write(fd, p, size_t(bytes));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        p += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+bool truncateFile(int fd, qint64 bytes) {
+    return ::ftruncate(fd, off_t(bytes)) == 0;
+}
+
+bool syncFile(int fd) {
+    return ::fdatasync(fd) == 0;
+}
+
+int duplicateFile(int fd) {
+    return ::dup(fd);
+}
+
+void closeFile(int fd) {
+    ::close(fd);
+}
+#else
+QString lastError() {
+    return QStringLiteral("当前平台不支持座位日志");
+}
+
+int openLockFile(const QString&) { return -1; }
+bool lockFile(int, bool) { return false; }
+int openLogFile(const QString&) { return -1; }
+bool writeAll(int, const void*, qint64) { return false; }
+bool truncateFile(int, qint64) { return false; }
+bool syncFile(int) { return false; }
+int duplicateFile(int) { return -1; }
+void closeFile(int) {}
+#endif
+
+int envPositive(const QProcessEnvironment& env, const char* name, int fallback) {
+    bool ok = false;
+    const int value = env.value(name).trimmed().toInt(&ok);
+    return ok && value > 0 ? value : fallback;
+}
+}
+
+SeatInventory* SeatInventory::getInstance() {
+    if (!m_instance) {
+        m_instance = new SeatInventory();
+    }
+    return m_instance;
+}
+
+SeatInventory::SeatInventory() {
+    Metrics* metrics = Metrics::getInstance();
+    metrics->gauge("ftms_seat_inventory_flights", "座位库存中的航班数，未启用时为 0", QString(),
+                   [this]() { return double(m_trackedFlights.load()); });
+    metrics->gauge("ftms_seat_log_records", "上次座位快照之后追加的日志记录数（下次启动需要重放的上限）", QString(),
+                   [this]() { return double(m_pendingRecords.load()); });
+    metrics->gauge("ftms_seat_log_unsynced_records", "已写入但尚未 fdatasync 的座位日志记录数", QString(),
+                   [this]() { return double(m_appendedSeq.load() - qMin(m_appendedSeq.load(), m_syncedSeq.load())); });
+}
+
+QString SeatInventory::pathFor(const QString& dbPath) {
+#ifndef Q_OS_LINUX
+    Q_UNUSED(dbPath);
+    return QString();
+#endif
+    const QString configured = QProcessEnvironment::systemEnvironment().value("FTMS_SEAT_INVENTORY").trimmed();
+    if (configured.compare("off", Qt::CaseInsensitive) == 0) return QString();
+    return configured.isEmpty() ? dbPath + ".seatmap" : configured;
+}
+
+QString SeatInventory::segmentPath(quint64 segment) const {
+    return QString("%1.log.%2").arg(m_path).arg(segment);
+}
+
+quint64 SeatInventory::lastSegmentOnDisk() const {
+    const QFileInfo info(m_path);
+    const QString prefix = info.fileName() + ".log.";
+    quint64 last = 0;
+    for (const QString& name : info.dir().entryList({prefix + "*"}, QDir::Files)) {
+        bool ok = false;
+        const quint64 segment = name.mid(prefix.size()).toULongLong(&ok);
+        if (ok) last = qMax(last, segment);
+    }
+    return last;
+}
+
+bool SeatInventory::acquire(const QString& path, QString* error) {
+    if (m_lockFd >= 0) return true;
+    m_path = path;
+    m_lockFd = openLockFile(path + ".lock");
+    if (m_lockFd < 0) {
+        if (error) *error = QString("无法打开 %1：%2").arg(path + ".lock", lastError());
+        return false;
+    }
+    if (lockFile(m_lockFd, false)) return true;
+    logInfo(logSeats, "座位库存被其他进程占用，等待其退出：{}", path);
+    if (lockFile(m_lockFd, true)) return true;
+    if (error) *error = QString("加锁失败：%1").arg(lastError());
+    closeFile(m_lockFd);
+    m_lockFd = -1;
+    return false;
+}
+
+bool SeatInventory::loadSnapshot(QString* error) {
+    auto fail = [error](const QString& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    QFile file(m_path);
+    if (!file.exists()) return fail("快照不存在");
+    if (!file.open(QIODevice::ReadOnly)) return fail(QString("无法打开 %1").arg(m_path));
+    QByteArray bytes = file.readAll();
+    if (bytes.size() < qsizetype(sizeof(SnapshotHeader))) return fail("快照不完整");
+
+    SnapshotHeader header;
+    std::memcpy(&header, bytes.constData(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        header.formatVersion != kFormatVersion || header.headerBytes != sizeof(SnapshotHeader)) {
+        return fail("快照格式不符");
+    }
+    if (quint64(bytes.size()) != sizeof(SnapshotHeader) + quint64(header.flightCount) * sizeof(SnapshotEntry)) {
+        return fail("快照长度与航班数不符");
+    }
+    const quint32 expected = header.crc;
+    header.crc = 0;
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (crc32(bytes.constData(), bytes.size()) != expected) return fail("快照校验失败");
+
+    m_flights.clear();
+    m_flights.reserve(header.flightCount);
+    const char* p = bytes.constData() + sizeof(SnapshotHeader);
+    for (quint32 i = 0; i < header.flightCount; ++i, p += sizeof(SnapshotEntry)) {
+        SnapshotEntry entry;
+        std::memcpy(&entry, p, sizeof(entry));
+        FlightSeats& seats = m_flights[entry.flightRef];
+        std::memcpy(seats.bits, entry.bits, sizeof(seats.bits));
+        seats.changeSeq = entry.changeSeq;
+        seats.untracked = entry.flags & kUntracked;
+    }
+    m_databaseId = header.databaseId;
+    m_seq = header.lastSeq;
+    m_changeSeq = header.changeSeq;
+    m_segment = header.firstSegment;
+    return true;
+}
+
+// 重放一个日志段，段头不符时返回 false；遇到不完整、校验失败或序号不连续的记录时截断在该处
+bool SeatInventory::replaySegment(quint64 segment, bool* truncated) {
+    QFile file(segmentPath(segment));
+    if (!file.open(QIODevice::ReadWrite)) return false;
+    const QByteArray bytes = file.readAll();
+    SegmentHeader header;
+    if (bytes.size() < qsizetype(sizeof(header))) return false;
+    std::memcpy(&header, bytes.constData(), sizeof(header));
+    if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 || header.databaseId != m_databaseId) {
+        return false;
+    }
+
+    qint64 offset = sizeof(header);
+    while (offset + qint64(sizeof(LogRecord)) <= bytes.size()) {
+        LogRecord record;
+        std::memcpy(&record, bytes.constData() + offset, sizeof(record));
+        if (record.crc != recordCrc(record) || record.seq != m_seq + 1) break;
+        FlightSeats& seats = m_flights[record.flightRef];
+        std::memcpy(seats.bits, record.bits, sizeof(seats.bits));
+        seats.changeSeq = record.changeSeq;
+        seats.untracked = record.flags & kUntracked;
+        m_changeSeq = qMax(m_changeSeq, record.changeSeq);
+        m_seq = record.seq;
+        ++m_replayed;
+        offset += sizeof(LogRecord);
+    }
+    if (offset < bytes.size()) {
+        logWarning(logSeats, "座位日志 {} 在偏移 {} 处不完整或校验失败，截断 {} 字节", file.fileName(), offset,
+                   bytes.size() - offset);
+        file.resize(offset);
+        *truncated = true;
+    }
+    return true;
+}
+
+bool SeatInventory::restore(QString* error) {
+    QElapsedTimer timer;
+    timer.start();
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    m_replayed = 0;
+    if (!loadSnapshot(error)) {
+        m_flights.clear();
+        m_databaseId = 0;
+        m_changeSeq = 0;
+        m_segment = lastSegmentOnDisk();
+        updateMemoryLocked();
+        return false;
+    }
+
+    const quint64 onDisk = lastSegmentOnDisk();
+    bool truncated = false;
+    // 上次恢复截断后新开的段与截断的段之间可能有空号，记录序号保证不会跨过缺失的记录
+    for (quint64 segment = m_segment; segment <= onDisk && !truncated; ++segment) {
+        if (!QFile::exists(segmentPath(segment))) continue;
+        if (!replaySegment(segment, &truncated)) break;
+    }
+    // 截断处之后的记录不再可信，新记录写入新的段，旧段由下一次快照删除
+    if (!openSegment(qMax(onDisk, m_segment) + 1, error)) return false;
+    updateMemoryLocked();
+    logInfo(logSeats, "座位快照 {} 个航班，重放 {} 条日志，耗时 {} ms", m_flights.size(), m_replayed, timer.elapsed());
+    return true;
+}
+
+bool SeatInventory::openSegment(quint64 segment, QString* error) {
+    const int fd = openLogFile(segmentPath(segment));
+    SegmentHeader header;
+    std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header.databaseId = m_databaseId;
+    if (fd < 0 || !writeAll(fd, &header, sizeof(header))) {
+        if (error) *error = QString("无法创建日志段 %1：%2").arg(segmentPath(segment), lastError());
+        if (fd >= 0) closeFile(fd);
+        return false;
+    }
+    m_logFd = fd;
+    m_segment = segment;
+    m_segmentBytes = sizeof(header);
+    return true;
+}
+
+qint64 SeatInventory::databaseId() const {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    return m_databaseId;
+}
+
+qint64 SeatInventory::replayedRecords() const {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    return m_replayed;
+}
+
+qint64 SeatInventory::replayedChangeSeq() const {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    return m_changeSeq;
+}
+
+QList<qint64> SeatInventory::flightsChangedAfter(qint64 changeSeq) const {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    QList<qint64> flights;
+    for (auto it = m_flights.cbegin(); it != m_flights.cend(); ++it) {
+        if (it.value().changeSeq > changeSeq) flights.append(it.key());
+    }
+    return flights;
+}
+
+void SeatInventory::reset(qint64 databaseId, qint64 changeSeq) {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    m_flights.clear();
+    m_databaseId = databaseId;
+    m_changeSeq = changeSeq;
+    updateMemoryLocked();
+}
+
+void SeatInventory::load(qint64 flightRef, const QString& seatNumber) {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    FlightSeats& seats = m_flights[flightRef];
+    const int index = seatIndex(seatNumber);
+    if (index < 0) {
+        seats.untracked = true;
+    } else {
+        seats.bits[index / 64] |= quint64(1) << (index % 64);
+    }
+}
+
+bool SeatInventory::appendLocked(qint64 flightRef, const FlightSeats& seats) {
+    if (m_logFd < 0) return false;
+    LogRecord record;
+    record.flags = seats.untracked ? kUntracked : 0;
+    record.seq = m_seq + 1;
+    record.changeSeq = seats.changeSeq;
+    record.flightRef = flightRef;
+    std::memcpy(record.bits, seats.bits, sizeof(record.bits));
+    record.crc = recordCrc(record);
+    if (!writeAll(m_logFd, &record, sizeof(record))) {
+        logWarning(logSeats, "写座位日志失败：{}", lastError());
+        return false;
+    }
+    m_seq = record.seq;
+    m_segmentBytes += sizeof(record);
+    ++m_sinceCheckpoint;
+    m_appendedSeq.store(m_seq, std::memory_order_relaxed);
+    m_pendingRecords.store(qint64(m_sinceCheckpoint), std::memory_order_relaxed);
+    return true;
+}
+
+bool SeatInventory::assign(qint64 flightRef, const QStringList& seatNumbers, qint64 changeSeq) {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    FlightSeats seats;
+    seats.changeSeq = changeSeq;
+    for (const QString& seatNumber : seatNumbers) {
+        const int index = seatIndex(seatNumber);
+        if (index < 0) {
+            seats.untracked = true;
+        } else {
+            seats.bits[index / 64] |= quint64(1) << (index % 64);
+        }
+    }
+    if (!appendLocked(flightRef, seats)) {
+        // 日志里可能留着与库不符的记录：该航班改走 SQL，并删除快照让下次启动全量重建
+        seats.untracked = true;
+        m_flights[flightRef] = seats;
+        QFile::remove(m_path);
+        logWarning(logSeats, "航班 {} 的座位无法写入日志，下次启动时全量重建座位库存", flightRef);
+        updateMemoryLocked();
+        return false;
+    }
+    m_flights[flightRef] = seats;
+    updateMemoryLocked();
+    return true;
+}
+
+bool SeatInventory::apply(qint64 changeSeq, std::initializer_list<SeatChange> changes) {
+    std::lock_guard<ProfiledMutex> lock(m_mutex);
+    // 改签可能涉及两个航班，也可能是同一航班换座，先合并出各航班变更后的状态
+    QList<QPair<qint64, FlightSeats>> updated;
+    for (const SeatChange& change : changes) {
+        auto it = std::find_if(updated.begin(), updated.end(), [&change](const QPair<qint64, FlightSeats>& entry) {
+            return entry.first == change.flightRef;
+        });
+        if (it == updated.end()) {
+            updated.append(qMakePair(change.flightRef, m_flights.value(change.flightRef)));
+            it = updated.end() - 1;
+        }
+        FlightSeats& seats = it->second;
+        seats.changeSeq = changeSeq;
+        const int index = seatIndex(change.seatNumber);
+        if (index < 0) {
+            seats.untracked = true;
+        } else if (change.occupied) {
+            seats.bits[index / 64] |= quint64(1) << (index % 64);
+        } else {
+            seats.bits[index / 64] &= ~(quint64(1) << (index % 64));
+        }
+    }
+
+    // 一次变更的记录要么全部留在日志里，要么全部撤掉
+    const quint64 startSeq = m_seq;
+    const qint64 startBytes = m_segmentBytes;
+    for (const auto& entry : updated) {
+        if (appendLocked(entry.first, entry.second)) continue;
+        if (m_logFd >= 0 && !truncateFile(m_logFd, startBytes)) {
+            QFile::remove(m_path);
+            logWarning(logSeats, "无法撤掉不完整的座位日志，下次启动时全量重建座位库存");
+        }
+        m_sinceCheckpoint -= m_seq - startSeq;
+        m_seq = startSeq;
+        m_segmentBytes = startBytes;
+        m_appendedSeq.store(m_seq, std::memory_order_relaxed);
+        return false;
+    }
+    for (const auto& entry : updated) m_flights[entry.first] = entry.second;
+    m_changeSeq = qMax(m_changeSeq, changeSeq);
+    updateMemoryLocked();
+    return true;
+}
+
+bool SeatInventory::checkpoint(QString* error) {
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray bytes;
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    int previousFd = -1;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+        header.formatVersion = kFormatVersion;
+        header.headerBytes = sizeof(SnapshotHeader);
+        header.databaseId = m_databaseId;
+        header.lastSeq = m_seq;
+        header.changeSeq = m_changeSeq;
+        header.flightCount = quint32(m_flights.size());
+
+        QList<SnapshotEntry> entries;
+        entries.reserve(m_flights.size());
+        for (auto it = m_flights.cbegin(); it != m_flights.cend(); ++it) {
+            SnapshotEntry entry;
+            entry.flightRef = it.key();
+            entry.changeSeq = it.value().changeSeq;
+            entry.flags = it.value().untracked ? kUntracked : 0;
+            entry.reserved = 0;
+            std::memcpy(entry.bits, it.value().bits, sizeof(entry.bits));
+            entries.append(entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const SnapshotEntry& a, const SnapshotEntry& b) {
+            return a.flightRef < b.flightRef;
+        });
+        bytes.reserve(sizeof(SnapshotHeader) + entries.size() * sizeof(SnapshotEntry));
+        bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        bytes.append(reinterpret_cast<const char*>(entries.constData()), entries.size() * sizeof(SnapshotEntry));
+
+        // 之后的记录都写进新的段，重放从新段开始
+        previousFd = m_logFd;
+        if (!openSegment(m_segment + 1, error)) return false;
+        header.firstSegment = m_segment;
+        m_sinceCheckpoint = 0;
+        m_pendingRecords.store(0, std::memory_order_relaxed);
+    }
+    if (previousFd >= 0) {
+        syncFile(previousFd);
+        closeFile(previousFd);
+    }
+
+    header.crc = 0;
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    header.crc = crc32(bytes.constData(), bytes.size());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    // 快照替换失败时旧快照与旧段都还在，下次启动照常重放
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        if (error) *error = QString("写座位快照失败：%1").arg(file.errorString());
+        return false;
+    }
+
+    const QFileInfo info(m_path);
+    const QString prefix = info.fileName() + ".log.";
+    for (const QString& name : info.dir().entryList({prefix + "*"}, QDir::Files)) {
+        bool ok = false;
+        const quint64 segment = name.mid(prefix.size()).toULongLong(&ok);
+        if (ok && segment < header.firstSegment) info.dir().remove(name);
+    }
+    logInfo(logSeats, "座位快照已写出：{} 个航班，{} 字节，耗时 {} ms", header.flightCount, bytes.size(), timer.elapsed());
+    return true;
+}
+
+void SeatInventory::start() {
+    if (m_thread.joinable()) return;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        m_stopping = false;
+    }
+    m_active.store(true, std::memory_order_release);
+    m_thread = std::thread([this]() { run(); });
+}
+
+void SeatInventory::stop() {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    QString error;
+    if (!checkpoint(&error)) logWarning(logSeats, "{}", error);
+}
+
+// 组提交：每个周期对本周期追加的全部记录做一次 fdatasync；记录数或时间到了就写新快照
+void SeatInventory::run() {
+    const auto env = QProcessEnvironment::systemEnvironment();
+    const auto syncInterval = std::chrono::milliseconds(envPositive(env, "FTMS_SEAT_LOG_SYNC_MS", 20));
+    const quint64 snapshotRecords = quint64(envPositive(env, "FTMS_SEAT_SNAPSHOT_RECORDS", 100000));
+    const qint64 snapshotMs = qint64(envPositive(env, "FTMS_SEAT_SNAPSHOT_SECS", 300)) * 1000;
+    QElapsedTimer sinceCheckpoint;
+    sinceCheckpoint.start();
+
+    std::unique_lock<ProfiledMutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_wake.wait_for(lock, syncInterval, [this]() { return m_stopping; });
+        if (m_stopping) break;
+
+        const quint64 seq = m_seq;
+        if (m_logFd >= 0 && seq > m_syncedSeq.load(std::memory_order_relaxed)) {
+            // 复制一份描述符在锁外同步，同步期间写事务照常追加
+            const int fd = duplicateFile(m_logFd);
+            lock.unlock();
+            if (fd >= 0) {
+                if (syncFile(fd)) m_syncedSeq.store(seq, std::memory_order_relaxed);
+                closeFile(fd);
+            }
+            lock.lock();
+        }
+
+        const bool due = m_sinceCheckpoint >= snapshotRecords ||
+                         (m_sinceCheckpoint > 0 && sinceCheckpoint.elapsed() >= snapshotMs);
+        if (due) {
+            lock.unlock();
+            QString error;
+            if (!checkpoint(&error)) logWarning(logSeats, "{}", error);
+            sinceCheckpoint.restart();
+            lock.lock();
+        }
+    }
+}
+
+void SeatInventory::updateMemoryLocked() {
+    m_memory.resize(qint64(m_flights.capacity()) * qint64(sizeof(qint64) + sizeof(FlightSeats) + 8));
+    m_trackedFlights.store(m_flights.size(), std::memory_order_relaxed);
+}
+
+bool SeatInventory::occupiedSeats(qint64 flightRef, QStringList* seats) const {
+    if (!isActive()) return false;
+    FlightSeats state;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        state = m_flights.value(flightRef);
+    }
+    if (state.untracked) return false;
+    seats->clear();
+    for (int index = 0; index < kSeatCount; ++index) {
+        if (state.bits[index / 64] & (quint64(1) << (index % 64))) seats->append(seatName(index));
+    }
+    return true;
+}
+
+QString SeatInventory::pickFreeSeat(qint64 flightRef) const {
+    if (!isActive()) return QString();
+    FlightSeats state;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        state = m_flights.value(flightRef);
+    }
+    if (state.untracked) return QString();
+    int occupied = 0;
+    for (quint64 word : state.bits) occupied += qPopulationCount(word);
+    if (occupied >= kSeatCount) return QString();
+
+    // 在空闲座位中均匀取一个
+    int remaining = QRandomGenerator::global()->bounded(kSeatCount - occupied);
+    for (int index = 0; index < kSeatCount; ++index) {
+        if (state.bits[index / 64] & (quint64(1) << (index % 64))) continue;
+        if (remaining-- == 0) return seatName(index);
+    }
+    return QString();
+}
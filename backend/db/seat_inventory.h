@@ -0,0 +1,124 @@
+#ifndef SEAT_INVENTORY_H
+#define SEAT_INVENTORY_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <condition_variable>
+#include <initializer_list>
+#include <thread>
+
+#include "metrics/memory_accounting.h"
+#include "metrics/profiled_mutex.h"
+
+// 座位库存：执行写事务的进程（单进程模式或写进程）在内存中按航班保存已占座位位图
+// （30 排 × 6 座，座位号 1A…30F），随机选座与座位图查询不再读出整个航班的订单。
+// 持久化由两部分组成，启动恢复的耗时只与航班数和快照之后的日志条数有关，与订单总数无关：
+//   快照  <路径>           各航班的位图与最后一次变更的 order_change.seq，经临时文件原子替换
+//   日志  <路径>.log.<N>   只追加的定长记录，每条带 CRC-32，记录变更后该航班的完整位图，重放幂等
+// 订票、退票、改签在写事务内、提交之前追加日志（此时持有库的写锁，日志顺序与提交顺序一致），
+// write 返回即可在进程被 kill -9 后保留；fdatasync 由后台线程按 FTMS_SEAT_LOG_SYNC_MS（默认 20）
+// 成批执行（组提交），不阻塞写事务。日志超过 FTMS_SEAT_SNAPSHOT_RECORDS 条（默认 100000）或
+// 距上次快照 FTMS_SEAT_SNAPSHOT_SECS 秒（默认 300）后写新快照，切到新的日志段并删除旧段。
+// 座位号不在 1A…30F 范围内的航班标记为不跟踪，查询退回 SQL
+//
+// 文件格式（本机字节序）：
+//   快照  文件头（64 字节）| 航班条目（48 字节，按航班 id 排序），CRC 覆盖整个文件
+//   日志  段头（16 字节：魔数 + 库标识）| 记录（56 字节）…，记录序号跨段连续
+// 库标识是全量重建时生成的随机数，同时写入库的 meta 表，用来识别换过的库文件
+class SeatInventory {
+public:
+    struct SeatChange {
+        qint64 flightRef;
+        QString seatNumber;
+        bool occupied;
+    };
+
+    static SeatInventory* getInstance();
+
+    // 快照路径：FTMS_SEAT_INVENTORY，缺省为 <库文件>.seatmap；设为 off 或不是 Linux 时返回空串，不启用
+    static QString pathFor(const QString& dbPath);
+
+    // 取得 <路径>.lock 上的排他锁，滚动重启时新写进程在此等旧写进程退出
+    bool acquire(const QString& path, QString* error);
+    // 读入快照并按序号重放其后的日志，在第一条不完整或校验失败的记录处截断，之后的记录写入新的日志段。
+    // 快照缺失或损坏时返回 false，由调用方全量重建
+    bool restore(QString* error);
+    qint64 databaseId() const;
+    qint64 replayedRecords() const;
+    // 快照与日志中出现过的最大 order_change.seq
+    qint64 replayedChangeSeq() const;
+    // 最后一次变更的 order_change.seq 大于 changeSeq 的航班（崩溃时未提交的事务留下的记录）
+    QList<qint64> flightsChangedAfter(qint64 changeSeq) const;
+
+    // 全量重建：清空后逐个登记库中的座位，不写日志，最后由 checkpoint 写出快照
+    void reset(qint64 databaseId, qint64 changeSeq);
+    void load(qint64 flightRef, const QString& seatNumber);
+    // 按库中的座位整体替换某航班的状态并写日志（恢复校正、提交失败后的回退）
+    bool assign(qint64 flightRef, const QStringList& seatNumbers, qint64 changeSeq);
+    // 在写事务内、提交之前调用：先写日志再改内存，日志写失败时不改内存并返回 false，调用方回滚
+    bool apply(qint64 changeSeq, std::initializer_list<SeatChange> changes);
+
+    // 写出快照，切到新的日志段并删除旧段
+    bool checkpoint(QString* error);
+    // 恢复完成后启动组提交与定期快照的后台线程，之后查询接口才生效
+    void start();
+    // 停止后台线程、写最后一次快照；之后的 apply 仍写日志
+    void stop();
+    bool isActive() const { return m_active.load(std::memory_order_acquire); }
+
+    // 航班未跟踪或库存未启用时返回 false
+    bool occupiedSeats(qint64 flightRef, QStringList* seats) const;
+    // 随机取一个空闲座位，未跟踪、未启用或已满时返回空串
+    QString pickFreeSeat(qint64 flightRef) const;
+
+private:
+    struct FlightSeats {
+        quint64 bits[3] = {0, 0, 0};
+        qint64 changeSeq = 0;
+        bool untracked = false;
+    };
+
+    SeatInventory();
+    SeatInventory(const SeatInventory&) = delete;
+    SeatInventory& operator=(const SeatInventory&) = delete;
+
+    QString segmentPath(quint64 segment) const;
+    quint64 lastSegmentOnDisk() const;
+    bool loadSnapshot(QString* error);
+    bool replaySegment(quint64 segment, bool* truncated);
+    bool openSegment(quint64 segment, QString* error);
+    bool appendLocked(qint64 flightRef, const FlightSeats& seats);
+    void updateMemoryLocked();
+    void run();
+
+    QString m_path;
+    int m_lockFd = -1;
+
+    mutable ProfiledMutex m_mutex{"seat_inventory"};  // 保护以下状态与日志追加
+    QHash<qint64, FlightSeats> m_flights;
+    qint64 m_databaseId = 0;
+    qint64 m_changeSeq = 0;
+    quint64 m_seq = 0;                  // 最后一条日志记录的序号
+    quint64 m_segment = 0;              // 当前日志段编号
+    int m_logFd = -1;
+    qint64 m_segmentBytes = 0;
+    quint64 m_sinceCheckpoint = 0;      // 上次快照之后追加的记录数
+    qint64 m_replayed = 0;
+    bool m_stopping = false;
+    std::condition_variable_any m_wake;
+    MemoryCharge m_memory{MemoryTag::Caches};
+
+    std::atomic<bool> m_active{false};
+    std::thread m_thread;
+    // 指标回调在注册表锁内执行，不能获取 m_mutex，另存一份
+    std::atomic<qint64> m_trackedFlights{0};
+    std::atomic<qint64> m_pendingRecords{0};
+    std::atomic<quint64> m_appendedSeq{0};
+    std::atomic<quint64> m_syncedSeq{0};
+    static SeatInventory* m_instance;
+};
+
+#endif // SEAT_INVENTORY_H
@@ -0,0 +1,165 @@
+#include "statement_profiler.h"
+#include "log/logger.h"
+#include "metrics/metrics.h"
+#include <QMutexLocker>
+#include <QVariant>
+#include <algorithm>
+
+StatementProfiler* StatementProfiler::m_instance = nullptr;
+
+namespace {
+LogCategory logSql("sql");
+
+// 参数只记类型与长度，不记值（含密码哈希、手机号等）
+QByteArray valueShape(const QVariant& value) {
+    if (value.isNull()) return "null";
+    switch (value.typeId()) {
+    case QMetaType::Bool:
+        return "bool";
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return "int";
+    case QMetaType::Double:
+        return "real";
+    case QMetaType::QString:
+        return "text(" + QByteArray::number(value.toString().size()) + ")";
+    case QMetaType::QByteArray:
+        return "blob(" + QByteArray::number(value.toByteArray().size()) + ")";
+    default:
+        return value.typeName();
+    }
+}
+
+QByteArray bindShapes(const QVariantList& values) {
+    QByteArray out;
+    for (const QVariant& value : values) {
+        if (!out.isEmpty()) out += ",";
+        out += valueShape(value);
+    }
+    return out;
+}
+
+// 只有查询与增删改有执行计划；事务控制、PRAGMA 与建表语句跳过
+bool explainable(const QString& sql) {
+    static const char* const kVerbs[] = {"SELECT", "INSERT", "UPDATE", "DELETE", "WITH", "REPLACE"};
+    for (const char* verb : kVerbs) {
+        if (sql.startsWith(QLatin1String(verb), Qt::CaseInsensitive)) return true;
+    }
+    return false;
+}
+
+// EXPLAIN QUERY PLAN 中不带 USING（索引、主键、覆盖索引）的 SCAN 即全表扫描
+bool hasFullScan(const QStringList& plan) {
+    for (const QString& line : plan) {
+        const QString detail = line.trimmed();
+        if (detail.startsWith("SCAN ") && !detail.contains("USING ")) return true;
+    }
+    return false;
+}
+}
+
+StatementProfiler* StatementProfiler::getInstance() {
+    if (!m_instance) {
+        m_instance = new StatementProfiler();
+    }
+    return m_instance;
+}
+
+StatementProfiler::StatementProfiler() {
+    bool ok = false;
+    const int ms = qEnvironmentVariableIntValue("FTMS_SLOW_SQL_MS", &ok);
+    if (ok) setThresholdMs(ms);
+}
+
+bool StatementProfiler::exec(QSqlQuery& query) {
+    if (m_thresholdUs.load(std::memory_order_relaxed) < 0) return query.exec();
+    const qint64 start = Metrics::nowMicros();
+    const bool ok = query.exec();
+    return record(query, query.lastQuery(), ok, Metrics::nowMicros() - start);
+}
+
+bool StatementProfiler::exec(QSqlQuery& query, const QString& sql) {
+    if (m_thresholdUs.load(std::memory_order_relaxed) < 0) return query.exec(sql);
+    const qint64 start = Metrics::nowMicros();
+    const bool ok = query.exec(sql);
+    return record(query, sql, ok, Metrics::nowMicros() - start);
+}
+
+bool StatementProfiler::record(QSqlQuery& query, const QString& sql, bool ok, qint64 micros) {
+    const qint64 threshold = m_thresholdUs.load(std::memory_order_relaxed);
+    const bool slow = micros >= threshold;
+    const int rows = ok && !query.isSelect() ? query.numRowsAffected() : -1;
+    // 同一形态在源码中可能有不同的缩进与换行
+    const QString shape = sql.simplified();
+
+    bool capturePlan = false;
+    QStringList plan;
+    {
+        QMutexLocker locker(&m_mutex);
+        ShapeStats& stats = m_shapes[shape];
+        if (stats.count == 0) stats.sql = shape;
+        ++stats.count;
+        stats.totalUs += micros;
+        stats.maxUs = qMax(stats.maxUs, micros);
+        if (rows > 0) stats.rowsAffected += rows;
+        if (!slow) return ok;
+        // 计划为空且未抓取过时由本线程抓取；抓取前先置标记，并发变慢的同形态语句不重复执行 EXPLAIN
+        capturePlan = stats.slow++ == 0 && m_planProvider && explainable(shape);
+        plan = stats.plan;
+    }
+
+    const QVariantList values = query.boundValues();
+    if (capturePlan) {
+        plan = m_planProvider(sql, values);
+        QMutexLocker locker(&m_mutex);
+        ShapeStats& stats = m_shapes[shape];
+        stats.plan = plan;
+        stats.fullScan = hasFullScan(plan);
+    }
+
+    logWarning(logSql, "🐢 慢语句 {}ms rows={} 参数=[{}] 计划=[{}] {}", micros / 1000, rows,
+               bindShapes(values), plan.join(" | "), shape);
+    return ok;
+}
+
+QByteArray StatementProfiler::report(int n, const QByteArray& orderBy) {
+    QList<ShapeStats> shapes;
+    {
+        QMutexLocker locker(&m_mutex);
+        shapes = m_shapes.values();
+    }
+
+    auto key = [&orderBy](const ShapeStats& s) -> double {
+        if (orderBy == "max") return double(s.maxUs);
+        if (orderBy == "count") return double(s.count);
+        if (orderBy == "avg") return s.count ? double(s.totalUs) / double(s.count) : 0.0;
+        return double(s.totalUs);
+    };
+    std::sort(shapes.begin(), shapes.end(),
+              [&key](const ShapeStats& a, const ShapeStats& b) { return key(a) > key(b); });
+    if (n > 0 && shapes.size() > n) shapes = shapes.mid(0, n);
+
+    QByteArray out = "count      total_ms   avg_us     max_us     slow   rows       scan  sql\n";
+    for (const ShapeStats& s : shapes) {
+        const qint64 avg = s.count ? s.totalUs / qint64(s.count) : 0;
+        out += QByteArray::number(s.count).leftJustified(11)
+               + QByteArray::number(s.totalUs / 1000).leftJustified(11)
+               + QByteArray::number(avg).leftJustified(11)
+               + QByteArray::number(s.maxUs).leftJustified(11)
+               + QByteArray::number(s.slow).leftJustified(7)
+               + QByteArray::number(s.rowsAffected).leftJustified(11)
+               + QByteArray(s.fullScan ? "full" : "-").leftJustified(6)
+               + s.sql.toUtf8() + "\n";
+        for (const QString& line : s.plan) {
+            out += "    plan: " + line.toUtf8() + "\n";
+        }
+    }
+    return out;
+}
+
+void StatementProfiler::reset() {
+    QMutexLocker locker(&m_mutex);
+    m_shapes.clear();
+}
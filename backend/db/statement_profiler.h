@@ -0,0 +1,63 @@
+#ifndef STATEMENT_PROFILER_H
+#define STATEMENT_PROFILER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSqlQuery>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+#include "metrics/profiled_mutex.h"
+
+// 语句级计时：DBManager 的语句都经 exec() 执行，按语句形态（带占位符的 SQL）汇总次数与耗时。
+// 超过 FTMS_SLOW_SQL_MS（默认 100，-1 关闭计时）的语句写入慢语句日志，带参数形态、耗时、
+// 影响行数与 EXPLAIN QUERY PLAN；执行计划每种形态只在第一次变慢时抓取一次。
+//
+// 计时覆盖 exec()，QtSql 的 SQLite 驱动在其中执行到第一行结果，排序、聚合与写语句的全部工作都在此完成；
+// 逐行读取剩余结果的时间计入 DBManager 各操作的耗时指标
+class StatementProfiler {
+public:
+    struct ShapeStats {
+        QString sql;
+        quint64 count = 0;
+        qint64 totalUs = 0;
+        qint64 maxUs = 0;
+        quint64 slow = 0;
+        qint64 rowsAffected = 0;    // 写语句累计影响行数
+        QStringList plan;           // 首次变慢时抓取，之前为空
+        bool fullScan = false;      // 计划中有不走索引的 SCAN
+    };
+
+    // 在语句所在连接上执行 EXPLAIN QUERY PLAN，返回各行 detail；由 DBManager 提供
+    using PlanProvider = std::function<QStringList(const QString& sql, const QVariantList& values)>;
+
+    static StatementProfiler* getInstance();
+
+    void setThresholdMs(int ms) { m_thresholdUs.store(ms < 0 ? -1 : qint64(ms) * 1000, std::memory_order_relaxed); }
+    void setPlanProvider(PlanProvider provider) { m_planProvider = std::move(provider); }
+
+    // 代替 query.exec()：已 prepare 的语句与直接给出 SQL 的语句
+    bool exec(QSqlQuery& query);
+    bool exec(QSqlQuery& query, const QString& sql);
+
+    // 按 total / max / count / avg 排序的前 n 种语句形态，文本表格
+    QByteArray report(int n, const QByteArray& orderBy);
+    void reset();
+
+private:
+    StatementProfiler();
+    StatementProfiler(const StatementProfiler&) = delete;
+    StatementProfiler& operator=(const StatementProfiler&) = delete;
+
+    bool record(QSqlQuery& query, const QString& sql, bool ok, qint64 micros);
+
+    std::atomic<qint64> m_thresholdUs{100 * 1000};
+    PlanProvider m_planProvider;
+    ProfiledMutex m_mutex{"sql_profiler"};     // 保护 m_shapes，只在语句执行后短暂持有
+    QHash<QString, ShapeStats> m_shapes;
+
+    static StatementProfiler* m_instance;
+};
+
+#endif // STATEMENT_PROFILER_H
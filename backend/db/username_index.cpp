@@ -0,0 +1,148 @@
+#include "username_index.h"
+#include "metrics/metrics.h"
+#include <QDebug>
+#include <QHash>
+#include <QProcessEnvironment>
+#include <cmath>
+
+namespace {
+constexpr double kLn2 = 0.69314718055994530942;
+constexpr size_t kSeed1 = 0x9E3779B97F4A7C15ull;
+constexpr size_t kSeed2 = 0xC2B2AE3D27D4EB4Full;
+// 正向缓存每项的内存估算：QCache 节点、哈希桶与一个短用户名
+constexpr qint64 kCacheEntryBytes = 128;
+}
+
+UsernameIndex* UsernameIndex::m_instance = nullptr;
+
+UsernameIndex* UsernameIndex::getInstance() {
+    if (!m_instance) {
+        m_instance = new UsernameIndex();
+    }
+    return m_instance;
+}
+
+// FTMS_USERNAME_FP_RATE 目标误判率（默认 0.01），FTMS_USERNAME_CAPACITY 最小容量，
+// FTMS_USERNAME_CACHE 正向缓存条数
+UsernameIndex::UsernameIndex() {
+    const auto env = QProcessEnvironment::systemEnvironment();
+    bool ok = false;
+    const double fpRate = env.value("FTMS_USERNAME_FP_RATE").trimmed().toDouble(&ok);
+    m_fpRate = (ok && fpRate > 0.0 && fpRate < 0.5) ? fpRate : 0.01;
+    const int capacity = env.value("FTMS_USERNAME_CAPACITY").trimmed().toInt(&ok);
+    m_minCapacity = (ok && capacity > 0) ? capacity : 100000;
+    const int cacheSize = env.value("FTMS_USERNAME_CACHE").trimmed().toInt(&ok);
+    m_present.setMaxCost((ok && cacheSize > 0) ? cacheSize : 4096);
+
+    // 查询去向：过滤器判定不存在、正向缓存命中、回落查库
+    const char* help = "缓存命中情况";
+    Metrics* metrics = Metrics::getInstance();
+    metrics->callbackCounter("ftms_cache_requests_total", help, "cache=\"username\",result=\"bloom_negative\"",
+                             [this]() { return double(m_definiteMisses.load()); });
+    metrics->callbackCounter("ftms_cache_requests_total", help, "cache=\"username\",result=\"hit\"",
+                             [this]() { return double(m_cacheHits.load()); });
+    metrics->callbackCounter("ftms_cache_requests_total", help, "cache=\"username\",result=\"miss\"",
+                             [this]() { return double(m_dbLookups.load()); });
+}
+
+void UsernameIndex::rebuild(const QStringList& usernames) {
+    const int capacity = qMax(m_minCapacity, int(usernames.size()) * 2);
+    // 最优参数：m = -n·ln(p) / (ln2)^2，k = (m/n)·ln2
+    const qint64 bits = qMax<qint64>(64, qint64(std::ceil(-capacity * std::log(m_fpRate) / (kLn2 * kLn2))));
+    const int hashes = qBound(1, int(std::lround(double(bits) / capacity * kLn2)), 16);
+
+    ProfiledWriteLocker locker(&m_lock);
+    m_capacity = capacity;
+    m_bitCount = (bits + 63) / 64 * 64;
+    m_hashCount = hashes;
+    m_words.fill(0, int(m_bitCount / 64));
+    m_bloomMemory.resize(qint64(m_words.capacity()) * qint64(sizeof(quint64)));
+    m_count = 0;
+    for (const QString& username : usernames) {
+        setBit(qHash(username, kSeed1), qHash(username, kSeed2));
+        ++m_count;
+    }
+    m_loaded = true;
+
+    qDebug() << "用户名布隆过滤器：" << m_count << "个用户名，" << m_bitCount / 8 / 1024 << "KB，"
+             << m_hashCount << "个哈希，目标误判率" << m_fpRate;
+}
+
+UsernameIndex::Lookup UsernameIndex::lookup(const QString& username) {
+    {
+        ProfiledReadLocker locker(&m_lock);
+        if (m_loaded && !testBits(qHash(username, kSeed1), qHash(username, kSeed2))) {
+            m_definiteMisses++;
+            return DefinitelyAbsent;
+        }
+    }
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (m_present.contains(username)) {
+            m_cacheHits++;
+            return KnownPresent;
+        }
+    }
+    m_dbLookups++;
+    return Unknown;
+}
+
+void UsernameIndex::add(const QString& username) {
+    {
+        ProfiledWriteLocker locker(&m_lock);
+        if (m_loaded) {
+            setBit(qHash(username, kSeed1), qHash(username, kSeed2));
+            ++m_count;
+        }
+    }
+    rememberPresent(username);
+}
+
+void UsernameIndex::rememberPresent(const QString& username) {
+    QMutexLocker locker(&m_cacheMutex);
+    m_present.insert(username, new bool(true));
+    m_cacheMemory.resize(qint64(m_present.size()) * kCacheEntryBytes);
+}
+
+bool UsernameIndex::needsRebuild() const {
+    ProfiledReadLocker locker(&m_lock);
+    return m_loaded && m_count > m_capacity;
+}
+
+UsernameIndex::Stats UsernameIndex::stats() const {
+    Stats s;
+    {
+        ProfiledReadLocker locker(&m_lock);
+        s.count = m_count;
+        s.capacity = m_capacity;
+        s.bits = m_bitCount;
+        s.hashes = m_hashCount;
+        s.targetFpRate = m_fpRate;
+        // p ≈ (1 - e^(-kn/m))^k
+        if (m_bitCount > 0) {
+            s.estimatedFpRate = std::pow(1.0 - std::exp(-double(m_hashCount) * m_count / m_bitCount), m_hashCount);
+        }
+    }
+    s.definiteMisses = m_definiteMisses.load();
+    s.cacheHits = m_cacheHits.load();
+    s.dbLookups = m_dbLookups.load();
+    return s;
+}
+
+// 双重哈希：第 i 个位置为 h1 + i·h2，只需计算两次字符串哈希
+void UsernameIndex::setBit(quint64 hash1, quint64 hash2) {
+    hash2 |= 1;  // 步长为奇数，避免各位置重合
+    for (int i = 0; i < m_hashCount; ++i) {
+        const quint64 bit = (hash1 + quint64(i) * hash2) % quint64(m_bitCount);
+        m_words[int(bit / 64)] |= quint64(1) << (bit % 64);
+    }
+}
+
+bool UsernameIndex::testBits(quint64 hash1, quint64 hash2) const {
+    hash2 |= 1;
+    for (int i = 0; i < m_hashCount; ++i) {
+        const quint64 bit = (hash1 + quint64(i) * hash2) % quint64(m_bitCount);
+        if (!(m_words[int(bit / 64)] & (quint64(1) << (bit % 64)))) return false;
+    }
+    return true;
+}
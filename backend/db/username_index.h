@@ -0,0 +1,80 @@
+#ifndef USERNAME_INDEX_H
+#define USERNAME_INDEX_H
+
+#include <QCache>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+
+#include "metrics/memory_accounting.h"
+#include "metrics/profiled_mutex.h"
+
+// 用户名的内存索引：布隆过滤器判定"一定不存在"，小容量正向缓存覆盖"已确认存在"，
+// 两者都未命中时才回落到 SQLite。用户名只增不删，过滤器随注册增量更新，
+// 元素数超过容量时由 DBManager 全量重建
+class UsernameIndex {
+public:
+    enum Lookup {
+        DefinitelyAbsent,   // 过滤器未命中，无需查库
+        KnownPresent,       // 正向缓存命中
+        Unknown             // 需要查库确认
+    };
+
+    struct Stats {
+        int count = 0;              // 已加入的用户名数
+        int capacity = 0;           // 按此容量与误判率确定位数
+        qint64 bits = 0;
+        int hashes = 0;
+        double targetFpRate = 0.0;
+        double estimatedFpRate = 0.0;   // 按当前元素数估算的误判率
+        quint64 definiteMisses = 0;
+        quint64 cacheHits = 0;
+        quint64 dbLookups = 0;
+    };
+
+    static UsernameIndex* getInstance();
+
+    // 用全部用户名重建过滤器，容量取 max(现有数量 * 2, 配置容量)
+    void rebuild(const QStringList& usernames);
+
+    Lookup lookup(const QString& username);
+    // 注册成功或查库确认存在后调用
+    void add(const QString& username);
+    void rememberPresent(const QString& username);
+
+    bool needsRebuild() const;
+    Stats stats() const;
+
+private:
+    UsernameIndex();
+    UsernameIndex(const UsernameIndex&) = delete;
+    UsernameIndex& operator=(const UsernameIndex&) = delete;
+
+    void setBit(quint64 hash1, quint64 hash2);
+    bool testBits(quint64 hash1, quint64 hash2) const;
+
+    mutable ProfiledReadWriteLock m_lock{"username_bloom"};
+    QVector<quint64> m_words;
+    qint64 m_bitCount = 0;
+    int m_hashCount = 0;
+    int m_capacity = 0;
+    int m_count = 0;
+    bool m_loaded = false;
+    double m_fpRate;
+    int m_minCapacity;
+    MemoryCharge m_bloomMemory{MemoryTag::Caches};
+
+    // QCache 非线程安全，单独加锁
+    mutable ProfiledMutex m_cacheMutex{"username_cache"};
+    QCache<QString, bool> m_present;
+    MemoryCharge m_cacheMemory{MemoryTag::Caches};
+
+    std::atomic<quint64> m_definiteMisses{0};
+    std::atomic<quint64> m_cacheHits{0};
+    std::atomic<quint64> m_dbLookups{0};
+
+    static UsernameIndex* m_instance;
+};
+
+#endif // USERNAME_INDEX_H
@@ -0,0 +1,32 @@
+#ifndef WRITE_FORWARDER_H
+#define WRITE_FORWARDER_H
+
+#include <QByteArray>
+
+// 多进程模式下的写操作编号：工作进程的 DBManager 把写接口的参数按 QDataStream 编码，
+// 连同编号交给转发器，由唯一的写进程执行 DBManager::executeForwardedWrite 后返回编码的结果
+enum class WriteOp : quint8 {
+    BookTicket = 1,
+    BookTicketWithSeat,
+    CancelTicket,
+    ChangeTicket,
+    UpdateUserInfo,
+    ChangePassword,
+    RegisterUser,
+    AddFlight,
+    ImportFlights,
+    SaveSession,
+    TouchSession,
+    RemoveSession,
+    UpgradePassword,
+};
+
+class WriteForwarder {
+public:
+    virtual ~WriteForwarder() = default;
+
+    // 同步调用，可在任意线程使用；写进程不可达或应答丢失时返回 false，此时写操作是否已执行不确定
+    virtual bool call(WriteOp op, const QByteArray& args, QByteArray* result) = 0;
+};
+
+#endif // WRITE_FORWARDER_H
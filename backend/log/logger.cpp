@@ -0,0 +1,325 @@
+#include "logger.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcessEnvironment>
+#include <chrono>
+
+Logger* Logger::m_instance = nullptr;
+
+struct Logger::Slot {
+    std::atomic<quint64> sequence;
+    Record record;
+};
+
+namespace {
+const char kLevelChars[] = {'D', 'I', 'W', 'E'};
+
+QMutex& categoryMutex() {
+    static QMutex mutex;
+    return mutex;
+}
+
+QList<LogCategory*>& categories() {
+    static QList<LogCategory*> list;
+    return list;
+}
+
+quint32 currentThreadNumber() {
+    static std::atomic<quint32> next{1};
+    thread_local const quint32 number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+qint64 steadySeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 解析 "name:value,name:value"
+QHash<QString, int> parsePerCategory(const QString& text) {
+    QHash<QString, int> values;
+    for (const QString& item : text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList pair = item.split(':');
+        bool ok = false;
+        const int value = pair.value(1).trimmed().toInt(&ok);
+        if (pair.size() == 2 && ok) values.insert(pair.value(0).trimmed(), value);
+    }
+    return values;
+}
+}
+
+LogCategory::LogCategory(const char* name) : m_name(name) {
+    QMutexLocker locker(&categoryMutex());
+    categories().append(this);
+}
+
+void LogCategory::configure(int limitPerSec, int sampleEvery) {
+    m_limitPerSec.store(qMax(0, limitPerSec), std::memory_order_relaxed);
+    m_sampleEvery.store(qMax(0, sampleEvery), std::memory_order_relaxed);
+}
+
+// 抽样掉的记录属于预期行为，不计入丢弃数；超出每秒上限的才计入
+bool LogCategory::admit() {
+    const int sample = m_sampleEvery.load(std::memory_order_relaxed);
+    if (sample > 1 && m_sampleCounter.fetch_add(1, std::memory_order_relaxed) % quint64(sample) != 0) {
+        return false;
+    }
+    const int limit = m_limitPerSec.load(std::memory_order_relaxed);
+    if (limit <= 0) return true;
+
+    const qint64 now = steadySeconds();
+    qint64 window = m_windowSec.load(std::memory_order_relaxed);
+    if (window != now && m_windowSec.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        m_windowCount.store(0, std::memory_order_relaxed);
+    }
+    if (m_windowCount.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+Logger* Logger::getInstance() {
+    if (!m_instance) {
+        m_instance = new Logger();
+    }
+    return m_instance;
+}
+
+Logger::Logger() = default;
+
+void Logger::start() {
+    if (m_running.load()) return;
+    const auto env = QProcessEnvironment::systemEnvironment();
+
+    const QString level = env.value("FTMS_LOG_LEVEL").trimmed().toLower();
+    if (level == "debug") m_level = Debug;
+    else if (level == "warning" || level == "warn") m_level = Warning;
+    else if (level == "error") m_level = Error;
+    else m_level = Info;
+
+    bool ok = false;
+    int capacity = env.value("FTMS_LOG_BUFFER").trimmed().toInt(&ok);
+    if (!ok || capacity < 256) capacity = 16384;
+    quint64 size = 1;
+    while (size < quint64(capacity)) size <<= 1;
+    m_slots = new Slot[size];
+    for (quint64 i = 0; i < size; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_mask = size - 1;
+
+    const QHash<QString, int> limits = parsePerCategory(env.value("FTMS_LOG_LIMITS"));
+    const QHash<QString, int> samples = parsePerCategory(env.value("FTMS_LOG_SAMPLE"));
+    {
+        QMutexLocker locker(&categoryMutex());
+        for (LogCategory* category : categories()) {
+            const QString name = QString::fromLatin1(category->name());
+            category->configure(limits.value(name), samples.value(name));
+        }
+    }
+
+    m_out = stderr;
+    const QString path = env.value("FTMS_LOG_FILE").trimmed();
+    if (!path.isEmpty()) {
+        FILE* file = std::fopen(path.toLocal8Bit().constData(), "a");
+        if (file) {
+            m_out = file;
+        } else {
+            qWarning() << "无法打开日志文件" << path << "，改为输出到 stderr";
+        }
+    }
+
+    m_stopping = false;
+    m_running = true;
+    m_thread = std::thread([this]() { run(); });
+}
+
+void Logger::stop() {
+    if (!m_running.load()) return;
+    m_stopping = true;
+    m_thread.join();
+    m_running = false;
+    if (m_out && m_out != stderr) std::fclose(m_out);
+    m_out = nullptr;
+}
+
+void Logger::appendRaw(Record& record, ArgTag tag, const void* data, int size) {
+    if (record.size + 1 + size > kArgBytes) return;
+    record.args[record.size++] = tag;
+    std::memcpy(record.args + record.size, data, size_t(size));
+    record.size += quint16(size);
+}
+
+void Logger::appendString(Record& record, const char* data, int size) {
+    const int room = kArgBytes - record.size - 3;
+    if (room < 0) return;
+    // 截断时退回到 UTF-8 字符边界
+    int length = qMin(size, room);
+    if (length < size) {
+        while (length > 0 && (uchar(data[length]) & 0xC0) == 0x80) --length;
+    }
+    const quint16 length16 = quint16(length);
+    record.args[record.size++] = TagString;
+    std::memcpy(record.args + record.size, &length16, sizeof(length16));
+    record.size += sizeof(length16);
+    std::memcpy(record.args + record.size, data, size_t(length));
+    record.size += quint16(length);
+}
+
+void Logger::submit(Record& record) {
+    record.timeMs = QDateTime::currentMSecsSinceEpoch();
+    record.threadId = currentThreadNumber();
+    if (!m_running.load(std::memory_order_acquire)) {
+        qDebug().noquote() << QString::fromUtf8(format(record));
+        return;
+    }
+    if (!push(record)) {
+        m_overflow.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// 有界多生产者队列：每个槽位的序号表明它当前可写（== pos）还是可读（== pos + 1）
+bool Logger::push(const Record& record) {
+    quint64 pos = m_tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = m_slots[pos & m_mask];
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        const qint64 diff = qint64(sequence) - qint64(pos);
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+    Slot& slot = m_slots[pos & m_mask];
+    std::memcpy(&slot.record, &record, offsetof(Record, args) + record.size);
+    slot.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool Logger::pop(Record& record) {
+    Slot& slot = m_slots[m_head & m_mask];
+    if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) return false;
+    std::memcpy(&record, &slot.record, offsetof(Record, args) + slot.record.size);
+    slot.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+    ++m_head;
+    return true;
+}
+
+void Logger::run() {
+    qint64 lastReport = steadySeconds();
+    for (;;) {
+        const bool stopping = m_stopping.load(std::memory_order_acquire);
+        writeRecords();
+
+        const qint64 now = steadySeconds();
+        if (now != lastReport || stopping) {
+            lastReport = now;
+            QByteArray notes;
+            const quint64 overflow = m_overflow.exchange(0, std::memory_order_relaxed);
+            if (overflow) notes += "日志缓冲区已满，丢弃 " + QByteArray::number(overflow) + " 条\n";
+            QMutexLocker locker(&categoryMutex());
+            for (LogCategory* category : categories()) {
+                const quint64 dropped = category->takeDropped();
+                if (dropped) {
+                    notes += QByteArray("日志类别 ") + category->name() + " 超出限流，丢弃 "
+                             + QByteArray::number(dropped) + " 条\n";
+                }
+            }
+            if (!notes.isEmpty()) {
+                std::fwrite(notes.constData(), 1, size_t(notes.size()), m_out);
+                std::fflush(m_out);
+            }
+        }
+        if (stopping) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+// 一次取空队列，拼成一块再写出
+void Logger::writeRecords() {
+    QByteArray text;
+    Record record;
+    while (pop(record)) {
+        text += format(record);
+        text += '\n';
+        if (text.size() >= 64 * 1024) {
+            std::fwrite(text.constData(), 1, size_t(text.size()), m_out);
+            text.clear();
+        }
+    }
+    if (!text.isEmpty()) {
+        std::fwrite(text.constData(), 1, size_t(text.size()), m_out);
+        std::fflush(m_out);
+    }
+}
+
+QByteArray Logger::format(const Record& record) {
+    // 同一秒内的记录复用日期时间前缀
+    thread_local qint64 cachedSecond = -1;
+    thread_local QByteArray cachedPrefix;
+    const qint64 second = record.timeMs / 1000;
+    if (second != cachedSecond) {
+        cachedSecond = second;
+        cachedPrefix = QDateTime::fromMSecsSinceEpoch(second * 1000).toString("yyyy-MM-dd hh:mm:ss").toUtf8();
+    }
+
+    QByteArray line;
+    line.reserve(160);
+    line += cachedPrefix;
+    line += '.';
+    line += QByteArray::number(record.timeMs % 1000).rightJustified(3, '0');
+    line += ' ';
+    line += kLevelChars[qMin<int>(record.level, Error)];
+    line += " [";
+    line += record.category->name();
+    line += "] #";
+    line += QByteArray::number(record.threadId);
+    line += ' ';
+
+    int offset = 0;
+    auto nextArg = [&](QByteArray& out) -> bool {
+        if (offset >= record.size) return false;
+        const char tag = record.args[offset++];
+        auto read = [&](void* value, int size) {
+            std::memcpy(value, record.args + offset, size_t(size));
+            offset += size;
+        };
+        switch (tag) {
+        case TagInt: { qint64 v; read(&v, sizeof(v)); out += QByteArray::number(v); break; }
+        case TagUInt: { quint64 v; read(&v, sizeof(v)); out += QByteArray::number(v); break; }
+        case TagDouble: { double v; read(&v, sizeof(v)); out += QByteArray::number(v, 'g', 6); break; }
+        case TagBool: { quint8 v; read(&v, 1); out += v ? "true" : "false"; break; }
+        case TagDate: {
+            qint64 v; read(&v, sizeof(v));
+            out += v ? QDate::fromJulianDay(v).toString(Qt::ISODate).toUtf8() : QByteArray("无效日期");
+            break;
+        }
+        case TagString: {
+            quint16 length; read(&length, sizeof(length));
+            out.append(record.args + offset, length);
+            offset += length;
+            break;
+        }
+        default:
+            offset = record.size;
+            return false;
+        }
+        return true;
+    };
+
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (!nextArg(line)) line += "{}";
+            ++p;
+        } else {
+            line += *p;
+        }
+    }
+    return line;
+}
@@ -0,0 +1,163 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QString>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// 请求路径上的异步日志：调用线程只把格式串指针与参数的二进制形式写入无锁多生产者环形缓冲区，
+// 不格式化、不做系统调用；后台线程批量取出，转换为文本后写入 stderr 或 FTMS_LOG_FILE。
+// 缓冲区满时丢弃并计数，绝不阻塞请求线程。
+//
+// 格式串以 {} 作为占位符，需为字符串字面量（只保存指针）。参数支持整数、浮点、bool、
+// const char*、QString、QByteArray 与 QDate，字符串过长时截断。
+//
+// 日志级别 FTMS_LOG_LEVEL（debug/info/warning/error，默认 info）；按类别限流 FTMS_LOG_LIMITS
+// （如 book:200,query:100，每秒条数）与抽样 FTMS_LOG_SAMPLE（如 query:10，每 10 条记 1 条）。
+// 未调用 start() 的进程（离线工具）退化为同步输出到 qDebug
+
+// 日志类别：在使用它的源文件中定义为静态对象，构造时登记，start() 时按名称套用限流与抽样配置；
+// 不同源文件中的同名类别各自计数
+class LogCategory {
+public:
+    explicit LogCategory(const char* name);
+
+    const char* name() const { return m_name; }
+    // 限流与抽样判定，可被多个线程同时调用；未配置时不访问任何共享变量
+    bool admit();
+    void configure(int limitPerSec, int sampleEvery);
+    quint64 takeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+
+private:
+    const char* m_name;
+    std::atomic<int> m_limitPerSec{0};
+    std::atomic<int> m_sampleEvery{0};
+    std::atomic<qint64> m_windowSec{0};
+    std::atomic<int> m_windowCount{0};
+    std::atomic<quint64> m_sampleCounter{0};
+    std::atomic<quint64> m_dropped{0};
+};
+
+class Logger {
+public:
+    enum Level : quint8 { Debug = 0, Info, Warning, Error };
+
+    static constexpr int kArgBytes = 224;
+
+    // 一条日志记录的二进制形式，参数按 (类型标记, 数据) 依次排列
+    struct Record {
+        qint64 timeMs;
+        const char* format;
+        LogCategory* category;
+        quint32 threadId;
+        quint8 level;
+        quint16 size;
+        char args[kArgBytes];
+    };
+
+    static Logger* getInstance();
+
+    // 读取环境变量配置并启动后台输出线程
+    void start();
+    // 输出缓冲区中剩余的记录后停止
+    void stop();
+
+    // 把一条记录格式化为一行文本（不含换行），后台线程与同步退化路径共用
+    static QByteArray format(const Record& record);
+
+    bool enabled(Level level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    template <typename... Args>
+    void log(Level level, LogCategory& category, const char* format, const Args&... args) {
+        if (!enabled(level) || !category.admit()) return;
+        Record record;
+        record.level = level;
+        record.format = format;
+        record.category = &category;
+        record.size = 0;
+        (appendArg(record, args), ...);
+        submit(record);
+    }
+
+private:
+    Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    enum ArgTag : char { TagInt = 'i', TagUInt = 'u', TagDouble = 'd', TagBool = 'b', TagString = 's', TagDate = 'D' };
+
+    static void appendRaw(Record& record, ArgTag tag, const void* data, int size);
+    static void appendString(Record& record, const char* data, int size);
+
+    template <typename T>
+    static void appendArg(Record& record, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            const quint8 v = value ? 1 : 0;
+            appendRaw(record, TagBool, &v, 1);
+        } else if constexpr (std::is_enum_v<T> || (std::is_integral_v<T> && std::is_signed_v<T>)) {
+            const qint64 v = qint64(value);
+            appendRaw(record, TagInt, &v, sizeof(v));
+        } else if constexpr (std::is_integral_v<T>) {
+            const quint64 v = quint64(value);
+            appendRaw(record, TagUInt, &v, sizeof(v));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            const double v = double(value);
+            appendRaw(record, TagDouble, &v, sizeof(v));
+        } else if constexpr (std::is_same_v<T, QString>) {
+            const QByteArray utf8 = value.toUtf8();
+            appendString(record, utf8.constData(), int(utf8.size()));
+        } else if constexpr (std::is_same_v<T, QByteArray>) {
+            appendString(record, value.constData(), int(value.size()));
+        } else if constexpr (std::is_same_v<T, QDate>) {
+            const qint64 v = value.isValid() ? value.toJulianDay() : 0;
+            appendRaw(record, TagDate, &v, sizeof(v));
+        } else {
+            // 字符串字面量与 const char*
+            const char* text = value;
+            appendString(record, text, text ? int(std::strlen(text)) : 0);
+        }
+    }
+
+    void submit(Record& record);
+    bool push(const Record& record);
+    bool pop(Record& record);
+    void run();
+    void writeRecords();
+
+    struct Slot;
+
+    std::atomic<int> m_level{Info};
+    Slot* m_slots = nullptr;
+    quint64 m_mask = 0;
+    alignas(64) std::atomic<quint64> m_tail{0};     // 生产者争用
+    alignas(64) quint64 m_head = 0;                 // 仅后台线程使用
+    std::atomic<quint64> m_overflow{0};
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopping{false};
+    std::thread m_thread;
+    FILE* m_out = nullptr;
+
+    static Logger* m_instance;
+};
+
+template <typename... Args>
+inline void logDebug(LogCategory& category, const char* format, const Args&... args) {
+    Logger::getInstance()->log(Logger::Debug, category, format, args...);
+}
+
+template <typename... Args>
+inline void logInfo(LogCategory& category, const char* format, const Args&... args) {
+    Logger::getInstance()->log(Logger::Info, category, format, args...);
+}
+
+template <typename... Args>
+inline void logWarning(LogCategory& category, const char* format, const Args&... args) {
+    Logger::getInstance()->log(Logger::Warning, category, format, args...);
+}
+
+#endif // LOGGER_H
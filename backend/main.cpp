@@ -1,22 +1,383 @@
+#include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QProcessEnvironment>
+#include <QTimer>
 #include "network/tcp_server.h"
+#include "network/traffic_capture.h"
 #include "db/db_manager.h"
+#include "db/schema_migrator.h"
+#include "db/seat_inventory.h"
+#include "db/flight_importer.h"
+#include "auth/session_manager.h"
+#include "auth/auth_worker_pool.h"
+#include "log/logger.h"
+#include "metrics/memory_accounting.h"
+#include "metrics/metrics_server.h"
+#include "metrics/tracer.h"
+#ifdef FTMS_EPOLL_BACKEND
+#include "network/epoll_server.h"
+#endif
+#ifdef FTMS_MULTIPROCESS
+#include "cluster/supervisor.h"
+#include "cluster/unix_signals.h"
+#include "cluster/write_client.h"
+#include "cluster/writer_protocol.h"
+#include "cluster/writer_service.h"
+#include "metrics/metrics.h"
+#include <QDateTime>
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#endif
+
+// 读取整数环境变量，缺省或非法时返回 fallback
+static int envInt(const char* name, int fallback) {
+    bool ok = false;
+    const int value = QProcessEnvironment::systemEnvironment().value(name).trimmed().toInt(&ok);
+    return ok ? value : fallback;
+}
+
+// 离线导入航班文件后退出，不启动网络服务
+static int runImport(const QCommandLineParser& parser) {
+    const QString path = parser.value("import");
+    if (!DBManager::getInstance()->init("ftms.db", false)) {
+        qCritical() << "数据库初始化失败，程序退出！";
+        return -1;
+    }
+
+    FlightFileReader reader;
+    if (!reader.open(path)) {
+        qCritical() << "导入失败：" << reader.errorString();
+        return -1;
+    }
+
+    ImportOptions options;
+    options.dropIndexes = parser.isSet("drop-indexes");
+    if (parser.isSet("batch-rows")) options.rowsPerStatement = parser.value("batch-rows").toInt();
+    if (parser.isSet("txn-rows")) options.rowsPerTransaction = parser.value("txn-rows").toInt();
+    qDebug() << "开始导入" << path << "，每条语句" << options.rowsPerStatement
+             << "行，每个事务" << options.rowsPerTransaction << "行"
+             << (options.dropIndexes ? "，导入期间删除索引" : "");
+
+    ImportStats stats;
+    if (!DBManager::getInstance()->importFlights(reader, options, &stats)) {
+        qCritical() << "导入失败，已提交的事务保留";
+        return -1;
+    }
+    const double rate = stats.elapsedMs > 0 ? stats.rows * 1000.0 / stats.elapsedMs : 0.0;
+    qDebug() << "✅ 导入完成：写入" << stats.inserted << "条，已存在跳过" << stats.skipped
+             << "条，无效" << stats.invalid << "条；耗时" << stats.elapsedMs << "ms（"
+             << QString::number(rate, 'f', 0) << "条/秒），重建索引" << stats.indexMs << "ms";
+    return 0;
+}
+
+// 指标端点：FTMS_METRICS_PORT 非 0 时在 FTMS_METRICS_HOST（默认仅本机）上提供 GET /metrics 与 /debug/* 调试端点
+static void startMetricsServer(MetricsServer& metricsServer) {
+    const int metricsPort = envInt("FTMS_METRICS_PORT", 0);
+    if (metricsPort <= 0) return;
+    const QString metricsHost = QProcessEnvironment::systemEnvironment().value("FTMS_METRICS_HOST", "127.0.0.1");
+    if (metricsServer.listen(QHostAddress(metricsHost), quint16(metricsPort))) {
+        qDebug() << "指标端点：http://" + metricsHost + ":" + QString::number(metricsPort) + "/metrics";
+    } else {
+        qWarning() << "指标端点启动失败：" << metricsServer.errorString();
+    }
+}
+
+// 订单变更日志保留 FTMS_ORDER_LOG_KEEP 秒（默认 30 天），更旧的客户端版本改走全量分页
+static void startOrderLogPrune(QTimer& orderLogPrune) {
+    const int orderLogKeep = envInt("FTMS_ORDER_LOG_KEEP", 30 * 24 * 3600);
+    QObject::connect(&orderLogPrune, &QTimer::timeout, [orderLogKeep]() {
+        const int pruned = DBManager::getInstance()->pruneOrderChanges(orderLogKeep);
+        if (pruned > 0) {
+            qDebug() << "清理订单变更日志：" << pruned;
+        }
+    });
+    orderLogPrune.start(3600 * 1000);
+}
+
+#ifdef FTMS_MULTIPROCESS
+// 子进程初始化完成，通知监督进程（标准输出只用于这一行）
+static void notifyReady() {
+    std::fputs("READY\n", stdout);
+    std::fflush(stdout);
+}
+
+// 监督进程：不打开数据库，只负责启动、重启与关停子进程
+static int runSupervisor(QCoreApplication& a, int workers) {
+    Logger::getInstance()->start();
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        Logger::getInstance()->stop();
+    });
+
+    Supervisor supervisor(workers);
+    UnixSignals* unixSignals = UnixSignals::getInstance();
+    QObject::connect(unixSignals, &UnixSignals::received, &supervisor, [&supervisor](int signalNumber) {
+        if (signalNumber == SIGHUP) {
+            supervisor.reload();
+        } else {
+            supervisor.shutdown();
+        }
+    });
+    unixSignals->watch(SIGTERM);
+    unixSignals->watch(SIGINT);
+    unixSignals->watch(SIGHUP);
+    supervisor.start();
+    return a.exec();
+}
+
+// 写进程：唯一执行结构迁移和写事务的进程，不监听客户端端口
+static int runWriter(QCoreApplication& a) {
+    Logger::getInstance()->start();
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        Logger::getInstance()->stop();
+    });
+
+    // 后台迁移完成时通知工作进程；监听开始之前完成的版本由工作进程启动或重新订阅时从库中读取
+    WriterService service;
+    SchemaMigrator::getInstance()->setAdvancedListener([&service](int version) {
+        service.schemaChanged(version);
+    });
+    // 新增航班后合并重建的航班目录快照就绪时，通知工作进程重新映射
+    DBManager::getInstance()->setCatalogListener([&service]() {
+        service.catalogChanged();
+    });
+    if (!DBManager::getInstance()->init("ftms.db")) {
+        qCritical() << "数据库初始化失败，程序退出！";
+        return -1;
+    }
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        SchemaMigrator::getInstance()->stop();
+    });
+    // 工作进程只映射快照，在写进程就绪之前生成好
+    DBManager::getInstance()->refreshFlightCatalog();
+    // 座位库存在接受写请求之前恢复；滚动重启时在这里等旧写进程释放
+    if (DBManager::getInstance()->recoverSeatInventory()) {
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+            SeatInventory::getInstance()->stop();
+        });
+    }
+    QTimer orderLogPrune;
+    startOrderLogPrune(orderLogPrune);
+    // 工作进程共享的会话表按 FTMS_SESSION_TTL 清理，各工作进程在使用中的会话会定期续期
+    const int sessionTtl = qMax(60, envInt("FTMS_SESSION_TTL", 24 * 3600));
+    QTimer sessionPrune;
+    QObject::connect(&sessionPrune, &QTimer::timeout, [sessionTtl]() {
+        const int pruned = DBManager::getInstance()->pruneSessions(sessionTtl);
+        if (pruned > 0) {
+            qDebug() << "清理共享会话表中的过期会话：" << pruned;
+        }
+    });
+    sessionPrune.start(60 * 1000);
+    MetricsServer metricsServer;
+    startMetricsServer(metricsServer);
+    MemoryAccounting::getInstance();
+
+    QString error;
+    if (!service.listen(WriterProtocol::socketPath(), &error)) {
+        qCritical() << "写进程启动失败：" << error;
+        return -1;
+    }
+    qDebug() << "写进程正在监听" << WriterProtocol::socketPath();
+
+    // 先停止接受新连接，再等各连接上已收到的写请求执行完
+    UnixSignals* unixSignals = UnixSignals::getInstance();
+    QObject::connect(unixSignals, &UnixSignals::received, &a, [&service, &metricsServer]() {
+        metricsServer.close();
+        service.close();
+        QCoreApplication::quit();
+    });
+    unixSignals->watch(SIGTERM);
+    notifyReady();
+    return a.exec();
+}
+
+// 工作进程收到 SIGTERM：停止监听，等现有连接断开或超过 FTMS_DRAIN_SECS（默认 30 秒）后退出
+static void drainOnSignal(QCoreApplication& a, MetricsServer& metricsServer, std::function<void()> stopAccepting) {
+    UnixSignals* unixSignals = UnixSignals::getInstance();
+    QObject::connect(unixSignals, &UnixSignals::received, &a, [&a, &metricsServer, stopAccepting]() {
+        static bool draining = false;
+        if (draining) return;
+        draining = true;
+        metricsServer.close();
+        stopAccepting();
+        const qint64 deadline = QDateTime::currentMSecsSinceEpoch() + qint64(envInt("FTMS_DRAIN_SECS", 30)) * 1000;
+        qDebug() << "停止接受新连接，等待" << Metrics::getInstance()->activeConnections() << "个连接结束";
+        auto* drainTimer = new QTimer(&a);
+        QObject::connect(drainTimer, &QTimer::timeout, [deadline]() {
+            const int remaining = Metrics::getInstance()->activeConnections();
+            if (remaining == 0 || QDateTime::currentMSecsSinceEpoch() >= deadline) {
+                if (remaining > 0) qWarning() << "排空超时，仍有" << remaining << "个连接";
+                QCoreApplication::quit();
+            }
+        });
+        drainTimer->start(200);
+    });
+    unixSignals->watch(SIGTERM);
+}
+#endif
 
 int main(int argc, char *argv[]) {
     QCoreApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FTMS 后端服务器");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"import", "导入航班文件（CSV / JSON Lines / JSON 数组 / 二进制）后退出", "file"},
+        {"drop-indexes", "导入前删除 flight 的二级索引，完成后重建"},
+        {"batch-rows", "每条 INSERT 语句的行数（默认 200）", "rows"},
+        {"txn-rows", "每个事务的行数（默认 100000）", "rows"},
+    });
+#ifdef FTMS_MULTIPROCESS
+    parser.addOptions({
+        {"workers", "多进程模式：启动 1 个写进程和 N 个共享端口的工作进程（也可用 FTMS_WORKERS）", "count"},
+        {"role", "多进程模式下子进程的角色（writer / worker），由监督进程传入", "role"},
+    });
+#endif
+    parser.process(a);
+    if (parser.isSet("import")) {
+        return runImport(parser);
+    }
+
+#ifdef FTMS_MULTIPROCESS
+    const QString role = parser.value("role");
+    if (role.isEmpty()) {
+        const int workers = parser.isSet("workers") ? parser.value("workers").toInt() : envInt("FTMS_WORKERS", 0);
+        if (workers > 0) return runSupervisor(a, workers);
+    } else {
+        // 终端 Ctrl+C 会发给整个进程组，子进程只听监督进程的 SIGTERM，按先工作进程后写进程的顺序退出
+        std::signal(SIGINT, SIG_IGN);
+    }
+    if (role == "writer") {
+        return runWriter(a);
+    } else if (!role.isEmpty() && role != "worker") {
+        qCritical() << "未知的进程角色：" << role;
+        return -1;
+    }
+    const bool isWorker = role == "worker";
+#else
+    const bool isWorker = false;
+#endif
+
     qDebug() << "\n=== 启动后端服务器 ===";
 
-    // 初始化 SQLite 数据库
-    bool dbConnected = DBManager::getInstance()->init("ftms.db");
+    // 请求路径日志改走异步日志线程，退出前输出剩余记录
+    Logger::getInstance()->start();
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        Logger::getInstance()->stop();
+    });
+
+    // 初始化 SQLite 数据库；工作进程不建表、不做结构迁移，由写进程负责
+    bool dbConnected = isWorker ? DBManager::getInstance()->attach("ftms.db") : DBManager::getInstance()->init("ftms.db");
     if (!dbConnected) {
         qCritical() << "数据库初始化失败，程序退出！";
         return -1;
     }
+    // 退出前等待后台结构迁移的当前批次结束
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        SchemaMigrator::getInstance()->stop();
+    });
+#ifdef FTMS_MULTIPROCESS
+    // 工作进程的写操作全部转交写进程，并订阅其变更通知
+    WriteClient writeClient(WriterProtocol::socketPath());
+    if (isWorker) {
+        DBManager::getInstance()->setWriteForwarder(&writeClient);
+        SessionManager::getInstance()->setShared(true);
+        writeClient.startEvents();
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, [&writeClient]() {
+            writeClient.stop();
+        });
+    }
+#endif
+
+    // 会话表：空闲超过 FTMS_SESSION_TTL 秒的会话每分钟批量清理一次
+    SessionManager::getInstance()->setTtl(envInt("FTMS_SESSION_TTL", 24 * 3600));
+    QTimer sessionSweep;
+    QObject::connect(&sessionSweep, &QTimer::timeout, []() {
+        const int expired = SessionManager::getInstance()->expireSessions();
+        if (expired > 0) {
+            qDebug() << "清理过期会话：" << expired;
+        }
+    });
+    sessionSweep.start(60 * 1000);
+
+    // 航班目录快照过期时重新生成，余座表按库校正
+    if (!isWorker) DBManager::getInstance()->refreshFlightCatalog();
+    // 座位库存：快照加日志尾部恢复，退出时写最后一次快照
+    if (!isWorker && DBManager::getInstance()->recoverSeatInventory()) {
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+            SeatInventory::getInstance()->stop();
+        });
+    }
+    QTimer orderLogPrune;
+    if (!isWorker) startOrderLogPrune(orderLogPrune);
+
+    // 口令哈希线程池：线程数与排队上限，超出上限的登录直接返回 ServerBusy
+    AuthWorkerPool::getInstance()->configure(envInt("FTMS_AUTH_THREADS", 0), envInt("FTMS_AUTH_QUEUE", 0));
+    qDebug() << "认证线程池：" << AuthWorkerPool::getInstance()->threadCount()
+             << "线程，排队上限" << AuthWorkerPool::getInstance()->queueLimit();
+
+    MetricsServer metricsServer;
+    startMetricsServer(metricsServer);
+    // 在连接线程启动前注册内存记账的指标
+    qDebug() << "内存分配器：" << MemoryAccounting::allocatorName();
+    MemoryAccounting::getInstance();
+    if (Tracer::getInstance()->sampleEvery() > 0) {
+        qDebug() << "请求追踪：每" << Tracer::getInstance()->sampleEvery() << "个请求抽样一个";
+    }
+    // 流量抓取：FTMS_CAPTURE_FILE 非空时记录请求帧与应答状态，供 ftms_replay 重放
+    if (TrafficCapture::getInstance()->start()) {
+        qDebug() << "流量抓取：" << QProcessEnvironment::systemEnvironment().value("FTMS_CAPTURE_FILE");
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+            TrafficCapture::getInstance()->stop();
+        });
+    }
+
+    const int idleTimeout = envInt("FTMS_IDLE_TIMEOUT", kDefaultIdleTimeoutSecs);
+    const QString netBackend = QProcessEnvironment::systemEnvironment().value("FTMS_NET_BACKEND").trimmed().toLower();
+
+#ifdef FTMS_EPOLL_BACKEND
+    // 可选的 Linux 原生网络后端：FTMS_NET_BACKEND=epoll
+    if (netBackend == "epoll") {
+        EpollServer epollServer;
+        epollServer.setThreadCount(envInt("FTMS_NET_THREADS", QThread::idealThreadCount()));
+        epollServer.setIdleTimeout(idleTimeout);
+        if (!epollServer.listen(12345)) {
+            qCritical() << "服务器启动失败：" << epollServer.errorString();
+            return -1;
+        }
+        qDebug() << "服务器正在监听端口 12345（epoll 后端）...";
+#ifdef FTMS_MULTIPROCESS
+        if (isWorker) {
+            drainOnSignal(a, metricsServer, [&epollServer]() { epollServer.stopAccepting(); });
+            notifyReady();
+        }
+#endif
+        return a.exec();
+    }
+#else
+    if (netBackend == "epoll") {
+        qWarning() << "当前构建未包含 epoll 后端，改用 Qt 网络后端";
+    }
+#endif
 
     // 启动TCP服务器
     TcpServer server;
+    server.setIdleTimeout(idleTimeout);
+#ifdef FTMS_MULTIPROCESS
+    if (isWorker) {
+        QString error;
+        if (!server.listenReusePort(12345, &error)) {
+            qCritical() << "服务器启动失败：" << error;
+            return -1;
+        }
+        qDebug() << "服务器正在监听端口 12345（工作进程）...";
+        drainOnSignal(a, metricsServer, [&server]() { server.close(); });
+        notifyReady();
+        return a.exec();
+    }
+#endif
     if (!server.listen(QHostAddress::Any, 12345)) {
         qCritical() << "服务器启动失败：" << server.errorString();
         return -1;
@@ -0,0 +1,161 @@
+#include "memory_accounting.h"
+#include "metrics.h"
+#include <cstdio>
+#if defined(FTMS_ALLOCATOR_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(FTMS_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define FTMS_HAVE_MALLINFO2
+#endif
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+MemoryAccounting* MemoryAccounting::m_instance = nullptr;
+
+namespace {
+const char* const kTagNames[int(MemoryTag::Count)] = {
+    "connections", "receive_buffers", "send_buffers", "db_results", "caches", "ai_gateway",
+};
+
+QByteArray formatBytes(qint64 bytes) {
+    if (bytes < 0) return "-";
+    if (bytes < 10 * 1024) return QByteArray::number(bytes) + " B";
+    if (bytes < 10 * 1024 * 1024) return QByteArray::number(bytes / 1024.0, 'f', 1) + " KiB";
+    return QByteArray::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MiB";
+}
+}
+
+MemoryAccounting* MemoryAccounting::getInstance() {
+    if (!m_instance) {
+        m_instance = new MemoryAccounting();
+    }
+    return m_instance;
+}
+
+// 指标在首次使用时注册；回调只读原子变量或查询分配器，不获取其他锁
+MemoryAccounting::MemoryAccounting() {
+    Metrics* metrics = Metrics::getInstance();
+    for (int i = 0; i < int(MemoryTag::Count); ++i) {
+        const QString labels = QString("subsystem=\"%1\"").arg(kTagNames[i]);
+        Slot* slot = &m_slots[i];
+        metrics->gauge("ftms_memory_bytes", "各子系统登记的内存占用估算", labels,
+                       [slot]() { return double(slot->bytes.load(std::memory_order_relaxed)); });
+        metrics->gauge("ftms_memory_objects", "各子系统登记的对象数（连接、进行中的请求等）", labels,
+                       [slot]() { return double(slot->objects.load(std::memory_order_relaxed)); });
+    }
+    metrics->gauge("ftms_allocator_info", "构建时选定的内存分配器，值恒为 1",
+                   QString("allocator=\"%1\"").arg(allocatorName()), []() { return 1.0; });
+    if (allocatedBytes() >= 0) {
+        metrics->gauge("ftms_allocator_allocated_bytes", "分配器报告的已分配字节数", QString(),
+                       []() { return double(allocatedBytes()); });
+    }
+    if (residentBytes() >= 0) {
+        metrics->gauge("ftms_process_resident_bytes", "进程常驻内存", QString(),
+                       []() { return double(residentBytes()); });
+    }
+}
+
+void MemoryAccounting::charge(MemoryTag tag, qint64 bytes, qint64 objects) {
+    Slot& slot = m_slots[int(tag)];
+    if (bytes) slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (objects) slot.objects.fetch_add(objects, std::memory_order_relaxed);
+}
+
+qint64 MemoryAccounting::bytes(MemoryTag tag) const {
+    return m_slots[int(tag)].bytes.load(std::memory_order_relaxed);
+}
+
+qint64 MemoryAccounting::objects(MemoryTag tag) const {
+    return m_slots[int(tag)].objects.load(std::memory_order_relaxed);
+}
+
+const char* MemoryAccounting::tagName(MemoryTag tag) {
+    return kTagNames[int(tag)];
+}
+
+const char* MemoryAccounting::allocatorName() {
+#if defined(FTMS_ALLOCATOR_JEMALLOC)
+    return "jemalloc";
+#elif defined(FTMS_ALLOCATOR_MIMALLOC)
+    return "mimalloc";
+#else
+    return "system";
+#endif
+}
+
+qint64 MemoryAccounting::allocatedBytes() {
+#if defined(FTMS_ALLOCATOR_JEMALLOC)
+    // jemalloc 的统计按 epoch 缓存，先推进 epoch 才能读到最新值
+    uint64_t epoch = 1;
+    size_t size = sizeof(epoch);
+    mallctl("epoch", &epoch, &size, &epoch, size);
+    size_t allocated = 0;
+    size = sizeof(allocated);
+    if (mallctl("stats.allocated", &allocated, &size, nullptr, 0) != 0) return -1;
+    return qint64(allocated);
+#elif defined(FTMS_ALLOCATOR_MIMALLOC)
+    size_t elapsed, user, system, rss, peakRss, commit, peakCommit, faults;
+    mi_process_info(&elapsed, &user, &system, &rss, &peakRss, &commit, &peakCommit, &faults);
+    return qint64(commit);
+#elif defined(FTMS_HAVE_MALLINFO2)
+    // mallinfo2 会遍历全部 arena，只在抓取时调用
+    const struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryAccounting::residentBytes() {
+#ifdef Q_OS_LINUX
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) return -1;
+    long long pages = 0, resident = 0;
+    const int fields = std::fscanf(file, "%lld %lld", &pages, &resident);
+    std::fclose(file);
+    if (fields != 2) return -1;
+    return qint64(resident) * qint64(sysconf(_SC_PAGESIZE));
+#else
+    return -1;
+#endif
+}
+
+QByteArray MemoryAccounting::report() const {
+    QByteArray out = QByteArray("subsystem").leftJustified(18) + QByteArray("bytes").leftJustified(14) + "objects\n";
+    qint64 total = 0;
+    for (int i = 0; i < int(MemoryTag::Count); ++i) {
+        const qint64 bytes = m_slots[i].bytes.load(std::memory_order_relaxed);
+        total += bytes;
+        out += QByteArray(kTagNames[i]).leftJustified(18) + formatBytes(bytes).leftJustified(14)
+               + QByteArray::number(m_slots[i].objects.load(std::memory_order_relaxed)) + "\n";
+    }
+    out += QByteArray("total").leftJustified(18) + formatBytes(total) + "\n\n";
+
+    // 缓存为全进程共享，不随连接数增长，折算每连接占用时扣除
+    const qint64 connections = objects(MemoryTag::Connections);
+    if (connections > 0) {
+        const qint64 perConnection = (total - bytes(MemoryTag::Caches)) / connections;
+        out += "per_connection    " + formatBytes(perConnection) + "（" + QByteArray::number(connections) + " 个连接，不含缓存）\n";
+    }
+    out += QByteArray("allocator").leftJustified(18) + allocatorName() + "，已分配 " + formatBytes(allocatedBytes()) + "\n";
+    out += QByteArray("resident").leftJustified(18) + formatBytes(residentBytes()) + "\n";
+    return out;
+}
+
+MemoryCharge::MemoryCharge(MemoryTag tag, qint64 bytes, bool countObject)
+    : m_tag(tag), m_bytes(bytes), m_countObject(countObject) {
+    MemoryAccounting::getInstance()->charge(m_tag, m_bytes, m_countObject ? 1 : 0);
+}
+
+MemoryCharge::~MemoryCharge() {
+    MemoryAccounting::getInstance()->charge(m_tag, -m_bytes, m_countObject ? -1 : 0);
+}
+
+void MemoryCharge::resize(qint64 bytes) {
+    if (bytes == m_bytes) return;
+    MemoryAccounting::getInstance()->charge(m_tag, bytes - m_bytes);
+    m_bytes = bytes;
+}
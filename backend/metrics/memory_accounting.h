@@ -0,0 +1,86 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+// 按子系统记账的内存占用：各模块在分配或释放大块内存时登记字节数与对象数，
+// 经 /metrics 导出为 ftms_memory_bytes{subsystem} / ftms_memory_objects{subsystem}，
+// /debug/memory 另给出按当前连接数折算的每连接占用，用于按并发用户数估算容量。
+// 登记的是估算值（容器容量与已知的固定开销），不含分配器自身的元数据与碎片，
+// 与 ftms_allocator_allocated_bytes、ftms_process_resident_bytes 对照可看出未记账的部分
+enum class MemoryTag {
+    Connections,        // 连接对象、每连接的压缩上下文
+    ReceiveBuffers,     // 拆帧缓冲、读缓冲
+    SendBuffers,        // 应答发送缓冲
+    DbResults,          // 从查询结果物化、正在编码的列表
+    Caches,             // 城市字典、用户名过滤器与正向缓存、座位库存
+    AiGateway,          // 进行中的 AI 请求
+    Count
+};
+
+class MemoryAccounting {
+public:
+    static MemoryAccounting* getInstance();
+
+    void charge(MemoryTag tag, qint64 bytes, qint64 objects = 0);
+
+    qint64 bytes(MemoryTag tag) const;
+    qint64 objects(MemoryTag tag) const;
+
+    static const char* tagName(MemoryTag tag);
+
+    // 构建时选定的分配器：system / jemalloc / mimalloc
+    static const char* allocatorName();
+    // 分配器报告的已分配字节数，无法获取时返回 -1
+    static qint64 allocatedBytes();
+    // 进程常驻内存（/proc/self/statm），非 Linux 返回 -1
+    static qint64 residentBytes();
+
+    // 各子系统的占用表（文本）
+    QByteArray report() const;
+
+private:
+    MemoryAccounting();
+    MemoryAccounting(const MemoryAccounting&) = delete;
+    MemoryAccounting& operator=(const MemoryAccounting&) = delete;
+
+    // 每个子系统独占缓存行，不同子系统的登记互不干扰
+    struct alignas(64) Slot {
+        std::atomic<qint64> bytes{0};
+        std::atomic<qint64> objects{0};
+    };
+    Slot m_slots[int(MemoryTag::Count)];
+
+    static MemoryAccounting* m_instance;
+};
+
+// 作用域内的一笔占用：构造时登记，resize 调整，析构时撤销。
+// 作为成员使用时随所属对象一起释放；不可复制
+class MemoryCharge {
+public:
+    explicit MemoryCharge(MemoryTag tag, qint64 bytes = 0, bool countObject = false);
+    ~MemoryCharge();
+    MemoryCharge(const MemoryCharge&) = delete;
+    MemoryCharge& operator=(const MemoryCharge&) = delete;
+
+    void resize(qint64 bytes);
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    MemoryTag m_tag;
+    qint64 m_bytes;
+    bool m_countObject;
+};
+
+// 隐式共享容器数据块的堆占用估算（容量 + 数据头），共享的数据会被各持有者重复计入
+inline qint64 heapBytes(const QString& s) {
+    return s.capacity() ? qint64(s.capacity()) * qint64(sizeof(QChar)) + 16 : 0;
+}
+
+inline qint64 heapBytes(const QByteArray& b) {
+    return b.capacity() ? qint64(b.capacity()) + 16 : 0;
+}
+
+#endif // MEMORY_ACCOUNTING_H
@@ -0,0 +1,330 @@
+#include "metrics.h"
+#include "data_model.h"
+#include <QHash>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <chrono>
+#include <vector>
+
+Metrics* Metrics::m_instance = nullptr;
+
+namespace {
+// 下标即枚举值，0 收纳未知请求类型
+const char* const kRequestTypeNames[] = {
+    "unknown", "login", "flight_query", "book_ticket", "my_orders", "get_user_info", "update_user_info",
+    "cancel_ticket", "register", "change_ticket", "check_username", "get_cities", "get_occupied_seats",
+    "ai_chat", "change_password", "heartbeat", "handshake", "logout", "import_flights",
+};
+constexpr int kRequestTypes = int(sizeof(kRequestTypeNames) / sizeof(kRequestTypeNames[0]));
+static_assert(kRequestTypes == ImportFlightsRequest + 1, "请求类型名称表需与 RequestType 同步");
+
+const char* const kStatusNames[] = {
+    "success", "failed", "user_not_found", "password_error", "flight_not_found", "no_seats_left",
+    "username_exist", "route_not_match", "heartbeat_ack", "handshake_ack", "not_logged_in", "server_busy",
+    "not_modified", "permission_denied",
+};
+constexpr int kStatuses = int(sizeof(kStatusNames) / sizeof(kStatusNames[0]));
+static_assert(kStatuses == PermissionDenied + 1, "应答状态名称表需与 ResponseStatus 同步");
+
+constexpr qint64 kMaxMicros = (qint64(1) << 26) - 1;
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// 分片只由持有它的线程写入，读-改-写无需原子指令
+inline void bump(std::atomic<quint64>& value, quint64 delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct ShardHolder {
+    Metrics::Shard* shard = nullptr;
+    ~ShardHolder() {
+        if (shard) Metrics::getInstance()->releaseShard(shard);
+    }
+};
+thread_local ShardHolder t_shard;
+
+inline Metrics::Shard* localShard() {
+    if (!t_shard.shard) t_shard.shard = Metrics::getInstance()->acquireShard();
+    return t_shard.shard;
+}
+
+QByteArray formatDouble(double value) {
+    return QByteArray::number(value, 'g', 9);
+}
+
+QByteArray joinLabels(const QByteArray& labels, const QByteArray& extra) {
+    if (labels.isEmpty()) return extra.isEmpty() ? QByteArray() : "{" + extra + "}";
+    if (extra.isEmpty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+// 一个指标族的输出：HELP/TYPE 只写一次，序列按注册顺序追加
+struct Family {
+    QByteArray help;
+    QByteArray type;
+    QByteArray body;
+};
+}
+
+Metrics* Metrics::getInstance() {
+    if (!m_instance) {
+        m_instance = new Metrics();
+    }
+    return m_instance;
+}
+
+Metrics::Metrics() {
+    for (int type = 0; type < kRequestTypes; ++type) {
+        for (int status = 0; status < kStatuses; ++status) {
+            const int id = counter("ftms_requests_total", "已应答的请求数，按请求类型与应答状态",
+                                   QString("type=\"%1\",status=\"%2\"").arg(kRequestTypeNames[type], kStatusNames[status]));
+            if (m_requestCounters < 0) m_requestCounters = id;
+        }
+    }
+    for (int type = 0; type < kRequestTypes; ++type) {
+        const int id = histogram("ftms_request_duration_seconds", "收到请求帧到写出应答帧的耗时",
+                                 QString("type=\"%1\"").arg(kRequestTypeNames[type]));
+        if (m_requestHistograms < 0) m_requestHistograms = id;
+    }
+    m_bytesReceived = counter("ftms_bytes_received_total", "收到的请求帧字节数（解压后，含长度前缀）");
+    m_bytesSent = counter("ftms_bytes_sent_total", "写出的应答帧字节数（压缩后，含长度前缀）");
+    gauge("ftms_active_connections", "当前连接数", QString(), [this]() {
+        return double(m_connections.load(std::memory_order_relaxed));
+    });
+}
+
+const char* Metrics::requestTypeName(int requestType) {
+    return kRequestTypeNames[requestType > 0 && requestType < kRequestTypes ? requestType : 0];
+}
+
+qint64 Metrics::nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int Metrics::bucketIndex(qint64 micros) {
+    const quint64 value = quint64(qBound<qint64>(0, micros, kMaxMicros));
+    if (value < 8) return int(value);
+    const int exponent = 63 - qCountLeadingZeroBits(value);
+    return (exponent - 2) * 8 + int((value >> (exponent - 3)) & 7);
+}
+
+qint64 Metrics::bucketUpperBound(int index) {
+    if (index < 8) return index + 1;
+    const int exponent = index / 8 + 2;
+    return qint64(9 + index % 8) << (exponent - 3);
+}
+
+int Metrics::registerSeries(Kind kind, const char* name, const char* help, const QString& labels,
+                            std::function<double()> read) {
+    QMutexLocker locker(&m_mutex);
+    const QByteArray labelBytes = labels.toUtf8();
+    for (Series& series : m_series) {
+        if (series.kind == kind && series.name == name && series.labels == labelBytes) {
+            if (read) series.read = std::move(read);
+            return series.slot;
+        }
+    }
+
+    Series series;
+    series.kind = kind;
+    series.name = name;
+    series.help = help;
+    series.labels = labelBytes;
+    series.read = std::move(read);
+    if (kind == Kind::Counter) {
+        if (m_counterCount >= kMaxCounters) return -1;
+        series.slot = m_counterCount++;
+    } else if (kind == Kind::Histogram) {
+        if (m_histogramCount >= kMaxHistograms) return -1;
+        series.slot = m_histogramCount++;
+    }
+    m_series.append(series);
+    return series.slot;
+}
+
+int Metrics::counter(const char* name, const char* help, const QString& labels) {
+    return registerSeries(Kind::Counter, name, help, labels);
+}
+
+int Metrics::histogram(const char* name, const char* help, const QString& labels) {
+    return registerSeries(Kind::Histogram, name, help, labels);
+}
+
+void Metrics::gauge(const char* name, const char* help, const QString& labels, std::function<double()> read) {
+    registerSeries(Kind::Gauge, name, help, labels, std::move(read));
+}
+
+void Metrics::callbackCounter(const char* name, const char* help, const QString& labels, std::function<double()> read) {
+    registerSeries(Kind::CallbackCounter, name, help, labels, std::move(read));
+}
+
+void Metrics::add(int counter, quint64 delta) {
+    if (counter < 0) return;
+    bump(localShard()->counters[counter], delta);
+}
+
+void Metrics::observe(int histogram, qint64 micros) {
+    if (histogram < 0) return;
+    Shard* shard = localShard();
+    Histogram* h = shard->histograms[histogram].load(std::memory_order_relaxed);
+    if (!h) {
+        // 首次写入时才分配，线程只为用到的直方图付出内存
+        h = new Histogram();
+        shard->histograms[histogram].store(h, std::memory_order_release);
+    }
+    bump(h->buckets[bucketIndex(micros)], 1);
+    bump(h->sumMicros, quint64(qMax<qint64>(0, micros)));
+}
+
+void Metrics::recordRequest(int requestType, int status, qint64 micros) {
+    const int type = requestType > 0 && requestType < kRequestTypes ? requestType : 0;
+    const int statusIndex = status >= 0 && status < kStatuses ? status : int(Failed);
+    add(m_requestCounters + type * kStatuses + statusIndex);
+    observe(m_requestHistograms + type, micros);
+}
+
+void Metrics::addBytes(qint64 received, qint64 sent) {
+    if (received > 0) add(m_bytesReceived, quint64(received));
+    if (sent > 0) add(m_bytesSent, quint64(sent));
+}
+
+qint64 Metrics::quantileMicros(const std::vector<quint64>& buckets, quint64 total, double q) {
+    if (buckets.empty() || total == 0) return 0;
+    const quint64 rank = quint64(q * double(total - 1)) + 1;
+    quint64 seen = 0;
+    int b = 0;
+    for (; b < int(buckets.size()) - 1; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) break;
+    }
+    return bucketUpperBound(b);
+}
+
+quint64 Metrics::counterValue(int counter) {
+    QMutexLocker locker(&m_mutex);
+    if (counter < 0 || counter >= m_counterCount) return 0;
+    quint64 total = 0;
+    for (Shard* shard : m_shards) {
+        total += shard->counters[counter].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Metrics::HistogramSnapshot Metrics::histogramSnapshot(int histogram) {
+    QMutexLocker locker(&m_mutex);
+    HistogramSnapshot snapshot;
+    if (histogram < 0 || histogram >= m_histogramCount) return snapshot;
+    for (Shard* shard : m_shards) {
+        const Histogram* h = shard->histograms[histogram].load(std::memory_order_acquire);
+        if (!h) continue;
+        if (snapshot.buckets.empty()) snapshot.buckets.assign(kBuckets, 0);
+        for (int b = 0; b < kBuckets; ++b) {
+            const quint64 count = h->buckets[b].load(std::memory_order_relaxed);
+            snapshot.buckets[b] += count;
+            snapshot.count += count;
+        }
+        snapshot.sumMicros += h->sumMicros.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+Metrics::Shard* Metrics::acquireShard() {
+    QMutexLocker locker(&m_mutex);
+    if (!m_freeShards.isEmpty()) return m_freeShards.takeLast();
+    Shard* shard = new Shard();
+    m_shards.append(shard);
+    return shard;
+}
+
+void Metrics::releaseShard(Shard* shard) {
+    QMutexLocker locker(&m_mutex);
+    m_freeShards.append(shard);
+}
+
+QByteArray Metrics::exposition() {
+    QMutexLocker locker(&m_mutex);
+
+    std::vector<quint64> counters(m_counterCount, 0);
+    std::vector<std::vector<quint64>> histograms(m_histogramCount);
+    std::vector<quint64> sums(m_histogramCount, 0);
+    for (Shard* shard : m_shards) {
+        for (int i = 0; i < m_counterCount; ++i) {
+            counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+        }
+        for (int i = 0; i < m_histogramCount; ++i) {
+            const Histogram* h = shard->histograms[i].load(std::memory_order_acquire);
+            if (!h) continue;
+            if (histograms[i].empty()) histograms[i].assign(kBuckets, 0);
+            for (int b = 0; b < kBuckets; ++b) {
+                histograms[i][b] += h->buckets[b].load(std::memory_order_relaxed);
+            }
+            sums[i] += h->sumMicros.load(std::memory_order_relaxed);
+        }
+    }
+
+    QList<QByteArray> order;
+    QHash<QByteArray, Family> families;
+    auto family = [&](const QByteArray& name, const Series& series, const char* type) -> Family& {
+        if (!families.contains(name)) {
+            order.append(name);
+            families.insert(name, Family{series.help, type, QByteArray()});
+        }
+        return families[name];
+    };
+
+    // 从未写入过的计数器与直方图不输出，避免 (类型, 状态) 组合产生大量全零序列
+    for (const Series& series : m_series) {
+        switch (series.kind) {
+        case Kind::Counter: {
+            if (series.slot < 0 || counters[series.slot] == 0) break;
+            family(series.name, series, "counter").body +=
+                series.name + joinLabels(series.labels, {}) + " " + QByteArray::number(counters[series.slot]) + "\n";
+            break;
+        }
+        case Kind::Gauge:
+        case Kind::CallbackCounter: {
+            const char* type = series.kind == Kind::Gauge ? "gauge" : "counter";
+            family(series.name, series, type).body +=
+                series.name + joinLabels(series.labels, {}) + " " + formatDouble(series.read ? series.read() : 0.0) + "\n";
+            break;
+        }
+        case Kind::Histogram: {
+            if (series.slot < 0 || histograms[series.slot].empty()) break;
+            const std::vector<quint64>& buckets = histograms[series.slot];
+            quint64 total = 0;
+            for (quint64 count : buckets) total += count;
+
+            // Prometheus 桶取 2 的幂边界（8µs 起），恰好落在细分桶的边界上
+            QByteArray& body = family(series.name, series, "histogram").body;
+            quint64 cumulative = 0;
+            for (int b = 0; b < kBuckets; ++b) {
+                cumulative += buckets[b];
+                if (b % 8 != 7) continue;
+                const QByteArray le = "le=\"" + formatDouble(bucketUpperBound(b) / 1e6) + "\"";
+                body += series.name + "_bucket" + joinLabels(series.labels, le) + " " + QByteArray::number(cumulative) + "\n";
+            }
+            body += series.name + "_bucket" + joinLabels(series.labels, "le=\"+Inf\"") + " " + QByteArray::number(total) + "\n";
+            body += series.name + "_sum" + joinLabels(series.labels, {}) + " " + formatDouble(sums[series.slot] / 1e6) + "\n";
+            body += series.name + "_count" + joinLabels(series.labels, {}) + " " + QByteArray::number(total) + "\n";
+
+            // 按细分桶计算的累计分位数（取桶上界），比由 2 的幂桶插值更准
+            QByteArray& quantiles = family(series.name + "_quantile", series, "gauge").body;
+            for (double q : kQuantiles) {
+                const QByteArray label = "quantile=\"" + formatDouble(q) + "\"";
+                quantiles += series.name + "_quantile" + joinLabels(series.labels, label) + " "
+                             + formatDouble(quantileMicros(buckets, total, q) / 1e6) + "\n";
+            }
+            break;
+        }
+        }
+    }
+
+    QByteArray out;
+    for (const QByteArray& name : order) {
+        const Family& f = families[name];
+        out += "# HELP " + name + " " + f.help + "\n";
+        out += "# TYPE " + name + " " + f.type + "\n";
+        out += f.body;
+    }
+    return out;
+}
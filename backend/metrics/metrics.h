@@ -0,0 +1,126 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// 进程内指标注册表。计数器与延迟直方图按线程分片：热路径只写本线程的分片（单写者、无锁、不共享缓存行），
+// 抓取时汇总全部分片并输出 Prometheus 文本格式。线程退出后分片交给新线程复用，累计值不丢失。
+//
+// 直方图为 HDR 风格的对数-线性分桶：每个 2 的幂区间再分 8 个子桶，相对误差不超过 12.5%，
+// 以微秒记录，上限约 67 秒。导出时按 2 的幂边界合并为 Prometheus 桶，分位数另按细分桶计算
+class Metrics {
+public:
+    static constexpr int kMaxCounters = 1024;
+    static constexpr int kMaxHistograms = 256;
+    static constexpr int kBuckets = 192;
+
+    static Metrics* getInstance();
+
+    // 注册指标并返回热路径使用的编号，同名同标签重复注册返回同一编号；超出容量时返回 -1，之后的写入被忽略。
+    // labels 为 Prometheus 标签串（不含花括号），如 op="query_flights"
+    int counter(const char* name, const char* help, const QString& labels = QString());
+    int histogram(const char* name, const char* help, const QString& labels = QString());
+    // 抓取时才求值的指标：队列深度、连接数，或模块内已有的原子计数。回调在注册表锁内执行，不可再注册指标或获取 ProfiledMutex
+    void gauge(const char* name, const char* help, const QString& labels, std::function<double()> read);
+    void callbackCounter(const char* name, const char* help, const QString& labels, std::function<double()> read);
+
+    void add(int counter, quint64 delta = 1);
+    void observe(int histogram, qint64 micros);
+
+    // 一次请求的完整耗时（收到请求帧到写出应答帧），按请求类型与应答状态归类
+    void recordRequest(int requestType, int status, qint64 micros);
+    void addBytes(qint64 received, qint64 sent);
+
+    void connectionOpened() { m_connections.fetch_add(1, std::memory_order_relaxed); }
+    void connectionClosed() { m_connections.fetch_sub(1, std::memory_order_relaxed); }
+    int activeConnections() const { return m_connections.load(std::memory_order_relaxed); }
+
+    // Prometheus 文本格式（text/plain; version=0.0.4）
+    QByteArray exposition();
+
+    // 汇总各分片后的当前值，供调试端点使用
+    struct HistogramSnapshot {
+        std::vector<quint64> buckets;   // 从未写入时为空
+        quint64 count = 0;
+        quint64 sumMicros = 0;
+    };
+    quint64 counterValue(int counter);
+    HistogramSnapshot histogramSnapshot(int histogram);
+    // 按细分桶计算的分位数，取桶上界（微秒）
+    static qint64 quantileMicros(const std::vector<quint64>& buckets, quint64 total, double q);
+
+    // 请求类型的指标标签名（如 book_ticket），未知类型为 unknown
+    static const char* requestTypeName(int requestType);
+
+    // 单调时钟（微秒）
+    static qint64 nowMicros();
+
+    static int bucketIndex(qint64 micros);
+    // 桶的上界（不含），单位微秒
+    static qint64 bucketUpperBound(int index);
+
+    struct Histogram {
+        std::atomic<quint64> buckets[kBuckets];
+        std::atomic<quint64> sumMicros;
+    };
+    struct Shard {
+        std::atomic<quint64> counters[kMaxCounters];
+        std::atomic<Histogram*> histograms[kMaxHistograms];
+    };
+
+    // 供 thread_local 持有者在线程开始/结束时借还分片
+    Shard* acquireShard();
+    void releaseShard(Shard* shard);
+
+private:
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    enum class Kind { Counter, Histogram, Gauge, CallbackCounter };
+    struct Series {
+        Kind kind;
+        QByteArray name;
+        QByteArray help;
+        QByteArray labels;
+        int slot = -1;
+        std::function<double()> read;
+    };
+
+    int registerSeries(Kind kind, const char* name, const char* help, const QString& labels,
+                       std::function<double()> read = {});
+
+    QMutex m_mutex;                 // 保护注册表与分片列表，热路径不加锁
+    QList<Series> m_series;
+    int m_counterCount = 0;
+    int m_histogramCount = 0;
+    QList<Shard*> m_shards;
+    QList<Shard*> m_freeShards;
+
+    int m_requestCounters = -1;     // 按 (类型, 状态) 连续编号的首个计数器
+    int m_requestHistograms = -1;   // 按类型连续编号的首个直方图
+    int m_bytesReceived = -1;
+    int m_bytesSent = -1;
+    std::atomic<int> m_connections{0};
+
+    static Metrics* m_instance;
+};
+
+// 作用域计时：析构时把经过的微秒数记入直方图
+class ScopedLatency {
+public:
+    explicit ScopedLatency(int histogram) : m_histogram(histogram), m_start(Metrics::nowMicros()) {}
+    ~ScopedLatency() { Metrics::getInstance()->observe(m_histogram, Metrics::nowMicros() - m_start); }
+
+private:
+    int m_histogram;
+    qint64 m_start;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,85 @@
+#include "metrics_server.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "memory_accounting.h"
+#include "profiled_mutex.h"
+#include "db/statement_profiler.h"
+#include <QTcpSocket>
+#include <QTimer>
+
+namespace {
+// 请求头上限与读超时，防止本机其他进程占住连接
+constexpr qsizetype kMaxRequestBytes = 8192;
+constexpr int kReadTimeoutMs = 5000;
+}
+
+MetricsServer::MetricsServer(QObject* parent) : QTcpServer(parent) {}
+
+void MetricsServer::incomingConnection(qintptr socketDescriptor) {
+    auto* socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    QTimer::singleShot(kReadTimeoutMs, socket, [socket]() { socket->abort(); });
+
+    // 只需请求行，收齐请求头（空行）后应答并关闭
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+        const QByteArray buffered = socket->peek(kMaxRequestBytes);
+        if (!buffered.contains("\r\n\r\n") && buffered.size() < kMaxRequestBytes) return;
+        const QByteArray head = socket->readAll();
+        respond(socket, head.left(head.indexOf("\r\n")));
+    });
+}
+
+void MetricsServer::respond(QTcpSocket* socket, const QByteArray& requestLine) {
+    const QList<QByteArray> parts = requestLine.split(' ');
+    const QByteArray target = parts.value(1);
+    const QByteArray path = target.split('?').value(0);
+    const QByteArray query = target.contains('?') ? target.mid(target.indexOf('?') + 1) : QByteArray();
+
+    QByteArray status = "404 Not Found";
+    QByteArray body = "not found\n";
+    QByteArray contentType = "text/plain; charset=utf-8";
+    if (parts.value(0) != "GET") {
+        status = "405 Method Not Allowed";
+        body = "method not allowed\n";
+    } else if (path == "/metrics") {
+        status = "200 OK";
+        body = Metrics::getInstance()->exposition();
+        contentType = "text/plain; version=0.0.4; charset=utf-8";
+    } else if (path == "/debug/trace") {
+        // ?sample=N 调整抽样间隔（0 关闭）；返回各线程缓冲区中现存的追踪段
+        if (query.startsWith("sample=")) {
+            Tracer::getInstance()->setSampleEvery(query.mid(7).toInt());
+        }
+        status = "200 OK";
+        body = Tracer::getInstance()->dumpChromeTrace();
+        contentType = "application/json";
+    } else if (path == "/debug/sql") {
+        // ?top=N&by=total|max|count|avg，默认按累计耗时取前 20 种语句形态
+        int top = 20;
+        QByteArray by = "total";
+        for (const QByteArray& pair : query.split('&')) {
+            if (pair.startsWith("top=")) top = pair.mid(4).toInt();
+            else if (pair.startsWith("by=")) by = pair.mid(3);
+        }
+        status = "200 OK";
+        body = StatementProfiler::getInstance()->report(top, by);
+    } else if (path == "/debug/locks") {
+        status = "200 OK";
+        body = lockProfileReport();
+    } else if (path == "/debug/memory") {
+        status = "200 OK";
+        body = MemoryAccounting::getInstance()->report();
+    }
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,24 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <QTcpServer>
+
+class QTcpSocket;
+
+// 极简 HTTP 端点：GET /metrics 返回 Prometheus 文本格式，GET /debug/trace 返回 Chrome trace JSON，
+// GET /debug/sql 返回按语句形态汇总的 SQL 耗时表，GET /debug/locks 返回各锁的争用统计，
+// GET /debug/memory 返回各子系统的内存记账，其余路径 404。
+// 运行在主线程事件循环中，抓取频率低，不占用请求处理线程；默认只监听本机地址
+class MetricsServer : public QTcpServer {
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject* parent = nullptr);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    void respond(QTcpSocket* socket, const QByteArray& requestLine);
+};
+
+#endif // METRICS_SERVER_H
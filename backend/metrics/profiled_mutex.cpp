@@ -0,0 +1,171 @@
+#include "profiled_mutex.h"
+#include "metrics.h"
+#include <QList>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+
+#ifdef FTMS_LOCK_PROFILING
+
+namespace {
+// 锁名登记表。登记表自身用普通 QMutex，只在锁构造与导出时使用
+QMutex& registryMutex() {
+    static QMutex mutex;
+    return mutex;
+}
+
+QList<LockSite*>& registry() {
+    static QList<LockSite*> sites;
+    return sites;
+}
+
+const LockSite* siteFor(const char* name, const char* mode) {
+    QMutexLocker locker(&registryMutex());
+    for (const LockSite* site : registry()) {
+        if (std::strcmp(site->name, name) == 0 && std::strcmp(site->mode, mode) == 0) return site;
+    }
+    LockSite* site = new LockSite(name, mode);
+    registry().append(site);
+    return site;
+}
+
+qint64 maxMicros(const std::vector<quint64>& buckets) {
+    for (int b = int(buckets.size()) - 1; b >= 0; --b) {
+        if (buckets[b]) return Metrics::bucketUpperBound(b);
+    }
+    return 0;
+}
+}
+
+LockSite::LockSite(const char* name, const char* mode) : name(name), mode(mode) {
+    Metrics* metrics = Metrics::getInstance();
+    const QString labels = QString("lock=\"%1\",mode=\"%2\"").arg(name, mode);
+    acquisitions = metrics->counter("ftms_lock_acquisitions_total", "锁的获取次数", labels);
+    contended = metrics->counter("ftms_lock_contended_total", "获取时锁已被占用、需要等待的次数", labels);
+    wait = metrics->histogram("ftms_lock_wait_seconds", "争用时等待获得锁的时间", labels);
+    hold = std::strcmp(mode, "read") == 0 ? -1 : metrics->histogram("ftms_lock_hold_seconds", "锁的持有时间", labels);
+}
+
+ProfiledMutex::ProfiledMutex(const char* name) : m_site(siteFor(name, "exclusive")) {}
+
+void ProfiledMutex::lock() {
+    Metrics* metrics = Metrics::getInstance();
+    if (m_mutex.tryLock()) {
+        m_acquiredMicros = Metrics::nowMicros();
+    } else {
+        const qint64 start = Metrics::nowMicros();
+        m_mutex.lock();
+        m_acquiredMicros = Metrics::nowMicros();
+        metrics->add(m_site->contended);
+        metrics->observe(m_site->wait, m_acquiredMicros - start);
+    }
+    metrics->add(m_site->acquisitions);
+}
+
+void ProfiledMutex::unlock() {
+    const qint64 held = Metrics::nowMicros() - m_acquiredMicros;
+    m_mutex.unlock();
+    Metrics::getInstance()->observe(m_site->hold, held);
+}
+
+bool ProfiledMutex::tryLock() {
+    if (!m_mutex.tryLock()) return false;
+    m_acquiredMicros = Metrics::nowMicros();
+    Metrics::getInstance()->add(m_site->acquisitions);
+    return true;
+}
+
+ProfiledReadWriteLock::ProfiledReadWriteLock(const char* name)
+    : m_readSite(siteFor(name, "read")), m_writeSite(siteFor(name, "write")) {}
+
+void ProfiledReadWriteLock::lockForRead() {
+    Metrics* metrics = Metrics::getInstance();
+    if (!m_lock.tryLockForRead()) {
+        const qint64 start = Metrics::nowMicros();
+        m_lock.lockForRead();
+        metrics->add(m_readSite->contended);
+        metrics->observe(m_readSite->wait, Metrics::nowMicros() - start);
+    }
+    metrics->add(m_readSite->acquisitions);
+}
+
+void ProfiledReadWriteLock::lockForWrite() {
+    Metrics* metrics = Metrics::getInstance();
+    if (m_lock.tryLockForWrite()) {
+        m_writeAcquiredMicros.store(Metrics::nowMicros(), std::memory_order_relaxed);
+    } else {
+        const qint64 start = Metrics::nowMicros();
+        m_lock.lockForWrite();
+        const qint64 acquired = Metrics::nowMicros();
+        m_writeAcquiredMicros.store(acquired, std::memory_order_relaxed);
+        metrics->add(m_writeSite->contended);
+        metrics->observe(m_writeSite->wait, acquired - start);
+    }
+    metrics->add(m_writeSite->acquisitions);
+}
+
+void ProfiledReadWriteLock::unlock() {
+    // 读锁释放时写锁不可能被持有，读到的一定是 0，不写共享变量
+    const qint64 acquired = m_writeAcquiredMicros.load(std::memory_order_relaxed);
+    if (!acquired) {
+        m_lock.unlock();
+        return;
+    }
+    m_writeAcquiredMicros.store(0, std::memory_order_relaxed);
+    const qint64 held = Metrics::nowMicros() - acquired;
+    m_lock.unlock();
+    Metrics::getInstance()->observe(m_writeSite->hold, held);
+}
+
+QByteArray lockProfileReport() {
+    struct Row {
+        const LockSite* site;
+        quint64 acquisitions;
+        quint64 contended;
+        Metrics::HistogramSnapshot wait;
+        Metrics::HistogramSnapshot hold;
+    };
+    QList<LockSite*> sites;
+    {
+        QMutexLocker locker(&registryMutex());
+        sites = registry();
+    }
+    Metrics* metrics = Metrics::getInstance();
+    QList<Row> rows;
+    for (const LockSite* site : sites) {
+        rows.append(Row{site, metrics->counterValue(site->acquisitions), metrics->counterValue(site->contended),
+                        metrics->histogramSnapshot(site->wait), metrics->histogramSnapshot(site->hold)});
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.wait.sumMicros > b.wait.sumMicros; });
+
+    QByteArray out = QByteArray("lock").leftJustified(28) + QByteArray("mode").leftJustified(11)
+                     + QByteArray("acquired").leftJustified(12) + QByteArray("contended").leftJustified(18)
+                     + "wait_ms    wait_p99   wait_max   hold_ms    hold_p99   hold_max\n";
+    for (const Row& row : rows) {
+        const double contendedPercent = row.acquisitions ? 100.0 * double(row.contended) / double(row.acquisitions) : 0.0;
+        out += QByteArray(row.site->name).leftJustified(28)
+               + QByteArray(row.site->mode).leftJustified(11)
+               + QByteArray::number(row.acquisitions).leftJustified(12)
+               + (QByteArray::number(row.contended) + " (" + QByteArray::number(contendedPercent, 'f', 1) + "%)").leftJustified(18)
+               + QByteArray::number(row.wait.sumMicros / 1000.0, 'f', 1).leftJustified(11)
+               + QByteArray::number(Metrics::quantileMicros(row.wait.buckets, row.wait.count, 0.99)).leftJustified(11)
+               + QByteArray::number(maxMicros(row.wait.buckets)).leftJustified(11);
+        if (row.site->hold < 0) {
+            out += "-          -          -\n";
+            continue;
+        }
+        out += QByteArray::number(row.hold.sumMicros / 1000.0, 'f', 1).leftJustified(11)
+               + QByteArray::number(Metrics::quantileMicros(row.hold.buckets, row.hold.count, 0.99)).leftJustified(11)
+               + QByteArray::number(maxMicros(row.hold.buckets)) + "\n";
+    }
+    out += "（时间单位：_ms 为累计毫秒，_p99 / _max 为微秒，按细分桶上界取值）\n";
+    return out;
+}
+
+#else
+
+QByteArray lockProfileReport() {
+    return "锁争用统计未编译（FTMS_LOCK_PROFILING=OFF）\n";
+}
+
+#endif
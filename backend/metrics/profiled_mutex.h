@@ -0,0 +1,101 @@
+#ifndef PROFILED_MUTEX_H
+#define PROFILED_MUTEX_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <atomic>
+
+// 带争用统计的锁：按锁名（同名的多个实例合并，如会话表的各分片）记录获取次数、争用次数、
+// 等待时间与持有时间直方图，经 /metrics 导出（ftms_lock_*），/debug/locks 输出按等待总时间排序的表。
+// 未争用时只多一次 tryLock 与两次时钟读取；争用时才计时等待。
+//
+// ProfiledMutex 可直接配合 QMutexLocker 使用；读写锁用 ProfiledReadLocker / ProfiledWriteLocker。
+// 编译时关闭 FTMS_LOCK_PROFILING 后退化为 QMutex / QReadWriteLock，锁名被忽略。
+// 指标注册表、追踪与日志自身的锁不使用本类型，避免记录统计时重入
+#ifdef FTMS_LOCK_PROFILING
+
+// 一个锁名在一种模式（exclusive / read / write）下的指标编号
+struct LockSite {
+    LockSite(const char* name, const char* mode);
+    const char* name;
+    const char* mode;
+    int acquisitions;
+    int contended;
+    int wait;
+    int hold;       // 读锁可并发持有，不记持有时间，为 -1
+};
+
+class ProfiledMutex {
+public:
+    explicit ProfiledMutex(const char* name);
+
+    void lock();
+    void unlock();
+    bool tryLock();
+
+private:
+    QMutex m_mutex;
+    const LockSite* m_site;
+    qint64 m_acquiredMicros = 0;    // 只由持有者读写
+};
+
+class ProfiledReadWriteLock {
+public:
+    explicit ProfiledReadWriteLock(const char* name);
+
+    void lockForRead();
+    void lockForWrite();
+    void unlock();
+
+private:
+    QReadWriteLock m_lock;
+    const LockSite* m_readSite;
+    const LockSite* m_writeSite;
+    // 写锁持有期间为获得时刻，否则为 0；读锁释放时也会读取，故为原子变量
+    std::atomic<qint64> m_writeAcquiredMicros{0};
+};
+
+class ProfiledReadLocker {
+public:
+    explicit ProfiledReadLocker(ProfiledReadWriteLock* lock) : m_lock(lock) { m_lock->lockForRead(); }
+    ~ProfiledReadLocker() { m_lock->unlock(); }
+    ProfiledReadLocker(const ProfiledReadLocker&) = delete;
+    ProfiledReadLocker& operator=(const ProfiledReadLocker&) = delete;
+
+private:
+    ProfiledReadWriteLock* m_lock;
+};
+
+class ProfiledWriteLocker {
+public:
+    explicit ProfiledWriteLocker(ProfiledReadWriteLock* lock) : m_lock(lock) { m_lock->lockForWrite(); }
+    ~ProfiledWriteLocker() { m_lock->unlock(); }
+    ProfiledWriteLocker(const ProfiledWriteLocker&) = delete;
+    ProfiledWriteLocker& operator=(const ProfiledWriteLocker&) = delete;
+
+private:
+    ProfiledReadWriteLock* m_lock;
+};
+
+#else
+
+class ProfiledMutex : public QMutex {
+public:
+    explicit ProfiledMutex(const char*) {}
+};
+
+class ProfiledReadWriteLock : public QReadWriteLock {
+public:
+    explicit ProfiledReadWriteLock(const char*) {}
+};
+
+using ProfiledReadLocker = QReadLocker;
+using ProfiledWriteLocker = QWriteLocker;
+
+#endif
+
+// 各锁的统计表（文本），按 wait 总时间降序；未开启 FTMS_LOCK_PROFILING 时只有一行说明
+QByteArray lockProfileReport();
+
+#endif // PROFILED_MUTEX_H
@@ -0,0 +1,146 @@
+#include "tracer.h"
+#include <QMutexLocker>
+#include <QProcessEnvironment>
+#include <QThread>
+#include <chrono>
+
+Tracer* Tracer::m_instance = nullptr;
+
+namespace {
+thread_local quint64 t_currentTrace = 0;
+thread_local quint64 t_requestCount = 0;
+std::atomic<quint64> g_nextTraceId{1};
+
+struct BufferHolder {
+    Tracer::Buffer* buffer = nullptr;
+    ~BufferHolder() {
+        if (buffer) Tracer::getInstance()->releaseBuffer(buffer);
+    }
+};
+thread_local BufferHolder t_buffer;
+
+void appendJsonString(QByteArray& out, const QByteArray& value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (uchar(c) < 0x20) continue;
+        out += c;
+    }
+    out += '"';
+}
+}
+
+Tracer* Tracer::getInstance() {
+    if (!m_instance) {
+        m_instance = new Tracer();
+    }
+    return m_instance;
+}
+
+Tracer::Tracer() : m_originNs(nowNs()) {
+    const auto env = QProcessEnvironment::systemEnvironment();
+    bool ok = false;
+    const int every = env.value("FTMS_TRACE_SAMPLE").trimmed().toInt(&ok);
+    if (ok) setSampleEvery(every);
+    const int events = env.value("FTMS_TRACE_BUFFER").trimmed().toInt(&ok);
+    if (ok) setBufferEvents(events);
+}
+
+qint64 Tracer::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+quint64 Tracer::currentTrace() {
+    return t_currentTrace;
+}
+
+void Tracer::setCurrentTrace(quint64 traceId) {
+    t_currentTrace = traceId;
+}
+
+// 按线程计数抽样，只有被抽中的请求才访问全局的追踪号计数器
+quint64 Tracer::sample() {
+    const int every = m_sampleEvery.load(std::memory_order_relaxed);
+    if (every <= 0 || ++t_requestCount % quint64(every) != 0) return 0;
+    return g_nextTraceId.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* category, const char* name, qint64 startNs, qint64 durationNs, quint64 traceId,
+                    qint64 arg) {
+    if (!t_buffer.buffer) t_buffer.buffer = acquireBuffer();
+    Buffer* buffer = t_buffer.buffer;
+    const quint64 head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[size_t(head % buffer->events.size())] =
+        Event{category, name, startNs, durationNs, traceId, arg};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+Tracer::Buffer* Tracer::acquireBuffer() {
+    QMutexLocker locker(&m_mutex);
+    Buffer* buffer = nullptr;
+    if (!m_freeBuffers.isEmpty()) {
+        buffer = m_freeBuffers.takeLast();
+    } else {
+        buffer = new Buffer();
+        buffer->tid = m_nextTid++;
+        buffer->events.resize(size_t(m_bufferEvents));
+        m_buffers.append(buffer);
+    }
+    // 复用的缓冲区沿用 tid，线程名更新为当前持有者
+    const QString name = QThread::currentThread() ? QThread::currentThread()->objectName() : QString();
+    buffer->threadName = name.isEmpty() ? QByteArray("thread-") + QByteArray::number(buffer->tid) : name.toUtf8();
+    return buffer;
+}
+
+void Tracer::releaseBuffer(Buffer* buffer) {
+    QMutexLocker locker(&m_mutex);
+    m_freeBuffers.append(buffer);
+}
+
+// 导出与写入并发进行：先读 head 拷贝事件，再读一次 head，丢弃拷贝期间可能已被覆盖的槽位
+QByteArray Tracer::dumpChromeTrace() {
+    QMutexLocker locker(&m_mutex);
+
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+
+    for (Buffer* buffer : m_buffers) {
+        const quint64 capacity = quint64(buffer->events.size());
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 begin = head > capacity ? head - capacity : 0;
+        std::vector<Event> copy;
+        copy.reserve(size_t(head - begin));
+        for (quint64 i = begin; i < head; ++i) {
+            copy.push_back(buffer->events[size_t(i % capacity)]);
+        }
+        const quint64 after = buffer->head.load(std::memory_order_acquire);
+        const quint64 valid = after > capacity ? after - capacity : 0;
+
+        separator();
+        out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->tid)
+               + ",\"args\":{\"name\":";
+        appendJsonString(out, buffer->threadName);
+        out += "}}";
+
+        for (quint64 i = qMax(begin, valid); i < head; ++i) {
+            const Event& event = copy[size_t(i - begin)];
+            separator();
+            out += "{\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->tid) + ",\"cat\":";
+            appendJsonString(out, event.category);
+            out += ",\"name\":";
+            appendJsonString(out, event.name);
+            out += ",\"ts\":" + QByteArray::number((event.startNs - m_originNs) / 1000.0, 'f', 3);
+            out += ",\"dur\":" + QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+            out += ",\"args\":{\"trace\":" + QByteArray::number(event.traceId);
+            if (event.arg) out += ",\"arg\":" + QByteArray::number(event.arg);
+            out += "}}";
+        }
+    }
+    out += "]}\n";
+    return out;
+}
@@ -0,0 +1,103 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include <vector>
+
+// 请求级追踪：按 FTMS_TRACE_SAMPLE 每 N 个请求抽样一个，被抽中的请求在其处理线程上激活追踪号，
+// 期间的 TraceSpan（分发、处理函数、DBManager、组帧与写出）记入本线程的环形缓冲区，满了覆盖最旧的。
+// 未抽中时 TraceSpan 只读一次线程局部变量。dumpChromeTrace 输出 Chrome trace / Perfetto 可读的 JSON
+class Tracer {
+public:
+    struct Event {
+        const char* category;
+        const char* name;
+        qint64 startNs;
+        qint64 durationNs;
+        quint64 traceId;
+        qint64 arg;
+    };
+
+    struct Buffer {
+        int tid = 0;
+        QByteArray threadName;
+        std::vector<Event> events;      // 容量固定，按 head 取模写入
+        std::atomic<quint64> head{0};   // 已写入的事件总数，写者递增、导出时读取
+    };
+
+    static Tracer* getInstance();
+
+    // 抽样间隔：0 关闭，1 追踪全部请求
+    void setSampleEvery(int every) { m_sampleEvery.store(every < 0 ? 0 : every, std::memory_order_relaxed); }
+    int sampleEvery() const { return m_sampleEvery.load(std::memory_order_relaxed); }
+    void setBufferEvents(int events) { m_bufferEvents = events > 0 ? events : m_bufferEvents; }
+
+    // 在请求入口调用：本请求被抽中时返回非 0 的追踪号
+    quint64 sample();
+
+    static quint64 currentTrace();
+    static qint64 nowNs();
+
+    void record(const char* category, const char* name, qint64 startNs, qint64 durationNs, quint64 traceId, qint64 arg);
+
+    // 导出各线程缓冲区中现存的事件
+    QByteArray dumpChromeTrace();
+
+    Buffer* acquireBuffer();
+    void releaseBuffer(Buffer* buffer);
+
+private:
+    Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    friend class TraceActivation;
+    static void setCurrentTrace(quint64 traceId);
+
+    std::atomic<int> m_sampleEvery{0};
+    int m_bufferEvents = 8192;
+    qint64 m_originNs;
+
+    QMutex m_mutex;                     // 保护缓冲区列表，记录事件时不加锁
+    QList<Buffer*> m_buffers;
+    QList<Buffer*> m_freeBuffers;
+    int m_nextTid = 1;
+
+    static Tracer* m_instance;
+};
+
+// 在本线程激活（或恢复）一个追踪号，析构时还原；跨线程继续同一请求时（认证线程池、投递回 I/O 线程）使用
+class TraceActivation {
+public:
+    explicit TraceActivation(quint64 traceId) : m_previous(Tracer::currentTrace()) { Tracer::setCurrentTrace(traceId); }
+    ~TraceActivation() { Tracer::setCurrentTrace(m_previous); }
+
+private:
+    quint64 m_previous;
+};
+
+// 作用域追踪段：当前线程有激活的追踪号时，析构时记录一段耗时；name 与 category 需为静态字符串
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name, qint64 arg = 0)
+        : m_category(category), m_name(name), m_arg(arg), m_trace(Tracer::currentTrace()),
+          m_start(m_trace ? Tracer::nowNs() : 0) {}
+    // 参数在进入作用域时还未知（如请求类型）时补设
+    void setArg(qint64 arg) { m_arg = arg; }
+
+    ~TraceSpan() {
+        if (m_trace) Tracer::getInstance()->record(m_category, m_name, m_start, Tracer::nowNs() - m_start, m_trace, m_arg);
+    }
+
+private:
+    const char* m_category;
+    const char* m_name;
+    qint64 m_arg;
+    quint64 m_trace;
+    qint64 m_start;
+};
+
+#endif // TRACER_H
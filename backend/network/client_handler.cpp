@@ -1,364 +1,121 @@
 #include "client_handler.h"
 #include "../ai/ai_manager.h"
 #include "db/db_manager.h"
-#include <QDebug>
+#include "idle_reaper.h"
+#include "log/logger.h"
+#include "metrics/memory_accounting.h"
+#include "metrics/profiled_mutex.h"
+#include "request_dispatcher.h"
+#include <QMutexLocker>
+
+namespace {
+LogCategory logNet("net");
+}
+
+// Qt 传输层的应答出口：socket 属于连接线程，异步结果经事件队列切回该线程。
+// close() 之后不再投递，已投递未执行的任务随 socket 析构一并丢弃。
+// 任务执行后调用 resume，继续处理等待异步应答期间暂停的请求
+class SocketSink : public ResponseSink {
+public:
+    SocketSink(QTcpSocket* socket, std::function<void()> resume) : m_socket(socket), m_resume(std::move(resume)) {}
+
+    void write(const QByteArray& frame) override {
+        if (!m_socket) return;
+        m_socket->write(frame);
+        m_socket->flush();
+        updateMemory();
+    }
+
+    // socket 写缓冲中尚未发出的字节记入 send_buffers，写出或追加后更新
+    void updateMemory() {
+        if (m_socket) m_sendMemory.resize(m_socket->bytesToWrite());
+    }
+
+    void post(std::function<void()> task) override {
+        QMutexLocker locker(&m_mutex);
+        if (!m_socket) return;
+        QMetaObject::invokeMethod(m_socket, [task = std::move(task), resume = m_resume]() {
+            task();
+            resume();
+        }, Qt::QueuedConnection);
+    }
+
+    void close() {
+        QMutexLocker locker(&m_mutex);
+        m_socket = nullptr;
+    }
+
+private:
+    ProfiledMutex m_mutex{"socket_sink"};
+    QTcpSocket* m_socket;
+    std::function<void()> m_resume;
+    MemoryCharge m_sendMemory{MemoryTag::SendBuffers};
+};
 
 ClientHandler::ClientHandler(qintptr socketDescriptor, QObject *parent)
-    : QThread(parent), m_socketDescriptor(socketDescriptor) {}
+    : QThread(parent), m_socketDescriptor(socketDescriptor), m_lastActivity(IdleReaper::nowSecs()) {}
+
+ClientHandler::~ClientHandler() = default;
 
 void ClientHandler::run() {
     m_socket = new QTcpSocket();
     if (!m_socket->setSocketDescriptor(m_socketDescriptor)) {
-        qDebug() << "客户端连接失败：" << m_socket->errorString();
+        logWarning(logNet, "客户端连接失败：{}", m_socket->errorString());
+        delete m_socket;  m_socket = nullptr;
         return;
     }
     connect(m_socket, &QTcpSocket::readyRead, this, &ClientHandler::onReadyRead, Qt::DirectConnection);
     connect(m_socket, &QTcpSocket::disconnected, this, &ClientHandler::onDisconnected, Qt::DirectConnection);
     
     m_aiManager = new AIManager();
-
-    m_recvBuffer.clear();
-    m_expectedSize = 0;
-    qDebug() << "客户端连接成功，等待数据...";
+    m_sink = std::make_shared<SocketSink>(m_socket, [this]() { processFrames(); });
+    m_dispatcher = std::make_unique<RequestDispatcher>(m_sink, m_aiManager);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, [this]() { m_sink->updateMemory(); }, Qt::DirectConnection);
+    // Qt 传输层每个连接独占的对象（分发器自身另行登记）
+    MemoryCharge connectionMemory(MemoryTag::Connections, sizeof(ClientHandler) + sizeof(SocketSink) + sizeof(AIManager));
+
+    m_reader.clear();
+    logInfo(logNet, "客户端连接成功，等待数据...");
     exec();
-    
-    delete m_aiManager;  m_aiManager = nullptr;
-}
 
-void ClientHandler::onReadyRead() {
-    m_recvBuffer.append(m_socket->readAll());
-    
-    while (true) {
-        if (m_expectedSize == 0) {
-            if (m_recvBuffer.size() < (int)sizeof(quint32)) {
-                return;
-            }
-            QDataStream sizeStream(m_recvBuffer.left(sizeof(quint32)));
-            sizeStream.setVersion(QDataStream::Qt_6_0);
-            sizeStream >> m_expectedSize;
-            m_recvBuffer.remove(0, sizeof(quint32));
-        }
-        if ((quint32)m_recvBuffer.size() < m_expectedSize) {
-            return; 
-        }
-        QByteArray packet = m_recvBuffer.left(m_expectedSize);
-        m_recvBuffer.remove(0, m_expectedSize);
-        m_expectedSize = 0;
-        processPacket(packet);
-    }
-}
-
-// 解析请求类型并分发
-void ClientHandler::processPacket(const QByteArray& packet) {
-    QDataStream in(packet);
-    in.setVersion(QDataStream::Qt_6_0);
-
-    int requestType;
-    in >> requestType;
-
-    QByteArray data;
-    in >> data;
-
-    switch (requestType) {
-    case LoginRequest:
-        handleLoginRequest(data);
-        break;
-    case FlightQueryRequest:
-        handleFlightQueryRequest(data);
-        break;
-    case BookTicketRequest:
-        handleBookTicketRequest(data);
-        break;
-    case MyOrdersRequest:
-        handleMyOrdersRequest(data);
-        break;
-    case GetUserInfoRequest:
-        handleGetUserInfoRequest(data);
-        break;
-    case UpdateUserInfoRequest:
-        handleUpdateUserInfoRequest(data);
-        break;
-    case CancelTicketRequest:
-        handleCancelTicketRequest(data);
-        break;
-    case RegisterRequest:
-        handleRegisterRequest(data);
-        break;
-    case ChangeTicketRequest:
-        handleChangeTicketRequest(data);
-        break;
-    case CheckUsernameRequest:
-        handleCheckUsernameRequest(data);
-        break;
-    case GetCitiesRequest:
-        handleGetCitiesRequest(data);
-        break;
-    case GetOccupiedSeatsRequest:
-        handleGetOccupiedSeatsRequest(data);
-        break;
-    case AIChatRequest:
-        handleAIChatRequest(data);
-        break;
-    case ChangePasswordRequest:
-        handleChangePasswordRequest(data);
-        break;
-    default:
-        sendResponse(Failed);
-        qDebug() << "收到未知请求类型：" << requestType;
-        break;
-    }
+    // 正常断开与空闲回收都从这里退出，线程内的资源统一在此释放
+    m_sink->close();
+    m_socket->abort();
+    delete m_socket;  m_socket = nullptr;
+    m_dispatcher.reset();
+    m_sink.reset();
+    delete m_aiManager;  m_aiManager = nullptr;
+    m_reader.clear();
+    DBManager::getInstance()->releaseConnection();
 }
 
-void ClientHandler::handleLoginRequest(const QByteArray& data) {
-    QDataStream in(data);
-    User user;
-    in >> user;
-
-    ResponseStatus status = DBManager::getInstance()->verifyUser(user.username, user.password);
-    sendResponse(status);
-
-    qDebug() << "登录请求 - 用户名：" << user.username << " 验证结果：" << (status == Success ? "成功" : "失败");
+void ClientHandler::reap() {
+    quit();
 }
 
-void ClientHandler::handleFlightQueryRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString departure, destination;
-    QDate date;
-    in >> departure >> destination >> date;
-
-    QList<Flight> flights = DBManager::getInstance()->queryFlights(departure, destination, date);
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << static_cast<quint32>(flights.size());
-    for (const Flight& flight : flights) {
-        out << flight;
-    }
-
-    ResponseStatus status = flights.isEmpty() ? FlightNotFound : Success;
-    sendResponse(status, responseData);
-
-    qDebug() << "航班查询请求 - 出发地：" << departure << " 目的地：" << destination << " 日期：" << date << " 查到航班数：" << flights.size();
+void ClientHandler::onReadyRead() {
+    m_lastActivity.store(IdleReaper::nowSecs(), std::memory_order_relaxed);
+    processFrames();
 }
 
-void ClientHandler::handleBookTicketRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username, flight_id, seat_number;
-    in >> username >> flight_id >> seat_number;
-
-    QString orderId;
-    if (seat_number.isEmpty()) {
-        orderId = DBManager::getInstance()->bookTicket(username, flight_id);
-    } else {
-        orderId = DBManager::getInstance()->bookTicketWithSeat(username, flight_id, seat_number);
-    }
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << orderId;
-
-    ResponseStatus status = Success;
-    if (orderId.isEmpty()) {
-        const int restSeats = DBManager::getInstance()->getRestSeats(flight_id);
-        if (restSeats == -1) {
-            status = FlightNotFound;
-        } else if (restSeats == 0) {
-            status = NoSeatsLeft;
-        } else {
-            status = Failed;
+// 有异步应答尚未写出时既不读也不分发，未读的数据留在 socket 中，应答写出后由 SocketSink 再次调用
+void ClientHandler::processFrames() {
+    QByteArray packet;
+    while (!m_dispatcher->awaitingReply()) {
+        if (m_reader.next(packet)) {
+            m_dispatcher->processPacket(packet);
+            continue;
         }
+        if (m_reader.failed() || m_socket->bytesAvailable() == 0) break;
+        m_reader.append(m_socket->readAll());
     }
-
-    sendResponse(status, responseData);
-    qDebug() << "订票请求 - 用户名：" << username << " 航班号：" << flight_id << " 座位：" << seat_number << " 订单号：" << (orderId.isEmpty() ? "无" : orderId);
-}
-
-void ClientHandler::handleMyOrdersRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username;
-    in >> username;
-
-    QList<Order> orders = DBManager::getInstance()->queryUserOrders(username);
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << static_cast<quint32>(orders.size());
-    for (const Order& order : orders) {
-        out << order;
+    if (m_reader.failed()) {
+        logWarning(logNet, "客户端发送了压缩帧，断开连接，描述符：{}", m_socketDescriptor);
+        quit();
     }
-
-    sendResponse(Success, responseData);
-    qDebug() << "订单查询请求 - 用户名：" << username << " 查到订单数：" << orders.size();
-}
-
-void ClientHandler::handleGetUserInfoRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username;
-    in >> username;
-
-    User user = DBManager::getInstance()->getUserInfo(username);
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << user;
-
-    ResponseStatus status = user.username.isEmpty() ? UserNotFound : Success;
-    sendResponse(status, responseData);
-    qDebug() << "用户信息请求 - 用户名：" << username << " 结果：" << (status == Success ? "成功" : "失败");
-}
-
-void ClientHandler::handleUpdateUserInfoRequest(const QByteArray& data) {
-    QDataStream in(data);
-    User user;
-    in >> user;
-
-    bool success = DBManager::getInstance()->updateUserInfo(user);
-    sendResponse(success ? Success : Failed);
-
-    qDebug() << "更新用户信息请求 - 用户名：" << user.username << " 结果：" << (success ? "成功" : "失败");
-}
-
-void ClientHandler::handleCancelTicketRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString orderId;
-    in >> orderId;
-
-    bool success = DBManager::getInstance()->cancelTicket(orderId);
-    sendResponse(success ? Success : Failed);
-
-    qDebug() << "取消订单请求 - 订单号：" << orderId << " 结果：" << (success ? "成功" : "失败");
-}
-
-void ClientHandler::handleRegisterRequest(const QByteArray& data) {
-    QDataStream in(data);
-    User user;
-    in >> user;
-
-    bool success = DBManager::getInstance()->registerUser(user);
-    sendResponse(success ? Success : Failed);
-
-    qDebug() << "注册请求 - 用户名：" << user.username << " 结果：" << (success ? "成功" : "失败");
-}
-
-void ClientHandler::handleChangeTicketRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString orderId, newFlightId, seatNumber;
-    in >> orderId >> newFlightId >> seatNumber;
-
-    bool success = DBManager::getInstance()->changeTicket(orderId, newFlightId, seatNumber);
-    sendResponse(success ? Success : Failed);
-
-    qDebug() << "改签请求 - 订单号：" << orderId << " 新航班：" << newFlightId << " 座位：" << seatNumber << " 结果：" << (success ? "成功" : "失败");
-}
-
-void ClientHandler::handleCheckUsernameRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username;
-    in >> username;
-
-    bool exist = DBManager::getInstance()->isUserExist(username);
-    sendResponse(exist ? UsernameExist : Success);
-    
-    qDebug() << "检查用户名请求 - 用户名：" << username << " 存在：" << exist;
-}
-
-void ClientHandler::handleGetCitiesRequest(const QByteArray& /*data*/) {
-    QStringList cities = DBManager::getInstance()->getCities();
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << cities;
-
-    sendResponse(Success, responseData);
-    qDebug() << "城市列表请求 - 返回城市数：" << cities.size();
-}
-
-void ClientHandler::handleGetOccupiedSeatsRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString flightId;
-    in >> flightId;
-
-    QStringList seats = DBManager::getInstance()->getOccupiedSeats(flightId);
-
-    QByteArray responseData;
-    QDataStream out(&responseData, QIODevice::WriteOnly);
-    out.setVersion(QDataStream::Qt_6_0);
-    out << seats;
-
-    sendResponse(Success, responseData);
-    qDebug() << "已占座位请求 - 航班：" << flightId << " 已占座位数：" << seats.size();
-}
-
-void ClientHandler::sendResponse(ResponseStatus status, const QByteArray& data) {
-    QByteArray payload;
-    QDataStream payloadOut(&payload, QIODevice::WriteOnly);
-    payloadOut.setVersion(QDataStream::Qt_6_0);
-    payloadOut << status << data;
-    
-    QByteArray packet;
-
-    
-    QDataStream packetOut(&packet, QIODevice::WriteOnly);
-    packetOut.setVersion(QDataStream::Qt_6_0);
-    packetOut << (quint32)payload.size();
-    packet.append(payload);
-    
-    m_socket->write(packet);
-    m_socket->flush();
-}
-
-
-void ClientHandler::handleAIChatRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username, message;
-    in >> username >> message;
-
-    QString context = "";
-
-    QMetaObject::Connection *conn = new QMetaObject::Connection;
-    *conn = connect(m_aiManager, &AIManager::responseReceived, this, [this, conn](const QString& response) {
-        QByteArray responseData;
-        QDataStream out(&responseData, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_6_0);
-        out << response;
-        sendResponse(Success, responseData);
-        QObject::disconnect(*conn);
-        delete conn;
-    });
-    
-    QMetaObject::Connection *errConn = new QMetaObject::Connection;
-    *errConn = connect(m_aiManager, &AIManager::errorOccurred, this, [this, errConn](const QString& error) {
-        QByteArray responseData;
-        QDataStream out(&responseData, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_6_0);
-        out << error;
-        sendResponse(Failed, responseData);
-        QObject::disconnect(*errConn);
-        delete errConn;
-    });
-
-    m_aiManager->sendMessage(message, context);
-}
-
-void ClientHandler::handleChangePasswordRequest(const QByteArray& data) {
-    QDataStream in(data);
-    QString username, oldPass, newPass;
-    in >> username >> oldPass >> newPass;
-
-    bool success = DBManager::getInstance()->changePassword(username, oldPass, newPass);
-    sendResponse(success ? Success : Failed);
-
-    qDebug() << "修改密码请求 - 用户名：" << username << " 结果：" << (success ? "成功" : "失败");
 }
 
 void ClientHandler::onDisconnected() {
-    qDebug() << "客户端断开连接，描述符：" << m_socketDescriptor;
-    m_socket->close();
-    m_socket->deleteLater();
+    logInfo(logNet, "客户端断开连接，描述符：{}", m_socketDescriptor);
     quit();
 }
@@ -5,49 +5,46 @@
 #include <QTcpSocket>
 #include <QDataStream>
 #include <QObject>
+#include <atomic>
+#include <memory>
 
 #include "data_model.h"
+#include "frame_codec.h"
 
+class SocketSink;
+class RequestDispatcher;
+
+// Qt 传输层：每个连接一个线程，负责收发与拆帧，请求交给 RequestDispatcher
 class ClientHandler : public QThread {
     Q_OBJECT
 public:
     explicit ClientHandler(qintptr socketDescriptor, QObject *parent = nullptr);
+    ~ClientHandler() override;
     void run() override;
 
-signals:
-    void finished();
+    qintptr descriptor() const { return m_socketDescriptor; }
+    // 最近一次收到数据的时间（IdleReaper::nowSecs），可跨线程读取
+    qint64 lastActivity() const { return m_lastActivity.load(std::memory_order_relaxed); }
+    // 由空闲回收器调用：结束连接线程的事件循环，资源在线程内释放
+    void reap();
 
 private slots:
     void onReadyRead();
     void onDisconnected();
 
 private:
+    void processFrames();
+
     qintptr m_socketDescriptor;
-    QTcpSocket* m_socket;
-
-    void handleLoginRequest(const QByteArray& data);
-    void handleFlightQueryRequest(const QByteArray& data);
-    void handleBookTicketRequest(const QByteArray& data);
-    void handleMyOrdersRequest(const QByteArray& data);
-    void handleGetUserInfoRequest(const QByteArray& data);
-    void handleUpdateUserInfoRequest(const QByteArray& data);
-    void handleCancelTicketRequest(const QByteArray& data);
-    void handleRegisterRequest(const QByteArray& data);
-    void handleChangeTicketRequest(const QByteArray& data);
-    void handleCheckUsernameRequest(const QByteArray& data);
-    void handleGetCitiesRequest(const QByteArray& data);
-    void handleGetOccupiedSeatsRequest(const QByteArray& data);
-    void handleAIChatRequest(const QByteArray& data);
-    void handleChangePasswordRequest(const QByteArray& data);
-
-    void sendResponse(ResponseStatus status, const QByteArray& data = QByteArray());
-    void processPacket(const QByteArray& packet);
-    
+    QTcpSocket* m_socket = nullptr;
+    std::atomic<qint64> m_lastActivity;
+
     class AIManager* m_aiManager = nullptr;
-    
+    std::shared_ptr<SocketSink> m_sink;
+    std::unique_ptr<RequestDispatcher> m_dispatcher;
+
     // 用于处理 TCP 粘包/拆包
-    QByteArray m_recvBuffer;
-    quint32 m_expectedSize = 0;
+    FrameReader m_reader;
 };
 
 #endif // CLIENT_HANDLER_H
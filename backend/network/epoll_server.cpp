@@ -0,0 +1,493 @@
+#include "epoll_server.h"
+#include "../ai/ai_manager.h"
+#include "db/db_manager.h"
+#include "frame_codec.h"
+#include "idle_reaper.h"
+#include "log/logger.h"
+#include "metrics/memory_accounting.h"
+#include "metrics/profiled_mutex.h"
+#include "request_dispatcher.h"
+#include "timer_wheel.h"
+#include <QDebug>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+LogCategory logNet("net");
+
+// epoll_event.data.u64 中的保留标识，连接 id 从 kFirstConnectionId 起单调递增、不复用
+constexpr quint64 kListenerId = 0;
+constexpr quint64 kWakeupId = 1;
+constexpr quint64 kFirstConnectionId = 2;
+
+constexpr int kMaxEvents = 256;
+constexpr int kReadChunk = 64 * 1024;
+
+QString errnoString(const char* what) {
+    return QString("%1 失败：%2").arg(what, QString::fromLocal8Bit(strerror(errno)));
+}
+}
+
+class EpollWorker : public QThread {
+public:
+    EpollWorker(int index, AIManager* aiManager, int idleTimeout);
+    ~EpollWorker() override;
+
+    bool open(quint16 port, QString* error);
+    void stop();
+    // 任意线程调用：worker 线程取完积压的连接后关闭监听 socket，已有连接照常处理
+    void stopAccepting();
+
+protected:
+    void run() override;
+
+private:
+    struct Connection;
+    struct PostQueue;
+    class Sink;
+
+    void acceptAll();
+    void closeListener();
+    bool onReadable(Connection* conn);
+    bool flush(Connection* conn);
+    void closeConnection(Connection* conn);
+    void runPostedTasks();
+    void reapIdle();
+    void wakeup();
+
+    int m_index;
+    AIManager* m_aiManager;
+    int m_idleTimeout;
+    int m_listenFd = -1;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<bool> m_stopAccepting{false};
+
+    quint64 m_nextId = kFirstConnectionId;
+    QHash<quint64, Connection*> m_connections;
+    TimerWheel<quint64> m_wheel;
+    QByteArray m_readBuffer;
+    MemoryCharge m_readMemory{MemoryTag::ReceiveBuffers, kReadChunk};
+
+    std::shared_ptr<PostQueue> m_posted;
+};
+
+// 投递给 worker 的异步结果。连接的 Sink 共同持有队列而不是 worker 本身：认证线程池或 AI 线程的
+// 回调可能在 worker 退出、析构之后才投递，此时队列已关闭，任务直接丢弃
+struct EpollWorker::PostQueue {
+    ProfiledMutex mutex{"epoll_post"};
+    QVector<QPair<quint64, std::function<void()>>> tasks;
+    int wakeFd = -1;
+    bool closed = false;
+
+    // 任意线程调用，把任务投递给指定连接，在 worker 线程内执行
+    void post(quint64 connectionId, std::function<void()> task) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        if (closed) return;
+        tasks.append(qMakePair(connectionId, std::move(task)));
+        const quint64 one = 1;
+        const ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        Q_UNUSED(written);
+    }
+
+    QVector<QPair<quint64, std::function<void()>>> take() {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        return std::exchange(tasks, {});
+    }
+
+    // 之后的 post 不再入队也不再写 eventfd，worker 随后才关闭 eventfd
+    void close() {
+        QVector<QPair<quint64, std::function<void()>>> dropped;
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex);
+            closed = true;
+            dropped.swap(tasks);
+        }
+    }
+};
+
+struct EpollWorker::Connection {
+    quint64 id = 0;
+    int fd = -1;
+    qint64 lastActivity = 0;
+    FrameReader reader;
+    QByteArray outbox;
+    qsizetype outOffset = 0;
+    std::shared_ptr<Sink> sink;
+    std::unique_ptr<RequestDispatcher> dispatcher;
+    MemoryCharge memory{MemoryTag::Connections};
+    // 发送缓冲按容量登记，写空后保留的容量仍计入
+    MemoryCharge outboxMemory{MemoryTag::SendBuffers};
+};
+
+// epoll 连接的应答出口：写入只追加到发送缓冲，由 worker 在处理完一批请求后统一 flush，
+// 流水线请求因此合并成一次 send
+class EpollWorker::Sink : public ResponseSink {
+public:
+    Sink(std::shared_ptr<PostQueue> queue, Connection* conn) : m_queue(std::move(queue)), m_conn(conn), m_id(conn->id) {}
+
+    void write(const QByteArray& frame) override {
+        m_conn->outbox.append(frame);
+        m_conn->outboxMemory.resize(m_conn->outbox.capacity());
+    }
+
+    void post(std::function<void()> task) override {
+        m_queue->post(m_id, std::move(task));
+    }
+
+private:
+    std::shared_ptr<PostQueue> m_queue;
+    Connection* m_conn;
+    quint64 m_id;
+};
+
+EpollWorker::EpollWorker(int index, AIManager* aiManager, int idleTimeout)
+    : m_index(index), m_aiManager(aiManager), m_idleTimeout(idleTimeout),
+      m_wheel(64, IdleReaper::nowSecs()), m_posted(std::make_shared<PostQueue>()) {
+    m_readBuffer.resize(kReadChunk);
+}
+
+EpollWorker::~EpollWorker() {
+    m_posted->close();
+    if (m_wakeFd >= 0) ::close(m_wakeFd);
+    if (m_epollFd >= 0) ::close(m_epollFd);
+    if (m_listenFd >= 0) ::close(m_listenFd);
+}
+
+bool EpollWorker::open(quint16 port, QString* error) {
+    m_listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        *error = errnoString("socket");
+        return false;
+    }
+
+    // 每个 worker 独立监听同一端口，由内核在多个监听 socket 间分发新连接
+    int one = 1;
+    ::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        *error = errnoString("SO_REUSEPORT");
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        *error = errnoString("bind");
+        return false;
+    }
+    if (::listen(m_listenFd, SOMAXCONN) < 0) {
+        *error = errnoString("listen");
+        return false;
+    }
+
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        *error = errnoString("epoll_create1/eventfd");
+        return false;
+    }
+    m_posted->wakeFd = m_wakeFd;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.u64 = kListenerId;
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &ev) < 0) {
+        *error = errnoString("epoll_ctl(listen)");
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = kWakeupId;
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0) {
+        *error = errnoString("epoll_ctl(eventfd)");
+        return false;
+    }
+    return true;
+}
+
+void EpollWorker::stop() {
+    m_stopping.store(true);
+    wakeup();
+}
+
+void EpollWorker::stopAccepting() {
+    m_stopAccepting.store(true);
+    wakeup();
+}
+
+void EpollWorker::wakeup() {
+    const quint64 one = 1;
+    const ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+    Q_UNUSED(written);
+}
+
+void EpollWorker::run() {
+    epoll_event events[kMaxEvents];
+    const int timeoutMs = m_idleTimeout > 0 ? 1000 : -1;
+
+    while (!m_stopping.load()) {
+        const int count = ::epoll_wait(m_epollFd, events, kMaxEvents, timeoutMs);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            qWarning() << "epoll worker" << m_index << errnoString("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const quint64 id = events[i].data.u64;
+            if (id == kListenerId) {
+                if (m_listenFd >= 0) acceptAll();
+                continue;
+            }
+            if (id == kWakeupId) {
+                quint64 value = 0;
+                const ssize_t drained = ::read(m_wakeFd, &value, sizeof(value));
+                Q_UNUSED(drained);
+                if (m_stopAccepting.load() && m_listenFd >= 0) closeListener();
+                runPostedTasks();
+                continue;
+            }
+
+            // 同一批事件中连接可能已被关闭
+            Connection* conn = m_connections.value(id, nullptr);
+            if (!conn) continue;
+
+            const quint32 flags = events[i].events;
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                if (!onReadable(conn)) continue;
+            }
+            if ((flags & EPOLLOUT) && !flush(conn)) {
+                closeConnection(conn);
+            }
+        }
+
+        if (m_idleTimeout > 0) {
+            reapIdle();
+        }
+    }
+
+    m_posted->close();
+    const QList<Connection*> remaining = m_connections.values();
+    for (Connection* conn : remaining) {
+        closeConnection(conn);
+    }
+    DBManager::getInstance()->releaseConnection();
+}
+
+// 关闭前先取完已完成握手的连接，否则它们会随监听 socket 一起被内核重置
+void EpollWorker::closeListener() {
+    acceptAll();
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_listenFd, nullptr);
+    ::close(m_listenFd);
+    m_listenFd = -1;
+}
+
+// 边沿触发：一次把积压的连接全部取完
+void EpollWorker::acceptAll() {
+    while (true) {
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                qWarning() << "epoll worker" << m_index << errnoString("accept4");
+            }
+            return;
+        }
+
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto* conn = new Connection;
+        conn->id = m_nextId++;
+        conn->fd = fd;
+        conn->lastActivity = IdleReaper::nowSecs();
+        conn->sink = std::make_shared<Sink>(m_posted, conn);
+        conn->dispatcher = std::make_unique<RequestDispatcher>(conn->sink, m_aiManager);
+        conn->memory.resize(sizeof(Connection) + sizeof(Sink));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = conn->id;
+        if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            qWarning() << "epoll worker" << m_index << errnoString("epoll_ctl(client)");
+            ::close(fd);
+            delete conn;
+            continue;
+        }
+
+        m_connections.insert(conn->id, conn);
+        if (m_idleTimeout > 0) {
+            m_wheel.schedule(conn->id, conn->lastActivity + m_idleTimeout);
+        }
+    }
+}
+
+// 读到 EAGAIN 为止，再按帧分发；返回 false 表示连接已关闭。
+// 有异步应答尚未写出时既不读也不分发，数据留在内核缓冲区，应答写出后由 runPostedTasks 再次调用
+bool EpollWorker::onReadable(Connection* conn) {
+    if (conn->dispatcher->awaitingReply()) return true;
+    bool peerClosed = false;
+    while (true) {
+        const ssize_t n = ::recv(conn->fd, m_readBuffer.data(), m_readBuffer.size(), 0);
+        if (n > 0) {
+            conn->reader.append(m_readBuffer.constData(), n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        peerClosed = true;
+        break;
+    }
+    conn->lastActivity = IdleReaper::nowSecs();
+
+    QByteArray packet;
+    while (!conn->dispatcher->awaitingReply() && conn->reader.next(packet)) {
+        conn->dispatcher->processPacket(packet);
+    }
+    if (conn->reader.failed()) {
+        logWarning(logNet, "客户端发送了压缩帧，断开连接，描述符：{}", conn->fd);
+        peerClosed = true;
+    }
+
+    if (!flush(conn) || peerClosed) {
+        closeConnection(conn);
+        return false;
+    }
+    return true;
+}
+
+// 尽量写出发送缓冲；遇到 EAGAIN 保留剩余数据，等待下一次 EPOLLOUT 边沿
+bool EpollWorker::flush(Connection* conn) {
+    while (conn->outOffset < conn->outbox.size()) {
+        const ssize_t n = ::send(conn->fd, conn->outbox.constData() + conn->outOffset,
+                                 conn->outbox.size() - conn->outOffset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->outOffset += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false;
+    }
+    conn->outbox.resize(0);
+    conn->outOffset = 0;
+    return true;
+}
+
+void EpollWorker::closeConnection(Connection* conn) {
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    ::close(conn->fd);
+    m_connections.remove(conn->id);
+    delete conn;
+}
+
+void EpollWorker::runPostedTasks() {
+    QVector<QPair<quint64, std::function<void()>>> tasks = m_posted->take();
+    for (auto& task : tasks) {
+        Connection* conn = m_connections.value(task.first, nullptr);
+        if (!conn) continue;  // 连接已关闭，丢弃异步结果
+        task.second();
+        if (!conn->dispatcher->awaitingReply()) {
+            onReadable(conn);  // 写出应答，继续处理暂停期间收到的请求
+            continue;
+        }
+        if (!flush(conn)) {
+            closeConnection(conn);
+        }
+    }
+}
+
+void EpollWorker::reapIdle() {
+    const qint64 now = IdleReaper::nowSecs();
+    m_wheel.advance(now, [this, now](quint64 id) -> qint64 {
+        Connection* conn = m_connections.value(id, nullptr);
+        if (!conn) {
+            return 0;
+        }
+        // 等待异步应答期间不读取数据，活跃时间不会刷新，不按空闲回收
+        if (conn->dispatcher->awaitingReply()) {
+            return now + m_idleTimeout;
+        }
+        const qint64 deadline = conn->lastActivity + m_idleTimeout;
+        if (deadline > now) {
+            return deadline;
+        }
+        logInfo(logNet, "epoll worker {} 回收空闲连接，空闲秒数：{}", m_index, now - conn->lastActivity);
+        closeConnection(conn);
+        return 0;
+    });
+}
+
+EpollServer::EpollServer()
+    : m_threadCount(qMax(1, QThread::idealThreadCount())) {}
+
+EpollServer::~EpollServer() {
+    close();
+}
+
+void EpollServer::setThreadCount(int count) {
+    m_threadCount = qMax(1, count);
+}
+
+void EpollServer::setIdleTimeout(int seconds) {
+    m_idleTimeout = qMax(0, seconds);
+}
+
+bool EpollServer::listen(quint16 port) {
+    // AI 请求依赖 Qt 事件循环，所有 worker 共享一个驻留在独立线程中的 AIManager
+    m_aiManager = new AIManager();
+    m_aiManager->moveToThread(&m_aiThread);
+    QObject::connect(&m_aiThread, &QThread::finished, m_aiManager, &QObject::deleteLater);
+    m_aiThread.start();
+
+    for (int i = 0; i < m_threadCount; ++i) {
+        auto worker = std::make_unique<EpollWorker>(i, m_aiManager, m_idleTimeout);
+        if (!worker->open(port, &m_errorString)) {
+            close();
+            return false;
+        }
+        m_workers.push_back(std::move(worker));
+    }
+    for (auto& worker : m_workers) {
+        worker->start();
+    }
+    return true;
+}
+
+void EpollServer::stopAccepting() {
+    for (auto& worker : m_workers) {
+        worker->stopAccepting();
+    }
+}
+
+void EpollServer::close() {
+    for (auto& worker : m_workers) {
+        worker->stop();
+    }
+    for (auto& worker : m_workers) {
+        worker->wait();
+    }
+    m_workers.clear();
+
+    if (m_aiThread.isRunning()) {
+        m_aiThread.quit();
+        m_aiThread.wait();
+    }
+    m_aiManager = nullptr;
+}
@@ -0,0 +1,40 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#include <QString>
+#include <QThread>
+#include <vector>
+#include <memory>
+
+class AIManager;
+class EpollWorker;
+
+// Linux 原生网络后端：每个 worker 线程一个 epoll 实例和一个 SO_REUSEPORT 监听 socket，
+// 边沿触发读写、批量 accept，请求仍交给 RequestDispatcher 分发。
+// 连接上的数据库请求在 worker 线程内同步执行，AI 请求转交给共享的 AI 线程。
+class EpollServer {
+public:
+    EpollServer();
+    ~EpollServer();
+
+    void setThreadCount(int count);
+    // 空闲连接超时（秒），0 表示不回收
+    void setIdleTimeout(int seconds);
+
+    bool listen(quint16 port);
+    // 停止接受新连接，已有连接继续服务直到 close()；用于多进程模式下的排空退出
+    void stopAccepting();
+    void close();
+    QString errorString() const { return m_errorString; }
+
+private:
+    int m_threadCount;
+    int m_idleTimeout = 0;
+    QString m_errorString;
+
+    QThread m_aiThread;
+    AIManager* m_aiManager = nullptr;
+    std::vector<std::unique_ptr<EpollWorker>> m_workers;
+};
+
+#endif // EPOLL_SERVER_H
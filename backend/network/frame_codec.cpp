@@ -0,0 +1,183 @@
+#include "frame_codec.h"
+#include <QDataStream>
+#include <QProcessEnvironment>
+#include <QtEndian>
+#ifdef FTMS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+// 低于阈值的负载压缩收益小于 CPU 开销，直接原样发送
+constexpr int kDefaultCompressThreshold = 1024;
+constexpr int kCompressionLevel = 1;
+// deflateInit 默认参数（windowBits 15、memLevel 8）下的压缩状态：窗口与哈希表各 128KB，另加状态结构约 6KB
+constexpr qint64 kDeflateStateBytes = (1 << (15 + 2)) + (1 << (8 + 9)) + 6 * 1024;
+
+struct CompressionConfig {
+    bool enabled = true;
+    int threshold = kDefaultCompressThreshold;
+};
+
+// FTMS_COMPRESS=0 关闭压缩协商，FTMS_COMPRESS_THRESHOLD 调整阈值（字节）
+const CompressionConfig& compressionConfig() {
+    static const CompressionConfig config = [] {
+        CompressionConfig c;
+        const auto env = QProcessEnvironment::systemEnvironment();
+        c.enabled = env.value("FTMS_COMPRESS", "1").trimmed() != "0";
+        bool ok = false;
+        const int threshold = env.value("FTMS_COMPRESS_THRESHOLD").trimmed().toInt(&ok);
+        if (ok && threshold >= 0) c.threshold = threshold;
+        return c;
+    }();
+    return config;
+}
+}
+
+quint32 serverCapabilities() {
+    return compressionConfig().enabled ? quint32(CapCompressZlib) : 0u;
+}
+
+QByteArray encodeResponseFrame(ResponseStatus status, const QByteArray& data) {
+    QByteArray packet;
+    packet.reserve(sizeof(quint32) * 3 + data.size());
+
+    QDataStream out(&packet, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(0) << status << data;
+
+    // 回填长度前缀
+    qToBigEndian<quint32>(quint32(packet.size() - sizeof(quint32)), packet.data());
+    return packet;
+}
+
+#ifdef FTMS_HAVE_ZLIB
+struct FrameEncoder::ZlibContext {
+    z_stream stream{};
+    bool ready = false;
+};
+#else
+struct FrameEncoder::ZlibContext {};
+#endif
+
+FrameEncoder::FrameEncoder() = default;
+
+FrameEncoder::~FrameEncoder() {
+#ifdef FTMS_HAVE_ZLIB
+    if (m_zlib && m_zlib->ready) {
+        deflateEnd(&m_zlib->stream);
+    }
+#endif
+    delete m_zlib;
+}
+
+QByteArray FrameEncoder::encode(ResponseStatus status, const QByteArray& data) {
+    QByteArray frame = encodeResponseFrame(status, data);
+    if (m_compress && frame.size() - qsizetype(sizeof(quint32)) >= compressionConfig().threshold) {
+        return compressFrame(frame);
+    }
+    return frame;
+}
+
+// 输出与 qCompress 相同的格式：4 字节大端原始长度 + zlib 流，客户端用 qUncompress 解压；
+// 压缩后没有变小则仍发送原始帧
+QByteArray FrameEncoder::compressFrame(const QByteArray& frame) {
+    const char* payload = frame.constData() + sizeof(quint32);
+    const qsizetype payloadSize = frame.size() - sizeof(quint32);
+
+#ifdef FTMS_HAVE_ZLIB
+    if (!m_zlib) {
+        m_zlib = new ZlibContext;
+    }
+    if (!m_zlib->ready) {
+        if (deflateInit(&m_zlib->stream, kCompressionLevel) != Z_OK) return frame;
+        m_zlib->ready = true;
+        m_zlibMemory.resize(kDeflateStateBytes);
+    } else if (deflateReset(&m_zlib->stream) != Z_OK) {
+        return frame;
+    }
+
+    z_stream& zs = m_zlib->stream;
+    const uLong bound = deflateBound(&zs, uLong(payloadSize));
+    const qsizetype headerSize = sizeof(quint32) * 2;
+
+    QByteArray out;
+    out.resize(headerSize + qsizetype(bound));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(payload));
+    zs.avail_in = uInt(payloadSize);
+    zs.next_out = reinterpret_cast<Bytef*>(out.data() + headerSize);
+    zs.avail_out = uInt(bound);
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) return frame;
+
+    const qsizetype compressedSize = headerSize + qsizetype(zs.total_out);
+    if (compressedSize >= frame.size()) return frame;
+    out.resize(compressedSize);
+    qToBigEndian<quint32>(quint32(payloadSize), out.data() + sizeof(quint32));
+#else
+    const QByteArray compressed = qCompress(reinterpret_cast<const uchar*>(payload), payloadSize, kCompressionLevel);
+    if (compressed.isEmpty() || compressed.size() + qsizetype(sizeof(quint32)) >= frame.size()) return frame;
+    QByteArray out;
+    out.resize(sizeof(quint32));
+    out.append(compressed);
+#endif
+
+    qToBigEndian<quint32>(quint32(out.size() - sizeof(quint32)) | kFrameCompressedFlag, out.data());
+    return out;
+}
+
+void FrameReader::append(const QByteArray& bytes) {
+    compact();
+    m_buffer.append(bytes);
+    updateMemory();
+}
+
+void FrameReader::append(const char* bytes, qsizetype size) {
+    compact();
+    m_buffer.append(bytes, size);
+    updateMemory();
+}
+
+bool FrameReader::next(QByteArray& packet) {
+    if (m_failed) return false;
+    if (!m_haveHeader) {
+        if (buffered() < qsizetype(sizeof(quint32))) {
+            return false;
+        }
+        const quint32 header = qFromBigEndian<quint32>(m_buffer.constData() + m_offset);
+        if (header & kFrameCompressedFlag) {
+            m_failed = true;
+            return false;
+        }
+        m_expectedSize = header & kFrameSizeMask;
+        m_offset += sizeof(quint32);
+        m_haveHeader = true;
+    }
+    if (buffered() < qsizetype(m_expectedSize)) {
+        return false;
+    }
+    packet = m_buffer.mid(m_offset, m_expectedSize);
+    m_offset += m_expectedSize;
+    m_haveHeader = false;
+    m_expectedSize = 0;
+    return true;
+}
+
+void FrameReader::clear() {
+    m_buffer.clear();
+    m_offset = 0;
+    m_expectedSize = 0;
+    m_haveHeader = false;
+    m_failed = false;
+    updateMemory();
+}
+
+// 已消费的数据超过一半时才整体前移，摊销为 O(1)
+void FrameReader::compact() {
+    if (m_offset == 0) return;
+    if (m_offset == m_buffer.size()) {
+        m_buffer.clear();
+        m_offset = 0;
+    } else if (m_offset * 2 >= m_buffer.size()) {
+        m_buffer.remove(0, m_offset);
+        m_offset = 0;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <QByteArray>
+#include "data_model.h"
+#include "metrics/memory_accounting.h"
+
+// 帧格式：quint32 大端长度 + 负载。请求负载为 (int 类型, QByteArray 数据)，
+// 应答负载为 (int 状态, QByteArray 数据)，与前端 TcpClient 保持一致。
+// 长度最高位为 kFrameCompressedFlag 时负载为 qCompress 格式，仅用于握手协商后的应答
+
+// 组装一条完整的未压缩应答帧（含长度前缀）
+QByteArray encodeResponseFrame(ResponseStatus status, const QByteArray& data);
+
+// 本服务端支持的连接能力位
+quint32 serverCapabilities();
+
+// 每连接一个的应答编码器：协商开启压缩后，超过阈值的负载按 qCompress 格式压缩。
+// 有系统 zlib 时复用同一个 deflate 上下文（deflateReset），避免每帧重新分配压缩窗口
+class FrameEncoder {
+public:
+    FrameEncoder();
+    ~FrameEncoder();
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    void setCompressionEnabled(bool enabled) { m_compress = enabled; }
+    bool compressionEnabled() const { return m_compress; }
+
+    QByteArray encode(ResponseStatus status, const QByteArray& data);
+
+private:
+    QByteArray compressFrame(const QByteArray& frame);
+
+    bool m_compress = false;
+    struct ZlibContext;
+    ZlibContext* m_zlib = nullptr;
+    MemoryCharge m_zlibMemory{MemoryTag::Connections};
+};
+
+// 增量拆帧：处理 TCP 粘包/拆包，内部用读偏移避免每帧搬移缓冲区。
+// 客户端不发送压缩帧：收到带压缩标志的帧即视为协议错误，不解压（避免解压炸弹），调用方断开连接
+class FrameReader {
+public:
+    void append(const QByteArray& bytes);
+    void append(const char* bytes, qsizetype size);
+
+    // 取出下一帧负载，数据不足或出现协议错误时返回 false
+    bool next(QByteArray& packet);
+    bool failed() const { return m_failed; }
+
+    void clear();
+    qsizetype buffered() const { return m_buffer.size() - m_offset; }
+
+private:
+    void compact();
+    void updateMemory() { m_memory.resize(m_buffer.capacity()); }
+
+    QByteArray m_buffer;
+    qsizetype m_offset = 0;
+    quint32 m_expectedSize = 0;
+    bool m_haveHeader = false;
+    bool m_failed = false;
+    MemoryCharge m_memory{MemoryTag::ReceiveBuffers};
+};
+
+#endif // FRAME_CODEC_H
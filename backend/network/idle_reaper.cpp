@@ -0,0 +1,57 @@
+#include "idle_reaper.h"
+#include <QElapsedTimer>
+#include "client_handler.h"
+#include "log/logger.h"
+
+namespace {
+LogCategory logNet("net");
+}
+
+IdleReaper::IdleReaper(QObject* parent)
+    : QObject(parent), m_wheel(64, nowSecs()) {
+    m_timer.setInterval(1000);
+    connect(&m_timer, &QTimer::timeout, this, &IdleReaper::onTick);
+}
+
+qint64 IdleReaper::nowSecs() {
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.elapsed() / 1000;
+}
+
+void IdleReaper::setIdleTimeout(int seconds) {
+    m_idleTimeout = qMax(0, seconds);
+    if (m_idleTimeout > 0) {
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+}
+
+void IdleReaper::watch(ClientHandler* handler) {
+    if (m_idleTimeout <= 0 || !handler) return;
+    m_wheel.schedule(handler, nowSecs() + m_idleTimeout);
+}
+
+// 到期时按连接真实的最近活跃时间决定续期还是回收，活跃连接只会被惰性地重新挂到后面的槽位
+void IdleReaper::onTick() {
+    const qint64 now = nowSecs();
+    m_wheel.advance(now, [this, now](const QPointer<ClientHandler>& handler) -> qint64 {
+        if (!handler) {
+            return 0;  // 连接已正常结束并析构
+        }
+        const qint64 lastActivity = handler->lastActivity();
+        const qint64 deadline = lastActivity + m_idleTimeout;
+        if (deadline > now) {
+            return deadline;
+        }
+        ++m_reapedCount;
+        logInfo(logNet, "回收空闲连接，描述符：{} 空闲秒数：{} 累计回收：{}", handler->descriptor(),
+                now - lastActivity, m_reapedCount);
+        handler->reap();
+        return 0;
+    });
+}
@@ -0,0 +1,38 @@
+#ifndef IDLE_REAPER_H
+#define IDLE_REAPER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include "timer_wheel.h"
+
+class ClientHandler;
+
+// 空闲连接回收：所有连接共用一个 1 秒定时器驱动的时间轮，
+// 连接线程收到数据时只需原子地更新最近活跃时间，不再每连接一个 QTimer
+class IdleReaper : public QObject {
+    Q_OBJECT
+public:
+    explicit IdleReaper(QObject* parent = nullptr);
+
+    // 空闲超时（秒），0 表示不回收
+    void setIdleTimeout(int seconds);
+    int idleTimeout() const { return m_idleTimeout; }
+
+    void watch(ClientHandler* handler);
+
+    // 进程内单调时钟（秒），连接用它记录最近活跃时间
+    static qint64 nowSecs();
+
+private slots:
+    void onTick();
+
+private:
+    TimerWheel<QPointer<ClientHandler>> m_wheel;
+    QTimer m_timer;
+    int m_idleTimeout = 0;
+    quint64 m_reapedCount = 0;
+};
+
+#endif // IDLE_REAPER_H
@@ -0,0 +1,697 @@
+#include "request_dispatcher.h"
+#include "../ai/ai_manager.h"
+#include "auth/auth_worker_pool.h"
+#include "auth/session_manager.h"
+#include "db/city_dictionary.h"
+#include "db/db_manager.h"
+#include "db/flight_importer.h"
+#include "frame_codec.h"
+#include "traffic_capture.h"
+#include "log/logger.h"
+#include "metrics/memory_accounting.h"
+#include "metrics/metrics.h"
+#include "metrics/tracer.h"
+#include <QDataStream>
+#include <QProcessEnvironment>
+#include <QSet>
+#include <atomic>
+
+namespace {
+LogCategory logNet("net");
+LogCategory logAuth("auth");
+LogCategory logQuery("query");
+LogCategory logBook("book");
+LogCategory logOrders("orders");
+LogCategory logUser("user");
+LogCategory logAdmin("admin");
+
+// 管理员用户名单来自 FTMS_ADMIN_USERS（逗号分隔），启动后不再变化
+bool isAdmin(const QString& username) {
+    static const QSet<QString> admins = []() {
+        QSet<QString> names;
+        const QString value = QProcessEnvironment::systemEnvironment().value("FTMS_ADMIN_USERS");
+        for (const QString& name : value.split(',', Qt::SkipEmptyParts)) {
+            names.insert(name.trimmed());
+        }
+        return names;
+    }();
+    return admins.contains(username);
+}
+
+// 分发层的指标编号，首次使用时注册
+struct DispatchMetrics {
+    int requestDecode;
+    int replyEncode;
+    int frameEncode;
+    int cityHit;
+    int cityMiss;
+    int orderDeltaHit;
+    int orderDeltaMiss;
+};
+
+std::atomic<int> g_aiInFlight{0};
+
+// 一次进行中的 AI 请求，随最后一个持有它的回调销毁而撤销计数：
+// 连接关闭时 AIManager 连同未完成的请求一起删除，回调不会被调用
+class AiInFlight {
+public:
+    AiInFlight() { g_aiInFlight.fetch_add(1, std::memory_order_relaxed); }
+    ~AiInFlight() { g_aiInFlight.fetch_sub(1, std::memory_order_relaxed); }
+    AiInFlight(const AiInFlight&) = delete;
+    AiInFlight& operator=(const AiInFlight&) = delete;
+};
+
+// 查询结果物化后的内存估算：列表存储加各字符串的数据块，在编码完成前记入 db_results
+qint64 stringBytes(const QString& s) { return heapBytes(s); }
+qint64 stringBytes(const Flight& f) {
+    return heapBytes(f.flight_id) + heapBytes(f.departure) + heapBytes(f.destination)
+           + heapBytes(f.departure_airport) + heapBytes(f.arrival_airport);
+}
+qint64 stringBytes(const Order& o) {
+    return heapBytes(o.order_id) + heapBytes(o.username) + heapBytes(o.flight_id) + heapBytes(o.seat_number)
+           + heapBytes(o.departure) + heapBytes(o.destination) + heapBytes(o.departure_airport)
+           + heapBytes(o.arrival_airport);
+}
+
+template <typename T>
+qint64 resultBytes(const QList<T>& rows) {
+    qint64 bytes = qint64(rows.capacity()) * qint64(sizeof(T));
+    for (const T& row : rows) bytes += stringBytes(row);
+    return bytes;
+}
+
+const DispatchMetrics& dispatchMetrics() {
+    static const DispatchMetrics metrics = []() {
+        Metrics* m = Metrics::getInstance();
+        const char* serialization = "请求解码、应答数据编码与组帧（含压缩）的耗时";
+        const char* cache = "缓存命中情况";
+        m->gauge("ftms_queue_depth", "各工作队列中已提交未完成的任务数", "queue=\"ai\"",
+                 []() { return double(g_aiInFlight.load(std::memory_order_relaxed)); });
+        return DispatchMetrics{
+            m->histogram("ftms_serialization_duration_seconds", serialization, "stage=\"request_decode\""),
+            m->histogram("ftms_serialization_duration_seconds", serialization, "stage=\"reply_encode\""),
+            m->histogram("ftms_serialization_duration_seconds", serialization, "stage=\"frame_encode\""),
+            m->counter("ftms_cache_requests_total", cache, "cache=\"city_list\",result=\"hit\""),
+            m->counter("ftms_cache_requests_total", cache, "cache=\"city_list\",result=\"miss\""),
+            m->counter("ftms_cache_requests_total", cache, "cache=\"order_delta\",result=\"hit\""),
+            m->counter("ftms_cache_requests_total", cache, "cache=\"order_delta\",result=\"miss\""),
+        };
+    }();
+    return metrics;
+}
+}
+
+RequestDispatcher::RequestDispatcher(std::shared_ptr<ResponseSink> sink, AIManager* aiManager)
+    : m_sink(std::move(sink)), m_aiManager(aiManager),
+      m_captureId(TrafficCapture::getInstance()->openConnection()) {
+    Metrics::getInstance()->connectionOpened();
+}
+
+RequestDispatcher::~RequestDispatcher() {
+    Metrics::getInstance()->connectionClosed();
+    TrafficCapture::getInstance()->close(m_captureId);
+}
+
+// 解析请求类型并分发
+void RequestDispatcher::processPacket(const QByteArray& packet) {
+    const qint64 start = Metrics::nowMicros();
+    Metrics::getInstance()->addBytes(packet.size() + 4, 0);
+    TrafficCapture::getInstance()->request(m_captureId, packet);
+    const quint64 traceId = Tracer::getInstance()->sample();
+    TraceActivation activation(traceId);
+    TraceSpan root("net", "processPacket");
+
+    int requestType = 0;
+    QByteArray data;
+    {
+        TraceSpan span("net", "decode");
+        QDataStream in(packet);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> requestType >> data;
+    }
+    Metrics::getInstance()->observe(dispatchMetrics().requestDecode, Metrics::nowMicros() - start);
+    m_current = PendingRequest{requestType, start, traceId};
+    root.setArg(requestType);
+
+    TraceSpan handler("handler", Metrics::requestTypeName(requestType));
+
+    switch (requestType) {
+    case LoginRequest:
+        handleLoginRequest(data);
+        break;
+    case FlightQueryRequest:
+        handleFlightQueryRequest(data);
+        break;
+    case BookTicketRequest:
+        handleBookTicketRequest(data);
+        break;
+    case MyOrdersRequest:
+        handleMyOrdersRequest(data);
+        break;
+    case GetUserInfoRequest:
+        handleGetUserInfoRequest(data);
+        break;
+    case UpdateUserInfoRequest:
+        handleUpdateUserInfoRequest(data);
+        break;
+    case CancelTicketRequest:
+        handleCancelTicketRequest(data);
+        break;
+    case RegisterRequest:
+        handleRegisterRequest(data);
+        break;
+    case ChangeTicketRequest:
+        handleChangeTicketRequest(data);
+        break;
+    case CheckUsernameRequest:
+        handleCheckUsernameRequest(data);
+        break;
+    case GetCitiesRequest:
+        handleGetCitiesRequest(data);
+        break;
+    case GetOccupiedSeatsRequest:
+        handleGetOccupiedSeatsRequest(data);
+        break;
+    case AIChatRequest:
+        handleAIChatRequest(data);
+        break;
+    case ChangePasswordRequest:
+        handleChangePasswordRequest(data);
+        break;
+    case HeartbeatRequest:
+        handleHeartbeatRequest(data);
+        break;
+    case HandshakeRequest:
+        handleHandshakeRequest(data);
+        break;
+    case LogoutRequest:
+        handleLogoutRequest(data);
+        break;
+    case ImportFlightsRequest:
+        handleImportFlightsRequest(data);
+        break;
+    default:
+        sendResponse(Failed);
+        logWarning(logNet, "收到未知请求类型：{}", requestType);
+        break;
+    }
+}
+
+void RequestDispatcher::handleLoginRequest(const QByteArray& data) {
+    QDataStream in(data);
+    User user;
+    in >> user;
+
+    // 口令校验放到认证线程池，结果经 sink 投递回 I/O 线程再签发会话
+    std::shared_ptr<ResponseSink> sink = m_sink;
+    const PendingRequest request = m_current;
+    const bool queued = AuthWorkerPool::getInstance()->submit([this, sink, user, request]() {
+        TraceActivation activation(request.traceId);
+        qint64 userId = 0;
+        const ResponseStatus status = DBManager::getInstance()->verifyUser(user.username, user.password, &userId);
+        sink->post([this, status, userId, username = user.username, request]() {
+            TraceActivation activation(request.traceId);
+            m_current = request;
+            finishLogin(status, userId, username);
+        });
+    });
+    if (queued) {
+        m_awaitingReply = true;
+    } else {
+        sendResponse(ServerBusy);
+        logWarning(logAuth, "登录请求 - 用户名：{} 认证队列已满", user.username);
+    }
+}
+
+// 登录成功后签发会话令牌并绑定到本连接，后续请求不再携带用户名
+void RequestDispatcher::finishLogin(ResponseStatus status, qint64 userId, const QString& username) {
+    QByteArray responseData;
+    if (status == Success) {
+        if (m_sessionToken) SessionManager::getInstance()->remove(m_sessionToken);
+        m_sessionToken = SessionManager::getInstance()->create(userId, username);
+        QDataStream out(&responseData, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << m_sessionToken;
+    }
+    sendResponse(status, responseData);
+
+    logInfo(logAuth, "登录请求 - 用户名：{} 验证结果：{}", username, status == Success ? "成功" : "失败");
+}
+
+void RequestDispatcher::handleFlightQueryRequest(const QByteArray& data) {
+    QDataStream in(data);
+    QString departure, destination;
+    QDate date;
+    in >> departure >> destination >> date;
+
+    QList<Flight> flights = DBManager::getInstance()->queryFlights(departure, destination, date);
+    MemoryCharge results(MemoryTag::DbResults, resultBytes(flights), true);
+
+    QByteArray responseData;
+    {
+        ScopedLatency timer(dispatchMetrics().replyEncode);
+        TraceSpan span("net", "replyEncode", flights.size());
+        QDataStream out(&responseData, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << static_cast<quint32>(flights.size());
+        for (const Flight& flight : flights) {
+            out << flight;
+        }
+    }
+
+    ResponseStatus status = flights.isEmpty() ? FlightNotFound : Success;
+    sendResponse(status, responseData);
+
+    logInfo(logQuery, "航班查询请求 - 出发地：{} 目的地：{} 日期：{} 查到航班数：{}", departure, destination, date, flights.size());
+}
+
+void RequestDispatcher::handleBookTicketRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+    const QString& username = session.username;
+
+    QDataStream in(data);
+    QString flight_id, seat_number;
+    in >> flight_id >> seat_number;
+
+    qint64 id = 0;
+    if (seat_number.isEmpty()) {
+        id = DBManager::getInstance()->bookTicket(session.userId, flight_id);
+    } else {
+        id = DBManager::getInstance()->bookTicketWithSeat(session.userId, flight_id, seat_number);
+    }
+    // 订单号对外以十进制字符串表示
+    const QString orderId = id ? QString::number(id) : QString();
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << orderId;
+
+    ResponseStatus status = Success;
+    if (orderId.isEmpty()) {
+        const int restSeats = DBManager::getInstance()->getRestSeats(flight_id);
+        if (restSeats == -1) {
+            status = FlightNotFound;
+        } else if (restSeats == 0) {
+            status = NoSeatsLeft;
+        } else {
+            status = Failed;
+        }
+    }
+
+    sendResponse(status, responseData);
+    logInfo(logBook, "订票请求 - 用户名：{} 航班号：{} 座位：{} 订单号：{}", username, flight_id, seat_number,
+            orderId.isEmpty() ? QStringLiteral("无") : orderId);
+}
+
+// 客户端带已知版本时只回增量；否则按游标返回一页
+void RequestDispatcher::handleMyOrdersRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+    const QString& username = session.username;
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint64 knownVersion = 0;
+    QString cursor;
+    quint32 limit = kOrdersPageSize;
+    if (!data.isEmpty()) {
+        in >> knownVersion >> cursor >> limit;
+    }
+    limit = qBound<quint32>(1, limit, kOrdersMaxPageSize);
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    DBManager::OrderChanges changes;
+    if (knownVersion != 0 && DBManager::getInstance()->queryOrderChanges(session.userId, knownVersion, &changes)) {
+        Metrics::getInstance()->add(dispatchMetrics().orderDeltaHit);
+        MemoryCharge results(MemoryTag::DbResults, resultBytes(changes.upserts) + resultBytes(changes.removed), true);
+        out << quint8(OrdersDelta) << changes.version << changes.removed
+            << static_cast<quint32>(changes.upserts.size());
+        for (const Order& order : changes.upserts) {
+            out << order;
+        }
+        sendResponse(Success, responseData);
+        logInfo(logOrders, "订单增量请求 - 用户名：{} 版本：{}->{} 变更：{}/{}", username, knownVersion, changes.version,
+                changes.upserts.size(), changes.removed.size());
+        return;
+    }
+
+    // 版本已过期（日志被清理）时从头分页
+    if (knownVersion != 0) {
+        Metrics::getInstance()->add(dispatchMetrics().orderDeltaMiss);
+        cursor.clear();
+    }
+    const DBManager::OrderPage page = DBManager::getInstance()->queryUserOrdersPage(session.userId, cursor, int(limit));
+    MemoryCharge results(MemoryTag::DbResults, resultBytes(page.orders), true);
+    out << quint8(OrdersPage) << page.version << page.nextCursor << static_cast<quint32>(page.orders.size());
+    for (const Order& order : page.orders) {
+        out << order;
+    }
+
+    sendResponse(Success, responseData);
+    logInfo(logOrders, "订单查询请求 - 用户名：{} 本页订单数：{}", username, page.orders.size());
+}
+
+void RequestDispatcher::handleGetUserInfoRequest(const QByteArray& /*data*/) {
+    Session session;
+    if (!requireSession(&session)) return;
+    const QString& username = session.username;
+
+    User user = DBManager::getInstance()->getUserInfo(username);
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << user;
+
+    ResponseStatus status = user.username.isEmpty() ? UserNotFound : Success;
+    sendResponse(status, responseData);
+    logInfo(logUser, "用户信息请求 - 用户名：{} 结果：{}", username, status == Success ? "成功" : "失败");
+}
+
+void RequestDispatcher::handleUpdateUserInfoRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+
+    QDataStream in(data);
+    User user;
+    in >> user;
+    user.username = session.username;  // 只能修改自己的资料
+
+    bool success = DBManager::getInstance()->updateUserInfo(user);
+    sendResponse(success ? Success : Failed);
+
+    logInfo(logUser, "更新用户信息请求 - 用户名：{} 结果：{}", user.username, success ? "成功" : "失败");
+}
+
+void RequestDispatcher::handleCancelTicketRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+
+    QDataStream in(data);
+    QString orderId;
+    in >> orderId;
+
+    bool ok = false;
+    const qint64 id = orderId.toLongLong(&ok);
+    bool success = ok && DBManager::getInstance()->cancelTicket(id, session.userId);
+    sendResponse(success ? Success : Failed);
+
+    logInfo(logBook, "取消订单请求 - 订单号：{} 结果：{}", orderId, success ? "成功" : "失败");
+}
+
+void RequestDispatcher::handleRegisterRequest(const QByteArray& data) {
+    QDataStream in(data);
+    User user;
+    in >> user;
+
+    // 注册需要计算口令哈希，同样在认证线程池执行
+    std::shared_ptr<ResponseSink> sink = m_sink;
+    const PendingRequest request = m_current;
+    const bool queued = AuthWorkerPool::getInstance()->submit([this, sink, user, request]() {
+        TraceActivation activation(request.traceId);
+        const bool success = DBManager::getInstance()->registerUser(user);
+        sink->post([this, success, request]() {
+            TraceActivation activation(request.traceId);
+            m_current = request;
+            sendResponse(success ? Success : Failed);
+        });
+        logInfo(logAuth, "注册请求 - 用户名：{} 结果：{}", user.username, success ? "成功" : "失败");
+    });
+    if (queued) {
+        m_awaitingReply = true;
+    } else {
+        sendResponse(ServerBusy);
+    }
+}
+
+void RequestDispatcher::handleChangeTicketRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+
+    QDataStream in(data);
+    QString orderId, newFlightId, seatNumber;
+    in >> orderId >> newFlightId >> seatNumber;
+
+    bool ok = false;
+    const qint64 id = orderId.toLongLong(&ok);
+    bool success = ok && DBManager::getInstance()->changeTicket(id, session.userId, newFlightId, seatNumber);
+    sendResponse(success ? Success : Failed);
+
+    logInfo(logBook, "改签请求 - 订单号：{} 新航班：{} 座位：{} 结果：{}", orderId, newFlightId, seatNumber,
+            success ? "成功" : "失败");
+}
+
+void RequestDispatcher::handleCheckUsernameRequest(const QByteArray& data) {
+    QDataStream in(data);
+    QString username;
+    in >> username;
+
+    bool exist = DBManager::getInstance()->isUserExist(username);
+    sendResponse(exist ? UsernameExist : Success);
+    
+    logInfo(logUser, "检查用户名请求 - 用户名：{} 存在：{}", username, exist);
+}
+
+// 客户端带上已缓存的字典版本号，未变化时只回 NotModified；
+// 否则直接发送按版本预编码好的数据
+void RequestDispatcher::handleGetCitiesRequest(const QByteArray& data) {
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 knownVersion = 0;
+    if (!data.isEmpty()) in >> knownVersion;
+
+    quint32 version = 0;
+    const QByteArray encoded = CityDictionary::getInstance()->encodedFor(&version);
+    if (knownVersion != 0 && knownVersion == version) {
+        Metrics::getInstance()->add(dispatchMetrics().cityHit);
+        sendResponse(NotModified);
+        return;
+    }
+    Metrics::getInstance()->add(dispatchMetrics().cityMiss);
+
+    sendResponse(Success, encoded);
+    logInfo(logQuery, "城市列表请求 - 字典版本：{}", version);
+}
+
+void RequestDispatcher::handleGetOccupiedSeatsRequest(const QByteArray& data) {
+    QDataStream in(data);
+    QString flightId;
+    in >> flightId;
+
+    QStringList seats = DBManager::getInstance()->getOccupiedSeats(flightId);
+    MemoryCharge results(MemoryTag::DbResults, resultBytes(seats), true);
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << seats;
+
+    sendResponse(Success, responseData);
+    logInfo(logQuery, "已占座位请求 - 航班：{} 已占座位数：{}", flightId, seats.size());
+}
+
+void RequestDispatcher::sendResponse(ResponseStatus status, const QByteArray& data) {
+    TraceSpan span("net", "sendResponse", status);
+    Metrics* metrics = Metrics::getInstance();
+    const qint64 encodeStart = Metrics::nowMicros();
+    QByteArray frame;
+    {
+        TraceSpan encode("net", "frameEncode", data.size());
+        frame = m_encoder.encode(status, data);
+    }
+    const qint64 now = Metrics::nowMicros();
+    metrics->observe(dispatchMetrics().frameEncode, now - encodeStart);
+    {
+        TraceSpan write("net", "socketWrite", frame.size());
+        m_sink->write(frame);
+    }
+
+    // 等待中的异步应答即本帧：传输层暂停期间不会分发其他请求
+    m_awaitingReply = false;
+    metrics->addBytes(0, frame.size());
+    TrafficCapture::getInstance()->response(m_captureId, status);
+    if (m_current.startMicros) {
+        metrics->recordRequest(m_current.type, status, now - m_current.startMicros);
+        m_current = PendingRequest();
+    }
+}
+
+
+void RequestDispatcher::handleAIChatRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+
+    QDataStream in(data);
+    QString message;
+    in >> message;
+
+    if (!m_aiManager) {
+        QByteArray responseData;
+        QDataStream out(&responseData, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << QString("出行助手暂不可用");
+        sendResponse(Failed, responseData);
+        return;
+    }
+
+    QString context = "";
+
+    // AI 回复可能在其他线程完成，经 sink 投递回本连接的 I/O 线程再写出；
+    // 连接关闭后投递被丢弃，因此回调里可以安全地使用 this
+    std::shared_ptr<ResponseSink> sink = m_sink;
+    AIManager* aiManager = m_aiManager;
+    const PendingRequest request = m_current;
+    auto inFlight = std::make_shared<AiInFlight>();
+    QMetaObject::invokeMethod(aiManager, [this, sink, aiManager, message, context, request, inFlight]() {
+        aiManager->sendMessage(message, context, [this, sink, request, inFlight](bool success, const QString& text) {
+            sink->post([this, success, text, request]() {
+                TraceActivation activation(request.traceId);
+                m_current = request;
+                QByteArray responseData;
+                QDataStream out(&responseData, QIODevice::WriteOnly);
+                out.setVersion(QDataStream::Qt_6_0);
+                out << text;
+                sendResponse(success ? Success : Failed, responseData);
+            });
+        });
+    });
+    m_awaitingReply = true;
+}
+
+void RequestDispatcher::handleChangePasswordRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+    const QString& username = session.username;
+
+    QDataStream in(data);
+    QString oldPass, newPass;
+    in >> oldPass >> newPass;
+
+    std::shared_ptr<ResponseSink> sink = m_sink;
+    const qint64 userId = session.userId;
+    const PendingRequest request = m_current;
+    const bool queued = AuthWorkerPool::getInstance()->submit([this, sink, userId, username, oldPass, newPass, request]() {
+        TraceActivation activation(request.traceId);
+        const bool success = DBManager::getInstance()->changePassword(username, oldPass, newPass);
+        if (success) {
+            // 改密后该用户所有会话失效，其他设备需重新登录
+            SessionManager::getInstance()->removeUser(userId);
+        }
+        sink->post([this, success, request]() {
+            TraceActivation activation(request.traceId);
+            m_current = request;
+            if (success) m_sessionToken = 0;
+            sendResponse(success ? Success : Failed);
+        });
+        logInfo(logAuth, "修改密码请求 - 用户名：{} 结果：{}", username, success ? "成功" : "失败");
+    });
+    if (queued) {
+        m_awaitingReply = true;
+    } else {
+        sendResponse(ServerBusy);
+    }
+}
+
+// 活跃时间由传输层在收到数据时刷新，心跳只需应答，不记日志
+void RequestDispatcher::handleHeartbeatRequest(const QByteArray& /*data*/) {
+    sendResponse(HeartbeatAck);
+}
+
+// 客户端声明可解码的能力，回复双方都支持的子集；握手应答本身总是不压缩。
+// 断线重连的客户端会附带上次的会话令牌，有效则直接绑定到新连接，省去重新登录
+void RequestDispatcher::handleHandshakeRequest(const QByteArray& data) {
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 clientCaps = 0;
+    quint64 token = 0;
+    in >> clientCaps;
+    if (!in.atEnd()) {
+        in >> token;
+    }
+
+    const quint32 negotiated = clientCaps & serverCapabilities();
+    const bool resumed = SessionManager::getInstance()->resolve(token, nullptr);
+    if (resumed) {
+        m_sessionToken = token;
+    }
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << negotiated << resumed;
+    sendResponse(HandshakeAck, responseData);
+
+    m_encoder.setCompressionEnabled(negotiated & CapCompressZlib);
+    logInfo(logNet, "连接握手 - 客户端能力：{} 协商结果：{} 会话恢复：{}", clientCaps, negotiated, resumed);
+}
+
+void RequestDispatcher::handleLogoutRequest(const QByteArray& /*data*/) {
+    if (m_sessionToken) {
+        SessionManager::getInstance()->remove(m_sessionToken);
+        m_sessionToken = 0;
+    }
+    sendResponse(Success);
+}
+
+// 管理员批量导入：整批在一个事务内写入，航班号已存在的跳过
+void RequestDispatcher::handleImportFlightsRequest(const QByteArray& data) {
+    Session session;
+    if (!requireSession(&session)) return;
+    if (!isAdmin(session.username)) {
+        sendResponse(PermissionDenied);
+        logWarning(logAdmin, "批量导入请求 - 用户：{} 无管理员权限", session.username);
+        return;
+    }
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 count = 0;
+    in >> count;
+    if (count > kImportMaxBatch) {
+        sendResponse(Failed);
+        logWarning(logAdmin, "批量导入请求 - 条数 {} 超过上限 {}", count, kImportMaxBatch);
+        return;
+    }
+    QList<Flight> flights;
+    flights.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Flight flight;
+        in >> flight;
+        flights.append(flight);
+    }
+    if (in.status() != QDataStream::Ok) {
+        sendResponse(Failed);
+        return;
+    }
+
+    ImportStats stats;
+    if (!DBManager::getInstance()->importFlights(flights, &stats)) {
+        sendResponse(Failed);
+        logWarning(logAdmin, "批量导入请求 - 用户：{} 写入失败", session.username);
+        return;
+    }
+
+    QByteArray responseData;
+    QDataStream out(&responseData, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << static_cast<quint32>(stats.inserted) << static_cast<quint32>(stats.skipped);
+    sendResponse(Success, responseData);
+
+    logInfo(logAdmin, "批量导入请求 - 用户：{} 写入：{} 跳过：{} 耗时：{}ms", session.username, stats.inserted,
+            stats.skipped, stats.elapsedMs);
+}
+
+// 按本连接绑定的令牌取会话（O(1)，不查库）；未登录或已过期时直接回复 NotLoggedIn
+bool RequestDispatcher::requireSession(Session* session) {
+    if (SessionManager::getInstance()->resolve(m_sessionToken, session)) {
+        return true;
+    }
+    m_sessionToken = 0;
+    sendResponse(NotLoggedIn);
+    return false;
+}
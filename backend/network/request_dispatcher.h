@@ -0,0 +1,87 @@
+#ifndef REQUEST_DISPATCHER_H
+#define REQUEST_DISPATCHER_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include <memory>
+
+#include "data_model.h"
+#include "frame_codec.h"
+
+class AIManager;
+struct Session;
+
+// 连接的应答出口，由传输层（Qt 线程模型或 epoll 后端）实现
+class ResponseSink {
+public:
+    virtual ~ResponseSink() = default;
+
+    // 在连接所属 I/O 线程内写出一帧完整数据
+    virtual void write(const QByteArray& frame) = 0;
+
+    // 可在任意线程调用：把任务投递回连接所属 I/O 线程执行，连接已关闭时丢弃
+    virtual void post(std::function<void()> task) = 0;
+};
+
+// 与传输层无关的请求解析与分发，每个连接一个实例，只在 I/O 线程内使用
+class RequestDispatcher {
+public:
+    // aiManager 需驻留在有事件循环的线程中，可与连接不在同一线程
+    RequestDispatcher(std::shared_ptr<ResponseSink> sink, AIManager* aiManager);
+    ~RequestDispatcher();
+
+    // 解析请求类型并分发，packet 为去掉长度前缀后的帧负载
+    void processPacket(const QByteArray& packet);
+
+    // 已转交其他线程生成、尚未写出应答的请求存在时为 true。帧不带请求号，客户端按发送顺序解码应答，
+    // 传输层在此期间暂停读取与分发该连接的后续请求，应答写出后（投递的任务执行完）再继续
+    bool awaitingReply() const { return m_awaitingReply; }
+
+private:
+    void handleLoginRequest(const QByteArray& data);
+    void handleFlightQueryRequest(const QByteArray& data);
+    void handleBookTicketRequest(const QByteArray& data);
+    void handleMyOrdersRequest(const QByteArray& data);
+    void handleGetUserInfoRequest(const QByteArray& data);
+    void handleUpdateUserInfoRequest(const QByteArray& data);
+    void handleCancelTicketRequest(const QByteArray& data);
+    void handleRegisterRequest(const QByteArray& data);
+    void handleChangeTicketRequest(const QByteArray& data);
+    void handleCheckUsernameRequest(const QByteArray& data);
+    void handleGetCitiesRequest(const QByteArray& data);
+    void handleGetOccupiedSeatsRequest(const QByteArray& data);
+    void handleAIChatRequest(const QByteArray& data);
+    void handleChangePasswordRequest(const QByteArray& data);
+    void handleHeartbeatRequest(const QByteArray& data);
+    void handleHandshakeRequest(const QByteArray& data);
+    void handleLogoutRequest(const QByteArray& data);
+    void handleImportFlightsRequest(const QByteArray& data);
+
+    void finishLogin(ResponseStatus status, qint64 userId, const QString& username);
+    bool requireSession(Session* session);
+
+    void sendResponse(ResponseStatus status, const QByteArray& data = QByteArray());
+
+    // 正在处理的请求（类型、收到时刻与追踪号），写出应答时记入指标后清空；异步应答在回调里先恢复再发送
+    struct PendingRequest {
+        int type = 0;
+        qint64 startMicros = 0;
+        quint64 traceId = 0;        // 被追踪抽中时非 0，异步继续处理的线程据此激活追踪
+    };
+
+    std::shared_ptr<ResponseSink> m_sink;
+    AIManager* m_aiManager;
+    // 本连接的应答编码（含协商后的压缩上下文），只在 I/O 线程使用
+    FrameEncoder m_encoder;
+    // 登录或会话恢复后绑定的令牌，0 表示未登录
+    quint64 m_sessionToken = 0;
+    PendingRequest m_current;
+    bool m_awaitingReply = false;
+    // 流量抓取中的连接号，未开启抓取时为 0
+    quint32 m_captureId = 0;
+    // 每个分发器对应一个连接，connections 子系统的对象数即当前连接数
+    MemoryCharge m_memory{MemoryTag::Connections, sizeof(RequestDispatcher), true};
+};
+
+#endif // REQUEST_DISPATCHER_H
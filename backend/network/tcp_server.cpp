@@ -1,13 +1,59 @@
 #include "tcp_server.h"
-#include <QDebug>
 #include "client_handler.h"
+#include "idle_reaper.h"
+#include "log/logger.h"
+#ifdef FTMS_MULTIPROCESS
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+LogCategory logNet("net");
+}
 
 TcpServer::TcpServer(QObject* parent)
-	: QTcpServer(parent) {}
+	: QTcpServer(parent), m_reaper(new IdleReaper(this)) {}
+
+void TcpServer::setIdleTimeout(int seconds) {
+	m_reaper->setIdleTimeout(seconds);
+}
 
 void TcpServer::incomingConnection(qintptr socketDescriptor) {
-	qDebug() << "新的客户端连接，描述符：" << socketDescriptor;
+	logInfo(logNet, "新的客户端连接，描述符：{}", socketDescriptor);
 	auto* handler = new ClientHandler(socketDescriptor, this);
-	connect(handler, &ClientHandler::finished, handler, &ClientHandler::deleteLater);
+	connect(handler, &QThread::finished, handler, &QObject::deleteLater);
+	m_reaper->watch(handler);
 	handler->start();
 }
+
+#ifdef FTMS_MULTIPROCESS
+bool TcpServer::listenReusePort(quint16 port, QString* error) {
+	const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		*error = QString("socket 失败：%1").arg(QString::fromLocal8Bit(strerror(errno)));
+		return false;
+	}
+	int one = 1;
+	::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0
+		|| ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+		|| ::listen(fd, SOMAXCONN) < 0) {
+		*error = QString("监听端口 %1 失败：%2").arg(port).arg(QString::fromLocal8Bit(strerror(errno)));
+		::close(fd);
+		return false;
+	}
+	if (!setSocketDescriptor(fd)) {
+		*error = errorString();
+		::close(fd);
+		return false;
+	}
+	return true;
+}
+#endif
@@ -3,13 +3,26 @@
 
 #include <QTcpServer>
 
+class IdleReaper;
+
 class TcpServer : public QTcpServer {
     Q_OBJECT
 public:
     explicit TcpServer(QObject* parent = nullptr);
 
+    // 空闲连接超时（秒），0 表示不回收
+    void setIdleTimeout(int seconds);
+
+#ifdef FTMS_MULTIPROCESS
+    // 以 SO_REUSEPORT 监听所有地址，多个工作进程共享同一端口，由内核分发新连接
+    bool listenReusePort(quint16 port, QString* error);
+#endif
+
 protected:
     void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    IdleReaper* m_reaper;
 };
 
 #endif // TCP_SERVER_H
@@ -0,0 +1,69 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// 哈希时间轮：槽位按 tick 取模，条目记录绝对到期 tick，
+// 未到期（超过一圈）的条目在轮转时原地保留。非线程安全，由单一线程驱动。
+template <typename T>
+class TimerWheel {
+public:
+    explicit TimerWheel(int slotCount = 64, qint64 startTick = 0)
+        : m_slots(slotCount), m_tick(startTick) {}
+
+    qint64 currentTick() const { return m_tick; }
+    int size() const { return m_count; }
+
+    void schedule(const T& item, qint64 deadlineTick) {
+        if (deadlineTick <= m_tick) {
+            deadlineTick = m_tick + 1;
+        }
+        m_slots[deadlineTick % m_slots.size()].append({item, deadlineTick});
+        ++m_count;
+    }
+
+    // 推进到 nowTick，对每个到期条目调用 onExpire(item)：
+    // 返回值大于当前 tick 表示续期到该 tick，否则移除
+    template <typename Fn>
+    void advance(qint64 nowTick, Fn onExpire) {
+        while (m_tick < nowTick) {
+            ++m_tick;
+            QVector<Entry>& slot = m_slots[m_tick % m_slots.size()];
+            if (slot.isEmpty()) {
+                continue;
+            }
+
+            QVector<Entry> due;
+            for (int i = 0; i < slot.size();) {
+                if (slot[i].deadline <= m_tick) {
+                    due.append(slot[i]);
+                    slot[i] = slot.last();
+                    slot.removeLast();
+                } else {
+                    ++i;
+                }
+            }
+            m_count -= due.size();
+
+            for (const Entry& entry : due) {
+                const qint64 next = onExpire(entry.item);
+                if (next > m_tick) {
+                    schedule(entry.item, next);
+                }
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        T item;
+        qint64 deadline;
+    };
+
+    QVector<QVector<Entry>> m_slots;
+    qint64 m_tick;
+    int m_count = 0;
+};
+
+#endif // TIMER_WHEEL_H
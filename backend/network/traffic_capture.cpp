@@ -0,0 +1,184 @@
+#include "traffic_capture.h"
+#include "log/logger.h"
+#include "metrics/metrics.h"
+#include <QDateTime>
+#include <QProcessEnvironment>
+#include <QtEndian>
+#include <chrono>
+
+TrafficCapture* TrafficCapture::m_instance = nullptr;
+
+namespace {
+LogCategory logCapture("capture");
+
+// 缓冲区超过该大小时提前唤醒写盘线程，否则每 100ms 写一次
+constexpr qsizetype kFlushBytes = 256 * 1024;
+constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+qint64 envMegabytes(const QProcessEnvironment& env, const char* name, qint64 fallback) {
+    bool ok = false;
+    const qint64 value = env.value(name).trimmed().toLongLong(&ok);
+    return (ok && value > 0 ? value : fallback) * 1024 * 1024;
+}
+}
+
+TrafficCapture* TrafficCapture::getInstance() {
+    if (!m_instance) {
+        m_instance = new TrafficCapture();
+    }
+    return m_instance;
+}
+
+void TrafficCapture::appendVarint(QByteArray& out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool TrafficCapture::start() {
+    if (m_enabled.load()) return true;
+    const auto env = QProcessEnvironment::systemEnvironment();
+    m_path = env.value("FTMS_CAPTURE_FILE").trimmed();
+    if (m_path.isEmpty()) return false;
+
+    m_rotateBytes = envMegabytes(env, "FTMS_CAPTURE_ROTATE_MB", 256);
+    m_maxPending = envMegabytes(env, "FTMS_CAPTURE_BUFFER_MB", 32);
+    bool ok = false;
+    m_keepFiles = env.value("FTMS_CAPTURE_KEEP").trimmed().toInt(&ok);
+    if (!ok || m_keepFiles < 0) m_keepFiles = 8;
+
+    m_startEpochMicros = QDateTime::currentMSecsSinceEpoch() * 1000;
+    m_lastMicros = 0;
+    m_stopping = false;
+    if (!openFile(0)) {
+        logWarning(logCapture, "无法打开抓取文件 {}：{}", m_path, m_file.errorString());
+        return false;
+    }
+    m_pending.reserve(kFlushBytes * 2);
+    m_startMicros = Metrics::nowMicros();
+    m_thread = std::thread([this]() { run(); });
+    m_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void TrafficCapture::stop() {
+    // 写盘线程可能已因轮转失败自行停止抓取，仍需回收
+    m_enabled.store(false);
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    m_file.close();
+}
+
+quint32 TrafficCapture::openConnection() {
+    if (!enabled()) return 0;
+    return m_nextConnection.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void TrafficCapture::request(quint32 connection, const QByteArray& payload) {
+    if (connection) append(Request, connection, quint64(payload.size()), payload);
+}
+
+void TrafficCapture::response(quint32 connection, qint32 status) {
+    if (connection) append(Response, connection, quint32(status), QByteArray());
+}
+
+void TrafficCapture::close(quint32 connection) {
+    if (connection) append(Close, connection, 0, QByteArray());
+}
+
+void TrafficCapture::append(RecordKind kind, quint32 connection, quint64 value, const QByteArray& payload) {
+    if (!enabled()) return;
+    bool wake = false;
+    {
+        std::lock_guard<ProfiledMutex> lock(m_mutex);
+        if (m_pending.size() + payload.size() > m_maxPending) {
+            ++m_dropped;
+            return;
+        }
+        // 时间戳在锁内取，保证文件中记录的时刻单调不减
+        const qint64 now = Metrics::nowMicros() - m_startMicros;
+        m_pending.append(char(kind));
+        appendVarint(m_pending, connection);
+        appendVarint(m_pending, quint64(qMax<qint64>(0, now - m_lastMicros)));
+        m_lastMicros = qMax(m_lastMicros, now);
+        if (kind != Close) appendVarint(m_pending, value);
+        if (kind == Request) m_pending.append(payload);
+        wake = m_pending.size() >= kFlushBytes;
+    }
+    if (wake) m_wake.notify_one();
+}
+
+bool TrafficCapture::openFile(qint64 baseMicros) {
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    m_file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    QByteArray header(kMagic, 8);
+    char number[8];
+    qToLittleEndian<qint64>(m_startEpochMicros, number);
+    header.append(number, 8);
+    qToLittleEndian<qint64>(baseMicros, number);
+    header.append(number, 8);
+    m_file.write(header);
+    m_written = header.size();
+    return true;
+}
+
+// 当前文件改名为 .1，已有的依次后移，超出保留数的删除
+void TrafficCapture::rotate() {
+    m_file.close();
+    if (m_keepFiles == 0) {
+        QFile::remove(m_path);
+        return;
+    }
+    QFile::remove(QString("%1.%2").arg(m_path).arg(m_keepFiles));
+    for (int i = m_keepFiles - 1; i >= 1; --i) {
+        QFile::rename(QString("%1.%2").arg(m_path).arg(i), QString("%1.%2").arg(m_path).arg(i + 1));
+    }
+    QFile::rename(m_path, m_path + ".1");
+}
+
+void TrafficCapture::run() {
+    // 换出的每块数据都以上一块最后一条记录的时刻为基准，轮转只发生在块边界上，新文件头记下该基准
+    qint64 chunkBase = 0;
+    QByteArray chunk;
+    for (;;) {
+        bool stopping = false;
+        quint64 dropped = 0;
+        qint64 chunkEnd = 0;
+        {
+            std::unique_lock<ProfiledMutex> lock(m_mutex);
+            m_wake.wait_for(lock, kFlushInterval, [this]() { return m_stopping || m_pending.size() >= kFlushBytes; });
+            chunk.swap(m_pending);
+            chunkEnd = m_lastMicros;
+            dropped = m_dropped;
+            m_dropped = 0;
+            stopping = m_stopping;
+        }
+
+        if (!chunk.isEmpty()) {
+            if (m_written + chunk.size() > m_rotateBytes && m_written > kHeaderBytes) {
+                rotate();
+                if (!openFile(chunkBase)) {
+                    logWarning(logCapture, "轮转后无法打开抓取文件 {}，停止抓取", m_path);
+                    m_enabled.store(false, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            m_file.write(chunk);
+            m_file.flush();
+            m_written += chunk.size();
+            chunk.clear();
+        }
+        chunkBase = chunkEnd;
+        if (dropped) logWarning(logCapture, "抓取缓冲区已满，丢弃 {} 条记录", dropped);
+        if (stopping) break;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef TRAFFIC_CAPTURE_H
+#define TRAFFIC_CAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "metrics/profiled_mutex.h"
+
+// 流量抓取：FTMS_CAPTURE_FILE 非空时，把每个连接收到的请求帧负载（解压后）、写出的应答状态与连接关闭
+// 依次追加到紧凑的二进制抓取文件，供 ftms_replay 按原节奏或加速重放并比对应答状态。
+// 请求线程只在短暂持锁时把记录编码进内存缓冲区；后台线程定期换出缓冲区整块写盘，
+// 文件超过 FTMS_CAPTURE_ROTATE_MB（默认 256）后轮转为 <文件>.1 … <文件>.N（FTMS_CAPTURE_KEEP，默认 8）。
+// 待写数据超过 FTMS_CAPTURE_BUFFER_MB（默认 32）时丢弃新记录并计数，不阻塞请求线程。
+// 抓取文件含登录口令等原始请求，仅属主可读写
+//
+// 文件格式（小端）：
+//   文件头  "FTMSCAP1" | qint64 抓取开始时刻（Unix 微秒） | qint64 本文件时间基准（相对开始时刻，微秒）
+//   记录    quint8 类型 | varint 连接号 | varint 距上一条记录的微秒数 | 类型相关数据
+//     Request  varint 长度 + 请求帧负载（不含长度前缀）
+//     Response varint 应答状态
+//     Close    无
+// 同一连接的应答按写出顺序记录，重放时与请求按先后一一对应
+class TrafficCapture {
+public:
+    enum RecordKind : quint8 { Request = 1, Response = 2, Close = 3 };
+
+    static constexpr char kMagic[9] = "FTMSCAP1";
+    static constexpr int kHeaderBytes = 24;
+
+    static TrafficCapture* getInstance();
+
+    // 读取环境变量，配置了抓取文件时打开文件并启动写盘线程；返回是否已开启
+    bool start();
+    // 写出缓冲区中剩余的记录并关闭文件
+    void stop();
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // 为新连接分配连接号，未开启时返回 0，之后的记录调用均忽略连接号 0
+    quint32 openConnection();
+    void request(quint32 connection, const QByteArray& payload);
+    void response(quint32 connection, qint32 status);
+    void close(quint32 connection);
+
+    static void appendVarint(QByteArray& out, quint64 value);
+
+private:
+    TrafficCapture() = default;
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    void append(RecordKind kind, quint32 connection, quint64 value, const QByteArray& payload);
+    void run();
+    bool openFile(qint64 baseMicros);
+    void rotate();
+
+    QString m_path;
+    qint64 m_rotateBytes = 0;
+    int m_keepFiles = 0;
+    qint64 m_maxPending = 0;
+    qint64 m_startEpochMicros = 0;
+    qint64 m_startMicros = 0;           // 抓取开始时的单调时钟，记录时刻均相对于它
+
+    std::atomic<bool> m_enabled{false};
+    std::atomic<quint32> m_nextConnection{0};
+
+    ProfiledMutex m_mutex{"traffic_capture"};     // 保护以下缓冲区状态，只在编码一条记录期间持有
+    std::condition_variable_any m_wake;
+    QByteArray m_pending;
+    qint64 m_lastMicros = 0;            // 最后一条已编码记录的时刻（相对开始时刻）
+    quint64 m_dropped = 0;
+    bool m_stopping = false;
+
+    // 以下只在写盘线程使用
+    std::thread m_thread;
+    QFile m_file;
+    qint64 m_written = 0;
+
+    static TrafficCapture* m_instance;
+};
+
+#endif // TRAFFIC_CAPTURE_H
@@ -21,7 +21,11 @@ enum RequestType {
     GetCitiesRequest,       // 获取城市列表请求
     GetOccupiedSeatsRequest,// 获取已占座位请求
     AIChatRequest,          // AI对话请求
-    ChangePasswordRequest   // 修改密码请求
+    ChangePasswordRequest,  // 修改密码请求
+    HeartbeatRequest,       // 心跳请求
+    HandshakeRequest,       // 连接握手（能力协商、会话恢复）请求
+    LogoutRequest,          // 退出登录请求
+    ImportFlightsRequest    // 管理员批量导入航班请求
 };
 
 // 响应结果
@@ -33,9 +37,42 @@ enum ResponseStatus {
     FlightNotFound,         // 航班不存在
     NoSeatsLeft,            // 无剩余座位
     UsernameExist,          // 用户名已存在
-    RouteNotMatch           // 航线不匹配（改签时出发地/目的地不一致）
+    RouteNotMatch,          // 航线不匹配（改签时出发地/目的地不一致）
+    HeartbeatAck,           // 心跳应答（不对应任何业务请求）
+    HandshakeAck,           // 握手应答，数据为协商后的能力位与会话是否恢复
+    NotLoggedIn,            // 未登录或会话已过期
+    ServerBusy,             // 服务端繁忙（认证队列已满），稍后重试
+    NotModified,            // 客户端缓存的数据仍是最新版本
+    PermissionDenied        // 当前用户无权执行该操作
 };
 
+// 心跳间隔与服务端默认空闲超时（秒），心跳间隔需明显小于空闲超时
+constexpr int kHeartbeatIntervalSecs = 30;
+constexpr int kDefaultIdleTimeoutSecs = 90;
+
+// 连接能力位，客户端连接后通过 HandshakeRequest 声明，服务端回复双方都支持的子集
+enum ConnectionCapability : quint32 {
+    CapCompressZlib = 0x1   // 可解码 qCompress 格式的压缩帧
+};
+
+// 订单查询（MyOrdersRequest）请求为 (quint64 已知版本, QString 分页游标, quint32 每页条数)。
+// 已知版本非 0 时返回增量：(Delta, 新版本, QStringList 删除的订单号, quint32 n, n 个 Order)；
+// 否则或变更日志已清理时返回一页：(Page, 版本, QString 下一页游标, quint32 n, n 个 Order)，游标为空表示最后一页
+enum OrdersReplyKind : quint8 {
+    OrdersPage = 0,
+    OrdersDelta = 1
+};
+constexpr quint32 kOrdersPageSize = 50;
+constexpr quint32 kOrdersMaxPageSize = 200;
+
+// 批量导入航班（ImportFlightsRequest）请求为 (quint32 n, n 个 Flight)，仅 FTMS_ADMIN_USERS 中的用户可用；
+// 成功返回 (quint32 写入条数, quint32 航班号已存在而跳过的条数)
+constexpr quint32 kImportMaxBatch = 10000;
+
+// 帧长度前缀的最高位表示负载经过压缩（qCompress 格式），其余 31 位为负载长度
+constexpr quint32 kFrameCompressedFlag = 0x80000000u;
+constexpr quint32 kFrameSizeMask = 0x7FFFFFFFu;
+
 // 用户结构体
 struct User {
     QString username;       // 用户名
@@ -60,8 +97,8 @@ struct Flight {
     QString destination;    // 目的地
     QString departure_airport; // 出发机场
     QString arrival_airport;   // 到达机场
-    QDateTime depart_time;  // 出发时间
-    QDateTime arrive_time;  // 到达时间
+    qint64 depart_time = 0; // 出发时间（Unix 秒），仅在界面显示时转换为 QDateTime
+    qint64 arrive_time = 0; // 到达时间（Unix 秒）
     double price;           // 票价
     int rest_seats;         // 剩余座位
 
@@ -85,7 +122,7 @@ struct Order {
     QString order_id;       // 订单号
     QString username;       // 用户名
     QString flight_id;      // 关联航班号
-    QDateTime book_time;    // 订票时间
+    qint64 book_time = 0;   // 订票时间（Unix 秒）
     QString seat_number;    // 座位号
     
     // 行程信息
@@ -93,8 +130,8 @@ struct Order {
     QString destination;
     QString departure_airport;
     QString arrival_airport;
-    QDateTime depart_time;
-    QDateTime arrive_time;
+    qint64 depart_time = 0;
+    qint64 arrive_time = 0;
 
     friend QDataStream& operator<<(QDataStream& out, const Order& order) {
         out << order.order_id << order.username << order.flight_id << order.book_time << order.seat_number
@@ -1,5 +1,8 @@
 #include "tcp_client.h"
 #include <QDataStream>
+#include <QSet>
+#include <algorithm>
+#include <utility>
 
 TcpClient* TcpClient::m_instance = nullptr;
 
@@ -15,13 +18,28 @@ TcpClient::TcpClient(QObject *parent) : QObject(parent)
 {
     m_socket = new QTcpSocket(this);
     connect(m_socket, &QTcpSocket::readyRead, this, &TcpClient::onReadyRead);
+
+    // 空闲时定期发送心跳，避免被服务端按空闲超时回收
+    m_heartbeatTimer = new QTimer(this);
+    m_heartbeatTimer->setInterval(kHeartbeatIntervalSecs * 1000);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &TcpClient::sendHeartbeat);
+    connect(m_socket, &QTcpSocket::connected, m_heartbeatTimer, qOverload<>(&QTimer::start));
+    connect(m_socket, &QTcpSocket::disconnected, m_heartbeatTimer, &QTimer::stop);
+
+    // 连接建立后先声明可解码的能力（压缩帧），服务端据此决定是否压缩大应答
+    connect(m_socket, &QTcpSocket::connected, this, &TcpClient::sendHandshake);
+    connect(m_socket, &QTcpSocket::disconnected, this, &TcpClient::onDisconnected);
 }
 
 void TcpClient::connectToServer(const QString& ip, int port)
 {
+    m_host = ip;
+    m_port = port;
     m_socket->connectToHost(ip, port);
     m_recvBuffer.clear();
     m_expectedSize = 0;
+    m_expectedCompressed = false;
+    m_capabilities = 0;
 }
 
 static void sendPacket(QTcpSocket* socket, const QByteArray& payload)
@@ -35,6 +53,27 @@ static void sendPacket(QTcpSocket* socket, const QByteArray& payload)
     socket->flush();
 }
 
+// 订单分页链进行中时其他请求先暂存，链结束后依次发出：应答按 m_lastRequestType 解码，
+// 链中途插入的请求会与后续分页的应答互相错位
+void TcpClient::sendRequest(int type, const QByteArray& payload)
+{
+    if (m_ordersPending && type != MyOrdersRequest) {
+        m_heldRequests.append(qMakePair(type, payload));
+        return;
+    }
+    m_lastRequestType = type;
+    sendPacket(m_socket, payload);
+}
+
+void TcpClient::finishOrdersChain()
+{
+    m_ordersPending = false;
+    const QList<QPair<int, QByteArray>> held = std::exchange(m_heldRequests, {});
+    for (const auto& request : held) {
+        sendRequest(request.first, request.second);
+    }
+}
+
 void TcpClient::login(const QString& username, const QString& password)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
@@ -48,14 +87,13 @@ void TcpClient::login(const QString& username, const QString& password)
     user.password = password;
     
     out << (int)LoginRequest;
-    m_lastRequestType = LoginRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << user;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(LoginRequest, payload);
 }
 
 void TcpClient::registerUser(const User& user)
@@ -67,14 +105,13 @@ void TcpClient::registerUser(const User& user)
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)RegisterRequest;
-    m_lastRequestType = RegisterRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << user;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(RegisterRequest, payload);
 }
 
 void TcpClient::queryFlights(const QString& departure, const QString& destination, const QDate& date)
@@ -86,17 +123,16 @@ void TcpClient::queryFlights(const QString& departure, const QString& destinatio
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)FlightQueryRequest;
-    m_lastRequestType = FlightQueryRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << departure << destination << date;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(FlightQueryRequest, payload);
 }
 
-void TcpClient::bookTicket(const QString& username, const QString& flightId, const QString& seatNumber)
+void TcpClient::bookTicket(const QString& flightId, const QString& seatNumber)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
 
@@ -105,36 +141,107 @@ void TcpClient::bookTicket(const QString& username, const QString& flightId, con
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)BookTicketRequest;
-    m_lastRequestType = BookTicketRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
-    requestOut << username << flightId << seatNumber;
+    requestOut << flightId << seatNumber;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(BookTicketRequest, payload);
 }
 
-void TcpClient::queryOrders(const QString& username)
+// 已有完整缓存时只请求增量，否则从第一页开始分页拉取
+void TcpClient::queryOrders()
 {
-    if (m_socket->state() != QAbstractSocket::ConnectedState) return;
+    // 分页链尚未结束时，链完成后的结果已包含最新数据
+    if (m_ordersPending) return;
+    requestOrders(m_ordersVersion, QString());
+}
+
+void TcpClient::requestOrders(quint64 knownVersion, const QString& cursor)
+{
+    if (m_socket->state() != QAbstractSocket::ConnectedState) {
+        finishOrdersChain();
+        return;
+    }
+    m_ordersCursor = cursor;
 
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)MyOrdersRequest;
-    m_lastRequestType = MyOrdersRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
-    requestOut << username;
+    requestOut << knownVersion << cursor << kOrdersPageSize;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(MyOrdersRequest, payload);
+    m_ordersPending = true;
 }
 
-void TcpClient::getUserInfo(const QString& username)
+void TcpClient::processOrdersReply(QDataStream& dataIn)
+{
+    quint8 kind = OrdersPage;
+    quint64 version = 0;
+    dataIn >> kind >> version;
+
+    if (kind == OrdersDelta) {
+        QStringList removed;
+        quint32 count = 0;
+        dataIn >> removed >> count;
+        QSet<QString> changed(removed.begin(), removed.end());
+        QList<Order> upserts;
+        for (quint32 i = 0; i < count; ++i) {
+            Order o;
+            dataIn >> o;
+            changed.insert(o.order_id);
+            upserts.append(o);
+        }
+        m_orders.removeIf([&changed](const Order& o) { return changed.contains(o.order_id); });
+        m_orders.append(upserts);
+        std::sort(m_orders.begin(), m_orders.end(), [](const Order& a, const Order& b) {
+            if (a.depart_time != b.depart_time) return a.depart_time > b.depart_time;
+            return a.order_id.toLongLong() > b.order_id.toLongLong();
+        });
+        m_ordersVersion = version;
+        finishOrdersChain();
+        emit myOrdersResults(m_orders);
+        return;
+    }
+
+    QString nextCursor;
+    quint32 count = 0;
+    dataIn >> nextCursor >> count;
+    if (m_ordersCursor.isEmpty()) {
+        m_orders.clear();
+        m_pendingOrdersVersion = version;
+    }
+    for (quint32 i = 0; i < count; ++i) {
+        Order o;
+        dataIn >> o;
+        m_orders.append(o);
+    }
+    if (nextCursor.isEmpty()) {
+        m_ordersVersion = m_pendingOrdersVersion;
+        finishOrdersChain();
+    } else {
+        requestOrders(0, nextCursor);
+    }
+    emit myOrdersResults(m_orders);
+}
+
+void TcpClient::resetOrderCache()
+{
+    m_orders.clear();
+    m_ordersVersion = 0;
+    m_pendingOrdersVersion = 0;
+    m_ordersCursor.clear();
+    finishOrdersChain();
+}
+
+void TcpClient::getUserInfo()
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
 
@@ -142,15 +249,9 @@ void TcpClient::getUserInfo(const QString& username)
     QDataStream out(&payload, QIODevice::WriteOnly);
     out.setVersion(QDataStream::Qt_6_0);
     
-    out << (int)GetUserInfoRequest;
-    m_lastRequestType = GetUserInfoRequest;
-    QByteArray requestData;
-    QDataStream requestOut(&requestData, QIODevice::WriteOnly);
-    requestOut.setVersion(QDataStream::Qt_6_0);
-    requestOut << username;
-    out << requestData;
+    out << (int)GetUserInfoRequest << QByteArray();
     
-    sendPacket(m_socket, payload);
+    sendRequest(GetUserInfoRequest, payload);
 }
 
 void TcpClient::updateUserInfo(const User& user)
@@ -162,14 +263,13 @@ void TcpClient::updateUserInfo(const User& user)
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)UpdateUserInfoRequest;
-    m_lastRequestType = UpdateUserInfoRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << user;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(UpdateUserInfoRequest, payload);
 }
 
 void TcpClient::cancelTicket(const QString& orderId)
@@ -181,14 +281,13 @@ void TcpClient::cancelTicket(const QString& orderId)
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)CancelTicketRequest;
-    m_lastRequestType = CancelTicketRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << orderId;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(CancelTicketRequest, payload);
 }
 
 void TcpClient::changeTicket(const QString& orderId, const QString& newFlightId, const QString& seatNumber)
@@ -200,20 +299,18 @@ void TcpClient::changeTicket(const QString& orderId, const QString& newFlightId,
     out.setVersion(QDataStream::Qt_6_0);
     
     out << (int)ChangeTicketRequest;
-    m_lastRequestType = ChangeTicketRequest;
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
     requestOut << orderId << newFlightId << seatNumber;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(ChangeTicketRequest, payload);
 }
 
 void TcpClient::checkUsername(const QString& username)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
-    m_lastRequestType = CheckUsernameRequest;
     
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
@@ -225,26 +322,29 @@ void TcpClient::checkUsername(const QString& username)
     requestOut << username;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(CheckUsernameRequest, payload);
 }
 
 void TcpClient::getCities()
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
-    m_lastRequestType = GetCitiesRequest;
     
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
     out.setVersion(QDataStream::Qt_6_0);
-    out << (int)GetCitiesRequest << QByteArray();
+    out << (int)GetCitiesRequest;
+    QByteArray requestData;
+    QDataStream requestOut(&requestData, QIODevice::WriteOnly);
+    requestOut.setVersion(QDataStream::Qt_6_0);
+    requestOut << m_citiesVersion;
+    out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(GetCitiesRequest, payload);
 }
 
 void TcpClient::getOccupiedSeats(const QString& flightId)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
-    m_lastRequestType = GetOccupiedSeatsRequest;
     
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
@@ -256,13 +356,12 @@ void TcpClient::getOccupiedSeats(const QString& flightId)
     requestOut << flightId;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(GetOccupiedSeatsRequest, payload);
 }
 
-void TcpClient::sendAIChatMessage(const QString& username, const QString& message)
+void TcpClient::sendAIChatMessage(const QString& message)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
-    m_lastRequestType = AIChatRequest;
     
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
@@ -271,16 +370,15 @@ void TcpClient::sendAIChatMessage(const QString& username, const QString& messag
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
-    requestOut << username << message;
+    requestOut << message;
     out << requestData;
     
-    sendPacket(m_socket, payload);
+    sendRequest(AIChatRequest, payload);
 }
 
-void TcpClient::changePassword(const QString& username, const QString& oldPass, const QString& newPass)
+void TcpClient::changePassword(const QString& oldPass, const QString& newPass)
 {
     if (m_socket->state() != QAbstractSocket::ConnectedState) return;
-    m_lastRequestType = ChangePasswordRequest;
     
     QByteArray payload;
     QDataStream out(&payload, QIODevice::WriteOnly);
@@ -289,12 +387,72 @@ void TcpClient::changePassword(const QString& username, const QString& oldPass,
     QByteArray requestData;
     QDataStream requestOut(&requestData, QIODevice::WriteOnly);
     requestOut.setVersion(QDataStream::Qt_6_0);
-    requestOut << username << oldPass << newPass;
+    requestOut << oldPass << newPass;
     out << requestData;
     
+    sendRequest(ChangePasswordRequest, payload);
+}
+
+void TcpClient::logout()
+{
+    m_sessionToken = 0;
+    resetOrderCache();
+    if (m_socket->state() != QAbstractSocket::ConnectedState) return;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (int)LogoutRequest << QByteArray();
+
+    sendRequest(LogoutRequest, payload);
+}
+
+// 心跳不改写 m_lastRequestType，应答以 HeartbeatAck 状态单独识别
+void TcpClient::sendHeartbeat()
+{
+    if (m_socket->state() != QAbstractSocket::ConnectedState) return;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (int)HeartbeatRequest << QByteArray();
+
+    sendPacket(m_socket, payload);
+}
+
+// 与心跳一样不改写 m_lastRequestType，应答以 HandshakeAck 状态单独识别
+void TcpClient::sendHandshake()
+{
+    if (m_socket->state() != QAbstractSocket::ConnectedState) return;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (int)HandshakeRequest;
+    QByteArray requestData;
+    QDataStream requestOut(&requestData, QIODevice::WriteOnly);
+    requestOut.setVersion(QDataStream::Qt_6_0);
+    requestOut << (quint32)CapCompressZlib << m_sessionToken;
+    out << requestData;
+
     sendPacket(m_socket, payload);
 }
 
+// 已登录时掉线自动重连，握手里带上会话令牌即可恢复登录状态
+void TcpClient::onDisconnected()
+{
+    // 未完成的分页链与暂存的请求随连接作废
+    m_ordersPending = false;
+    m_heldRequests.clear();
+    if (m_sessionToken == 0 || m_host.isEmpty()) return;
+
+    QTimer::singleShot(3000, this, [this]() {
+        if (m_sessionToken != 0 && m_socket->state() == QAbstractSocket::UnconnectedState) {
+            connectToServer(m_host, m_port);
+        }
+    });
+}
+
 void TcpClient::onReadyRead()
 {
     m_recvBuffer.append(m_socket->readAll());
@@ -306,7 +464,10 @@ void TcpClient::onReadyRead()
             }
             QDataStream sizeStream(m_recvBuffer.left(sizeof(quint32)));
             sizeStream.setVersion(QDataStream::Qt_6_0);
-            sizeStream >> m_expectedSize;
+            quint32 header = 0;
+            sizeStream >> header;
+            m_expectedSize = header & kFrameSizeMask;
+            m_expectedCompressed = (header & kFrameCompressedFlag) != 0;
             m_recvBuffer.remove(0, sizeof(quint32));
         }
         
@@ -316,6 +477,10 @@ void TcpClient::onReadyRead()
         QByteArray packet = m_recvBuffer.left(m_expectedSize);
         m_recvBuffer.remove(0, m_expectedSize);
         m_expectedSize = 0;
+        if (m_expectedCompressed) {
+            packet = qUncompress(packet);
+            m_expectedCompressed = false;
+        }
         processResponse(packet);
     }
 }
@@ -328,15 +493,40 @@ void TcpClient::processResponse(const QByteArray& packet)
     int statusInt;
     in >> statusInt;
     ResponseStatus status = (ResponseStatus)statusInt;
+    if (status == HeartbeatAck) {
+        return;
+    }
 
     QByteArray data;
     in >> data;
 
+    if (status == HandshakeAck) {
+        QDataStream capsIn(data);
+        capsIn.setVersion(QDataStream::Qt_6_0);
+        bool resumed = false;
+        capsIn >> m_capabilities >> resumed;
+        if (!resumed && m_sessionToken != 0) {
+            m_sessionToken = 0;
+            emit sessionExpired();
+        }
+        return;
+    }
+    if (status == NotLoggedIn) {
+        m_sessionToken = 0;
+        resetOrderCache();
+        emit sessionExpired();
+        return;
+    }
+
     QDataStream dataIn(data);
     dataIn.setVersion(QDataStream::Qt_6_0);
 
     switch (m_lastRequestType) {
     case LoginRequest:
+        if (status == Success) {
+            dataIn >> m_sessionToken;
+            resetOrderCache();
+        }
         emit loginResult(status);
         break;
     case RegisterRequest:
@@ -366,20 +556,14 @@ void TcpClient::processResponse(const QByteArray& packet)
         }
         break;
     }
-    case MyOrdersRequest: {
-        QList<Order> orders;
+    case MyOrdersRequest:
         if (status == Success) {
-            quint32 count;
-            dataIn >> count;
-            for (quint32 i = 0; i < count; ++i) {
-                Order o;
-                dataIn >> o;
-                orders.append(o);
-            }
+            processOrdersReply(dataIn);
+        } else {
+            finishOrdersChain();
+            emit myOrdersResults(m_orders);
         }
-        emit myOrdersResults(orders);
         break;
-    }
     case GetUserInfoRequest: {
         User user;
         if (status == Success) {
@@ -401,11 +585,11 @@ void TcpClient::processResponse(const QByteArray& packet)
         emit checkUsernameResult(status == UsernameExist);
         break;
     case GetCitiesRequest: {
-        QStringList cities;
         if (status == Success) {
-            dataIn >> cities;
+            dataIn >> m_citiesVersion >> m_cities;
         }
-        emit citiesResult(cities);
+        // NotModified 时沿用缓存
+        emit citiesResult(m_cities);
         break;
     }
     case GetOccupiedSeatsRequest: {
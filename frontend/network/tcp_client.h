@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QTcpSocket>
+#include <QTimer>
 #include "data_model.h"
 
 // 前端和后端通信的单例
@@ -14,9 +15,10 @@ public:
     void connectToServer(const QString& ip, int port);
     void login(const QString& username, const QString& password);
     void queryFlights(const QString& departure, const QString& destination, const QDate& date);
-    void bookTicket(const QString& username, const QString& flightId, const QString& seatNumber = QString());
-    void queryOrders(const QString& username);
-    void getUserInfo(const QString& username);
+    // 以下用户相关请求由登录时签发的会话令牌确定用户，不再携带用户名
+    void bookTicket(const QString& flightId, const QString& seatNumber = QString());
+    void queryOrders();
+    void getUserInfo();
     void updateUserInfo(const User& user);
     void cancelTicket(const QString& orderId);
     void changeTicket(const QString& orderId, const QString& newFlightId, const QString& seatNumber);
@@ -24,8 +26,9 @@ public:
     void checkUsername(const QString& username);
     void getCities();
     void getOccupiedSeats(const QString& flightId);
-    void sendAIChatMessage(const QString& username, const QString& message);
-    void changePassword(const QString& username, const QString& oldPass, const QString& newPass);
+    void sendAIChatMessage(const QString& message);
+    void changePassword(const QString& oldPass, const QString& newPass);
+    void logout();
 
 signals:
     void loginResult(ResponseStatus status);
@@ -42,20 +45,50 @@ signals:
     void occupiedSeatsResult(const QStringList& seats);
     void aiChatResult(bool success, const QString& response);
     void changePasswordResult(bool success);
+    // 会话失效（过期或在其他设备改密），需要重新登录
+    void sessionExpired();
 
 private slots:
     void onReadyRead();
+    void sendHeartbeat();
+    void sendHandshake();
+    void onDisconnected();
 
 private:
     explicit TcpClient(QObject *parent = nullptr);
     void processResponse(const QByteArray& packet);  
+    void sendRequest(int type, const QByteArray& payload);
+    void finishOrdersChain();
+    void requestOrders(quint64 knownVersion, const QString& cursor);
+    void processOrdersReply(QDataStream& dataIn);
+    void resetOrderCache();
     
     QTcpSocket *m_socket;
+    QTimer *m_heartbeatTimer;
     static TcpClient *m_instance;
     int m_lastRequestType = 0;
     
     QByteArray m_recvBuffer;
     quint32 m_expectedSize = 0;
+    bool m_expectedCompressed = false;
+    quint32 m_capabilities = 0;     // 握手协商后的连接能力
+
+    // 会话令牌在断线重连后随握手发送，服务端据此恢复登录状态
+    quint64 m_sessionToken = 0;
+    QString m_host;
+    int m_port = 0;
+
+    // 城市列表缓存及其字典版本号，版本未变时服务端只回 NotModified
+    QStringList m_cities;
+    quint32 m_citiesVersion = 0;
+
+    // 订单缓存：首次分页拉全，之后按版本号只取增量并在本地合并
+    QList<Order> m_orders;
+    quint64 m_ordersVersion = 0;
+    quint64 m_pendingOrdersVersion = 0;  // 分页拉取中，首页返回的版本号
+    QString m_ordersCursor;              // 正在请求的分页游标
+    bool m_ordersPending = false;        // 订单请求（含后续分页）尚未结束
+    QList<QPair<int, QByteArray>> m_heldRequests;
 };
 
 #endif // TCP_CLIENT_H
@@ -453,7 +453,7 @@ void ChatWidget::onSendClicked()
     showThinkingIndicator(true);
     
     // 发送消息到服务器
-    TcpClient::getInstance()->sendAIChatMessage(m_username, text);
+    TcpClient::getInstance()->sendAIChatMessage(text);
 }
 
 void ChatWidget::onAIResponse(bool success, const QString &response)
@@ -1,5 +1,6 @@
 #include "flight_card.h"
 #include <QGraphicsDropShadowEffect>
+#include <QDateTime>
 
 FlightCard::FlightCard(const Flight& flight, QWidget *parent) 
     : QWidget(parent), m_flight(flight) 
@@ -31,7 +32,11 @@ void FlightCard::setupUI() {
     QLabel *flightIdLabel = new QLabel(m_flight.flight_id, this);
     flightIdLabel->setObjectName("FlightId");
 
-    QLabel *dateLabel = new QLabel(m_flight.depart_time.date().toString("yyyy-MM-dd ddd"), this);
+    // 协议中的时间为 Unix 秒，只在显示时按本地时区转换
+    const QDateTime departTime = QDateTime::fromSecsSinceEpoch(m_flight.depart_time);
+    const QDateTime arriveTime = QDateTime::fromSecsSinceEpoch(m_flight.arrive_time);
+
+    QLabel *dateLabel = new QLabel(departTime.date().toString("yyyy-MM-dd ddd"), this);
     dateLabel->setObjectName("AirportLabel");
 
     QVBoxLayout *idLayout = new QVBoxLayout();
@@ -42,7 +47,7 @@ void FlightCard::setupUI() {
     
     // 左侧：出发信息
     QVBoxLayout *depLayout = new QVBoxLayout();
-    QLabel *depTime = new QLabel(m_flight.depart_time.toString("HH:mm"), this);
+    QLabel *depTime = new QLabel(departTime.toString("HH:mm"), this);
     depTime->setObjectName("TimeLabel");
     
     QLabel *depCity = new QLabel(m_flight.departure, this);
@@ -58,7 +63,7 @@ void FlightCard::setupUI() {
 
     // 中间：箭头和时长
     QVBoxLayout *midLayout = new QVBoxLayout();
-    qint64 durationSecs = m_flight.depart_time.secsTo(m_flight.arrive_time);
+    qint64 durationSecs = m_flight.arrive_time - m_flight.depart_time;
     int hours = durationSecs / 3600;
     int minutes = (durationSecs % 3600) / 60;
     QLabel *duration = new QLabel(QString("%1h %2m").arg(hours).arg(minutes), this);
@@ -75,7 +80,7 @@ void FlightCard::setupUI() {
 
     // 右侧：到达信息
     QVBoxLayout *arrLayout = new QVBoxLayout();
-    QLabel *arrTime = new QLabel(m_flight.arrive_time.toString("HH:mm"), this);
+    QLabel *arrTime = new QLabel(arriveTime.toString("HH:mm"), this);
     arrTime->setObjectName("TimeLabel");
     
     QLabel *arrCity = new QLabel(m_flight.destination, this);
@@ -331,7 +331,7 @@ void LoginPage::setupConnections()
         } else {
             QMessageBox msgBox(this);
             msgBox.setWindowTitle("登录失败");
-            msgBox.setText("用户名或密码错误");
+            msgBox.setText(status == ServerBusy ? "服务器繁忙，请稍后重试" : "用户名或密码错误");
             msgBox.setIcon(QMessageBox::Warning);
             msgBox.setStandardButtons(QMessageBox::Ok);
             msgBox.setButtonText(QMessageBox::Ok, "确定");
@@ -326,6 +326,7 @@ void MainWindow::setupConnections()
     connect(m_themeBtn, &QPushButton::clicked, this, &MainWindow::switchTheme);
     
     connect(m_logoutBtn, &QPushButton::clicked, [this](){
+        TcpClient::getInstance()->logout();
         LoginPage *login = new LoginPage();
         login->setAttribute(Qt::WA_DeleteOnClose);
         login->show();
@@ -409,7 +410,7 @@ void MainWindow::setupConnections()
             msgBox.setWindowTitle("取消成功");
             msgBox.setText("订单已取消");
             msgBox.setIcon(QMessageBox::Information);
-            TcpClient::getInstance()->queryOrders(m_username);
+            TcpClient::getInstance()->queryOrders();
         } else {
             msgBox.setWindowTitle("取消失败");
             msgBox.setText("取消失败，请重试");
@@ -453,7 +454,7 @@ void MainWindow::setupConnections()
             msgBox.setWindowTitle("更新成功");
             msgBox.setText("个人信息已更新");
             msgBox.setIcon(QMessageBox::Information);
-            TcpClient::getInstance()->getUserInfo(m_username);
+            TcpClient::getInstance()->getUserInfo();
         } else {
             msgBox.setWindowTitle("更新失败");
             msgBox.setText("更新失败，请重试");
@@ -463,10 +464,20 @@ void MainWindow::setupConnections()
     });
     
     connect(TcpClient::getInstance(), &TcpClient::userInfoResult, m_profilePage, &ProfilePage::setUserInfo);
+
+    // 会话失效时回到登录页
+    connect(TcpClient::getInstance(), &TcpClient::sessionExpired, this, [this](){
+        QMessageBox::warning(this, "登录已失效", "登录状态已失效，请重新登录");
+        LoginPage *login = new LoginPage();
+        login->setAttribute(Qt::WA_DeleteOnClose);
+        login->show();
+        this->close();
+        this->deleteLater();
+    });
     
     // 修改密码
     connect(m_profilePage, &ProfilePage::changePassword, this, [this](const QString& oldPass, const QString& newPass){
-        TcpClient::getInstance()->changePassword(m_username, oldPass, newPass);
+        TcpClient::getInstance()->changePassword(oldPass, newPass);
     });
     connect(TcpClient::getInstance(), &TcpClient::changePasswordResult, this, [this](bool success){
         QMessageBox msgBox(this);
@@ -478,6 +489,7 @@ void MainWindow::setupConnections()
             msgBox.setIcon(QMessageBox::Information);
             msgBox.exec();
             // 退出登录
+            TcpClient::getInstance()->logout();
             LoginPage *login = new LoginPage();
             login->setAttribute(Qt::WA_DeleteOnClose);
             login->show();
@@ -552,7 +564,7 @@ void MainWindow::onOccupiedSeatsReceived(const QStringList& seats)
             TcpClient::getInstance()->changeTicket(m_changingOrderId, m_pendingFlightId, selectedSeat);
             m_changingOrderId.clear();
         } else {
-            TcpClient::getInstance()->bookTicket(m_username, m_pendingFlightId, selectedSeat);
+            TcpClient::getInstance()->bookTicket(m_pendingFlightId, selectedSeat);
         }
     }
     m_pendingFlightId.clear();
@@ -575,9 +587,9 @@ void MainWindow::navigateTo(int index)
     m_chatBtn->setChecked(index == 3);
 
     if (index == 1) {
-        TcpClient::getInstance()->queryOrders(m_username);
+        TcpClient::getInstance()->queryOrders();
     } else if (index == 2) {
-        TcpClient::getInstance()->getUserInfo(m_username);
+        TcpClient::getInstance()->getUserInfo();
     }
 }
 
@@ -1,5 +1,6 @@
 #include "order_card.h"
 #include <QGraphicsDropShadowEffect>
+#include <QDateTime>
 
 OrderCard::OrderCard(const Order& order, QWidget *parent) 
     : QWidget(parent), m_order(order) 
@@ -27,11 +28,14 @@ void OrderCard::setupUI() {
     mainLayout->setContentsMargins(20, 20, 20, 10);
     mainLayout->setSpacing(20);
 
+    const QDateTime departTime = QDateTime::fromSecsSinceEpoch(m_order.depart_time);
+    const QDateTime arriveTime = QDateTime::fromSecsSinceEpoch(m_order.arrive_time);
+
     // 航班号和日期
     QVBoxLayout *infoLayout = new QVBoxLayout();
     QLabel *flightId = new QLabel(m_order.flight_id, this);
     flightId->setObjectName("FlightId");
-    QLabel *date = new QLabel(m_order.depart_time.toString("yyyy-MM-dd"), this);
+    QLabel *date = new QLabel(departTime.toString("yyyy-MM-dd"), this);
     date->setObjectName("DurationLabel"); // Use DurationLabel style for date
     infoLayout->addWidget(flightId);
     infoLayout->addWidget(date);
@@ -41,12 +45,12 @@ void OrderCard::setupUI() {
     QVBoxLayout *routeLayout = new QVBoxLayout();
     QHBoxLayout *timeLayout = new QHBoxLayout();
     
-    QLabel *depTime = new QLabel(m_order.depart_time.toString("HH:mm"), this);
+    QLabel *depTime = new QLabel(departTime.toString("HH:mm"), this);
     depTime->setObjectName("TimeLabel");
     QLabel *arrow = new QLabel("➔", this);
     arrow->setObjectName("ArrowLabel");
     arrow->setStyleSheet("margin: 0 10px;"); // Keep margin
-    QLabel *arrTime = new QLabel(m_order.arrive_time.toString("HH:mm"), this);
+    QLabel *arrTime = new QLabel(arriveTime.toString("HH:mm"), this);
     arrTime->setObjectName("TimeLabel");
     
     timeLayout->addWidget(depTime);
@@ -0,0 +1,545 @@
+// 确定性数据集生成：按种子生成航班、用户与已售座位，输出后端可直接打开的 SQLite 库，
+// 作为各压测工具共用的数据集
+//
+//   ftms_datagen --output bench_1m.db --scale 1m --seed 42
+//   ftms_datagen --output bench.db --flights 200000 --users 20000 --fill 0.3 --threads 8
+//   ftms_datagen --output bench_10k.db --scale 10k --start-date 2026-01-01 --flight-file bench_10k.ftmf
+//
+// 参数（种子、规模、起始日期、天数、填充率）相同则生成的航班、用户、订单完全相同，与线程数无关：
+// 航班按固定大小分块，每块的随机数由 (种子, 块号) 派生，写库按块号顺序进行。
+// 口令哈希的盐随机生成，是库中唯一不由参数决定的内容。
+//
+// 机场与航空公司目录与 generate_flights.py 共用 tools/flight_catalog.json（编译进资源）。
+// 生成参数写入 meta 表（datagen_*），结果以单行 JSON 输出
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDate>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "auth/password_hasher.h"
+#include "data_model.h"
+#include "db/db_manager.h"
+#include "db/flight_importer.h"
+#include "db/order_id_generator.h"
+
+namespace {
+
+constexpr int kChunkFlights = 4096;
+constexpr int kSeatsPerRow = 6;
+constexpr const char* kConnectionName = "ftms_datagen";
+
+struct Options {
+    QString output;
+    QString flightFile;             // 另存一份二进制航班文件（--import 格式），可选
+    qint64 flights = 10000;
+    qint64 users = 0;               // 0 表示按航班数的十分之一（至少 100）
+    double fill = 0.1;              // 已售座位占比
+    quint64 seed = 42;
+    QDate startDate = QDate::currentDate();
+    int days = 60;
+    int threads = QThread::idealThreadCount();
+    QString password = "123456";    // 所有生成用户的口令
+    bool force = false;
+};
+
+struct Airport {
+    QString city;
+    QString name;
+};
+
+struct Catalog {
+    std::vector<Airport> airports;
+    QStringList airlines;
+    QSet<QString> hotCities;
+    QSet<QString> longDistanceCities;
+    QSet<QString> trunkCities{"北京", "上海", "广州"};   // 京沪穗之间的干线
+};
+
+struct Ticket {
+    qint64 flightRef = 0;
+    qint64 userId = 0;
+    qint64 bookTime = 0;
+    qint64 departTime = 0;
+    QString seat;
+};
+
+struct Chunk {
+    QList<Flight> flights;
+    std::vector<Ticket> tickets;
+};
+
+// splitmix64：由种子和块号派生互不相关的子种子
+quint64 mix(quint64 x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// 标准库分布的实现因平台而异，这里只用 mt19937_64 的原始输出，保证各平台结果一致
+class Rng {
+public:
+    explicit Rng(quint64 seed) : m_engine(seed) {}
+    int range(int lo, int hi) { return lo + int(m_engine() % quint64(hi - lo + 1)); }
+    double unit() { return double(m_engine() >> 11) * (1.0 / 9007199254740992.0); }
+    double uniform(double lo, double hi) { return lo + (hi - lo) * unit(); }
+
+private:
+    std::mt19937_64 m_engine;
+};
+
+bool loadCatalog(Catalog* catalog) {
+    QFile file(":/flight_catalog.json");
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (const QJsonValue& value : root.value("airports").toArray()) {
+        const QJsonObject airport = value.toObject();
+        catalog->airports.push_back({airport.value("city").toString(), airport.value("name").toString()});
+    }
+    for (const QJsonValue& value : root.value("airlines").toArray()) {
+        catalog->airlines.append(value.toObject().value("code").toString());
+    }
+    for (const QJsonValue& value : root.value("hot_cities").toArray()) {
+        catalog->hotCities.insert(value.toString());
+    }
+    for (const QJsonValue& value : root.value("long_distance_cities").toArray()) {
+        catalog->longDistanceCities.insert(value.toString());
+    }
+    return catalog->airports.size() > 1 && !catalog->airlines.isEmpty();
+}
+
+// 与 generate_flights.py 的规则一致：航线、时刻、时长、票价、座位数（6 的倍数）
+Chunk generateChunk(const Catalog& catalog, const Options& opt, qint64 startSecs, qint64 users,
+                    qint64 chunkIndex, qint64 begin, qint64 end) {
+    Rng rng(mix(opt.seed ^ mix(quint64(chunkIndex))));
+    Chunk chunk;
+    chunk.flights.reserve(end - begin);
+    std::vector<int> seats;
+
+    for (qint64 index = begin; index < end; ++index) {
+        const int airportCount = int(catalog.airports.size());
+        const Airport* dep = &catalog.airports[rng.range(0, airportCount - 1)];
+        const Airport* arr = &catalog.airports[rng.range(0, airportCount - 1)];
+        while (arr->city == dep->city) {
+            arr = &catalog.airports[rng.range(0, airportCount - 1)];
+        }
+        const QString& airline = catalog.airlines[rng.range(0, catalog.airlines.size() - 1)];
+
+        const int day = rng.range(0, opt.days - 1);
+        const int hour = rng.range(6, 21);
+        const int minute = rng.range(0, 11) * 5;
+
+        int duration;
+        if (catalog.longDistanceCities.contains(dep->city) || catalog.longDistanceCities.contains(arr->city)) {
+            duration = rng.range(180, 300);
+        } else if (catalog.trunkCities.contains(dep->city) && catalog.trunkCities.contains(arr->city)) {
+            duration = rng.range(120, 180);
+        } else {
+            duration = rng.range(90, 180);
+        }
+
+        const bool hot = catalog.hotCities.contains(dep->city) && catalog.hotCities.contains(arr->city);
+        double price = duration * 3 * (hot ? rng.uniform(1.2, 1.8) : rng.uniform(0.8, 1.2));
+        price = std::round(price + rng.range(-100, 200));
+        const int capacity = 120 + 12 * rng.range(0, 5);
+
+        Flight flight;
+        flight.flight_id = airline + QString::number(1000 + index);
+        flight.departure = dep->city;
+        flight.destination = arr->city;
+        flight.departure_airport = dep->name;
+        flight.arrival_airport = arr->name;
+        flight.depart_time = startSecs + day * 86400 + hour * 3600 + minute * 60;
+        flight.arrive_time = flight.depart_time + duration * 60;
+        flight.price = price;
+
+        // 已售座位数以 capacity * fill 为均值上下浮动，座位号在本航班内不重复
+        int booked = opt.fill >= 1.0 ? capacity : qRound(capacity * opt.fill * (0.5 + rng.unit()));
+        booked = qBound(0, booked, capacity);
+        seats.resize(capacity);
+        for (int i = 0; i < capacity; ++i) seats[i] = i;
+        for (int i = 0; i < booked; ++i) {
+            std::swap(seats[i], seats[rng.range(i, capacity - 1)]);
+            const int seat = seats[i];
+            Ticket ticket;
+            ticket.flightRef = index + 1;   // 新库中航班按序写入，rowid 从 1 开始
+            ticket.userId = rng.range(1, int(users));
+            ticket.bookTime = flight.depart_time - rng.range(3600, 30 * 86400);
+            ticket.departTime = flight.depart_time;
+            ticket.seat = QString("%1%2").arg(seat / kSeatsPerRow + 1).arg(QChar('A' + seat % kSeatsPerRow));
+            chunk.tickets.push_back(std::move(ticket));
+        }
+        flight.rest_seats = capacity - booked;
+        chunk.flights.append(flight);
+    }
+    return chunk;
+}
+
+// 多行 INSERT：攒满一批执行一次，事务由调用方控制
+class BatchInsert {
+public:
+    BatchInsert(QSqlDatabase db, const QString& table, const QStringList& columns, int rowsPerStatement)
+        : m_db(db), m_columns(columns.size()), m_rowsPerStatement(rowsPerStatement), m_query(db) {
+        m_sql = QString("INSERT INTO %1 (%2) VALUES ").arg(table, columns.join(", "));
+        m_query.prepare(statement(m_rowsPerStatement));
+    }
+
+    bool add(const QVariantList& row) {
+        m_pending.append(row);
+        if (m_pending.size() < m_rowsPerStatement) return true;
+        return exec(m_query);
+    }
+
+    bool flush() {
+        if (m_pending.isEmpty()) return true;
+        QSqlQuery tail(m_db);
+        tail.prepare(statement(m_pending.size()));
+        return exec(tail);
+    }
+
+    QString errorString() const { return m_error; }
+
+private:
+    QString statement(int rows) const {
+        const QString row = "(" + QStringList(QList<QString>(m_columns, "?")).join(",") + ")";
+        QStringList rowList;
+        for (int i = 0; i < rows; ++i) rowList.append(row);
+        return m_sql + rowList.join(",");
+    }
+
+    bool exec(QSqlQuery& query) {
+        int position = 0;
+        for (const QVariantList& row : m_pending) {
+            for (const QVariant& value : row) query.bindValue(position++, value);
+        }
+        m_pending.clear();
+        if (!query.exec()) {
+            m_error = query.lastError().text();
+            return false;
+        }
+        return true;
+    }
+
+    QSqlDatabase m_db;
+    int m_columns;
+    int m_rowsPerStatement;
+    QSqlQuery m_query;
+    QString m_sql;
+    QList<QVariantList> m_pending;
+    QString m_error;
+};
+
+qint64 parseCount(const QString& text) {
+    QString value = text.trimmed().toLower();
+    qint64 multiplier = 1;
+    if (value.endsWith('k')) multiplier = 1000;
+    else if (value.endsWith('m')) multiplier = 1000000;
+    if (multiplier > 1) value.chop(1);
+    return value.toLongLong() * multiplier;
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> QString { return i + 1 < argc ? QString::fromLocal8Bit(argv[++i]) : QString(); };
+        if (arg == "--output") opt.output = value();
+        else if (arg == "--flight-file") opt.flightFile = value();
+        else if (arg == "--scale" || arg == "--flights") opt.flights = parseCount(value());
+        else if (arg == "--users") opt.users = parseCount(value());
+        else if (arg == "--fill") opt.fill = value().toDouble();
+        else if (arg == "--seed") opt.seed = value().toULongLong();
+        else if (arg == "--start-date") opt.startDate = QDate::fromString(value(), Qt::ISODate);
+        else if (arg == "--days") opt.days = value().toInt();
+        else if (arg == "--threads") opt.threads = value().toInt();
+        else if (arg == "--password") opt.password = value();
+        else if (arg == "--force") opt.force = true;
+        else {
+            opt.output.clear();
+            break;
+        }
+    }
+    if (opt.output.isEmpty() || opt.flights <= 0 || !opt.startDate.isValid()) {
+        std::fprintf(stderr,
+                     "用法: %s --output FILE [--scale 10k|1m|10m | --flights N] [--users N] [--fill 0.1]\n"
+                     "          [--seed N] [--start-date YYYY-MM-DD] [--days 60] [--threads N]\n"
+                     "          [--password P] [--flight-file FILE] [--force]\n",
+                     argv[0]);
+        return false;
+    }
+    if (opt.users <= 0) opt.users = std::max<qint64>(100, opt.flights / 10);
+    opt.fill = qBound(0.0, opt.fill, 1.0);
+    opt.days = std::max(1, opt.days);
+    opt.threads = std::max(1, opt.threads);
+    return true;
+}
+
+bool insertUsers(QSqlDatabase& db, const Options& opt) {
+    // 同一口令只计算一次哈希（共用盐），逐个计算在百万用户时需要数小时
+    const QString password = PasswordHasher::hash(opt.password);
+    BatchInsert users(db, "user", {"id", "username", "password", "real_name", "phone"}, 500);
+    db.transaction();
+    for (qint64 id = 1; id <= opt.users; ++id) {
+        const bool ok = users.add({id, QString("user%1").arg(id, 7, 10, QChar('0')), password,
+                                   QString("压测用户%1").arg(id),
+                                   QString("138%1").arg(id % 100000000, 8, 10, QChar('0'))});
+        if (!ok) {
+            db.rollback();
+            std::fprintf(stderr, "写入用户失败：%s\n", qPrintable(users.errorString()));
+            return false;
+        }
+    }
+    if (!users.flush() || !db.commit()) {
+        db.rollback();
+        std::fprintf(stderr, "写入用户失败：%s\n", qPrintable(users.errorString()));
+        return false;
+    }
+    return true;
+}
+
+// 删除表上的二级索引并返回建索引语句，写完后按原语句重建
+QStringList dropIndexes(QSqlDatabase& db, const QString& table) {
+    QSqlQuery query(db);
+    query.prepare("SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = :table AND sql IS NOT NULL");
+    query.bindValue(":table", table);
+    query.exec();
+    QStringList names, statements;
+    while (query.next()) {
+        names.append(query.value(0).toString());
+        statements.append(query.value(1).toString());
+    }
+    for (const QString& name : names) {
+        query.exec(QString("DROP INDEX IF EXISTS %1").arg(name));
+    }
+    return statements;
+}
+
+bool writeMeta(QSqlDatabase& db, const QString& key, qint64 value) {
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO meta (key, value) VALUES (:key, :value)");
+    query.bindValue(":key", key);
+    query.bindValue(":value", value);
+    return query.exec();
+}
+
+int run(const Options& opt) {
+    Catalog catalog;
+    if (!loadCatalog(&catalog)) {
+        std::fprintf(stderr, "读取航班目录失败\n");
+        return 1;
+    }
+    if (QFileInfo::exists(opt.output)) {
+        if (!opt.force) {
+            std::fprintf(stderr, "%s 已存在，使用 --force 覆盖\n", qPrintable(opt.output));
+            return 1;
+        }
+        for (const QString& suffix : {"", "-wal", "-shm"}) {
+            QFile::remove(opt.output + suffix);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 建表与结构版本沿用后端的初始化流程；后台迁移在写完数据后同步执行
+    DBManager* manager = DBManager::getInstance();
+    if (!manager->init(opt.output, false)) {
+        std::fprintf(stderr, "初始化数据库失败\n");
+        return 1;
+    }
+
+    const qint64 startSecs = QDateTime(opt.startDate, QTime(0, 0)).toSecsSinceEpoch();
+    const qint64 chunks = (opt.flights + kChunkFlights - 1) / kChunkFlights;
+    qint64 ticketCount = 0;
+    bool ok = true;
+    QStringList cities;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kConnectionName);
+        db.setDatabaseName(opt.output);
+        if (!db.open()) {
+            std::fprintf(stderr, "打开数据库失败：%s\n", qPrintable(db.lastError().text()));
+            return 1;
+        }
+        QSqlQuery(db).exec("PRAGMA synchronous = OFF");
+        if (!insertUsers(db, opt)) return 1;
+
+        QFile flightFile(opt.flightFile);
+        QDataStream flightOut;
+        if (!opt.flightFile.isEmpty()) {
+            if (!flightFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                std::fprintf(stderr, "无法写入 %s\n", qPrintable(opt.flightFile));
+                return 1;
+            }
+            flightOut.setDevice(&flightFile);
+            flightOut.setVersion(QDataStream::Qt_6_0);
+            flightOut << kFlightFileMagic << kFlightFileVersion << quint64(opt.flights);
+        }
+
+        // 订单随航班一起写入 FlightBulkWriter 的事务；两张表的二级索引都在写完后重建
+        const QStringList ticketIndexes = dropIndexes(db, "ticket");
+        ImportOptions importOptions;
+        importOptions.dropIndexes = true;
+        FlightBulkWriter flights(db, importOptions);
+        BatchInsert tickets(db, "ticket",
+                            {"order_id", "user_id", "flight_ref", "book_time", "status", "seat_number", "depart_time"},
+                            500);
+        ok = flights.begin();
+
+        // 生成线程按块号领取任务，最多领先写入进度 window 块；写入按块号顺序进行
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::map<qint64, Chunk> ready;
+        std::atomic<qint64> nextChunk{0};
+        qint64 written = 0;
+        bool aborted = !ok;
+        const qint64 window = qint64(opt.threads) * 4;
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < opt.threads; ++t) {
+            workers.emplace_back([&]() {
+                for (;;) {
+                    const qint64 index = nextChunk.fetch_add(1);
+                    if (index >= chunks) return;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&]() { return aborted || index < written + window; });
+                        if (aborted) return;
+                    }
+                    const qint64 begin = index * kChunkFlights;
+                    Chunk chunk = generateChunk(catalog, opt, startSecs, opt.users, index, begin,
+                                                std::min(opt.flights, begin + kChunkFlights));
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready.emplace(index, std::move(chunk));
+                    }
+                    cv.notify_all();
+                }
+            });
+        }
+
+        for (qint64 index = 0; ok && index < chunks; ++index) {
+            Chunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return ready.count(index) > 0; });
+                chunk = std::move(ready[index]);
+                ready.erase(index);
+                written = index + 1;
+            }
+            cv.notify_all();
+
+            for (const Flight& flight : chunk.flights) {
+                if (!flights.add(flight)) {
+                    ok = false;
+                    break;
+                }
+                if (!opt.flightFile.isEmpty()) flightOut << flight;
+            }
+            // 订单号按写入顺序编号，时间部分取起始日期之前，后端启动后新订单号都大于它们
+            for (const Ticket& ticket : chunk.tickets) {
+                if (!ok) break;
+                const qint64 sequence = ticketCount++;
+                const qint64 orderId = OrderIdGenerator::compose(startSecs * 1000 - 86400000LL + sequence / 4096,
+                                                                 0, int(sequence % 4096));
+                ok = tickets.add({orderId, ticket.userId, ticket.flightRef, ticket.bookTime, 1, ticket.seat,
+                                  ticket.departTime});
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        ok = ok && tickets.flush() && flights.finish();
+        if (!ok) {
+            std::fprintf(stderr, "写入失败：%s %s\n", qPrintable(flights.errorString()),
+                         qPrintable(tickets.errorString()));
+            return 1;
+        }
+        cities = flights.cities();
+
+        qDebug() << "重建订单索引" << ticketIndexes.size() << "个...";
+        QSqlQuery query(db);
+        for (const QString& sql : ticketIndexes) {
+            if (!query.exec(sql)) {
+                std::fprintf(stderr, "重建索引失败：%s\n", qPrintable(query.lastError().text()));
+                return 1;
+            }
+        }
+
+        // 航班 rowid 须与生成时的编号一致，否则订单的 flight_ref 错位
+        query.exec("SELECT COUNT(*), MAX(id) FROM flight");
+        if (!query.next() || query.value(0).toLongLong() != opt.flights || query.value(1).toLongLong() != opt.flights) {
+            std::fprintf(stderr, "航班编号与预期不符，生成结果不可用\n");
+            return 1;
+        }
+
+        writeMeta(db, "datagen_seed", qint64(opt.seed));
+        writeMeta(db, "datagen_flights", opt.flights);
+        writeMeta(db, "datagen_users", opt.users);
+        writeMeta(db, "datagen_tickets", ticketCount);
+        writeMeta(db, "datagen_start", startSecs);
+        writeMeta(db, "datagen_days", opt.days);
+        writeMeta(db, "datagen_fill_permille", qRound(opt.fill * 1000));
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(kConnectionName);
+
+    if (!manager->registerCities(cities) || !manager->finishMigrations()) {
+        std::fprintf(stderr, "更新城市字典或结构迁移失败\n");
+        return 1;
+    }
+    manager->close();
+    {
+        // 把 WAL 合并回主文件，数据集只需拷贝一个 .db 文件
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kConnectionName);
+        db.setDatabaseName(opt.output);
+        if (db.open()) QSqlQuery(db).exec("PRAGMA wal_checkpoint(TRUNCATE)");
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(kConnectionName);
+
+    const double seconds = timer.elapsed() / 1000.0;
+    std::printf("{\"output\":\"%s\",\"seed\":%llu,\"start_date\":\"%s\",\"flights\":%lld,\"users\":%lld,"
+                "\"tickets\":%lld,\"fill\":%.3f,\"threads\":%d,\"seconds\":%.3f,\"flights_per_sec\":%.1f,\"bytes\":%lld}\n",
+                qPrintable(opt.output), (unsigned long long)opt.seed, qPrintable(opt.startDate.toString(Qt::ISODate)),
+                (long long)opt.flights, (long long)opt.users, (long long)ticketCount, opt.fill, opt.threads, seconds,
+                opt.flights / std::max(seconds, 0.001), (long long)QFileInfo(opt.output).size());
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+    return run(opt);
+}
@@ -0,0 +1,391 @@
+// 数据库层微基准：直接调用 DBManager，按数据集规模与线程数测量各接口的吞吐与延迟分位数
+//
+//   ftms_db_bench --db bench_10k.db --db bench_1m.db --threads 1,4,8 --seconds 3
+//   ftms_db_bench --db bench_1m.db --ops query_popular,orders,book --label after-index
+//
+// 数据集为 ftms_datagen 生成的库（从 meta 表读取规模与起始日期），每个数据集先复制到临时目录，
+// 写操作不改动原文件。同一数据集上依次运行读操作、订票、退票、改签，退票与改签消耗预先抽样的订单，
+// 抽样用完即提前结束该组。
+//
+// 每个 (数据集, 操作, 线程数) 输出一行 JSON，--label 原样写入每行，便于比较不同提交的结果
+
+#include <QCoreApplication>
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data_model.h"
+#include "db/db_manager.h"
+
+namespace {
+
+constexpr const char* kConnectionName = "ftms_db_bench";
+constexpr const char* kPopularDeparture = "北京";
+constexpr const char* kPopularDestination = "上海";
+
+const QStringList kAllOps = {
+    "verify_user", "query_popular_date", "query_popular", "query_random_date", "query_empty",
+    "occupied_seats", "orders", "book", "book_with_seat", "cancel", "change",
+};
+
+struct Options {
+    QStringList datasets;
+    std::vector<int> threads{1, 4};
+    double seconds = 3.0;
+    QStringList ops = kAllOps;
+    QString password = "123456";    // 与 ftms_datagen 的 --password 一致
+    int samples = 20000;            // 抽样的航班数与订单数
+    QString label;
+};
+
+struct OrderRef {
+    qint64 orderId = 0;
+    qint64 userId = 0;
+    QString newFlightId;            // 改签目标：同航线的另一航班
+};
+
+struct Dataset {
+    QString name;
+    qint64 flights = 0;
+    qint64 users = 0;
+    qint64 tickets = 0;
+    QDate startDate;
+    int days = 60;
+    QStringList flightIds;
+    QStringList cities;
+    std::vector<OrderRef> cancelPool;
+    std::vector<OrderRef> changePool;
+    std::atomic<size_t> cancelNext{0};
+    std::atomic<size_t> changeNext{0};
+};
+
+struct CaseResult {
+    quint64 ops = 0;
+    quint64 errors = 0;
+    double seconds = 0;
+    std::vector<qint64> latencies;  // 纳秒
+};
+
+class Rng {
+public:
+    explicit Rng(quint64 seed) : m_engine(seed) {}
+    int range(int lo, int hi) { return lo + int(m_engine() % quint64(hi - lo + 1)); }
+
+private:
+    std::mt19937_64 m_engine;
+};
+
+std::vector<int> parseThreads(const QString& text) {
+    std::vector<int> threads;
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        const int value = part.toInt();
+        if (value > 0) threads.push_back(value);
+    }
+    return threads;
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> QString { return i + 1 < argc ? QString::fromLocal8Bit(argv[++i]) : QString(); };
+        if (arg == "--db") opt.datasets.append(value());
+        else if (arg == "--threads") opt.threads = parseThreads(value());
+        else if (arg == "--seconds") opt.seconds = value().toDouble();
+        else if (arg == "--ops") opt.ops = value().split(',', Qt::SkipEmptyParts);
+        else if (arg == "--password") opt.password = value();
+        else if (arg == "--samples") opt.samples = value().toInt();
+        else if (arg == "--label") opt.label = value();
+        else ok = false;
+    }
+    for (const QString& op : opt.ops) {
+        if (!kAllOps.contains(op)) ok = false;
+    }
+    if (!ok || opt.datasets.isEmpty() || opt.threads.empty()) {
+        std::fprintf(stderr,
+                     "用法: %s --db FILE [--db FILE ...] [--threads 1,4,8] [--seconds 3] [--ops a,b,...]\n"
+                     "          [--password P] [--samples N] [--label TEXT]\n"
+                     "操作: %s\n",
+                     argv[0], qPrintable(kAllOps.join(',')));
+        return false;
+    }
+    opt.seconds = std::max(0.1, opt.seconds);
+    opt.samples = std::max(100, opt.samples);
+    return true;
+}
+
+qint64 metaValue(QSqlQuery& query, const QString& key, qint64 fallback) {
+    query.prepare("SELECT value FROM meta WHERE key = :key");
+    query.bindValue(":key", key);
+    return query.exec() && query.next() ? query.value(0).toLongLong() : fallback;
+}
+
+qint64 scalar(QSqlQuery& query, const QString& sql) {
+    return query.exec(sql) && query.next() ? query.value(0).toLongLong() : 0;
+}
+
+// 读取数据集规模并抽样航班号与订单；不是 ftms_datagen 生成的库时按表内容估计
+bool loadDataset(const QString& path, int samples, Dataset* dataset) {
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kConnectionName);
+        db.setDatabaseName(path);
+        if (!db.open()) return false;
+        QSqlQuery query(db);
+        dataset->flights = metaValue(query, "datagen_flights", scalar(query, "SELECT COUNT(*) FROM flight"));
+        dataset->users = metaValue(query, "datagen_users", scalar(query, "SELECT COUNT(*) FROM user"));
+        dataset->tickets = metaValue(query, "datagen_tickets", scalar(query, "SELECT COUNT(*) FROM ticket"));
+        dataset->days = int(metaValue(query, "datagen_days", 60));
+        const qint64 start = metaValue(query, "datagen_start", 0);
+        dataset->startDate = start > 0 ? QDateTime::fromSecsSinceEpoch(start).date() : QDate::currentDate();
+
+        query.prepare("SELECT flight_id FROM flight WHERE id % :step = 0 LIMIT :limit");
+        query.bindValue(":step", std::max<qint64>(1, dataset->flights / samples));
+        query.bindValue(":limit", samples);
+        query.exec();
+        while (query.next()) dataset->flightIds.append(query.value(0).toString());
+
+        // 订单号按奇偶分给退票和改签两个池，互不重叠
+        query.prepare("SELECT order_id, user_id FROM ticket WHERE order_id % 2 = 0 LIMIT :limit");
+        query.bindValue(":limit", samples);
+        query.exec();
+        while (query.next()) dataset->cancelPool.push_back({query.value(0).toLongLong(), query.value(1).toLongLong(), {}});
+
+        query.prepare("SELECT t.order_id, t.user_id, "
+                      "(SELECT f2.flight_id FROM flight f2 WHERE f2.departure = f.departure "
+                      "AND f2.destination = f.destination AND f2.id <> f.id AND f2.rest_seats > 0 LIMIT 1) "
+                      "FROM ticket t JOIN flight f ON f.id = t.flight_ref WHERE t.order_id % 2 = 1 LIMIT :limit");
+        query.bindValue(":limit", samples);
+        query.exec();
+        while (query.next()) {
+            if (query.value(2).isNull()) continue;
+            dataset->changePool.push_back({query.value(0).toLongLong(), query.value(1).toLongLong(),
+                                           query.value(2).toString()});
+        }
+        ok = !dataset->flightIds.isEmpty() && dataset->users > 0;
+    }
+    QSqlDatabase::removeDatabase(kConnectionName);
+    return ok;
+}
+
+QString username(qint64 id) {
+    return QString("user%1").arg(id, 7, 10, QChar('0'));
+}
+
+QString randomSeat(Rng& rng) {
+    return QString("%1%2").arg(rng.range(1, 20)).arg(QChar('A' + rng.range(0, 5)));
+}
+
+// 执行一次操作，返回 false 表示操作失败（计入 errors），返回时 *exhausted 为 true 表示抽样已用完
+using Operation = std::function<bool(Rng& rng, bool* exhausted)>;
+
+Operation makeOperation(const QString& op, Dataset& data, const Options& opt) {
+    DBManager* db = DBManager::getInstance();
+    auto randomUser = [&data](Rng& rng) { return qint64(rng.range(1, int(data.users))); };
+    auto randomFlight = [&data](Rng& rng) { return data.flightIds[rng.range(0, data.flightIds.size() - 1)]; };
+    auto randomDate = [&data](Rng& rng) { return data.startDate.addDays(rng.range(0, data.days - 1)); };
+    auto randomCity = [&data](Rng& rng) { return data.cities[rng.range(0, data.cities.size() - 1)]; };
+
+    if (op == "verify_user") {
+        return [=](Rng& rng, bool*) {
+            return db->verifyUser(username(randomUser(rng)), opt.password) == Success;
+        };
+    }
+    if (op == "query_popular_date") {
+        return [=](Rng& rng, bool*) {
+            db->queryFlights(kPopularDeparture, kPopularDestination, randomDate(rng));
+            return true;
+        };
+    }
+    if (op == "query_popular") {
+        return [=](Rng&, bool*) {
+            db->queryFlights(kPopularDeparture, kPopularDestination, QDate());
+            return true;
+        };
+    }
+    if (op == "query_random_date") {
+        return [=](Rng& rng, bool*) {
+            db->queryFlights(randomCity(rng), randomCity(rng), randomDate(rng));
+            return true;
+        };
+    }
+    if (op == "query_empty") {
+        // 出发地与目的地相同的航线不存在，测量没有结果时的开销
+        return [=](Rng& rng, bool*) {
+            const QString city = randomCity(rng);
+            return db->queryFlights(city, city, randomDate(rng)).isEmpty();
+        };
+    }
+    if (op == "occupied_seats") {
+        return [=](Rng& rng, bool*) {
+            db->getOccupiedSeats(randomFlight(rng));
+            return true;
+        };
+    }
+    if (op == "orders") {
+        return [=](Rng& rng, bool*) {
+            db->queryUserOrders(randomUser(rng));
+            return true;
+        };
+    }
+    if (op == "book") {
+        return [=](Rng& rng, bool*) { return db->bookTicket(randomUser(rng), randomFlight(rng)) != 0; };
+    }
+    if (op == "book_with_seat") {
+        return [=](Rng& rng, bool*) {
+            return db->bookTicketWithSeat(randomUser(rng), randomFlight(rng), randomSeat(rng)) != 0;
+        };
+    }
+    if (op == "cancel") {
+        return [&data, db](Rng&, bool* exhausted) {
+            const size_t index = data.cancelNext.fetch_add(1);
+            if (index >= data.cancelPool.size()) {
+                *exhausted = true;
+                return true;
+            }
+            const OrderRef& order = data.cancelPool[index];
+            return db->cancelTicket(order.orderId, order.userId);
+        };
+    }
+    // change
+    return [&data, db](Rng& rng, bool* exhausted) {
+        const size_t index = data.changeNext.fetch_add(1);
+        if (index >= data.changePool.size()) {
+            *exhausted = true;
+            return true;
+        }
+        const OrderRef& order = data.changePool[index];
+        return db->changeTicket(order.orderId, order.userId, order.newFlightId, randomSeat(rng));
+    };
+}
+
+CaseResult runCase(const Operation& operation, int threads, double seconds) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<CaseResult> perThread(threads);
+    std::atomic<bool> exhausted{false};
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            Rng rng(0x9E3779B97F4A7C15ULL * (t + 1));
+            CaseResult& result = perThread[t];
+            while (!exhausted.load(std::memory_order_relaxed) && Clock::now() < deadline) {
+                bool done = false;
+                const auto begin = Clock::now();
+                const bool ok = operation(rng, &done);
+                const auto end = Clock::now();
+                if (done) {
+                    exhausted.store(true);
+                    break;
+                }
+                ++result.ops;
+                if (!ok) ++result.errors;
+                result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+            }
+            DBManager::getInstance()->releaseConnection();
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    CaseResult total;
+    total.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (CaseResult& result : perThread) {
+        total.ops += result.ops;
+        total.errors += result.errors;
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+    return total;
+}
+
+double percentileUs(const std::vector<qint64>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    const size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+    return sorted[index] / 1000.0;
+}
+
+void printResult(const Options& opt, const Dataset& data, const QString& op, int threads, const CaseResult& result) {
+    std::printf("{\"label\":\"%s\",\"dataset\":\"%s\",\"flights\":%lld,\"users\":%lld,\"tickets\":%lld,"
+                "\"op\":\"%s\",\"threads\":%d,\"seconds\":%.3f,\"ops\":%llu,\"errors\":%llu,\"ops_per_sec\":%.1f,"
+                "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+                qPrintable(opt.label), qPrintable(data.name), (long long)data.flights, (long long)data.users,
+                (long long)data.tickets, qPrintable(op), threads, result.seconds,
+                (unsigned long long)result.ops, (unsigned long long)result.errors,
+                result.seconds > 0 ? result.ops / result.seconds : 0.0,
+                percentileUs(result.latencies, 0.50), percentileUs(result.latencies, 0.90),
+                percentileUs(result.latencies, 0.99),
+                result.latencies.empty() ? 0.0 : result.latencies.back() / 1000.0);
+    std::fflush(stdout);
+}
+
+bool runDataset(const Options& opt, const QString& path) {
+    QTemporaryDir workDir;
+    const QString copy = workDir.filePath(QFileInfo(path).fileName());
+    if (!workDir.isValid() || !QFile::copy(path, copy)) {
+        std::fprintf(stderr, "无法复制数据集 %s\n", qPrintable(path));
+        return false;
+    }
+    if (QFileInfo::exists(path + "-wal")) QFile::copy(path + "-wal", copy + "-wal");
+
+    Dataset data;
+    data.name = QFileInfo(path).fileName();
+    if (!loadDataset(copy, opt.samples, &data)) {
+        std::fprintf(stderr, "数据集 %s 为空或无法读取\n", qPrintable(path));
+        return false;
+    }
+
+    DBManager* manager = DBManager::getInstance();
+    if (!manager->init(copy, false)) {
+        std::fprintf(stderr, "打开数据集 %s 失败\n", qPrintable(path));
+        return false;
+    }
+    data.cities = manager->getCities();
+    if (data.cities.isEmpty()) data.cities = {kPopularDeparture, kPopularDestination};
+
+    // 按 kAllOps 的顺序执行：读操作在前，写操作在后
+    for (const QString& op : kAllOps) {
+        if (!opt.ops.contains(op)) continue;
+        const Operation operation = makeOperation(op, data, opt);
+        for (int threads : opt.threads) {
+            printResult(opt, data, op, threads, runCase(operation, threads, opt.seconds));
+        }
+    }
+    manager->close();
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    // 每次调用都输出日志会淹没结果并拖慢测量，只保留警告以上
+    qInstallMessageHandler([](QtMsgType type, const QMessageLogContext&, const QString& message) {
+        if (type >= QtWarningMsg) std::fprintf(stderr, "%s\n", qPrintable(message));
+    });
+
+    for (const QString& path : opt.datasets) {
+        if (!runDataset(opt, path)) return 1;
+    }
+    return 0;
+}
@@ -3,90 +3,21 @@
 生成 10000 条覆盖中国主要机场的航班数据
 """
 
+import json
 import sqlite3
 import random
 from datetime import datetime, timedelta
 import os
 
-# ==================== 中国主要机场数据 ====================
-AIRPORTS = [
-    # 一线城市
-    ("北京", "北京首都国际机场", "PEK"),
-    ("北京", "北京大兴国际机场", "PKX"),
-    ("上海", "上海浦东国际机场", "PVG"),
-    ("上海", "上海虹桥国际机场", "SHA"),
-    ("广州", "广州白云国际机场", "CAN"),
-    ("深圳", "深圳宝安国际机场", "SZX"),
-    
-    # 新一线/二线城市
-    ("成都", "成都天府国际机场", "TFU"),
-    ("成都", "成都双流国际机场", "CTU"),
-    ("重庆", "重庆江北国际机场", "CKG"),
-    ("杭州", "杭州萧山国际机场", "HGH"),
-    ("南京", "南京禄口国际机场", "NKG"),
-    ("武汉", "武汉天河国际机场", "WUH"),
-    ("西安", "西安咸阳国际机场", "XIY"),
-    ("昆明", "昆明长水国际机场", "KMG"),
-    ("长沙", "长沙黄花国际机场", "CSX"),
-    ("郑州", "郑州新郑国际机场", "CGO"),
-    ("青岛", "青岛胶东国际机场", "TAO"),
-    ("厦门", "厦门高崎国际机场", "XMN"),
-    ("天津", "天津滨海国际机场", "TSN"),
-    ("沈阳", "沈阳桃仙国际机场", "SHE"),
-    ("大连", "大连周水子国际机场", "DLC"),
-    ("哈尔滨", "哈尔滨太平国际机场", "HRB"),
-    ("长春", "长春龙嘉国际机场", "CGQ"),
-    ("济南", "济南遥墙国际机场", "TNA"),
-    ("福州", "福州长乐国际机场", "FOC"),
-    ("合肥", "合肥新桥国际机场", "HFE"),
-    ("南昌", "南昌昌北国际机场", "KHN"),
-    ("太原", "太原武宿国际机场", "TYN"),
-    ("石家庄", "石家庄正定国际机场", "SJW"),
-    ("南宁", "南宁吴圩国际机场", "NNG"),
-    ("贵阳", "贵阳龙洞堡国际机场", "KWE"),
-    ("海口", "海口美兰国际机场", "HAK"),
-    ("三亚", "三亚凤凰国际机场", "SYX"),
-    ("兰州", "兰州中川国际机场", "LHW"),
-    ("乌鲁木齐", "乌鲁木齐地窝堡国际机场", "URC"),
-    ("呼和浩特", "呼和浩特白塔国际机场", "HET"),
-    ("银川", "银川河东国际机场", "INC"),
-    ("西宁", "西宁曹家堡国际机场", "XNN"),
-    ("拉萨", "拉萨贡嘎国际机场", "LXA"),
-    
-    # 其他重要城市
-    ("无锡", "苏南硕放国际机场", "WUX"),
-    ("宁波", "宁波栎社国际机场", "NGB"),
-    ("温州", "温州龙湾国际机场", "WNZ"),
-    ("珠海", "珠海金湾国际机场", "ZUH"),
-    ("汕头", "揭阳潮汕国际机场", "SWA"),
-    ("烟台", "烟台蓬莱国际机场", "YNT"),
-    ("威海", "威海大水泊国际机场", "WEH"),
-    ("桂林", "桂林两江国际机场", "KWL"),
-    ("丽江", "丽江三义国际机场", "LJG"),
-    ("西双版纳", "西双版纳嘎洒国际机场", "JHG"),
-    ("张家界", "张家界荷花国际机场", "DYG"),
-    ("九寨沟", "九寨黄龙机场", "JZH"),
-    ("敦煌", "敦煌莫高国际机场", "DNH"),
-]
+# ==================== 机场与航空公司目录 ====================
+# 与 ftms_datagen 共用 flight_catalog.json
+with open(os.path.join(os.path.dirname(os.path.abspath(__file__)), "flight_catalog.json"), encoding="utf-8") as _f:
+    _CATALOG = json.load(_f)
 
-# 航空公司代码
-AIRLINES = [
-    ("CA", "中国国际航空"),
-    ("MU", "中国东方航空"),
-    ("CZ", "中国南方航空"),
-    ("HU", "海南航空"),
-    ("ZH", "深圳航空"),
-    ("MF", "厦门航空"),
-    ("3U", "四川航空"),
-    ("FM", "上海航空"),
-    ("SC", "山东航空"),
-    ("GS", "天津航空"),
-    ("KN", "中国联合航空"),
-    ("9C", "春秋航空"),
-    ("HO", "吉祥航空"),
-    ("8L", "祥鹏航空"),
-    ("G5", "华夏航空"),
-]
+AIRPORTS = [(a["city"], a["name"], a["code"]) for a in _CATALOG["airports"]]
+AIRLINES = [(a["code"], a["name"]) for a in _CATALOG["airlines"]]
+HOT_CITIES = set(_CATALOG["hot_cities"])
+LONG_DISTANCE_CITIES = set(_CATALOG["long_distance_cities"])
 
 
 def generate_flight_id(airline_code: str, index: int) -> str:
@@ -97,9 +28,7 @@ def generate_flight_id(airline_code: str, index: int) -> str:
 def get_flight_duration(dep_city: str, arr_city: str) -> int:
     """根据城市估算飞行时间（分钟）"""
     # 简化：根据是否跨区域估算时长
-    long_distance_cities = {"乌鲁木齐", "拉萨", "哈尔滨", "三亚", "海口"}
-    
-    if dep_city in long_distance_cities or arr_city in long_distance_cities:
+    if dep_city in LONG_DISTANCE_CITIES or arr_city in LONG_DISTANCE_CITIES:
         return random.randint(180, 300)  # 3-5小时
     elif dep_city in {"北京", "上海", "广州"} and arr_city in {"北京", "上海", "广州"}:
         return random.randint(120, 180)  # 2-3小时
@@ -122,9 +51,6 @@ def generate_flights(num_flights: int = 10000):
     flights = []
     flight_index = 0
     
-    # 热门航线（一线城市之间）
-    hot_cities = {"北京", "上海", "广州", "深圳", "成都", "杭州", "重庆", "西安"}
-    
     # 生成未来60天的航班
     start_date = datetime.now().replace(hour=0, minute=0, second=0, microsecond=0)
     
@@ -154,7 +80,7 @@ def generate_flights(num_flights: int = 10000):
         arrive_time = depart_time + timedelta(minutes=duration)
         
         # 计算价格
-        is_hot = dep_airport[0] in hot_cities and arr_airport[0] in hot_cities
+        is_hot = dep_airport[0] in HOT_CITIES and arr_airport[0] in HOT_CITIES
         price = get_price(duration, is_hot)
         
         # 座位数（必须是6的倍数，适配前端座位选择界面：每排6座）
@@ -171,8 +97,9 @@ def generate_flights(num_flights: int = 10000):
             "destination": arr_airport[0],
             "departure_airport": dep_airport[1],
             "arrival_airport": arr_airport[1],
-            "depart_time": depart_time.strftime("%Y-%m-%dT%H:%M:%S"),
-            "arrive_time": arrive_time.strftime("%Y-%m-%dT%H:%M:%S"),
+            # 库中时间列为 Unix 秒（按本机时区解释）
+            "depart_time": int(depart_time.timestamp()),
+            "arrive_time": int(arrive_time.timestamp()),
             "price": price,
             "rest_seats": seats
         })
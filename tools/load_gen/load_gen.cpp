@@ -0,0 +1,720 @@
+// 协议级负载生成：不依赖界面，按 data_model.h 协议模拟真实用户会话，统计各请求类型的吞吐与延迟分位数
+//
+//   ftms_load --connections 2000 --threads 8 --rate 500 --seconds 60
+//   ftms_load --connections 200 --rate 0 --steps 12 --mix search:4,seats:2,book:1,orders:1,cancel:0.5
+//
+// 一个会话：登录 -> 按 --mix 权重抽取 --steps 个操作（城市列表、搜索、座位图、订票、订单、退票、AI 对话），
+// 操作间隔服从均值为 --think-ms 的指数分布 -> 退出登录。依赖前一步结果的操作（座位图、订票需要搜索结果，
+// 退票需要订单号）在缺少结果时改为先做前置操作。
+//
+// --rate > 0 为开环：会话按泊松过程到达（次/秒），到达时没有空闲连接则排队；会话第一个请求的延迟从
+// 计划到达时刻算起，排队时间计入延迟（协调遗漏修正），不会因服务端变慢而少发请求。
+// --rate 0 为闭环：每条连接结束一个会话后立即开始下一个，延迟从实际发送时刻算起。
+//
+// 账号为 ftms_datagen 生成的 user0000001 起的用户（--users、--password 与生成参数一致）。
+// 每条连接由所属线程的 epoll 驱动，结果以单行 JSON 输出
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDate>
+#include <QStringList>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "data_model.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Step { Login, Cities, Search, Seats, Book, Orders, Cancel, AIChat, Logout };
+
+struct StepInfo {
+    const char* name;
+    RequestType type;
+};
+
+const StepInfo kSteps[] = {
+    {"login", LoginRequest},
+    {"cities", GetCitiesRequest},
+    {"search", FlightQueryRequest},
+    {"seats", GetOccupiedSeatsRequest},
+    {"book", BookTicketRequest},
+    {"orders", MyOrdersRequest},
+    {"cancel", CancelTicketRequest},
+    {"ai", AIChatRequest},
+    {"logout", LogoutRequest},
+};
+constexpr int kStepCount = int(sizeof(kSteps) / sizeof(kSteps[0]));
+
+const QStringList kAiQuestions = {
+    "明天北京到上海有哪些航班？", "怎么退票？", "改签需要手续费吗？", "可以选靠窗的座位吗？",
+};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 12345;
+    int threads = 4;
+    int connections = 100;
+    double rate = 0;                // 会话到达率（次/秒），0 为闭环
+    int seconds = 30;
+    int steps = 8;                  // 每个会话登录后的操作数
+    double thinkMs = 200;
+    int users = 1000;
+    QString password = "123456";
+    QDate startDate = QDate::currentDate();
+    int days = 60;
+    int maxBacklog = 100000;        // 开环排队上限，超出的会话计为丢弃
+    // 默认权重：浏览多、下单少、AI 对话很少
+    double weights[kStepCount] = {0, 0.5, 4, 2, 1, 1, 0.5, 0.05, 0};
+};
+
+// 各线程独立统计，结束后合并
+struct Stats {
+    std::vector<quint32> latencies[kStepCount];    // 微秒
+    quint64 errors[kStepCount] = {};
+    std::vector<quint32> sessionDelay;             // 会话从计划到达到发出首个请求的等待（微秒）
+    quint64 sessionsStarted = 0;
+    quint64 sessionsCompleted = 0;
+    quint64 sessionsDropped = 0;
+    quint64 connectErrors = 0;
+
+    void merge(const Stats& other) {
+        for (int i = 0; i < kStepCount; ++i) {
+            latencies[i].insert(latencies[i].end(), other.latencies[i].begin(), other.latencies[i].end());
+            errors[i] += other.errors[i];
+        }
+        sessionDelay.insert(sessionDelay.end(), other.sessionDelay.begin(), other.sessionDelay.end());
+        sessionsStarted += other.sessionsStarted;
+        sessionsCompleted += other.sessionsCompleted;
+        sessionsDropped += other.sessionsDropped;
+        connectErrors += other.connectErrors;
+    }
+};
+
+QByteArray buildRequestFrame(RequestType type, const QByteArray& data) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (int)type << data;
+
+    QByteArray frame;
+    QDataStream frameOut(&frame, QIODevice::WriteOnly);
+    frameOut.setVersion(QDataStream::Qt_6_0);
+    frameOut << (quint32)payload.size();
+    frame.append(payload);
+    return frame;
+}
+
+template <typename... Args>
+QByteArray encode(const Args&... args) {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    (out << ... << args);
+    return data;
+}
+
+QString username(int id) {
+    return QString("user%1").arg(id, 7, 10, QChar('0'));
+}
+
+int openSocket(const Options& opt, bool blocking) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM | (blocking ? 0 : SOCK_NONBLOCK), 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    ::inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 启动前用一条阻塞连接取城市列表，供搜索随机选取航线
+QStringList fetchCities(const Options& opt) {
+    const int fd = openSocket(opt, true);
+    if (fd < 0) return {};
+    const QByteArray frame = buildRequestFrame(GetCitiesRequest, QByteArray());
+    QStringList cities;
+    if (::send(fd, frame.constData(), frame.size(), MSG_NOSIGNAL) == frame.size()) {
+        QByteArray reply;
+        char buffer[65536];
+        ssize_t n;
+        while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            reply.append(buffer, n);
+            if (reply.size() >= 4 && reply.size() >= 4 + qint64(qFromBigEndian<quint32>(reply.constData()))) break;
+        }
+        QDataStream in(reply.mid(4));
+        in.setVersion(QDataStream::Qt_6_0);
+        qint32 status = -1;
+        QByteArray data;
+        in >> status >> data;
+        QDataStream dataIn(data);
+        dataIn.setVersion(QDataStream::Qt_6_0);
+        quint32 version = 0;
+        if (status == Success) dataIn >> version >> cities;
+    }
+    ::close(fd);
+    return cities;
+}
+
+struct Session {
+    int stepsLeft = 0;
+    bool loggedIn = false;
+    QStringList flightIds;          // 最近一次搜索结果
+    QString seatFlight;             // 最近一次座位图对应的航班
+    QStringList occupied;
+    QStringList orderIds;
+};
+
+struct Connection {
+    int fd = -1;
+    bool connected = false;
+    bool inSession = false;
+    bool awaiting = false;
+    bool watchingWrite = true;
+    quint64 serial = 0;             // 会话序号，用于丢弃旧会话遗留的定时器
+    Step step = Step::Login;
+    Clock::time_point intended;     // 本请求的计划发送时刻，延迟从此算起
+    QByteArray out;
+    qsizetype outOffset = 0;
+    QByteArray in;
+    Session session;
+};
+
+class Worker {
+public:
+    Worker(const Options& opt, const QStringList& cities, int index, int connections, Clock::time_point deadline)
+        : m_opt(opt), m_cities(cities), m_connections(connections), m_deadline(deadline),
+          m_rng(0x9E3779B97F4A7C15ULL * (index + 1)) {
+        double total = 0;
+        for (int i = 0; i < kStepCount; ++i) total += opt.weights[i];
+        double running = 0;
+        for (int i = 0; i < kStepCount; ++i) {
+            running += opt.weights[i];
+            m_cumulative[i] = total > 0 ? running / total : 0;
+        }
+        m_ratePerThread = opt.rate / opt.threads;
+    }
+
+    void run();
+    const Stats& stats() const { return m_stats; }
+
+private:
+    double unit() { return double(m_rng() >> 11) * (1.0 / 9007199254740992.0); }
+    int range(int lo, int hi) { return lo + int(m_rng() % quint64(hi - lo + 1)); }
+    Clock::duration exponential(double meanSecs) {
+        const double secs = -std::log(1.0 - unit()) * meanSecs;
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(secs));
+    }
+
+    bool open(int index);
+    void reset(int index);
+    void startSession(int index, Clock::time_point intended);
+    void schedule(int index, Clock::time_point at);
+    void sendStep(int index, Clock::time_point intended);
+    Step chooseStep(const Session& session);
+    QByteArray buildStep(Connection& conn, Step step);
+    void watch(int index, bool writable);
+    void flush(int index);
+    void onReadable(int index);
+    void onResponse(int index, qint32 status, const QByteArray& data);
+    int timeoutMs(Clock::time_point now) const;
+
+    const Options& m_opt;
+    const QStringList& m_cities;
+    int m_connections;
+    Clock::time_point m_deadline;
+    std::mt19937_64 m_rng;
+    double m_cumulative[kStepCount] = {};
+    double m_ratePerThread = 0;
+
+    int m_epoll = -1;
+    std::vector<Connection> m_conns;
+    std::vector<int> m_idle;
+    std::deque<Clock::time_point> m_backlog;    // 已到达、等待空闲连接的会话
+    Clock::time_point m_nextArrival;
+    // 思考时间结束后要发送下一步的连接
+    using Timer = std::tuple<Clock::time_point, int, quint64>;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> m_timers;
+    quint64 m_nextSerial = 0;
+    Stats m_stats;
+};
+
+bool Worker::open(int index) {
+    Connection& conn = m_conns[index];
+    conn = Connection();
+    conn.fd = openSocket(m_opt, false);
+    if (conn.fd < 0) {
+        m_stats.connectErrors++;
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    event.data.u32 = quint32(index);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, conn.fd, &event);
+    return true;
+}
+
+// 连接出错：当前请求计为错误，会话作废，重新建连
+void Worker::reset(int index) {
+    Connection& conn = m_conns[index];
+    if (conn.awaiting) m_stats.errors[int(conn.step)]++;
+    if (conn.fd >= 0) {
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, conn.fd, nullptr);
+        ::close(conn.fd);
+    }
+    open(index);
+}
+
+void Worker::startSession(int index, Clock::time_point intended) {
+    Connection& conn = m_conns[index];
+    conn.inSession = true;
+    conn.serial = ++m_nextSerial;
+    conn.session = Session();
+    conn.session.stepsLeft = m_opt.steps;
+    m_stats.sessionsStarted++;
+    const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - intended).count();
+    m_stats.sessionDelay.push_back(quint32(std::max<qint64>(0, delay)));
+    sendStep(index, intended);
+}
+
+void Worker::schedule(int index, Clock::time_point at) {
+    m_timers.emplace(at, index, m_conns[index].serial);
+}
+
+Step Worker::chooseStep(const Session& session) {
+    if (!session.loggedIn) return Step::Login;
+    if (session.stepsLeft <= 0) return Step::Logout;
+
+    const double u = unit();
+    Step step = Step::Search;
+    for (int i = 0; i < kStepCount; ++i) {
+        if (u < m_cumulative[i]) {
+            step = Step(i);
+            break;
+        }
+    }
+    if ((step == Step::Seats || step == Step::Book) && session.flightIds.isEmpty()) return Step::Search;
+    if (step == Step::Cancel && session.orderIds.isEmpty()) return Step::Orders;
+    return step;
+}
+
+QByteArray Worker::buildStep(Connection& conn, Step step) {
+    Session& session = conn.session;
+    switch (step) {
+    case Step::Login: {
+        User user;
+        user.username = username(range(1, m_opt.users));
+        user.password = m_opt.password;
+        return buildRequestFrame(LoginRequest, encode(user));
+    }
+    case Step::Cities:
+        return buildRequestFrame(GetCitiesRequest, QByteArray());
+    case Step::Search: {
+        const QString from = m_cities[range(0, m_cities.size() - 1)];
+        QString to = m_cities[range(0, m_cities.size() - 1)];
+        const QDate date = m_opt.startDate.addDays(range(0, m_opt.days - 1));
+        return buildRequestFrame(FlightQueryRequest, encode(from, to, date));
+    }
+    case Step::Seats:
+        session.seatFlight = session.flightIds[range(0, session.flightIds.size() - 1)];
+        return buildRequestFrame(GetOccupiedSeatsRequest, encode(session.seatFlight));
+    case Step::Book: {
+        // 看过座位图的航班选一个空座，否则由服务端随机分配
+        QString flightId = session.flightIds[range(0, session.flightIds.size() - 1)];
+        QString seat;
+        if (!session.seatFlight.isEmpty()) {
+            flightId = session.seatFlight;
+            for (int attempt = 0; attempt < 20 && seat.isEmpty(); ++attempt) {
+                const QString candidate = QString("%1%2").arg(range(1, 20)).arg(QChar('A' + range(0, 5)));
+                if (!session.occupied.contains(candidate)) seat = candidate;
+            }
+        }
+        return buildRequestFrame(BookTicketRequest, encode(flightId, seat));
+    }
+    case Step::Orders:
+        return buildRequestFrame(MyOrdersRequest, encode(quint64(0), QString(), kOrdersPageSize));
+    case Step::Cancel: {
+        const int pick = range(0, session.orderIds.size() - 1);
+        const QString orderId = session.orderIds.takeAt(pick);
+        return buildRequestFrame(CancelTicketRequest, encode(orderId));
+    }
+    case Step::AIChat:
+        return buildRequestFrame(AIChatRequest, encode(kAiQuestions[range(0, kAiQuestions.size() - 1)]));
+    case Step::Logout:
+        return buildRequestFrame(LogoutRequest, QByteArray());
+    }
+    return QByteArray();
+}
+
+void Worker::sendStep(int index, Clock::time_point intended) {
+    Connection& conn = m_conns[index];
+    conn.step = chooseStep(conn.session);
+    conn.out.append(buildStep(conn, conn.step));
+    conn.intended = intended;
+    conn.awaiting = true;
+    flush(index);
+}
+
+// 仅在有未发完的数据（或尚未建连）时关注可写事件，避免水平触发空转
+void Worker::watch(int index, bool writable) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0);
+    event.data.u32 = quint32(index);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_conns[index].fd, &event);
+    m_conns[index].watchingWrite = writable;
+}
+
+void Worker::flush(int index) {
+    Connection& conn = m_conns[index];
+    if (!conn.connected) return;
+    while (conn.outOffset < conn.out.size()) {
+        const ssize_t n = ::send(conn.fd, conn.out.constData() + conn.outOffset, conn.out.size() - conn.outOffset,
+                                 MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.outOffset += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watch(index, true);
+            return;
+        } else {
+            reset(index);
+            return;
+        }
+    }
+    if (conn.watchingWrite) watch(index, false);
+    conn.out.clear();
+    conn.outOffset = 0;
+}
+
+void Worker::onReadable(int index) {
+    Connection& conn = m_conns[index];
+    char buffer[65536];
+    for (;;) {
+        const ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        reset(index);
+        return;
+    }
+
+    // 未握手，服务端不会发送压缩帧
+    while (conn.in.size() >= 4) {
+        const quint32 size = qFromBigEndian<quint32>(conn.in.constData());
+        if (size & kFrameCompressedFlag) {
+            reset(index);
+            return;
+        }
+        if (conn.in.size() < qsizetype(4 + size)) break;
+        QDataStream in(QByteArray::fromRawData(conn.in.constData() + 4, size));
+        in.setVersion(QDataStream::Qt_6_0);
+        qint32 status = -1;
+        QByteArray data;
+        in >> status >> data;
+        conn.in.remove(0, 4 + size);
+        if (status == HeartbeatAck) continue;
+        onResponse(index, status, data);
+    }
+}
+
+void Worker::onResponse(int index, qint32 status, const QByteArray& data) {
+    Connection& conn = m_conns[index];
+    if (!conn.awaiting) return;
+    conn.awaiting = false;
+
+    const Clock::time_point now = Clock::now();
+    const int step = int(conn.step);
+    m_stats.latencies[step].push_back(
+        quint32(std::chrono::duration_cast<std::chrono::microseconds>(now - conn.intended).count()));
+
+    // 查无航班、座位已满、缓存未变化属于正常业务结果
+    const bool ok = status == Success || status == NotModified || status == FlightNotFound || status == NoSeatsLeft;
+    if (!ok) m_stats.errors[step]++;
+
+    Session& session = conn.session;
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    switch (conn.step) {
+    case Step::Login:
+        if (status != Success) {
+            // 登录失败（账号不存在或服务端繁忙）结束本会话
+            session.stepsLeft = 0;
+        }
+        session.loggedIn = status == Success;
+        break;
+    case Step::Search: {
+        quint32 count = 0;
+        in >> count;
+        session.flightIds.clear();
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            Flight flight;
+            in >> flight;
+            if (flight.rest_seats > 0) session.flightIds.append(flight.flight_id);
+        }
+        session.seatFlight.clear();
+        break;
+    }
+    case Step::Seats:
+        in >> session.occupied;
+        break;
+    case Step::Book: {
+        QString orderId;
+        in >> orderId;
+        if (status == Success && !orderId.isEmpty()) session.orderIds.append(orderId);
+        session.seatFlight.clear();
+        break;
+    }
+    case Step::Orders: {
+        quint8 kind = 0;
+        quint64 version = 0;
+        QString cursor;
+        quint32 count = 0;
+        in >> kind >> version >> cursor >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            Order order;
+            in >> order;
+            if (!session.orderIds.contains(order.order_id)) session.orderIds.append(order.order_id);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (conn.step == Step::Logout || (conn.step == Step::Login && !session.loggedIn)) {
+        conn.inSession = false;
+        m_stats.sessionsCompleted++;
+        m_idle.push_back(index);
+        return;
+    }
+    if (conn.step != Step::Login) session.stepsLeft--;
+    schedule(index, now + exponential(m_opt.thinkMs / 1000.0));
+}
+
+int Worker::timeoutMs(Clock::time_point now) const {
+    Clock::time_point next = m_deadline;
+    if (m_ratePerThread > 0) next = std::min(next, m_nextArrival);
+    if (!m_timers.empty()) next = std::min(next, std::get<0>(m_timers.top()));
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+    return int(std::clamp<qint64>(ms, 0, 10));
+}
+
+void Worker::run() {
+    m_epoll = ::epoll_create1(0);
+    m_conns.resize(m_connections);
+    for (int i = 0; i < m_connections; ++i) {
+        open(i);
+    }
+    m_nextArrival = Clock::now();
+
+    std::vector<epoll_event> events(1024);
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        if (now >= m_deadline) break;
+
+        // 开环：按泊松过程生成到达时刻，排队等待空闲连接
+        while (m_ratePerThread > 0 && m_nextArrival <= now) {
+            if (int(m_backlog.size()) < m_opt.maxBacklog) {
+                m_backlog.push_back(m_nextArrival);
+            } else {
+                m_stats.sessionsDropped++;
+            }
+            m_nextArrival += exponential(1.0 / m_ratePerThread);
+        }
+        while (!m_idle.empty()) {
+            const int index = m_idle.back();
+            if (!m_conns[index].connected || m_conns[index].inSession) {
+                m_idle.pop_back();
+                continue;
+            }
+            if (m_ratePerThread > 0) {
+                if (m_backlog.empty()) break;
+                m_idle.pop_back();
+                const Clock::time_point intended = m_backlog.front();
+                m_backlog.pop_front();
+                startSession(index, intended);
+            } else {
+                m_idle.pop_back();
+                startSession(index, now);
+            }
+        }
+        while (!m_timers.empty() && std::get<0>(m_timers.top()) <= now) {
+            const auto [at, index, serial] = m_timers.top();
+            m_timers.pop();
+            const Connection& conn = m_conns[index];
+            if (conn.inSession && conn.serial == serial && !conn.awaiting) sendStep(index, at);
+        }
+
+        const int ready = ::epoll_wait(m_epoll, events.data(), int(events.size()), timeoutMs(Clock::now()));
+        for (int i = 0; i < ready; ++i) {
+            const int index = int(events[i].data.u32);
+            Connection& conn = m_conns[index];
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                if (!conn.connected) m_stats.connectErrors++;
+                reset(index);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !conn.connected) {
+                conn.connected = true;
+                watch(index, false);
+                m_idle.push_back(index);
+            }
+            if (events[i].events & EPOLLOUT) flush(index);
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) onReadable(index);
+        }
+    }
+
+    for (Connection& conn : m_conns) {
+        if (conn.fd >= 0) ::close(conn.fd);
+    }
+    ::close(m_epoll);
+}
+
+bool parseMix(const QString& text, Options& opt) {
+    std::fill(std::begin(opt.weights), std::end(opt.weights), 0.0);
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList pair = part.split(':');
+        int step = -1;
+        for (int i = 0; i < kStepCount; ++i) {
+            if (pair.value(0) == kSteps[i].name) step = i;
+        }
+        if (step < 0 || step == int(Step::Login) || step == int(Step::Logout)) return false;
+        opt.weights[step] = pair.value(1, "1").toDouble();
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--host") opt.host = value();
+        else if (arg == "--port") opt.port = std::atoi(value());
+        else if (arg == "--threads") opt.threads = std::atoi(value());
+        else if (arg == "--connections") opt.connections = std::atoi(value());
+        else if (arg == "--rate") opt.rate = std::atof(value());
+        else if (arg == "--seconds") opt.seconds = std::atoi(value());
+        else if (arg == "--steps") opt.steps = std::atoi(value());
+        else if (arg == "--think-ms") opt.thinkMs = std::atof(value());
+        else if (arg == "--users") opt.users = std::atoi(value());
+        else if (arg == "--password") opt.password = QString::fromLocal8Bit(value());
+        else if (arg == "--start-date") opt.startDate = QDate::fromString(value(), Qt::ISODate);
+        else if (arg == "--days") opt.days = std::atoi(value());
+        else if (arg == "--mix") ok = parseMix(value(), opt) && ok;
+        else ok = false;
+    }
+    if (!ok || !opt.startDate.isValid()) {
+        std::fprintf(stderr,
+                     "用法: %s [--host H] [--port P] [--threads N] [--connections N] [--rate 会话/秒，0 为闭环]\n"
+                     "          [--seconds N] [--steps N] [--think-ms MS] [--users N] [--password P]\n"
+                     "          [--start-date YYYY-MM-DD] [--days N] [--mix cities:W,search:W,seats:W,book:W,orders:W,cancel:W,ai:W]\n",
+                     argv[0]);
+        return false;
+    }
+    opt.threads = std::max(1, opt.threads);
+    opt.connections = std::max(opt.threads, opt.connections);
+    opt.seconds = std::max(1, opt.seconds);
+    opt.steps = std::max(0, opt.steps);
+    opt.users = std::max(1, opt.users);
+    opt.days = std::max(1, opt.days);
+    return true;
+}
+
+double percentileMs(std::vector<quint32>& values, double p) {
+    if (values.empty()) return 0.0;
+    const size_t index = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    const QStringList cities = fetchCities(opt);
+    if (cities.size() < 2) {
+        std::fprintf(stderr, "获取城市列表失败，请确认服务端已启动且已有航班数据\n");
+        return 1;
+    }
+
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::seconds(opt.seconds);
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; ++t) {
+        const int share = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(opt, cities, t, share, deadline));
+    }
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker]() { worker->run(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Stats total;
+    for (auto& worker : workers) {
+        total.merge(worker->stats());
+    }
+
+    std::string requests;
+    for (int i = 0; i < kStepCount; ++i) {
+        std::vector<quint32>& values = total.latencies[i];
+        if (values.empty() && total.errors[i] == 0) continue;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "%s\"%s\":{\"type\":%d,\"count\":%zu,\"errors\":%llu,\"per_sec\":%.1f,"
+                      "\"p50_ms\":%.2f,\"p90_ms\":%.2f,\"p99_ms\":%.2f,\"p999_ms\":%.2f,\"max_ms\":%.2f}",
+                      requests.empty() ? "" : ",", kSteps[i].name, int(kSteps[i].type), values.size(),
+                      (unsigned long long)total.errors[i], values.size() / elapsed,
+                      percentileMs(values, 0.50), percentileMs(values, 0.90), percentileMs(values, 0.99),
+                      percentileMs(values, 0.999), percentileMs(values, 1.0));
+        requests += line;
+    }
+
+    std::printf("{\"mode\":\"%s\",\"rate\":%.1f,\"threads\":%d,\"connections\":%d,\"steps\":%d,\"think_ms\":%.1f,"
+                "\"seconds\":%.3f,\"sessions_started\":%llu,\"sessions_completed\":%llu,\"sessions_dropped\":%llu,"
+                "\"connect_errors\":%llu,\"session_delay_p50_ms\":%.2f,\"session_delay_p99_ms\":%.2f,"
+                "\"requests\":{%s}}\n",
+                opt.rate > 0 ? "open" : "closed", opt.rate, opt.threads, opt.connections, opt.steps, opt.thinkMs,
+                elapsed, (unsigned long long)total.sessionsStarted, (unsigned long long)total.sessionsCompleted,
+                (unsigned long long)total.sessionsDropped, (unsigned long long)total.connectErrors,
+                percentileMs(total.sessionDelay, 0.50), percentileMs(total.sessionDelay, 0.99), requests.c_str());
+    return 0;
+}
@@ -0,0 +1,404 @@
+// 网络后端压测：分别对 Qt 后端与 epoll 后端运行，比较建连速率与请求吞吐
+//
+//   ftms_net_bench --mode connect --threads 8 --seconds 10
+//   ftms_net_bench --mode rpc --connections 256 --threads 8 --pipeline 4 --request heartbeat
+//   ftms_net_bench --mode login --connections 64 --threads 8 --users 200
+//
+// login 模式模拟登录高峰：先注册一批压测账号，再并发循环登录，统计登录延迟分位数；
+// 同时用一条独立连接持续发送心跳，观察口令哈希是否拖慢网络线程
+//
+// 结果以单行 JSON 输出，便于对比不同后端、不同提交之间的差异
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "data_model.h"
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 12345;
+    std::string mode = "rpc";        // connect | rpc | login
+    std::string request = "heartbeat"; // heartbeat | cities
+    int threads = 4;
+    int connections = 64;
+    int pipeline = 1;
+    int seconds = 10;
+    int users = 100;                 // login 模式的压测账号数
+};
+
+QByteArray buildRequestFrame(RequestType type, const QByteArray& data) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << (int)type << data;
+
+    QByteArray frame;
+    QDataStream frameOut(&frame, QIODevice::WriteOnly);
+    frameOut.setVersion(QDataStream::Qt_6_0);
+    frameOut << (quint32)payload.size();
+    frame.append(payload);
+    return frame;
+}
+
+int connectTo(const Options& opt) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    ::inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::recv(fd, data, size, 0);
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// 读取一条应答帧，返回其状态码；连接出错时返回 -1
+int readResponse(int fd, std::vector<char>& buffer) {
+    char header[sizeof(quint32)];
+    if (!readAll(fd, header, sizeof(header))) return -1;
+    const quint32 size = qFromBigEndian<quint32>(header);
+    buffer.resize(size);
+    if (size > 0 && !readAll(fd, buffer.data(), size)) return -1;
+    if (size < sizeof(qint32)) return -1;
+    return qFromBigEndian<qint32>(buffer.data());
+}
+
+struct Counters {
+    std::atomic<quint64> completed{0};
+    std::atomic<quint64> errors{0};
+    std::atomic<quint64> busy{0};
+};
+
+// 各线程的延迟样本（微秒），结束后合并计算分位数
+struct LatencySamples {
+    std::mutex mutex;
+    std::vector<quint32> values;
+
+    void merge(const std::vector<quint32>& local) {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.insert(values.end(), local.begin(), local.end());
+    }
+};
+
+double percentileMs(std::vector<quint32>& values, double p) {
+    if (values.empty()) return 0.0;
+    const size_t index = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+QByteArray buildUserFrame(RequestType type, const QString& username, const QString& password) {
+    User user;
+    user.username = username;
+    user.password = password;
+    user.real_name = username;
+    user.phone = "13800000000";
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << user;
+    return buildRequestFrame(type, data);
+}
+
+QString benchUser(int index) {
+    return QString("bench_user_%1").arg(index);
+}
+const QString kBenchPassword = "bench_pass_123";
+
+// 每次新建连接、完成一次心跳往返后关闭，衡量 accept + 首包处理能力
+void runConnectWorker(const Options& opt, const QByteArray& frame,
+                      std::chrono::steady_clock::time_point deadline, Counters& counters) {
+    std::vector<char> buffer;
+    while (std::chrono::steady_clock::now() < deadline) {
+        const int fd = connectTo(opt);
+        if (fd < 0) {
+            counters.errors++;
+            continue;
+        }
+        if (writeAll(fd, frame.constData(), frame.size()) && readResponse(fd, buffer) >= 0) {
+            counters.completed++;
+        } else {
+            counters.errors++;
+        }
+        ::close(fd);
+    }
+}
+
+// 每个线程持有若干长连接，轮流发送 pipeline 条请求后收齐应答
+void runRpcWorker(const Options& opt, int connectionCount, const QByteArray& frame,
+                  std::chrono::steady_clock::time_point deadline, Counters& counters) {
+    std::vector<int> fds;
+    for (int i = 0; i < connectionCount; ++i) {
+        const int fd = connectTo(opt);
+        if (fd < 0) {
+            counters.errors++;
+            continue;
+        }
+        fds.push_back(fd);
+    }
+
+    QByteArray batch;
+    for (int i = 0; i < opt.pipeline; ++i) {
+        batch.append(frame);
+    }
+
+    std::vector<char> buffer;
+    while (!fds.empty() && std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < fds.size();) {
+            bool ok = writeAll(fds[i], batch.constData(), batch.size());
+            for (int p = 0; ok && p < opt.pipeline; ++p) {
+                ok = readResponse(fds[i], buffer) >= 0;
+                if (ok) counters.completed++;
+            }
+            if (!ok) {
+                counters.errors++;
+                ::close(fds[i]);
+                fds[i] = fds.back();
+                fds.pop_back();
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+// 依次注册压测账号，已存在的账号注册失败可忽略
+bool registerBenchUsers(const Options& opt) {
+    const int fd = connectTo(opt);
+    if (fd < 0) return false;
+    std::vector<char> buffer;
+    bool ok = true;
+    for (int i = 0; ok && i < opt.users; ++i) {
+        const QByteArray frame = buildUserFrame(RegisterRequest, benchUser(i), kBenchPassword);
+        ok = writeAll(fd, frame.constData(), frame.size()) && readResponse(fd, buffer) >= 0;
+    }
+    ::close(fd);
+    return ok;
+}
+
+// 每条连接一问一答地循环登录随机账号，记录单次登录往返延迟
+void runLoginWorker(const Options& opt, int connectionCount, std::chrono::steady_clock::time_point deadline,
+                    Counters& counters, LatencySamples& samples) {
+    std::vector<int> fds;
+    for (int i = 0; i < connectionCount; ++i) {
+        const int fd = connectTo(opt);
+        if (fd < 0) {
+            counters.errors++;
+            continue;
+        }
+        fds.push_back(fd);
+    }
+
+    std::vector<QByteArray> frames;
+    for (int i = 0; i < opt.users; ++i) {
+        frames.push_back(buildUserFrame(LoginRequest, benchUser(i), kBenchPassword));
+    }
+
+    std::mt19937 rng(std::random_device{}());
+    std::vector<quint32> latencies;
+    std::vector<char> buffer;
+    while (!fds.empty() && std::chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < fds.size();) {
+            const QByteArray& frame = frames[rng() % frames.size()];
+            const auto begin = std::chrono::steady_clock::now();
+            int status = -1;
+            if (writeAll(fds[i], frame.constData(), frame.size())) {
+                status = readResponse(fds[i], buffer);
+            }
+            if (status < 0) {
+                counters.errors++;
+                ::close(fds[i]);
+                fds[i] = fds.back();
+                fds.pop_back();
+                continue;
+            }
+            if (status == ServerBusy) {
+                counters.busy++;
+            } else {
+                counters.completed++;
+                latencies.push_back(quint32(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count()));
+            }
+            ++i;
+        }
+    }
+
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    samples.merge(latencies);
+}
+
+// 登录高峰期间每 10ms 发一次心跳，心跳延迟反映网络线程是否被阻塞
+void runHeartbeatProbe(const Options& opt, std::chrono::steady_clock::time_point deadline, LatencySamples& samples) {
+    const int fd = connectTo(opt);
+    if (fd < 0) return;
+    const QByteArray frame = buildRequestFrame(HeartbeatRequest, QByteArray());
+    std::vector<quint32> latencies;
+    std::vector<char> buffer;
+    while (std::chrono::steady_clock::now() < deadline) {
+        const auto begin = std::chrono::steady_clock::now();
+        if (!writeAll(fd, frame.constData(), frame.size()) || readResponse(fd, buffer) < 0) break;
+        latencies.push_back(quint32(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - begin).count()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    samples.merge(latencies);
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--host") opt.host = value();
+        else if (arg == "--port") opt.port = std::atoi(value());
+        else if (arg == "--mode") opt.mode = value();
+        else if (arg == "--request") opt.request = value();
+        else if (arg == "--threads") opt.threads = std::atoi(value());
+        else if (arg == "--connections") opt.connections = std::atoi(value());
+        else if (arg == "--pipeline") opt.pipeline = std::atoi(value());
+        else if (arg == "--seconds") opt.seconds = std::atoi(value());
+        else if (arg == "--users") opt.users = std::atoi(value());
+        else {
+            std::fprintf(stderr,
+                         "用法: %s [--host H] [--port P] [--mode connect|rpc|login] [--request heartbeat|cities]\n"
+                         "          [--threads N] [--connections N] [--pipeline N] [--seconds N] [--users N]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    opt.threads = std::max(1, opt.threads);
+    opt.connections = std::max(opt.threads, opt.connections);
+    opt.pipeline = std::max(1, opt.pipeline);
+    opt.seconds = std::max(1, opt.seconds);
+    opt.users = std::max(1, opt.users);
+    return true;
+}
+
+int runLoginBench(const Options& opt) {
+    if (!registerBenchUsers(opt)) {
+        std::fprintf(stderr, "注册压测账号失败，请确认服务端已启动\n");
+        return 1;
+    }
+
+    Counters counters;
+    LatencySamples loginSamples;
+    LatencySamples heartbeatSamples;
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::seconds(opt.seconds);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < opt.threads; ++t) {
+        const int share = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        workers.emplace_back(runLoginWorker, std::cref(opt), share, deadline,
+                             std::ref(counters), std::ref(loginSamples));
+    }
+    workers.emplace_back(runHeartbeatProbe, std::cref(opt), deadline, std::ref(heartbeatSamples));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<quint32>& login = loginSamples.values;
+    std::vector<quint32>& heartbeat = heartbeatSamples.values;
+    std::printf("{\"mode\":\"login\",\"threads\":%d,\"connections\":%d,\"users\":%d,\"seconds\":%.3f,"
+                "\"completed\":%llu,\"busy\":%llu,\"errors\":%llu,\"logins_per_sec\":%.1f,"
+                "\"login_p50_ms\":%.2f,\"login_p90_ms\":%.2f,\"login_p99_ms\":%.2f,\"login_max_ms\":%.2f,"
+                "\"heartbeat_p50_ms\":%.2f,\"heartbeat_p99_ms\":%.2f}\n",
+                opt.threads, opt.connections, opt.users, elapsed,
+                (unsigned long long)counters.completed.load(), (unsigned long long)counters.busy.load(),
+                (unsigned long long)counters.errors.load(), counters.completed.load() / elapsed,
+                percentileMs(login, 0.50), percentileMs(login, 0.90), percentileMs(login, 0.99),
+                percentileMs(login, 1.0),
+                percentileMs(heartbeat, 0.50), percentileMs(heartbeat, 0.99));
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    if (opt.mode == "login") return runLoginBench(opt);
+
+    const RequestType type = opt.request == "cities" ? GetCitiesRequest : HeartbeatRequest;
+    const QByteArray frame = buildRequestFrame(type, QByteArray());
+
+    Counters counters;
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::seconds(opt.seconds);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < opt.threads; ++t) {
+        if (opt.mode == "connect") {
+            workers.emplace_back(runConnectWorker, std::cref(opt), std::cref(frame), deadline, std::ref(counters));
+        } else {
+            const int share = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+            workers.emplace_back(runRpcWorker, std::cref(opt), share, std::cref(frame), deadline, std::ref(counters));
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const quint64 completed = counters.completed.load();
+    std::printf("{\"mode\":\"%s\",\"request\":\"%s\",\"threads\":%d,\"connections\":%d,\"pipeline\":%d,"
+                "\"seconds\":%.3f,\"completed\":%llu,\"errors\":%llu,\"%s\":%.1f}\n",
+                opt.mode.c_str(), opt.request.c_str(), opt.threads,
+                opt.mode == "connect" ? opt.threads : opt.connections, opt.pipeline, elapsed,
+                (unsigned long long)completed, (unsigned long long)counters.errors.load(),
+                opt.mode == "connect" ? "connections_per_sec" : "requests_per_sec", completed / elapsed);
+    return 0;
+}
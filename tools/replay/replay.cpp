@@ -0,0 +1,630 @@
+// 流量重放：读取服务端 FTMS_CAPTURE_FILE 抓取的文件，按原连接、原请求帧重新发给服务端，
+// 把每个应答状态与抓取时的应答状态按先后比对，统计各请求类型的延迟与不一致情况
+//
+//   ftms_replay capture.bin                         按抓取时的节奏重放（1x）
+//   ftms_replay --speed 10 capture.bin.2 capture.bin.1 capture.bin
+//   ftms_replay --speed max --concurrency 256 capture.bin
+//
+// 轮转产生的多个文件可一起传入，按文件头中的时间基准自动排序。--speed N 为开环：第 k 个请求在
+// 抓取时刻 / N 时发出，不等待之前的应答，延迟从计划发送时刻算起。--speed max 为闭环：各连接收到上一个
+// 应答后立即发送下一个请求，同时进行的连接不超过 --concurrency。
+//
+// 会话令牌、订单号等随数据库状态变化，重放前应恢复抓取开始时的数据库快照，否则不一致主要来自状态差异。
+// 文件格式见 backend/network/traffic_capture.h；结果以单行 JSON 输出
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "data_model.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 与 backend/network/traffic_capture.h 保持一致
+const char kMagic[] = "FTMSCAP1";
+constexpr int kHeaderBytes = 24;
+enum RecordKind : quint8 { RecordRequest = 1, RecordResponse = 2, RecordClose = 3 };
+
+// 下标即枚举值，0 收纳未知类型
+const char* const kRequestTypeNames[] = {
+    "unknown", "login", "flight_query", "book_ticket", "my_orders", "get_user_info", "update_user_info",
+    "cancel_ticket", "register", "change_ticket", "check_username", "get_cities", "get_occupied_seats",
+    "ai_chat", "change_password", "heartbeat", "handshake", "logout", "import_flights",
+};
+constexpr int kRequestTypes = int(sizeof(kRequestTypeNames) / sizeof(kRequestTypeNames[0]));
+
+const char* const kStatusNames[] = {
+    "success", "failed", "user_not_found", "password_error", "flight_not_found", "no_seats_left",
+    "username_exist", "route_not_match", "heartbeat_ack", "handshake_ack", "not_logged_in", "server_busy",
+    "not_modified", "permission_denied",
+};
+constexpr int kStatuses = int(sizeof(kStatusNames) / sizeof(kStatusNames[0]));
+
+const char* typeName(int type) {
+    return kRequestTypeNames[type > 0 && type < kRequestTypes ? type : 0];
+}
+
+std::string statusName(qint32 status) {
+    if (status >= 0 && status < kStatuses) return kStatusNames[status];
+    return std::to_string(status);
+}
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 12345;
+    double speed = 1.0;             // 0 为 max
+    int concurrency = 256;          // max 模式同时进行的连接数
+    int drainMs = 5000;             // 全部请求发出后等待剩余应答的时间
+    std::vector<std::string> files;
+};
+
+// 请求与关闭事件，时刻为相对抓取开始的微秒数
+struct Event {
+    qint64 at;
+    int conn;
+    bool close;
+    QByteArray payload;
+};
+
+struct Connection {
+    int fd = -1;
+    bool opened = false;
+    bool connected = false;
+    bool finished = false;
+    bool watchingWrite = true;
+    std::vector<int> events;        // 本连接的请求与关闭事件（下标），按时刻排序
+    size_t next = 0;                // 下一个待发送的事件
+    size_t due = 0;                 // 开环模式下已到计划时刻的事件数
+    std::deque<qint32> expected;    // 抓取时的应答状态，按写出顺序
+    struct InFlight {
+        int type;
+        Clock::time_point intended;
+    };
+    std::deque<InFlight> inflight;
+    QByteArray out;
+    qsizetype outOffset = 0;
+    QByteArray in;
+};
+
+struct TypeStats {
+    std::vector<quint32> latencies; // 微秒
+    quint64 matched = 0;
+    quint64 mismatched = 0;
+    quint64 noResponse = 0;
+};
+
+quint64 readVarint(const QByteArray& data, qsizetype& offset, bool& ok) {
+    quint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= data.size()) break;
+        const uchar byte = uchar(data[offset++]);
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    ok = false;
+    return 0;
+}
+
+struct CaptureFile {
+    std::string path;
+    qint64 startEpochMicros = 0;
+    qint64 baseMicros = 0;
+    QByteArray data;
+};
+
+bool loadFile(const std::string& path, CaptureFile& file) {
+    QFile f(QString::fromStdString(path));
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    file.path = path;
+    file.data = f.readAll();
+    if (file.data.size() < kHeaderBytes || !file.data.startsWith(kMagic)) return false;
+    file.startEpochMicros = qFromLittleEndian<qint64>(file.data.constData() + 8);
+    file.baseMicros = qFromLittleEndian<qint64>(file.data.constData() + 16);
+    return true;
+}
+
+class Replayer {
+public:
+    explicit Replayer(const Options& opt) : m_opt(opt) {}
+
+    bool load();
+    void run();
+    void report() const;
+
+private:
+    void parseFile(const CaptureFile& file, qint64 originEpochMicros);
+    void open(int index);
+    void fail(int index);
+    void finish(int index);
+    void pump(int index);
+    void watch(int index, bool writable);
+    void flush(int index);
+    void onReadable(int index);
+    void onResponse(int index, qint32 status);
+    Clock::time_point scheduled(qint64 at) const;
+
+    const Options& m_opt;
+    std::vector<Event> m_events;
+    std::vector<Connection> m_conns;
+    QHash<QPair<qint64, quint32>, int> m_connIndex;   // (抓取开始时刻, 连接号) -> 连接下标
+    qint64 m_captureMicros = 0;
+
+    int m_epoll = -1;
+    Clock::time_point m_start;
+    Clock::time_point m_lastProgress;   // 最近一次发出事件或收到应答的时刻
+    size_t m_cursor = 0;            // 开环：下一个未到时刻的事件；闭环：下一个未启动的连接
+    int m_active = 0;
+    int m_pendingFinish = 0;
+
+    TypeStats m_types[kRequestTypes];
+    std::map<std::string, quint64> m_mismatches;      // "类型:抓取状态->重放状态" -> 次数
+    std::vector<quint32> m_sendLag;                   // 开环：实际发送晚于计划的微秒数
+    quint64 m_sent = 0;
+    quint64 m_responses = 0;
+    quint64 m_unexpected = 0;       // 抓取中没有对应应答的重放应答
+    quint64 m_notSent = 0;          // 连接出错而未发出的请求
+    quint64 m_connectErrors = 0;
+    double m_elapsed = 0;
+};
+
+void Replayer::parseFile(const CaptureFile& file, qint64 originEpochMicros) {
+    const QByteArray& data = file.data;
+    qsizetype offset = kHeaderBytes;
+    qint64 at = (file.startEpochMicros - originEpochMicros) + file.baseMicros;
+    bool ok = true;
+    while (offset < data.size()) {
+        const quint8 kind = quint8(data[offset++]);
+        const quint32 connection = quint32(readVarint(data, offset, ok));
+        at += qint64(readVarint(data, offset, ok));
+        if (!ok) break;
+
+        const QPair<qint64, quint32> key(file.startEpochMicros, connection);
+        auto found = m_connIndex.constFind(key);
+        int index;
+        if (found == m_connIndex.constEnd()) {
+            index = int(m_conns.size());
+            m_conns.emplace_back();
+            m_connIndex.insert(key, index);
+        } else {
+            index = found.value();
+        }
+
+        if (kind == RecordRequest) {
+            const qsizetype size = qsizetype(readVarint(data, offset, ok));
+            if (!ok || size < 0 || offset + size > data.size()) {
+                ok = false;
+                break;
+            }
+            m_conns[index].events.push_back(int(m_events.size()));
+            m_events.push_back(Event{at, index, false, data.mid(offset, size)});
+            offset += size;
+        } else if (kind == RecordResponse) {
+            const qint32 status = qint32(quint32(readVarint(data, offset, ok)));
+            if (!ok) break;
+            m_conns[index].expected.push_back(status);
+        } else if (kind == RecordClose) {
+            m_conns[index].events.push_back(int(m_events.size()));
+            m_events.push_back(Event{at, index, true, QByteArray()});
+        } else {
+            ok = false;
+            break;
+        }
+        m_captureMicros = std::max(m_captureMicros, at);
+    }
+    if (!ok) std::fprintf(stderr, "%s：文件在偏移 %lld 处截断或损坏，之后的记录被忽略\n", file.path.c_str(),
+                          (long long)offset);
+}
+
+bool Replayer::load() {
+    std::vector<CaptureFile> files(m_opt.files.size());
+    for (size_t i = 0; i < m_opt.files.size(); ++i) {
+        if (!loadFile(m_opt.files[i], files[i])) {
+            std::fprintf(stderr, "无法读取抓取文件：%s\n", m_opt.files[i].c_str());
+            return false;
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const CaptureFile& a, const CaptureFile& b) {
+        return std::tie(a.startEpochMicros, a.baseMicros) < std::tie(b.startEpochMicros, b.baseMicros);
+    });
+    for (CaptureFile& file : files) {
+        parseFile(file, files.front().startEpochMicros);
+        file.data.clear();
+    }
+    // 多次抓取的文件一起传入时各自的时间轴首尾相接，按时刻重新排序并更新各连接的事件下标
+    std::vector<int> order(m_events.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = int(i);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return m_events[a].at < m_events[b].at; });
+    std::vector<Event> sorted;
+    sorted.reserve(m_events.size());
+    for (Connection& conn : m_conns) conn.events.clear();
+    for (int i : order) {
+        m_conns[m_events[i].conn].events.push_back(int(sorted.size()));
+        sorted.push_back(std::move(m_events[i]));
+    }
+    m_events.swap(sorted);
+    return !m_events.empty();
+}
+
+Clock::time_point Replayer::scheduled(qint64 at) const {
+    return m_start + std::chrono::microseconds(qint64(double(at) / m_opt.speed));
+}
+
+void Replayer::open(int index) {
+    Connection& conn = m_conns[index];
+    conn.opened = true;
+    ++m_active;
+    conn.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn.fd >= 0) {
+        int one = 1;
+        ::setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_opt.port);
+        ::inet_pton(AF_INET, m_opt.host.c_str(), &addr.sin_addr);
+        if (::connect(conn.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 || errno == EINPROGRESS) {
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+            event.data.u32 = quint32(index);
+            ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, conn.fd, &event);
+            return;
+        }
+    }
+    m_connectErrors++;
+    fail(index);
+}
+
+// 连接出错：已发出未应答的请求计为无应答，未发出的事件跳过
+void Replayer::fail(int index) {
+    Connection& conn = m_conns[index];
+    for (const Connection::InFlight& request : conn.inflight) {
+        m_types[request.type].noResponse++;
+    }
+    conn.inflight.clear();
+    for (; conn.next < conn.events.size(); ++conn.next) {
+        if (!m_events[conn.events[conn.next]].close) m_notSent++;
+    }
+    finish(index);
+}
+
+void Replayer::finish(int index) {
+    Connection& conn = m_conns[index];
+    if (conn.finished) return;
+    conn.finished = true;
+    for (const Connection::InFlight& request : conn.inflight) {
+        m_types[request.type].noResponse++;
+    }
+    conn.inflight.clear();
+    if (conn.fd >= 0) {
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, conn.fd, nullptr);
+        ::close(conn.fd);
+        conn.fd = -1;
+    }
+    --m_active;
+    --m_pendingFinish;
+}
+
+// 发送已到时刻的请求：开环不等待应答，闭环一次只有一个未应答请求；关闭事件等全部应答收齐后执行
+void Replayer::pump(int index) {
+    Connection& conn = m_conns[index];
+    if (conn.finished) return;
+    const bool closedLoop = m_opt.speed <= 0;
+    const size_t limit = closedLoop ? conn.events.size() : conn.due;
+    const Clock::time_point now = Clock::now();
+    while (conn.next < limit) {
+        const Event& event = m_events[conn.events[conn.next]];
+        if (event.close) {
+            if (!conn.inflight.empty()) break;
+            finish(index);
+            return;
+        }
+        if (closedLoop && !conn.inflight.empty()) break;
+
+        int type = 0;
+        if (event.payload.size() >= 4) type = qFromBigEndian<qint32>(event.payload.constData());
+        if (type <= 0 || type >= kRequestTypes) type = 0;
+        const Clock::time_point intended = closedLoop ? now : scheduled(event.at);
+        if (!closedLoop) {
+            m_sendLag.push_back(quint32(std::max<qint64>(
+                0, std::chrono::duration_cast<std::chrono::microseconds>(now - intended).count())));
+        }
+        char prefix[4];
+        qToBigEndian<quint32>(quint32(event.payload.size()), prefix);
+        conn.out.append(prefix, 4);
+        conn.out.append(event.payload);
+        conn.inflight.push_back(Connection::InFlight{type, intended});
+        m_sent++;
+        conn.next++;
+    }
+    // 抓取在连接关闭前结束时没有关闭事件，发完并收齐应答即算完成
+    if (conn.next == conn.events.size() && conn.inflight.empty() && conn.out.size() == conn.outOffset) {
+        finish(index);
+        return;
+    }
+    flush(index);
+}
+
+// 仅在有未发完的数据（或尚未建连）时关注可写事件，避免水平触发空转
+void Replayer::watch(int index, bool writable) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0);
+    event.data.u32 = quint32(index);
+    ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_conns[index].fd, &event);
+    m_conns[index].watchingWrite = writable;
+}
+
+void Replayer::flush(int index) {
+    Connection& conn = m_conns[index];
+    if (!conn.connected || conn.finished) return;
+    while (conn.outOffset < conn.out.size()) {
+        const ssize_t n = ::send(conn.fd, conn.out.constData() + conn.outOffset, conn.out.size() - conn.outOffset,
+                                 MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.outOffset += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!conn.watchingWrite) watch(index, true);
+            return;
+        } else {
+            fail(index);
+            return;
+        }
+    }
+    if (conn.watchingWrite) watch(index, false);
+    conn.out.clear();
+    conn.outOffset = 0;
+}
+
+void Replayer::onReadable(int index) {
+    Connection& conn = m_conns[index];
+    char buffer[65536];
+    bool closed = false;
+    for (;;) {
+        const ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            continue;
+        }
+        // 对端关闭前写出的应答仍在缓冲区中，先处理完再结束连接
+        closed = !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        break;
+    }
+
+    // 抓取中的握手可能协商了压缩，压缩帧为 qCompress 格式
+    qsizetype offset = 0;
+    while (!conn.finished && conn.in.size() - offset >= 4) {
+        const quint32 header = qFromBigEndian<quint32>(conn.in.constData() + offset);
+        const quint32 size = header & ~kFrameCompressedFlag;
+        if (conn.in.size() - offset < qsizetype(4 + size)) break;
+        QByteArray payload = conn.in.mid(offset + 4, size);
+        offset += 4 + size;
+        if (header & kFrameCompressedFlag) payload = qUncompress(payload);
+        if (payload.size() < 4) {
+            fail(index);
+            return;
+        }
+        onResponse(index, qFromBigEndian<qint32>(payload.constData()));
+    }
+    if (conn.finished) return;
+    conn.in.remove(0, offset);
+    if (closed) {
+        fail(index);
+        return;
+    }
+    pump(index);
+}
+
+void Replayer::onResponse(int index, qint32 status) {
+    Connection& conn = m_conns[index];
+    m_responses++;
+    m_lastProgress = Clock::now();
+    if (conn.inflight.empty()) {
+        m_unexpected++;
+        return;
+    }
+    const Connection::InFlight request = conn.inflight.front();
+    conn.inflight.pop_front();
+    TypeStats& stats = m_types[request.type];
+    stats.latencies.push_back(quint32(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - request.intended).count()));
+
+    if (conn.expected.empty()) {
+        m_unexpected++;
+        return;
+    }
+    const qint32 expected = conn.expected.front();
+    conn.expected.pop_front();
+    if (expected == status) {
+        stats.matched++;
+    } else {
+        stats.mismatched++;
+        m_mismatches[std::string(typeName(request.type)) + ":" + statusName(expected) + "->" + statusName(status)]++;
+    }
+}
+
+void Replayer::run() {
+    m_epoll = ::epoll_create1(0);
+    m_pendingFinish = int(m_conns.size());
+    // 请求全在未传入的文件中、只剩应答记录的连接无需重放
+    for (Connection& conn : m_conns) {
+        if (!conn.events.empty()) continue;
+        conn.finished = true;
+        --m_pendingFinish;
+    }
+    m_start = Clock::now();
+    m_lastProgress = m_start;
+    const bool closedLoop = m_opt.speed <= 0;
+    const auto drain = std::chrono::milliseconds(m_opt.drainMs);
+
+    std::vector<epoll_event> events(1024);
+    for (;;) {
+        const Clock::time_point now = Clock::now();
+        if (m_pendingFinish <= 0) break;
+
+        if (closedLoop) {
+            // 按连接首次出现的顺序启动，保持同时进行的连接数
+            while (m_active < m_opt.concurrency && m_cursor < m_conns.size()) {
+                const int index = int(m_cursor++);
+                if (m_conns[index].finished) continue;
+                m_lastProgress = now;
+                open(index);
+                pump(index);
+            }
+        } else {
+            while (m_cursor < m_events.size() && scheduled(m_events[m_cursor].at) <= now) {
+                const int index = m_events[m_cursor].conn;
+                Connection& conn = m_conns[index];
+                m_cursor++;
+                conn.due++;
+                m_lastProgress = now;
+                if (!conn.opened) open(index);
+                pump(index);
+            }
+        }
+        // 超过 --drain-ms 没有新应答即结束：开环在全部事件发出后判断（抓取中本就可能有长时间的空闲），
+        // 闭环随时判断（服务端停止应答时各连接都在等待）
+        if ((closedLoop || m_cursor == m_events.size()) && now - m_lastProgress > drain) break;
+
+        int timeoutMs = 10;
+        if (!closedLoop && m_cursor < m_events.size()) {
+            const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                scheduled(m_events[m_cursor].at) - Clock::now()).count();
+            timeoutMs = int(std::clamp<qint64>(wait, 0, 10));
+        }
+        const int ready = ::epoll_wait(m_epoll, events.data(), int(events.size()), timeoutMs);
+        for (int i = 0; i < ready; ++i) {
+            const int index = int(events[i].data.u32);
+            Connection& conn = m_conns[index];
+            if (conn.finished) continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                if (!conn.connected) m_connectErrors++;
+                fail(index);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !conn.connected) {
+                conn.connected = true;
+                pump(index);
+                if (conn.finished) continue;
+            }
+            if (events[i].events & EPOLLOUT) flush(index);
+            if (!conn.finished && (events[i].events & (EPOLLIN | EPOLLRDHUP))) onReadable(index);
+        }
+    }
+
+    // 超过等待时间仍未完成的连接：剩余请求计为无应答或未发出
+    for (size_t i = 0; i < m_conns.size(); ++i) {
+        if (!m_conns[i].finished) fail(int(i));
+    }
+    ::close(m_epoll);
+    m_elapsed = std::chrono::duration<double>(Clock::now() - m_start).count();
+}
+
+double percentileMs(std::vector<quint32> values, double p) {
+    if (values.empty()) return 0.0;
+    const size_t index = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+void Replayer::report() const {
+    quint64 matched = 0;
+    quint64 mismatched = 0;
+    quint64 noResponse = 0;
+    std::string requests;
+    for (int i = 0; i < kRequestTypes; ++i) {
+        const TypeStats& stats = m_types[i];
+        matched += stats.matched;
+        mismatched += stats.mismatched;
+        noResponse += stats.noResponse;
+        if (stats.latencies.empty() && stats.noResponse == 0) continue;
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "%s\"%s\":{\"count\":%zu,\"matched\":%llu,\"mismatched\":%llu,\"no_response\":%llu,"
+                      "\"p50_ms\":%.2f,\"p99_ms\":%.2f,\"max_ms\":%.2f}",
+                      requests.empty() ? "" : ",", kRequestTypeNames[i], stats.latencies.size(),
+                      (unsigned long long)stats.matched, (unsigned long long)stats.mismatched,
+                      (unsigned long long)stats.noResponse, percentileMs(stats.latencies, 0.50),
+                      percentileMs(stats.latencies, 0.99), percentileMs(stats.latencies, 1.0));
+        requests += line;
+    }
+    std::string mismatches;
+    for (const auto& [key, count] : m_mismatches) {
+        mismatches += (mismatches.empty() ? "\"" : ",\"") + key + "\":" + std::to_string(count);
+    }
+
+    char speed[32];
+    if (m_opt.speed > 0) std::snprintf(speed, sizeof(speed), "%g", m_opt.speed);
+    else std::snprintf(speed, sizeof(speed), "\"max\"");
+    std::printf("{\"speed\":%s,\"connections\":%zu,\"capture_seconds\":%.3f,\"seconds\":%.3f,\"sent\":%llu,"
+                "\"responses\":%llu,\"matched\":%llu,\"mismatched\":%llu,\"no_response\":%llu,\"unexpected\":%llu,"
+                "\"not_sent\":%llu,\"connect_errors\":%llu,\"send_lag_p99_ms\":%.2f,\"requests\":{%s},"
+                "\"mismatches\":{%s}}\n",
+                speed, m_conns.size(), m_captureMicros / 1e6, m_elapsed, (unsigned long long)m_sent,
+                (unsigned long long)m_responses, (unsigned long long)matched, (unsigned long long)mismatched,
+                (unsigned long long)noResponse, (unsigned long long)m_unexpected, (unsigned long long)m_notSent,
+                (unsigned long long)m_connectErrors, percentileMs(m_sendLag, 0.99), requests.c_str(),
+                mismatches.c_str());
+}
+
+bool parseOptions(int argc, char* argv[], Options& opt) {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (arg == "--host") opt.host = value();
+        else if (arg == "--port") opt.port = std::atoi(value());
+        else if (arg == "--speed") {
+            const std::string speed = value();
+            opt.speed = speed == "max" ? 0.0 : std::atof(speed.c_str());
+            if (speed != "max" && opt.speed <= 0) ok = false;
+        }
+        else if (arg == "--concurrency") opt.concurrency = std::atoi(value());
+        else if (arg == "--drain-ms") opt.drainMs = std::atoi(value());
+        else if (arg.rfind("--", 0) == 0) ok = false;
+        else opt.files.push_back(arg);
+    }
+    if (!ok || opt.files.empty()) {
+        std::fprintf(stderr,
+                     "用法: %s [--host H] [--port P] [--speed 倍数|max] [--concurrency N] [--drain-ms MS] 抓取文件...\n",
+                     argv[0]);
+        return false;
+    }
+    opt.concurrency = std::max(1, opt.concurrency);
+    opt.drainMs = std::max(0, opt.drainMs);
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) return 1;
+
+    Replayer replayer(opt);
+    if (!replayer.load()) {
+        std::fprintf(stderr, "抓取文件中没有可重放的请求\n");
+        return 1;
+    }
+    replayer.run();
+    replayer.report();
+    return 0;
+}